@@ -0,0 +1,84 @@
+// AllocationBench.cpp  -  Report the heap allocations of library entry 
+//                         points on a typical workload
+//
+// Usage:  AllocationBench [number-of-specimens [cells-per-specimen]]
+//
+// The library and this program must be built with YOSOKUMO_ALLOC_TRACKING
+// defined (see makefile.inc); otherwise nothing is counted.
+
+#include "AllocationTracker.h"
+#include "Catalog.h"
+#include "NaturalValue.h"
+#include "RealValue.h"
+#include "SpecimenBlock.h"
+#include "YosokumoProtobuf.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+using namespace Yosokumo;
+
+int main(int argc, char **argv)
+{
+    unsigned nSpecimens = (argc > 1) ? atoi(argv[1]) : 1000;
+    unsigned nCells     = (argc > 2) ? atoi(argv[2]) : 20;
+
+    if (!AllocationTracker::isEnabled())
+    {
+        printf("Allocation tracking is not built in:  "
+               "build with YOSOKUMO_ALLOC_TRACKING\n");
+        return 1;
+    }
+
+    // Specimens:  build, copy, encode, and decode a block
+
+    std::vector<Specimen> specimens(nSpecimens);
+    SpecimenBlock block("bench-study");
+
+    for (unsigned i = 0;  i < nSpecimens;  ++i)
+    {
+        Specimen s(i + 1);
+        s.setPredictand(RealValue(i / 10.0));
+        for (unsigned j = 0;  j < nCells;  ++j)
+            s.addCell(Cell(j + 1, NaturalValue(j % 8)));
+        specimens[i] = s;
+        block.addSpecimen(&specimens[i]);
+    }
+
+    YosokumoProtobuf dif;
+    std::vector<uint8_t> bytes;
+    dif.makeBytesFromBlock(block, bytes);
+
+    Block decoded;
+    dif.makeBlockFromBytes(bytes, decoded);
+
+    // Catalogs:  encode, decode, and copy
+
+    Catalog catalog("USER-ID", "User");
+    for (unsigned i = 0;  i < 100;  ++i)
+    {
+        std::stringstream id;
+        id << "STUDY-" << i;
+        Study study;
+        study.setStudyIdentifier(id.str());
+        study.setStudyName("Study " + id.str());
+        catalog.addStudy(study);
+    }
+
+    dif.makeBytesFromCatalog(catalog, bytes);
+    Catalog copy;
+    dif.makeCatalogFromBytes(bytes, copy);
+    copy = catalog;
+
+    printf("%u specimens of %u cells; catalog of 100 studies\n\n",
+                                                        nSpecimens, nCells);
+    AllocationTracker::report(std::cout);
+
+    return 0;
+}
+
+// end AllocationBench.cpp
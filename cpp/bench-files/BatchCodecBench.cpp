@@ -0,0 +1,118 @@
+// BatchCodecBench.cpp  -  Measure how batch encoding and decoding of blocks
+//                         scale with the number of workers
+//
+// Usage:  BatchCodecBench [number-of-blocks [specimens-per-block]]
+
+#include "BatchCodec.h"
+#include "CellBlock.h"
+#include "NaturalValue.h"
+#include "RealValue.h"
+#include "SpecimenBlock.h"
+#include "WorkStealingPool.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <vector>
+
+using namespace Yosokumo;
+
+// Return a monotonic time in seconds
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned nBlocks    = (argc > 1) ? atoi(argv[1]) : 10000;
+    unsigned nSpecimens = (argc > 2) ? atoi(argv[2]) : 20;
+    unsigned nCells     = 10;
+
+    srand(12345);
+
+    // Blocks like the ones real users post; the specimens are shared by all
+    // the blocks, which only point to them
+
+    std::vector<Specimen> specimens(nSpecimens);
+    for (unsigned i = 0;  i < nSpecimens;  ++i)
+    {
+        Specimen &s = specimens[i];
+        s.setSpecimenKey(i + 1);
+        s.setPredictand(RealValue((rand() % 1000) / 10.0));
+
+        for (unsigned j = 0;  j < nCells;  ++j)
+            s.addCell(Cell(1 + rand() % 50, NaturalValue(rand() % 8)));
+    }
+
+    std::vector<SpecimenBlock *> owned;
+    std::vector<const Block *>   blocks;
+    std::vector<CellBlock *>     decoded;
+    std::vector<Block *>         out;
+    for (unsigned i = 0;  i < nBlocks;  ++i)
+    {
+        owned.push_back(new SpecimenBlock("bench-study"));
+        for (unsigned j = 0;  j < nSpecimens;  ++j)
+            owned.back()->addSpecimen(&specimens[j]);
+        blocks.push_back(owned.back());
+
+        decoded.push_back(new CellBlock);
+        out.push_back(decoded.back());
+    }
+
+    unsigned maxWorkers = WorkStealingPool::getProcessorCount();
+
+    printf("%u blocks of %u specimens, %u processors\n", nBlocks, nSpecimens,
+                                                                maxWorkers);
+    printf("%-8s %12s %9s %12s %9s\n", "workers", "encode ms", "speedup",
+                                                    "decode ms", "speedup");
+
+    double encode1 = 0, decode1 = 0;
+    bool   ok      = true;
+
+    for (unsigned n = 1;  n <= maxWorkers;  n = (n < maxWorkers && 2 * n >
+                                            maxWorkers) ? maxWorkers : 2 * n)
+    {
+        WorkStealingPool pool(n);
+        BatchCodec codec(pool);
+        std::vector<std::vector<uint8_t> > bytes;
+        std::vector<ServiceException>      exceptions;
+
+        double t = now();
+        ok = codec.encodeBlocks(blocks, bytes, exceptions) && ok;
+        double encodeSecs = now() - t;
+
+        t = now();
+        ok = codec.decodeBlocks(bytes, out, exceptions) && ok;
+        double decodeSecs = now() - t;
+
+        if (n == 1)
+        {
+            encode1 = encodeSecs;
+            decode1 = decodeSecs;
+        }
+
+        printf("%-8u %12.1f %8.2fx %12.1f %8.2fx\n", n, encodeSecs * 1e3,
+                encode1 / encodeSecs, decodeSecs * 1e3, decode1 / decodeSecs);
+    }
+
+    for (unsigned i = 0;  i < nBlocks;  ++i)
+    {
+        delete owned[i];
+        delete decoded[i];
+    }
+
+    if (!ok)
+    {
+        printf("a batch failed\n");
+        return 1;
+    }
+
+    return 0;
+}
+
+// end BatchCodecBench.cpp
@@ -0,0 +1,84 @@
+// BlockDecodeBench.cpp  -  Measure how decoding one large block of
+//                          specimens scales with the number of workers
+//
+// Usage:  BlockDecodeBench [number-of-specimens]
+
+#include "CellBlock.h"
+#include "RealValue.h"
+#include "WorkStealingPool.h"
+#include "YosokumoProtobuf.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <vector>
+
+using namespace Yosokumo;
+
+// Return a monotonic time in seconds
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned n = (argc > 1) ? atoi(argv[1]) : 500000;
+
+    // A block of cells is encoded as a block of specimens, as a large
+    // download of predictions would be
+
+    srand(12345);
+
+    CellBlock cblock("bench-study");
+    for (unsigned i = 0;  i < n;  ++i)
+        cblock.addCell(Cell(i + 1, RealValue((rand() % 1000) / 10.0)));
+
+    YosokumoProtobuf dif;
+    std::vector<uint8_t> bytes;
+    if (!dif.makeBytesFromBlock(cblock, bytes))
+    {
+        printf("encoding failed\n");
+        return 1;
+    }
+
+    unsigned maxWorkers = WorkStealingPool::getProcessorCount();
+
+    printf("%u specimens, %lu bytes, %u processors\n", n,
+                                    (unsigned long)bytes.size(), maxWorkers);
+    printf("%-8s %12s %9s\n", "workers", "decode ms", "speedup");
+
+    Block block;
+
+    double t = now();
+    bool ok = dif.makeBlockFromBytes(bytes, block);
+    double serialSecs = now() - t;
+
+    printf("%-8s %12.1f %8.2fx\n", "serial", serialSecs * 1e3, 1.0);
+
+    for (unsigned w = 2;  w <= maxWorkers;  w = (w < maxWorkers && 2 * w >
+                                            maxWorkers) ? maxWorkers : 2 * w)
+    {
+        WorkStealingPool pool(w);
+
+        t = now();
+        ok = dif.makeBlockFromBytes(bytes, block, pool) && ok;
+        double secs = now() - t;
+
+        printf("%-8u %12.1f %8.2fx\n", w, secs * 1e3, serialSecs / secs);
+    }
+
+    if (!ok || block.getItemCount() != n)
+    {
+        printf("decoding failed\n");
+        return 1;
+    }
+
+    return 0;
+}
+
+// end BlockDecodeBench.cpp
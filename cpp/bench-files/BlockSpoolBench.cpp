@@ -0,0 +1,168 @@
+// BlockSpoolBench.cpp  -  Measure the cost of durability:  blocks queued in
+//                         memory, against blocks appended to a BlockSpool
+//                         with and without a commit after each
+//
+// Usage:  BlockSpoolBench [blocks-per-thread [specimens-per-block [path]]]
+
+#include "BlockSpool.h"
+#include "Mutex.h"
+#include "NaturalValue.h"
+#include "RealValue.h"
+#include "SpecimenBlock.h"
+#include "Thread.h"
+#include "YosokumoProtobuf.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <deque>
+#include <vector>
+
+using namespace Yosokumo;
+
+// Return a monotonic time in seconds
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+enum Mode { MEMORY, SPOOL, DURABLE };
+
+static const char *modeNames[] = { "memory", "spool", "durable" };
+
+// The in-memory outbox:  what a process without a spool keeps
+
+static Mutex                              queueMutex;
+static std::deque<std::vector<uint8_t> > queue;
+
+class Producer : public Thread
+{
+    Mode                       mode;
+    BlockSpool                 &spool;
+    const std::vector<uint8_t> &bytes;
+    unsigned                   count;
+
+public:
+
+    bool ok;
+
+    Producer(
+        Mode                       mode,
+        BlockSpool                 &spool,
+        const std::vector<uint8_t> &bytes,
+        unsigned                   count) :
+            mode(mode), spool(spool), bytes(bytes), count(count), ok(true)
+    {}
+
+protected:
+
+    void run()
+    {
+        for (unsigned i = 0;  i < count;  ++i)
+        {
+            if (mode == MEMORY)
+            {
+                ScopedLock lock(queueMutex);
+                queue.push_back(bytes);
+                continue;
+            }
+
+            uint64_t ticket;
+            ok = spool.append("/table/1", bytes, ticket) && ok;
+            if (mode == DURABLE)
+                ok = spool.commit(ticket) && ok;
+        }
+    }
+};
+
+int main(int argc, char **argv)
+{
+    unsigned    nBlocks    = (argc > 1) ? atoi(argv[1]) : 2000;
+    unsigned    nSpecimens = (argc > 2) ? atoi(argv[2]) : 20;
+    std::string path       = (argc > 3) ? argv[3] : "BlockSpoolBench.spool";
+    unsigned    nCells     = 10;
+
+    srand(12345);
+
+    std::vector<Specimen> specimens(nSpecimens);
+    SpecimenBlock block("bench-study");
+    for (unsigned i = 0;  i < nSpecimens;  ++i)
+    {
+        Specimen &s = specimens[i];
+        s.setSpecimenKey(i + 1);
+        s.setPredictand(RealValue((rand() % 1000) / 10.0));
+
+        for (unsigned j = 0;  j < nCells;  ++j)
+            s.addCell(Cell(1 + rand() % 50, NaturalValue(rand() % 8)));
+
+        block.addSpecimen(&specimens[i]);
+    }
+
+    std::vector<uint8_t> bytes;
+    YosokumoProtobuf dif;
+    dif.makeBytesFromBlock(block, bytes);
+
+    printf("%u blocks of %u bytes per thread, spool %s\n", nBlocks,
+                                        unsigned(bytes.size()), path.c_str());
+    printf("%-8s %-8s %12s %12s %10s\n", "mode", "threads", "blocks/s",
+                                                        "MB/s", "syncs");
+
+    bool ok = true;
+
+    for (int m = MEMORY;  m <= DURABLE;  ++m)
+    {
+        for (unsigned nThreads = 1;  nThreads <= 8;  nThreads *= 2)
+        {
+            unlink(path.c_str());
+            queue.clear();
+
+            // Big enough for every record, so nothing is posted meanwhile
+
+            BlockSpool spool;
+            if (m != MEMORY && !spool.open(path, uint64_t(nBlocks) *
+                                    nThreads * (bytes.size() + 64) + 8192))
+            {
+                printf("%s\n", spool.getException().what());
+                return 1;
+            }
+
+            std::vector<Producer *> producers;
+            for (unsigned i = 0;  i < nThreads;  ++i)
+                producers.push_back(new Producer(Mode(m), spool, bytes,
+                                                                    nBlocks));
+
+            double t = now();
+            for (unsigned i = 0;  i < nThreads;  ++i)
+                producers[i]->start();
+            for (unsigned i = 0;  i < nThreads;  ++i)
+            {
+                producers[i]->join();
+                ok = producers[i]->ok && ok;
+                delete producers[i];
+            }
+            double secs = now() - t;
+
+            double total = double(nBlocks) * nThreads;
+            printf("%-8s %-8u %12.0f %12.1f %10lu\n", modeNames[m], nThreads,
+                            total / secs, total * bytes.size() / secs / 1e6,
+                            (unsigned long)spool.getSyncCount());
+        }
+    }
+
+    unlink(path.c_str());
+
+    if (!ok)
+    {
+        printf("an append or commit failed\n");
+        return 1;
+    }
+
+    return 0;
+}
+
+// end BlockSpoolBench.cpp
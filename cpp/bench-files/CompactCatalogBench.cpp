@@ -0,0 +1,137 @@
+// CompactCatalogBench.cpp  -  Compare the memory and lookup time of a
+//                             Catalog and a CompactCatalog
+//
+// Usage:  CompactCatalogBench [number-of-studies [number-of-lookups]]
+
+#include "CompactStudy.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sstream>
+#include <vector>
+
+using namespace Yosokumo;
+
+// Return a monotonic time in seconds
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Return the resident size of this process in bytes, or 0 if unknown
+
+static double residentBytes()
+{
+    FILE *f = fopen("/proc/self/statm", "r");
+    if (f == NULL)
+        return 0;
+
+    unsigned long size = 0, resident = 0;
+    if (fscanf(f, "%lu %lu", &size, &resident) != 2)
+        resident = 0;
+    fclose(f);
+
+    return double(resident) * sysconf(_SC_PAGESIZE);
+}
+
+static std::string studyIdentifier(unsigned i)
+{
+    std::stringstream id;
+    id << "5F3A" << 100000000 + i;
+    return id.str();
+}
+
+// A study as the server sends it
+
+static Study makeStudy(unsigned i)
+{
+    std::string id   = studyIdentifier(i);
+    std::string base = "https://api.yosokumo.com/v1";
+
+    Study study("Study " + id, Study::NUMBER, Study::RUNNING, Study::PRIVATE);
+    study.setStudyIdentifier(id);
+    study.setStudyLocation(base + "/study/" + id);
+    study.setOwnerIdentifier("1F2E3D4C5B6A7980");
+    study.setOwnerName("Bench User");
+    study.setTableLocation(base + "/table/" + id);
+    study.setModelLocation(base + "/model/" + id);
+    study.setPanelLocation(base + "/panel/" + id);
+    study.setRosterLocation(base + "/roster/" + id);
+    study.setNameControlLocation(base + "/control/name/" + id);
+    study.setStatusControlLocation(base + "/control/status/" + id);
+    study.setVisibilityControlLocation(base + "/control/visibility/" + id);
+    study.setBlockCount(i);
+    study.setCellCount(100 * i);
+    study.setProspectCount(10 * i);
+    study.setCreationTime("2012-01-31T23:59:59Z");
+    study.setLatestBlockTime("2012-02-29T10:00:00Z");
+    study.setLatestProspectTime("2012-03-01T08:30:00Z");
+
+    return study;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned nStudies = (argc > 1) ? atoi(argv[1]) : 50000;
+    unsigned nLookups = (argc > 2) ? atoi(argv[2]) : 10000;
+
+    srand(12345);
+
+    std::vector<std::string> lookups;
+    for (unsigned i = 0;  i < nLookups;  ++i)
+        lookups.push_back(studyIdentifier(rand() % nStudies));
+
+    printf("%u studies, %u lookups, sizeof Study %u, sizeof CompactStudy "
+            "%u\n", nStudies, nLookups, unsigned(sizeof(Study)),
+            unsigned(sizeof(CompactStudy)));
+    printf("%-8s %14s %12s\n", "catalog", "resident MB", "lookup ms");
+
+    // Each catalog is built a study at a time, as a decoder builds it
+
+    bool ok = true;
+    Study study;
+
+    double r = residentBytes();
+    CompactCatalog compact;
+    for (unsigned i = 0;  i < nStudies;  ++i)
+        compact.addStudy(makeStudy(i));
+    double resident = residentBytes() - r;
+
+    double t = now();
+    for (unsigned i = 0;  i < nLookups;  ++i)
+        ok = compact.getStudy(lookups[i], study) && ok;
+    double lookupSecs = now() - t;
+
+    printf("%-8s %14.1f %12.2f\n", "compact", resident / 1e6,
+                                                        lookupSecs * 1e3);
+
+    r = residentBytes();
+    Catalog catalog;
+    for (unsigned i = 0;  i < nStudies;  ++i)
+        catalog.addStudy(makeStudy(i));
+    resident = residentBytes() - r;
+
+    t = now();
+    for (unsigned i = 0;  i < nLookups;  ++i)
+        ok = catalog.getStudy(lookups[i], study) && ok;
+    lookupSecs = now() - t;
+
+    printf("%-8s %14.1f %12.2f\n", "study", resident / 1e6,
+                                                        lookupSecs * 1e3);
+
+    if (!ok)
+    {
+        printf("a lookup failed\n");
+        return 1;
+    }
+
+    return 0;
+}
+
+// end CompactCatalogBench.cpp
@@ -0,0 +1,138 @@
+// CompressionBench.cpp  -  Measure wire bytes against CPU time for the 
+//                          content codings, on generated specimen blocks
+//
+// Usage:  CompressionBench [number-of-specimens [cells-per-specimen]]
+
+#include "Compression.h"
+#include "NaturalValue.h"
+#include "RealValue.h"
+#include "SpecimenBlock.h"
+#include "YosokumoProtobuf.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <vector>
+
+using namespace Yosokumo;
+
+// Return a monotonic time in seconds
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Make a block like the ones real users post:  predictor keys drawn from a
+// small set, small natural values, and a real predictand
+
+static void makeBlockBytes(
+    unsigned             nSpecimens,
+    unsigned             nCells,
+    std::vector<uint8_t> &bytes)
+{
+    srand(12345);
+
+    std::vector<Specimen> specimens(nSpecimens);
+    SpecimenBlock block("bench-study");
+
+    for (unsigned i = 0;  i < nSpecimens;  ++i)
+    {
+        Specimen &s = specimens[i];
+        s.setSpecimenKey(i + 1);
+        s.setPredictand(RealValue((rand() % 1000) / 10.0));
+
+        for (unsigned j = 0;  j < nCells;  ++j)
+            s.addCell(Cell(1 + rand() % 50, NaturalValue(rand() % 8)));
+
+        block.addSpecimen(&s);
+    }
+
+    YosokumoProtobuf dif;
+    dif.makeBytesFromBlock(block, bytes);
+}
+
+static void measure(
+    Compression::Coding        coding,
+    int                        level,
+    const std::vector<uint8_t> &raw)
+{
+    Compressor compressor(coding, level);
+    std::vector<uint8_t> packed, unpacked;
+
+    // Repeat until about half a second has passed, to steady the timing
+
+    unsigned reps = 0;
+    double start = now(), elapsed;
+    do
+    {
+        if (!compressor.compress(raw, packed))
+        {
+            printf("%-5s %5d  %s\n", Compression::getCodingName(coding).c_str(),
+                                level, compressor.getException().what());
+            return;
+        }
+        ++reps;
+    } while ((elapsed = now() - start) < 0.5);
+    double compressSecs = elapsed / reps;
+
+    reps  = 0;
+    start = now();
+    do
+    {
+        unpacked.clear();
+        Decompressor decompressor;
+        decompressor.start(coding);
+        decompressor.update(&packed[0], packed.size(), unpacked);
+        decompressor.finish();
+        ++reps;
+    } while ((elapsed = now() - start) < 0.5);
+    double decompressSecs = elapsed / reps;
+
+    if (unpacked != raw)
+        printf("%-5s %5d  ROUND TRIP FAILED\n", 
+                    Compression::getCodingName(coding).c_str(), level);
+
+    double mb = raw.size() / 1e6;
+    printf("%-8s %5d %12lu %8.2f %12.1f %12.1f\n",
+                    Compression::getCodingName(coding).c_str(),
+                    compressor.getLevel(),
+                    (unsigned long)packed.size(),
+                    double(raw.size()) / packed.size(),
+                    mb / compressSecs,
+                    mb / decompressSecs);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned nSpecimens = (argc > 1) ? atoi(argv[1]) : 10000;
+    unsigned nCells     = (argc > 2) ? atoi(argv[2]) : 20;
+
+    std::vector<uint8_t> raw;
+    makeBlockBytes(nSpecimens, nCells, raw);
+
+    printf("%u specimens, %u cells each:  %lu bytes uncompressed\n\n",
+                        nSpecimens, nCells, (unsigned long)raw.size());
+    printf("%-8s %5s %12s %8s %12s %12s\n", "coding", "level", 
+                "wire bytes", "ratio", "comp MB/s", "decomp MB/s");
+
+    int gzipLevels[] = { 1, 3, 6, 9 };
+    for (unsigned i = 0;  i < sizeof(gzipLevels) / sizeof(int);  ++i)
+        measure(Compression::GZIP, gzipLevels[i], raw);
+
+    if (Compression::isAvailable(Compression::ZSTD))
+    {
+        int zstdLevels[] = { 1, 3, 9, 19 };
+        for (unsigned i = 0;  i < sizeof(zstdLevels) / sizeof(int);  ++i)
+            measure(Compression::ZSTD, zstdLevels[i], raw);
+    }
+    else
+        printf("(zstd not available:  build with YOSOKUMO_HAVE_ZSTD)\n");
+
+    return 0;
+}
+
+// end CompressionBench.cpp
@@ -0,0 +1,120 @@
+// FingerprintBench.cpp  -  Compare comparing and hashing model objects by
+//                          walking them with using their fingerprints
+//
+// Usage:  FingerprintBench [number-of-studies [number-of-specimens]]
+
+#include "Hash.h"
+#include "NaturalValue.h"
+#include "Study.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <set>
+#include <sstream>
+#include <vector>
+
+using namespace Yosokumo;
+
+// Return a monotonic time in seconds
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static Study makeStudy(unsigned i, const std::string &latestProspectTime)
+{
+    std::stringstream s;
+    s << "5F3A" << 100000000 + i;
+    std::string id   = s.str();
+    std::string base = "https://api.yosokumo.com/v1";
+
+    Study study("Study " + id, Study::NUMBER, Study::RUNNING, Study::PRIVATE);
+    study.setStudyIdentifier(id);
+    study.setStudyLocation(base + "/study/" + id);
+    study.setTableLocation(base + "/table/" + id);
+    study.setModelLocation(base + "/model/" + id);
+    study.setPanelLocation(base + "/panel/" + id);
+    study.setRosterLocation(base + "/roster/" + id);
+    study.setBlockCount(i);
+    study.setCreationTime("2012-01-31T23:59:59Z");
+    study.setLatestProspectTime(latestProspectTime);
+
+    return study;
+}
+
+// A specimen of 50 cells; specimens i and i + n / 2 have the same cells
+
+static Specimen makeSpecimen(unsigned i, unsigned n)
+{
+    Specimen specimen(i);
+    unsigned seed = i % (n / 2);
+
+    for (unsigned k = 0;  k < 50;  ++k)
+        specimen.addCell(Cell(k + 1, NaturalValue(seed * 31 + k)));
+
+    return specimen;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned nStudies   = (argc > 1) ? atoi(argv[1]) : 50000;
+    unsigned nSpecimens = (argc > 2) ? atoi(argv[2]) : 100000;
+
+    // Studies which differ only in their last attribute, as when a refresh
+    // compares a catalog with the one before it
+
+    std::vector<Study> before, after;
+    for (unsigned i = 0;  i < nStudies;  ++i)
+    {
+        before.push_back(makeStudy(i, "2012-03-01T08:30:00Z"));
+        after .push_back(makeStudy(i, "2012-03-01T08:30:01Z"));
+    }
+
+    printf("%u studies, %u specimens\n", nStudies, nSpecimens);
+    printf("%-36s %10s %8s\n", "", "ms", "count");
+
+    double t = now();
+    unsigned changed = 0;
+    for (unsigned i = 0;  i < nStudies;  ++i)
+        changed += (before[i].getChangedFields(after[i]) != 0);
+    printf("%-36s %10.2f %8u\n", "studies changed, walking",
+                                                (now() - t) * 1e3, changed);
+
+    t = now();
+    changed = 0;
+    for (unsigned i = 0;  i < nStudies;  ++i)
+        changed += (before[i] != after[i]);
+    printf("%-36s %10.2f %8u\n", "studies changed, by fingerprint",
+                                                (now() - t) * 1e3, changed);
+
+    // Specimens, half of them duplicates
+
+    std::vector<Specimen> specimens;
+    for (unsigned i = 0;  i < nSpecimens;  ++i)
+        specimens.push_back(makeSpecimen(i, nSpecimens));
+
+    std::set<uint64_t> seen;
+
+    t = now();
+    for (unsigned i = 0;  i < nSpecimens;  ++i)
+        seen.insert(hashSpecimenContent(HASH_SEED, specimens[i]));
+    printf("%-36s %10.2f %8u\n", "distinct specimens, walking",
+                                    (now() - t) * 1e3, unsigned(seen.size()));
+
+    seen.clear();
+
+    t = now();
+    for (unsigned i = 0;  i < nSpecimens;  ++i)
+        seen.insert(specimens[i].getContentFingerprint());
+    printf("%-36s %10.2f %8u\n", "distinct specimens, by fingerprint",
+                                    (now() - t) * 1e3, unsigned(seen.size()));
+
+    return 0;
+}
+
+// end FingerprintBench.cpp
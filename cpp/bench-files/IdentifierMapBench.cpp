@@ -0,0 +1,190 @@
+// IdentifierMapBench.cpp  -  Compare the study collection of a catalog, an
+//                            IdentifierMap, against the std::map it replaced
+//
+// Usage:  IdentifierMapBench [number-of-studies]
+
+#include "IdentifierMap.h"
+#include "Study.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace Yosokumo;
+
+// Return a monotonic time in seconds
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Make identifiers like the service's:  16 hex digits, in random order
+
+static void makeIdentifiers(unsigned n, std::vector<std::string> &ids)
+{
+    srand(12345);
+
+    ids.clear();
+    for (unsigned i = 0;  i < n;  ++i)
+    {
+        char id[17];
+        snprintf(id, sizeof(id), "%08X%08X", unsigned(rand()), i);
+        ids.push_back(id);
+    }
+}
+
+static Study makeStudy(const std::string &id)
+{
+    Study study("bench study", Study::NUMBER, Study::RUNNING, Study::PRIVATE);
+    study.setStudyIdentifier(id);
+    return study;
+}
+
+static void report(const char *what, double mapSecs, double indexSecs,
+                                                                    unsigned n)
+{
+    printf("%-10s %12.1f %12.1f %8.2fx\n", what, mapSecs / n * 1e9,
+                            indexSecs / n * 1e9, mapSecs / indexSecs);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned n = (argc > 1) ? atoi(argv[1]) : 50000;
+
+    std::vector<std::string> ids, lookupIds;
+    makeIdentifiers(n, ids);
+
+    // Look up in an order unrelated to the order of adding
+
+    lookupIds = ids;
+    for (unsigned i = n - 1;  i > 0;  --i)
+        std::swap(lookupIds[i], lookupIds[rand() % (i + 1)]);
+
+    typedef std::map<std::string, Study> StudyMap;
+    StudyMap map1, map2;
+    IdentifierMap<Study> index1, index2;
+    double t, mapSecs, indexSecs;
+
+    printf("%u studies\n", n);
+    printf("%-10s %12s %12s %9s\n", "operation", "map ns/op", "index ns/op",
+                                                                    "speedup");
+
+    // Add
+
+    t = now();
+    for (unsigned i = 0;  i < n;  ++i)
+        map1.insert(std::make_pair(ids[i], makeStudy(ids[i])));
+    mapSecs = now() - t;
+
+    t = now();
+    for (unsigned i = 0;  i < n;  ++i)
+        index1.insert(Identifier(ids[i]), makeStudy(ids[i]));
+    indexSecs = now() - t;
+
+    report("add", mapSecs, indexSecs, n);
+
+    // Find
+
+    unsigned found = 0;
+
+    t = now();
+    for (unsigned i = 0;  i < n;  ++i)
+        found += (map1.find(lookupIds[i]) != map1.end());
+    mapSecs = now() - t;
+
+    t = now();
+    for (unsigned i = 0;  i < n;  ++i)
+        found += (index1.find(lookupIds[i]) != NULL);
+    indexSecs = now() - t;
+
+    report("find", mapSecs, indexSecs, n);
+
+    // Find by interned identifier, as when following a role to its study
+
+    std::vector<Identifier> lookupHandles;
+    for (unsigned i = 0;  i < n;  ++i)
+        lookupHandles.push_back(Identifier(lookupIds[i]));
+
+    t = now();
+    for (unsigned i = 0;  i < n;  ++i)
+        found += (index1.find(lookupHandles[i]) != NULL);
+    indexSecs = now() - t;
+
+    report("find (id)", mapSecs, indexSecs, n);
+
+    // Equality, the way Catalog::operator== used to do it (walk one map and
+    // look up in the other) against IdentifierMap::operator==
+
+    for (unsigned i = 0;  i < n;  ++i)
+    {
+        map2.insert(std::make_pair(lookupIds[i], makeStudy(lookupIds[i])));
+        index2.insert(Identifier(lookupIds[i]), makeStudy(lookupIds[i]));
+    }
+
+    bool equal = true;
+
+    t = now();
+    for (StudyMap::const_iterator it = map1.begin();  it != map1.end();  ++it)
+    {
+        StudyMap::const_iterator other = map2.find(it->first);
+        if (other == map2.end() || other->second != it->second)
+            equal = false;
+    }
+    mapSecs = now() - t;
+
+    t = now();
+    equal = equal && (index1 == index2);
+    indexSecs = now() - t;
+
+    report("equality", mapSecs, indexSecs, n);
+
+    // Iterate
+
+    size_t length = 0;
+
+    t = now();
+    for (StudyMap::const_iterator it = map1.begin();  it != map1.end();  ++it)
+        length += it->first.size();
+    mapSecs = now() - t;
+
+    t = now();
+    IdentifierMap<Study>::const_iterator iter;
+    for (iter = index1.begin();  iter != index1.end();  ++iter)
+        length += iter->first.str().size();
+    indexSecs = now() - t;
+
+    report("iterate", mapSecs, indexSecs, n);
+
+    // Remove
+
+    t = now();
+    for (unsigned i = 0;  i < n;  ++i)
+        map1.erase(lookupIds[i]);
+    mapSecs = now() - t;
+
+    t = now();
+    for (unsigned i = 0;  i < n;  ++i)
+        index1.erase(lookupIds[i]);
+    indexSecs = now() - t;
+
+    report("remove", mapSecs, indexSecs, n);
+
+    // Keep the work from being optimized away
+
+    if (found != 3 * n || !equal || length != 2 * size_t(n) * 16)
+    {
+        printf("results differ\n");
+        return 1;
+    }
+
+    return 0;
+}
+
+// end IdentifierMapBench.cpp
@@ -0,0 +1,144 @@
+// LazyCatalogBench.cpp  -  Compare decoding a whole catalog with indexing
+//                          it lazily and decoding only the studies used
+//
+// Usage:  LazyCatalogBench [number-of-studies [number-of-lookups]]
+
+#include "LazyCatalog.h"
+#include "YosokumoProtobuf.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sstream>
+#include <vector>
+
+using namespace Yosokumo;
+
+// Return a monotonic time in seconds
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Return the resident size of this process in bytes, or 0 if unknown
+
+static double residentBytes()
+{
+    FILE *f = fopen("/proc/self/statm", "r");
+    if (f == NULL)
+        return 0;
+
+    unsigned long size = 0, resident = 0;
+    if (fscanf(f, "%lu %lu", &size, &resident) != 2)
+        resident = 0;
+    fclose(f);
+
+    return double(resident) * sysconf(_SC_PAGESIZE);
+}
+
+static std::string studyIdentifier(unsigned i)
+{
+    std::stringstream id;
+    id << "study-" << i;
+    return id.str();
+}
+
+int main(int argc, char **argv)
+{
+    unsigned nStudies = (argc > 1) ? atoi(argv[1]) : 50000;
+    unsigned nLookups = (argc > 2) ? atoi(argv[2]) : 100;
+
+    srand(12345);
+
+    // A catalog as the server sends it, with every study in full
+
+    ProtoBuf::Catalog protoCatalog;
+    protoCatalog.set_user_identifier("bench-user");
+    protoCatalog.set_user_name("Bench User");
+    protoCatalog.set_location("/catalog/bench-user");
+
+    for (unsigned i = 0;  i < nStudies;  ++i)
+    {
+        std::string id = studyIdentifier(i);
+
+        ProtoBuf::Study *p = protoCatalog.add_study();
+        p->set_study_identifier(id);
+        p->set_study_name("Study " + id);
+        p->set_type(ProtoBuf::Study_Type_Number);
+        p->set_status(ProtoBuf::Study_Status_Running);
+        p->set_visibility(ProtoBuf::Study_Visibility_Private);
+        p->set_location("/study/" + id);
+        p->mutable_owner()->set_user_identifier("bench-user");
+        p->mutable_owner()->set_user_name("Bench User");
+        p->mutable_table()->set_location("/table/" + id);
+        p->mutable_model()->set_location("/model/" + id);
+        p->mutable_panel()->set_location("/panel/" + id);
+        p->mutable_roster()->set_location("/roster/" + id);
+    }
+
+    std::vector<uint8_t> bytes(protoCatalog.ByteSize());
+    protoCatalog.SerializeToArray(&bytes[0], int(bytes.size()));
+    protoCatalog.Clear();
+
+    std::vector<std::string> lookups;
+    for (unsigned i = 0;  i < nLookups;  ++i)
+        lookups.push_back(studyIdentifier(rand() % nStudies));
+
+    printf("%u studies, %.1f MB encoded, %u lookups\n", nStudies,
+                                            bytes.size() / 1e6, nLookups);
+    printf("%-8s %12s %12s %14s\n", "catalog", "decode ms", "lookup ms",
+                                                            "resident MB");
+
+    YosokumoProtobuf dif;
+    Study study;
+    bool ok = true;
+
+    // Lazy first, so the eager catalog does not leave it freed memory.  Its
+    // resident size includes the bytes it keeps.
+
+    std::vector<uint8_t> lazyBytes = bytes;
+    double r = residentBytes();
+    double t = now();
+    LazyCatalog lazy;
+    ok = dif.makeLazyCatalogFromBytes(lazyBytes, lazy) && ok;
+    double decodeSecs = now() - t;
+    double resident = residentBytes() - r + bytes.size();
+
+    t = now();
+    for (unsigned i = 0;  i < nLookups;  ++i)
+        ok = lazy.findStudy(lookups[i], study) && ok;
+    double lookupSecs = now() - t;
+
+    printf("%-8s %12.1f %12.3f %14.1f\n", "lazy", decodeSecs * 1e3,
+                                        lookupSecs * 1e3, resident / 1e6);
+
+    r = residentBytes();
+    t = now();
+    Catalog eager;
+    ok = dif.makeCatalogFromBytes(bytes, eager) && ok;
+    decodeSecs = now() - t;
+    resident = residentBytes() - r;
+
+    t = now();
+    for (unsigned i = 0;  i < nLookups;  ++i)
+        ok = eager.getStudy(lookups[i], study) && ok;
+    lookupSecs = now() - t;
+
+    printf("%-8s %12.1f %12.3f %14.1f\n", "eager", decodeSecs * 1e3,
+                                        lookupSecs * 1e3, resident / 1e6);
+
+    if (!ok)
+    {
+        printf("a decode or lookup failed\n");
+        return 1;
+    }
+
+    return 0;
+}
+
+// end LazyCatalogBench.cpp
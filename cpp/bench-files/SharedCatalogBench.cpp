@@ -0,0 +1,127 @@
+// SharedCatalogBench.cpp  -  Time the refreshes and reads of a SharedCatalog
+//
+// Usage:  SharedCatalogBench [number-of-studies [number-changed]]
+
+#include "SharedCatalog.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <sstream>
+#include <vector>
+
+using namespace Yosokumo;
+
+// Return a monotonic time in seconds
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static std::string studyIdentifier(unsigned i)
+{
+    std::stringstream id;
+    id << "5F3A" << 100000000 + i;
+    return id.str();
+}
+
+static Study makeStudy(unsigned i, uint64_t blockCount)
+{
+    std::string id   = studyIdentifier(i);
+    std::string base = "https://api.yosokumo.com/v1";
+
+    Study study("Study " + id, Study::NUMBER, Study::RUNNING, Study::PRIVATE);
+    study.setStudyIdentifier(id);
+    study.setStudyLocation(base + "/study/" + id);
+    study.setTableLocation(base + "/table/" + id);
+    study.setModelLocation(base + "/model/" + id);
+    study.setPanelLocation(base + "/panel/" + id);
+    study.setBlockCount(blockCount);
+
+    return study;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned nStudies = (argc > 1) ? atoi(argv[1]) : 50000;
+    unsigned nChanged = (argc > 2) ? atoi(argv[2]) : 10;
+    unsigned nReads   = 1000000;
+
+    srand(12345);
+
+    Catalog catalog("1F2E3D4C5B6A7980", "Bench User");
+    for (unsigned i = 0;  i < nStudies;  ++i)
+        catalog.addStudy(makeStudy(i, 0));
+
+    SharedCatalog shared;
+    shared.publish(catalog);
+
+    Catalog next(catalog);
+    for (unsigned i = 0;  i < nChanged;  ++i)
+        next.addStudy(makeStudy(rand() % nStudies, 1));
+
+    printf("%u studies, %u changed\n", nStudies, nChanged);
+    printf("%-28s %12s\n", "refresh", "ms");
+
+    // A copy of the whole catalog, as a refresher under a lock would make
+
+    double t = now();
+    Catalog copy(next);
+    printf("%-28s %12.2f\n", "copy of Catalog", (now() - t) * 1e3);
+
+    t = now();
+    shared.publish(next);
+    printf("%-28s %12.2f\n", "publish of Catalog", (now() - t) * 1e3);
+
+    CatalogDelta delta;
+    delta.compute(next, catalog);
+
+    t = now();
+    shared.apply(delta);
+    printf("%-28s %12.2f\n", "apply of CatalogDelta", (now() - t) * 1e3);
+
+    // Reads
+
+    std::vector<Identifier> lookups;
+    for (unsigned i = 0;  i < 1000;  ++i)
+        lookups.push_back(Identifier(studyIdentifier(rand() % nStudies)));
+
+    unsigned found = 0;
+
+    t = now();
+    for (unsigned i = 0;  i < nReads;  ++i)
+    {
+        SharedCatalog::ReadGuard guard(shared);
+        const Study *study = guard->findStudy(lookups[i % 1000]);
+        found += (study != NULL);
+    }
+    double readSecs = now() - t;
+
+    Mutex mutex;
+    t = now();
+    for (unsigned i = 0;  i < nReads;  ++i)
+    {
+        ScopedLock lock(mutex);
+        const Study *study = catalog.findStudy(lookups[i % 1000]);
+        found += (study != NULL);
+    }
+    double lockedSecs = now() - t;
+
+    printf("%-28s %12s\n", "read", "ns");
+    printf("%-28s %12.1f\n", "guard and find", readSecs * 1e9 / nReads);
+    printf("%-28s %12.1f\n", "lock and find", lockedSecs * 1e9 / nReads);
+
+    if (found != 2 * nReads)
+    {
+        printf("a lookup failed\n");
+        return 1;
+    }
+
+    return 0;
+}
+
+// end SharedCatalogBench.cpp
@@ -0,0 +1,135 @@
+// TableImportBench.cpp  -  Measure how fast a CSV table is imported into
+//                          specimen blocks, for each number of workers
+//
+// Usage:  TableImportBench [megabytes [predictor-columns]]
+
+#include "TableImporter.h"
+#include "WorkStealingPool.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <string>
+
+using namespace Yosokumo;
+
+// Return a monotonic time in seconds
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Counts the blocks and specimens handed over, as a poster would see them
+
+class CountingSink : public ImportSink
+{
+public:
+    uint64_t blocks;
+    uint64_t specimens;
+
+    CountingSink() : blocks(0), specimens(0)
+    {}
+
+    bool blockReady(SpecimenBlock &block)
+    {
+        ++blocks;
+        specimens += block.size();
+        return true;
+    }
+};
+
+int main(int argc, char **argv)
+{
+    unsigned megabytes = (argc > 1) ? atoi(argv[1]) : 256;
+    unsigned nColumns  = (argc > 2) ? atoi(argv[2]) : 10;
+
+    srand(12345);
+
+    // A table like the ones real users import:  a key, a real predictand,
+    // and a mix of natural and real predictors
+
+    char path[] = "/tmp/TableImportBench.XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0)
+    {
+        printf("cannot create %s\n", path);
+        return 1;
+    }
+
+    FILE *f = fdopen(fd, "w");
+    uint64_t rows = 0;
+    long     size = 0;
+
+    fprintf(f, "key,y");
+    for (unsigned j = 0;  j < nColumns;  ++j)
+        fprintf(f, ",x%u", j);
+    fprintf(f, "\n");
+
+    while ((size = ftell(f)) < long(megabytes) << 20)
+    {
+        fprintf(f, "%llu,%.3f", (unsigned long long)++rows,
+                                                    (rand() % 100000) / 1e3);
+        for (unsigned j = 0;  j < nColumns;  ++j)
+            if (j % 2 == 0)
+                fprintf(f, ",%d", rand() % 1000);
+            else
+                fprintf(f, ",%.4f", (rand() % 1000000) / 1e4);
+        fprintf(f, "\n");
+    }
+    fclose(f);
+
+    unsigned maxWorkers = WorkStealingPool::getProcessorCount();
+
+    printf("%.1f MB, %llu rows of %u predictors, %u processors\n",
+            size / 1048576.0, (unsigned long long)rows, nColumns, maxWorkers);
+    printf("%-8s %10s %10s %12s %9s\n", "workers", "ms", "GB/s",
+                                                    "rows/s", "speedup");
+
+    double first = 0;
+    bool   ok    = true;
+
+    for (unsigned n = 1;  n <= maxWorkers;  n = (n < maxWorkers && 2 * n >
+                                            maxWorkers) ? maxWorkers : 2 * n)
+    {
+        WorkStealingPool pool(n);
+        TableImporter importer(pool);
+        importer.setHeaderLines(1);
+        importer.mapColumn(0, TableImporter::SPECIMEN_KEY);
+        importer.mapColumn(1, TableImporter::PREDICTAND, Value::REAL);
+        for (unsigned j = 0;  j < nColumns;  ++j)
+            importer.mapColumn(2 + j, TableImporter::PREDICTOR,
+                    (j % 2 == 0) ? Value::NATURAL : Value::REAL, j + 1);
+
+        CountingSink sink;
+
+        double t = now();
+        ok = importer.importFile(path, "bench-study", sink) && ok;
+        double secs = now() - t;
+
+        if (sink.specimens != rows)
+            ok = false;
+
+        if (n == 1)
+            first = secs;
+
+        printf("%-8u %10.1f %10.3f %12.0f %8.2fx\n", n, secs * 1e3,
+                size / secs / 1e9, rows / secs, first / secs);
+    }
+
+    unlink(path);
+
+    if (!ok)
+    {
+        printf("the import failed\n");
+        return 1;
+    }
+
+    return 0;
+}
+
+// end TableImportBench.cpp
@@ -0,0 +1,238 @@
+// AllocationTracker.cpp
+
+#include "AllocationTracker.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <new>
+
+using namespace Yosokumo;
+
+namespace
+{
+
+// The counts of the calling thread.  paused is set while the table is
+// updated, so the table's own allocations are not counted.
+
+__thread uint64_t threadAllocations = 0;
+__thread uint64_t threadBytes       = 0;
+__thread bool     paused            = false;
+
+pthread_mutex_t               tableMutex = PTHREAD_MUTEX_INITIALIZER;
+AllocationTracker::StatsMap   *table     = NULL;
+
+}   // end anonymous namespace
+
+//***************************   operator new   ****************************
+
+#ifdef YOSOKUMO_ALLOC_TRACKING
+
+#if __cplusplus >= 201103L
+#define THROW_BAD_ALLOC
+#define NO_THROW        noexcept
+#else
+#define THROW_BAD_ALLOC throw(std::bad_alloc)
+#define NO_THROW        throw()
+#endif
+
+static void *countedAlloc(size_t n)
+{
+    if (!paused)
+    {
+        ++threadAllocations;
+        threadBytes += n;
+    }
+
+    return malloc(n == 0 ? 1 : n);
+}
+
+void *operator new(size_t n) THROW_BAD_ALLOC
+{
+    void *p = countedAlloc(n);
+    if (p == NULL)
+        throw std::bad_alloc();
+    return p;
+}
+
+void *operator new[](size_t n) THROW_BAD_ALLOC
+{
+    void *p = countedAlloc(n);
+    if (p == NULL)
+        throw std::bad_alloc();
+    return p;
+}
+
+void *operator new(size_t n, const std::nothrow_t &) NO_THROW
+{
+    return countedAlloc(n);
+}
+
+void *operator new[](size_t n, const std::nothrow_t &) NO_THROW
+{
+    return countedAlloc(n);
+}
+
+void operator delete(void *p) NO_THROW
+{
+    free(p);
+}
+
+void operator delete[](void *p) NO_THROW
+{
+    free(p);
+}
+
+void operator delete(void *p, const std::nothrow_t &) NO_THROW
+{
+    free(p);
+}
+
+void operator delete[](void *p, const std::nothrow_t &) NO_THROW
+{
+    free(p);
+}
+
+#endif  // YOSOKUMO_ALLOC_TRACKING
+
+//**************************   AllocationTracker   ************************
+
+AllocationTracker::Stats::Stats() :
+    calls(0), allocations(0), bytes(0), maxAllocations(0)
+{}
+
+bool AllocationTracker::isEnabled()
+{
+#ifdef YOSOKUMO_ALLOC_TRACKING
+    return true;
+#else
+    return false;
+#endif
+}
+
+uint64_t AllocationTracker::getThreadAllocations()
+{
+    return threadAllocations;
+}
+
+uint64_t AllocationTracker::getThreadBytes()
+{
+    return threadBytes;
+}
+
+void AllocationTracker::addCall(
+    const char *entryPoint,
+    uint64_t   allocations,
+    uint64_t   bytes)
+{
+    bool wasPaused = paused;
+    paused = true;
+
+    pthread_mutex_lock(&tableMutex);
+
+    if (table == NULL)
+        table = new StatsMap;
+
+    Stats &s = (*table)[entryPoint];
+    s.calls       += 1;
+    s.allocations += allocations;
+    s.bytes       += bytes;
+    if (allocations > s.maxAllocations)
+        s.maxAllocations = allocations;
+
+    pthread_mutex_unlock(&tableMutex);
+
+    paused = wasPaused;
+}
+
+bool AllocationTracker::getStats(const std::string &entryPoint, Stats &stats)
+{
+    pthread_mutex_lock(&tableMutex);
+
+    bool found = false;
+    if (table != NULL)
+    {
+        StatsMap::const_iterator it = table->find(entryPoint);
+        if (it != table->end())
+        {
+            stats = it->second;
+            found = true;
+        }
+    }
+
+    pthread_mutex_unlock(&tableMutex);
+
+    return found;
+}
+
+void AllocationTracker::getAllStats(StatsMap &stats)
+{
+    pthread_mutex_lock(&tableMutex);
+
+    if (table != NULL)
+        stats = *table;
+    else
+        stats.clear();
+
+    pthread_mutex_unlock(&tableMutex);
+}
+
+void AllocationTracker::reset()
+{
+    pthread_mutex_lock(&tableMutex);
+
+    if (table != NULL)
+        table->clear();
+
+    pthread_mutex_unlock(&tableMutex);
+}
+
+void AllocationTracker::report(std::ostream &out)
+{
+    StatsMap stats;
+    getAllStats(stats);
+
+    char line[160];
+    snprintf(line, sizeof(line), "%-44s %10s %12s %12s %10s\n",
+            "entry point", "calls", "allocs/call", "bytes/call", "max allocs");
+    out << line;
+
+    for (StatsMap::const_iterator it = stats.begin();  it != stats.end();  ++it)
+    {
+        const Stats &s = it->second;
+        snprintf(line, sizeof(line), "%-44s %10lu %12.1f %12.1f %10lu\n",
+                    it->first.c_str(),
+                    (unsigned long)s.calls,
+                    double(s.allocations) / s.calls,
+                    double(s.bytes) / s.calls,
+                    (unsigned long)s.maxAllocations);
+        out << line;
+    }
+}
+
+//***************************   AllocationScope   *************************
+
+AllocationScope::AllocationScope(const char *entryPoint) :
+    entryPoint      (entryPoint),
+    startAllocations(threadAllocations),
+    startBytes      (threadBytes)
+{}
+
+AllocationScope::~AllocationScope()
+{
+    if (entryPoint != NULL && AllocationTracker::isEnabled())
+        AllocationTracker::addCall(entryPoint, getAllocations(), getBytes());
+}
+
+uint64_t AllocationScope::getAllocations() const
+{
+    return threadAllocations - startAllocations;
+}
+
+uint64_t AllocationScope::getBytes() const
+{
+    return threadBytes - startBytes;
+}
+
+// end AllocationTracker.cpp
@@ -0,0 +1,163 @@
+// AllocationTracker.h
+
+#ifndef ALLOCATIONTRACKER_H
+#define ALLOCATIONTRACKER_H
+
+#include <stdint.h>
+#include <map>
+#include <ostream>
+#include <string>
+
+namespace Yosokumo
+{
+
+/**
+ * Counts heap allocations, in a build of the library compiled with
+ * <code>YOSOKUMO_ALLOC_TRACKING</code> defined (see makefile.inc).  Such a
+ * build replaces the global <code>operator new</code> and
+ * <code>operator delete</code> of the whole program with versions which
+ * count, per thread, the allocations made and the bytes asked for.
+ * <p>
+ * Library entry points (e.g., <code>YosokumoProtobuf::makeBlockFromBytes</code>
+ * and <code>Catalog::operator=</code>) are marked with
+ * <code>YOSOKUMO_TRACK_ALLOCATIONS</code>, which adds the allocations of each
+ * call to a table by entry point name.  Tests and benchmarks can read the
+ * table, or count the allocations of any piece of code with an
+ * <code>AllocationScope</code>.
+ * <p>
+ * In a normal build nothing is counted, the marks compile to nothing, and
+ * all counts are zero.
+ */
+class AllocationTracker
+{
+public:
+
+    /**
+     * The allocations of one entry point, over all calls and threads.
+     * Allocations made by nested entry points are included.
+     */
+    struct Stats
+    {
+        uint64_t calls;
+        uint64_t allocations;
+        uint64_t bytes;
+        uint64_t maxAllocations;    // The most made by one call
+
+        Stats();
+    };
+
+    typedef std::map<std::string, Stats> StatsMap;
+
+    /**
+     * Test if this build counts allocations.
+     */
+    static bool isEnabled();
+
+    /**
+     * Return the number of allocations made by the calling thread so far.
+     */
+    static uint64_t getThreadAllocations();
+
+    /**
+     * Return the number of bytes allocated by the calling thread so far.
+     */
+    static uint64_t getThreadBytes();
+
+    /**
+     * Get the allocations of one entry point.
+     *
+     * @param  entryPoint  the name of the entry point, e.g.,
+     *             "Specimen::operator=".
+     * @param  stats  where to place the allocations.
+     *
+     * @return <code>true</code> means the entry point has been called.
+     */
+    static bool getStats(const std::string &entryPoint, Stats &stats);
+
+    /**
+     * Get the allocations of all entry points which have been called.
+     *
+     * @param  stats  where to place the allocations.
+     */
+    static void getAllStats(StatsMap &stats);
+
+    /**
+     * Forget the allocations of all entry points.
+     */
+    static void reset();
+
+    /**
+     * Write a table of the allocations of all entry points.
+     *
+     * @param  out  where to write.
+     */
+    static void report(std::ostream &out);
+
+    /**
+     * Add one call of an entry point to the table.  Called by
+     * <code>AllocationScope</code>.
+     */
+    static void addCall(
+        const char *entryPoint,
+        uint64_t   allocations,
+        uint64_t   bytes);
+
+};  // end class AllocationTracker
+
+
+/**
+ * Counts the allocations made by the calling thread from its construction
+ * on.  If it is given an entry point name, the counts are added to the
+ * table of <code>AllocationTracker</code> when it is destroyed.
+ */
+class AllocationScope
+{
+private:
+    const char *entryPoint;         // NULL means not in the table
+    uint64_t   startAllocations;
+    uint64_t   startBytes;
+
+public:
+    AllocationScope(const char *entryPoint = NULL);
+    ~AllocationScope();
+
+    /**
+     * Return the number of allocations made since construction.
+     */
+    uint64_t getAllocations() const;
+
+    /**
+     * Return the number of bytes allocated since construction.
+     */
+    uint64_t getBytes() const;
+
+private:
+
+    /**
+     * Copy constructor - NOT IMPLEMENTED.
+     */
+    AllocationScope(const AllocationScope &rhs);
+
+    /**
+     * Assignment operator - NOT IMPLEMENTED.
+     */
+    AllocationScope& operator=(const AllocationScope& rhs);
+
+};  // end class AllocationScope
+
+}   // end namespace Yosokumo
+
+/**
+ * Mark a library entry point, so its allocations are counted in a tracking
+ * build.
+ */
+#ifdef YOSOKUMO_ALLOC_TRACKING
+#define YOSOKUMO_TRACK_ALLOCATIONS(entryPoint) \
+    Yosokumo::AllocationScope yosokumoAllocationScope(entryPoint)
+#else
+#define YOSOKUMO_TRACK_ALLOCATIONS(entryPoint)
+#endif
+
+#endif  // ALLOCATIONTRACKER_H
+
+// end AllocationTracker.h
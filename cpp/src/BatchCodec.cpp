@@ -0,0 +1,124 @@
+// BatchCodec.cpp
+
+#include "BatchCodec.h"
+
+using namespace Yosokumo;
+
+namespace
+{
+
+class EncodeTask : public IndexedTask
+{
+    std::vector<YosokumoProtobuf *>    &difs;
+    const std::vector<const Block *>    &blocks;
+    std::vector<std::vector<uint8_t> > &bytes;
+    std::vector<ServiceException>      &exceptions;
+
+public:
+
+    EncodeTask(
+        std::vector<YosokumoProtobuf *>    &difs,
+        const std::vector<const Block *>    &blocks,
+        std::vector<std::vector<uint8_t> > &bytes,
+        std::vector<ServiceException>      &exceptions) :
+            difs(difs), blocks(blocks), bytes(bytes), exceptions(exceptions)
+    {}
+
+    void runItem(unsigned worker, size_t i)
+    {
+        YosokumoProtobuf &dif = *difs[worker];
+
+        if (!dif.makeBytesFromBlock(*blocks[i], bytes[i]))
+            dif.getException(exceptions[i]);
+    }
+};
+
+class DecodeTask : public IndexedTask
+{
+    std::vector<YosokumoProtobuf *>          &difs;
+    const std::vector<std::vector<uint8_t> > &bytes;
+    const std::vector<Block *>               &blocks;
+    std::vector<ServiceException>            &exceptions;
+
+public:
+
+    DecodeTask(
+        std::vector<YosokumoProtobuf *>          &difs,
+        const std::vector<std::vector<uint8_t> > &bytes,
+        const std::vector<Block *>               &blocks,
+        std::vector<ServiceException>            &exceptions) :
+            difs(difs), bytes(bytes), blocks(blocks), exceptions(exceptions)
+    {}
+
+    void runItem(unsigned worker, size_t i)
+    {
+        YosokumoProtobuf &dif = *difs[worker];
+
+        if (!dif.makeBlockFromBytes(bytes[i], *blocks[i]))
+            dif.getException(exceptions[i]);
+    }
+};
+
+}   // end anonymous namespace
+
+BatchCodec::BatchCodec(WorkStealingPool &pool) : pool(pool)
+{
+    for (unsigned i = 0;  i < pool.size();  ++i)
+        difs.push_back(new YosokumoProtobuf);
+}
+
+BatchCodec::~BatchCodec()
+{
+    for (size_t i = 0;  i < difs.size();  ++i)
+        delete difs[i];
+}
+
+bool BatchCodec::encodeBlocks(
+    const std::vector<const Block *>    &blocks,
+    std::vector<std::vector<uint8_t> > &bytes,
+    std::vector<ServiceException>      &exceptions)
+{
+    bytes.resize(blocks.size());
+    exceptions.assign(blocks.size(), ServiceException());
+
+    EncodeTask task(difs, blocks, bytes, exceptions);
+    pool.forEach(blocks.size(), task);
+
+    return setException(exceptions);
+}
+
+bool BatchCodec::decodeBlocks(
+    const std::vector<std::vector<uint8_t> > &bytes,
+    const std::vector<Block *>               &blocks,
+    std::vector<ServiceException>            &exceptions)
+{
+    exceptions.assign(bytes.size(), ServiceException());
+
+    DecodeTask task(difs, bytes, blocks, exceptions);
+    pool.forEach(bytes.size(), task);
+
+    return setException(exceptions);
+}
+
+ServiceException BatchCodec::getException()
+{
+    ScopedLock lock(mutex);
+    return exception;
+}
+
+bool BatchCodec::setException(const std::vector<ServiceException> &exceptions)
+{
+    for (size_t i = 0;  i < exceptions.size();  ++i)
+    {
+        if (YosokumoDIF::isException(exceptions[i]))
+        {
+            ScopedLock lock(mutex);
+            exception = exceptions[i];
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// end BatchCodec.cpp
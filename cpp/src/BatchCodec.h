@@ -0,0 +1,109 @@
+// BatchCodec.h
+
+#ifndef BATCHCODEC_H
+#define BATCHCODEC_H
+
+#include "Block.h"
+#include "Mutex.h"
+#include "ServiceException.h"
+#include "WorkStealingPool.h"
+#include "YosokumoProtobuf.h"
+
+#include <stdint.h>
+#include <vector>
+
+namespace Yosokumo
+{
+
+/**
+ * Encodes and decodes batches of blocks in parallel on a
+ * <code>WorkStealingPool</code>.  A <code>YosokumoProtobuf</code> object
+ * keeps the exception of its last call, so it cannot be shared between
+ * threads; a <code>BatchCodec</code> keeps one for each worker of the pool.
+ * <p>
+ * The methods may be called from any thread.
+ */
+class BatchCodec
+{
+    WorkStealingPool               &pool;
+    std::vector<YosokumoProtobuf *> difs;   // One per worker
+
+    Mutex                           mutex;  // Guards exception
+    ServiceException                exception;
+
+public:
+
+    /**
+     * Initializes a newly created <code>BatchCodec</code>.
+     *
+     * @param  pool  the pool on which to run.  Not owned by the codec.
+     */
+    explicit BatchCodec(WorkStealingPool &pool);
+
+    /**
+     * Destructor.
+     */
+    ~BatchCodec();
+
+    /**
+     * Encode a batch of blocks.
+     *
+     * @param  blocks  the blocks to encode.
+     * @param  bytes  set to the encoding of each block, in the same order.
+     * @param  exceptions  set to one entry per block:  the failure for the
+     *             block, or a default <code>ServiceException</code> if
+     *             the block was encoded.
+     *
+     * @return <code>true</code> means every block was encoded.
+     *         <code>false</code> means at least one failed;
+     *             <code>getException()</code> returns the first failure.
+     */
+    bool encodeBlocks(
+        const std::vector<const Block *>    &blocks,
+        std::vector<std::vector<uint8_t> > &bytes,
+        std::vector<ServiceException>      &exceptions);
+
+    /**
+     * Decode a batch of blocks.
+     *
+     * @param  bytes  the encodings to decode.
+     * @param  blocks  the blocks to decode into, one per encoding.
+     * @param  exceptions  set to one entry per block:  the failure for the
+     *             block, or a default <code>ServiceException</code> if
+     *             the block was decoded.
+     *
+     * @return <code>true</code> means every block was decoded.
+     *         <code>false</code> means at least one failed;
+     *             <code>getException()</code> returns the first failure.
+     */
+    bool decodeBlocks(
+        const std::vector<std::vector<uint8_t> > &bytes,
+        const std::vector<Block *>               &blocks,
+        std::vector<ServiceException>            &exceptions);
+
+    /**
+     * Return the first failure of the last batch which failed.
+     */
+    ServiceException getException();
+
+private:
+
+    bool setException(const std::vector<ServiceException> &exceptions);
+
+    /**
+     * Copy constructor - NOT IMPLEMENTED.
+     */
+    BatchCodec(const BatchCodec &rhs);
+
+    /**
+     * Assignment operator - NOT IMPLEMENTED.
+     */
+    BatchCodec& operator=(const BatchCodec& rhs);
+
+};  // end class BatchCodec
+
+}   // end namespace Yosokumo
+
+#endif  // BATCHCODEC_H
+
+// end BatchCodec.h
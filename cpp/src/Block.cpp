@@ -1,17 +1,44 @@
 // Block.cpp
 
 #include "Block.h" 
+#include "Hash.h"
 
 using namespace Yosokumo;
 
-Block::Block() : type(EMPTY), studyIdentifier("")
+namespace
+{
+
+// The hash of a predictor at a position, summed like those of cells
+
+inline uint64_t predictorHash(uint64_t position, const Predictor &p)
+{
+    uint64_t h = hashUint64(HASH_SEED, position);
+    h = hashUint64(h, uint64_t(p.getPredictorName()));
+    h = hashUint64(h, p.getStatus());
+    h = hashUint64(h, p.getType());
+    h = hashUint64(h, p.getLevel());
+
+    return mixHash(h);
+}
+
+}   // end anonymous namespace
+
+Block::Block() : 
+    type(EMPTY), 
+    studyIdentifier(""), 
+    cellsFingerprint(0), 
+    predictorsFingerprint(0)
 {
     cellSequence.clear();
     predictorSequence.clear();
     specimenSequence.clear();
 }
 
-Block::Block(std::string id) : type(EMPTY), studyIdentifier(id)
+Block::Block(std::string id) : 
+    type(EMPTY), 
+    studyIdentifier(id), 
+    cellsFingerprint(0), 
+    predictorsFingerprint(0)
 {
     cellSequence.clear();
     predictorSequence.clear();
@@ -41,6 +68,115 @@ std::string Block::getStudyIdentifier() const
     return studyIdentifier;
 }
 
+uint64_t Block::getItemCount() const
+{
+    switch (type)
+    {
+    case CELL:
+        return cellSequence.size();
+    case PREDICTOR:
+        return predictorSequence.size();
+    case SPECIMEN:
+        return specimenSequence.size();
+    default:
+        return 0;
+    }
+}
+
+uint64_t Block::getFingerprint() const
+{
+    uint64_t h = hashUint64(HASH_SEED, type);
+    h = hashString(h, studyIdentifier);
+
+    switch (type)
+    {
+    case CELL:
+        h = hashUint64(h, cellSequence.size());
+        h = hashUint64(h, cellsFingerprint);
+        break;
+    case PREDICTOR:
+        h = hashUint64(h, predictorSequence.size());
+        h = hashUint64(h, predictorsFingerprint);
+        break;
+    case SPECIMEN:
+        h = hashUint64(h, specimenSequence.size());
+        for (size_t i = 0;  i < specimenSequence.size();  ++i)
+            h = hashUint64(h, specimenSequence[i]->getFingerprint());
+        break;
+    default:
+        break;
+    }
+
+    return mixHash(h);
+}
+
+void Block::addCellsFingerprint(size_t first)
+{
+    for (size_t i = first;  i < cellSequence.size();  ++i)
+        cellsFingerprint += hashCellAt(i, cellSequence[i]);
+}
+
+void Block::subtractCellsFingerprint(size_t first)
+{
+    for (size_t i = first;  i < cellSequence.size();  ++i)
+        cellsFingerprint -= hashCellAt(i, cellSequence[i]);
+}
+
+void Block::addPredictorsFingerprint(size_t first)
+{
+    for (size_t i = first;  i < predictorSequence.size();  ++i)
+        predictorsFingerprint += predictorHash(i, predictorSequence[i]);
+}
+
+void Block::subtractPredictorsFingerprint(size_t first)
+{
+    for (size_t i = first;  i < predictorSequence.size();  ++i)
+        predictorsFingerprint -= predictorHash(i, predictorSequence[i]);
+}
+
+void Block::copyBlockRange(
+    Block       &t, 
+    const Block &s, 
+    uint64_t    begin, 
+    uint64_t    end)
+{
+    t.type            = s.type;
+    t.studyIdentifier = s.studyIdentifier;
+
+    t.cellSequence.clear();
+    t.predictorSequence.clear();
+    t.specimenSequence.clear();
+    t.cellsFingerprint      = 0;
+    t.predictorsFingerprint = 0;
+
+    if (end > s.getItemCount())
+        end = s.getItemCount();
+    if (begin > end)
+        begin = end;
+
+    switch (s.type)
+    {
+    case CELL:
+        t.cellSequence.assign(
+            s.cellSequence.begin() + begin, s.cellSequence.begin() + end);
+        t.addCellsFingerprint(0);
+        break;
+    case PREDICTOR:
+        t.predictorSequence.assign(
+            s.predictorSequence.begin() + begin, 
+            s.predictorSequence.begin() + end);
+        t.addPredictorsFingerprint(0);
+        break;
+    case SPECIMEN:
+        t.specimenSequence.assign(
+            s.specimenSequence.begin() + begin, 
+            s.specimenSequence.begin() + end);
+        break;
+    default:
+        break;
+    }
+}
+
 std::string Block::toString()
 {
     std::stringstream s;
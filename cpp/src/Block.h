@@ -91,6 +91,27 @@ protected:
      */
     std::vector<Specimen*> specimenSequence;
 
+    /**
+     * The fingerprint of the cell sequence, kept up to date as cells are
+     * added and removed.  It is the sum of the hashes of the cells at their
+     * positions, as in <code>Specimen</code>.
+     */
+    uint64_t cellsFingerprint;
+
+    /**
+     * The fingerprint of the predictor sequence, kept in the same way.
+     */
+    uint64_t predictorsFingerprint;
+
+    // Add the items from the one at first on to the fingerprint of their 
+    // sequence, or take them off it.  Each change to the cell sequence or 
+    // the predictor sequence calls one of these.
+
+    void addCellsFingerprint(size_t first);
+    void subtractCellsFingerprint(size_t first);
+    void addPredictorsFingerprint(size_t first);
+    void subtractPredictorsFingerprint(size_t first);
+
 
 public:
 
@@ -141,6 +162,48 @@ public:
      */
     std::string getStudyIdentifier() const;
 
+    /**
+     * Return the number of items in the block:  cells, predictors, or 
+     * specimens, according to the type of the block.
+     *
+     * @return the number of items in the block.
+     */
+    uint64_t getItemCount() const;
+
+    /**
+     * Return a 64-bit fingerprint of the block:  its type, its study
+     * identifier, and its items, in order.  Blocks with the same contents
+     * have the same fingerprint, so it may serve as a key for finding
+     * duplicate blocks, e.g., before they are sent again.  The fingerprint
+     * of the cells or predictors is kept up to date as they are added and
+     * removed, so for a cell block or a predictor block this costs nothing.
+     * For a specimen block it takes time in proportion to the number of
+     * specimens, which may change under the block; each contributes its own
+     * fingerprint (see <code>Specimen::getFingerprint()</code>), which costs
+     * nothing, so its cells are not walked again.
+     *
+     * @return the fingerprint.
+     */
+    uint64_t getFingerprint() const;
+
+    /**
+     * Copy a range of the items of one block to another.  The target gets
+     * the type and study identifier of the source, and items 
+     * <code>begin</code> up to (but not including) <code>end</code>.  As 
+     * with <code>SpecimenBlock</code>, specimens are not copied; the target 
+     * points to the same <code>Specimen</code> objects as the source.
+     *
+     * @param  t      the target block.
+     * @param  s      the source block.
+     * @param  begin  the index of the first item to copy.
+     * @param  end    one past the index of the last item to copy.
+     */
+    static void copyBlockRange(
+        Block       &t, 
+        const Block &s, 
+        uint64_t    begin, 
+        uint64_t    end);
+
     /**
      * Return the block as a string.
      *
@@ -0,0 +1,537 @@
+// BlockSpool.cpp
+
+#include "BlockSpool.h"
+#include "Service.h"
+#include "YosokumoProtobuf.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+using namespace Yosokumo;
+
+namespace
+{
+
+// The file starts with a header page; the records follow, each aligned to 8
+// bytes.  A record is a RecordHeader, the table location, and the encoded
+// block.
+//
+// Each record carries the lap of the file in which it was written.  The lap
+// goes up each time the spool is opened and each time it starts again at
+// the front, and the laps of the records must not go down from one record
+// to the next.  So a record left over from an earlier lap, which the
+// records of this lap have not (yet) overwritten, is never mistaken for a
+// live one.
+
+const char     SPOOL_MAGIC[8] = { 'Y', 'S', 'K', 'S', 'P', 'O', 'O', 'L' };
+const uint32_t SPOOL_VERSION  = 1;
+const uint64_t HEADER_SIZE    = 4096;
+const uint32_t RECORD_MAGIC   = 0x59535243;
+
+struct SpoolHeader
+{
+    char     magic[8];
+    uint32_t version;
+    uint32_t lap;               // Lap of the process which wrote it
+    uint32_t firstLap;          // No record at ackOffset is older
+    uint32_t reserved;
+    uint64_t ackOffset;         // First record not yet posted
+};
+
+struct RecordHeader
+{
+    uint32_t magic;
+    uint32_t lap;
+    uint32_t locationLength;
+    uint32_t payloadLength;
+    uint32_t crc;               // Of the lengths, location, and payload
+    uint32_t reserved;
+};
+
+uint64_t recordSize(uint64_t locationLength, uint64_t payloadLength)
+{
+    uint64_t n = sizeof(RecordHeader) + locationLength + payloadLength;
+
+    return (n + 7) & ~uint64_t(7);
+}
+
+uint32_t recordCrc(
+    uint32_t      locationLength,
+    uint32_t      payloadLength,
+    const uint8_t *location,
+    const uint8_t *payload)
+{
+    uLong crc = crc32(0L, Z_NULL, 0);
+    crc = crc32(crc, (const Bytef *)&locationLength, sizeof(locationLength));
+    crc = crc32(crc, (const Bytef *)&payloadLength,  sizeof(payloadLength));
+    crc = crc32(crc, location, locationLength);
+    crc = crc32(crc, payload,  payloadLength);
+
+    return uint32_t(crc);
+}
+
+}   // end anonymous namespace
+
+BlockSpool::BlockSpool() :
+    fd          (-1),
+    map         (NULL),
+    capacity    (0),
+    lap         (0),
+    firstLap    (0),
+    ackOffset   (0),
+    endOffset   (0),
+    syncedOffset(0),
+    appended    (0),
+    durable     (0),
+    syncing     (false),
+    pending     (0),
+    syncCount   (0)
+{}
+
+BlockSpool::~BlockSpool()
+{
+    close();
+}
+
+bool BlockSpool::open(const std::string &path, uint64_t capacity)
+{
+    close();
+
+    ScopedLock lock(mutex);
+
+    exception = ServiceException();
+
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+        return fail("Cannot open spool file " + path, "open");
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+        return fail("Cannot stat spool file " + path, "open");
+
+    bool created = (st.st_size == 0);
+
+    if (created)
+    {
+        if (capacity < 2 * HEADER_SIZE)
+            capacity = 2 * HEADER_SIZE;
+        if (ftruncate(fd, off_t(capacity)) != 0)
+            return fail("Cannot size spool file " + path, "open");
+    }
+    else
+        capacity = uint64_t(st.st_size);
+
+    if (capacity < HEADER_SIZE)
+    {
+        errno = 0;
+        return fail("Not a spool file: " + path, "open");
+    }
+
+    void *m = mmap(NULL, size_t(capacity), PROT_READ | PROT_WRITE,
+                                                        MAP_SHARED, fd, 0);
+    if (m == MAP_FAILED)
+        return fail("Cannot map spool file " + path, "open");
+
+    map            = (uint8_t *)m;
+    this->capacity = capacity;
+
+    if (created)
+    {
+        lap       = 1;
+        firstLap  = 1;
+        ackOffset = HEADER_SIZE;
+    }
+    else
+    {
+        SpoolHeader h;
+        memcpy(&h, map, sizeof(h));
+
+        if (memcmp(h.magic, SPOOL_MAGIC, sizeof(h.magic)) != 0 ||
+                    h.version != SPOOL_VERSION || h.ackOffset < HEADER_SIZE ||
+                    h.ackOffset > capacity || h.ackOffset % 8 != 0)
+        {
+            errno = 0;
+            return fail("Not a spool file: " + path, "open");
+        }
+
+        lap       = h.lap + 1;
+        firstLap  = h.firstLap;
+        ackOffset = h.ackOffset;
+    }
+
+    // Find the end of the records:  the first which is torn, or was not
+    // written since the file last started again at the front
+
+    uint64_t offset  = ackOffset;
+    uint32_t lastLap = firstLap;
+    pending = 0;
+
+    while (readRecord(offset, lastLap, lastLap, offset))
+        ++pending;
+
+    endOffset    = offset;
+    syncedOffset = offset;
+    appended     = 0;
+    durable      = 0;
+    syncing      = false;
+    syncCount    = 0;
+
+    // The new lap must be on disk before any record of it is
+
+    writeHeader();
+    if (!syncRange(0, HEADER_SIZE))
+        return fail("Cannot sync spool file " + path, "open");
+
+    return true;
+}
+
+void BlockSpool::close()
+{
+    ScopedLock lock(mutex);
+
+    if (map != NULL)
+    {
+        syncRange(0, HEADER_SIZE);
+        munmap(map, size_t(capacity));
+        map = NULL;
+    }
+
+    if (fd >= 0)
+    {
+        ::close(fd);
+        fd = -1;
+    }
+
+    pending = 0;
+    syncDone.broadcast();
+}
+
+bool BlockSpool::isOpen()
+{
+    ScopedLock lock(mutex);
+    return map != NULL;
+}
+
+bool BlockSpool::append(
+    const std::string &tableLocation,
+    const Block       &block,
+    uint64_t          &ticket)
+{
+    YosokumoProtobuf dif;
+    std::vector<uint8_t> bytes;
+
+    if (!dif.makeBytesFromBlock(block, bytes))
+    {
+        ScopedLock lock(mutex);
+        dif.getException(exception);
+        return false;
+    }
+
+    return append(tableLocation, bytes, ticket);
+}
+
+bool BlockSpool::append(
+    const std::string          &tableLocation,
+    const std::vector<uint8_t> &bytes,
+    uint64_t                   &ticket)
+{
+    RecordHeader h;
+    h.magic          = RECORD_MAGIC;
+    h.locationLength = uint32_t(tableLocation.size());
+    h.payloadLength  = uint32_t(bytes.size());
+    h.crc            = recordCrc(h.locationLength, h.payloadLength,
+                        (const uint8_t *)tableLocation.data(),
+                        bytes.empty() ? NULL : &bytes[0]);
+    h.reserved       = 0;
+
+    uint64_t size = recordSize(h.locationLength, h.payloadLength);
+
+    ScopedLock lock(mutex);
+
+    if (map == NULL)
+    {
+        errno = 0;
+        return fail("Spool is not open", "append");
+    }
+
+    // Start again at the front if everything has been posted, once no sync
+    // is using the old records
+
+    if (endOffset + size > capacity && ackOffset == endOffset)
+    {
+        while (syncing)
+            syncDone.wait(mutex);
+        if (map != NULL && ackOffset == endOffset)
+            rewind();
+    }
+
+    if (map == NULL || endOffset + size > capacity)
+    {
+        errno = 0;
+        return fail("Spool is full", "append");
+    }
+
+    h.lap = lap;
+
+    uint8_t *p = map + endOffset;
+    memcpy(p, &h, sizeof(h));
+    memcpy(p + sizeof(h), tableLocation.data(), h.locationLength);
+    if (!bytes.empty())
+        memcpy(p + sizeof(h) + h.locationLength, &bytes[0], bytes.size());
+
+    endOffset += size;
+    appended  += size;
+    ++pending;
+
+    ticket = appended;
+    return true;
+}
+
+bool BlockSpool::commit(uint64_t ticket)
+{
+    ScopedLock lock(mutex);
+
+    while (durable < ticket)
+    {
+        if (map == NULL)
+        {
+            errno = 0;
+            return fail("Spool is not open", "commit");
+        }
+
+        if (syncing)
+        {
+            syncDone.wait(mutex);
+            continue;
+        }
+
+        // Sync everything appended so far, for the callers waiting now and
+        // for those which come along during the sync
+
+        syncing = true;
+        uint64_t target = appended;
+        uint64_t begin  = syncedOffset;
+        uint64_t end    = endOffset;
+
+        mutex.unlock();
+        bool ok = syncRange(begin, end);
+        int  error = errno;
+        mutex.lock();
+
+        syncing = false;
+        syncDone.broadcast();
+
+        if (!ok)
+        {
+            errno = error;
+            return fail("Cannot sync spool file", "commit");
+        }
+
+        ++syncCount;
+        syncedOffset = end;
+        if (durable < target)
+            durable = target;
+    }
+
+    return true;
+}
+
+bool BlockSpool::commit()
+{
+    uint64_t ticket;
+    {
+        ScopedLock lock(mutex);
+        ticket = appended;
+    }
+
+    return commit(ticket);
+}
+
+bool BlockSpool::replay(Service &service)
+{
+    ScopedLock replayLock(replayMutex);
+
+    for (;;)
+    {
+        std::string location;
+        uint64_t    payloadOffset;
+        uint32_t    payloadLength;
+        uint64_t    next;
+        int         file;
+
+        {
+            ScopedLock lock(mutex);
+
+            if (map == NULL)
+            {
+                errno = 0;
+                return fail("Spool is not open", "replay");
+            }
+
+            if (ackOffset == endOffset)
+                return true;
+
+            RecordHeader h;
+            memcpy(&h, map + ackOffset, sizeof(h));
+
+            location.assign((const char *)map + ackOffset + sizeof(h),
+                                                            h.locationLength);
+            payloadOffset = ackOffset + sizeof(h) + h.locationLength;
+            payloadLength = h.payloadLength;
+            next          = ackOffset + recordSize(h.locationLength,
+                                                            h.payloadLength);
+            file          = fd;
+        }
+
+        // Only replay() moves ackOffset, so the record stays put meanwhile
+
+        bool ok = service.postBlockFromFile(location, file,
+                                        off_t(payloadOffset), payloadLength);
+
+        ScopedLock lock(mutex);
+
+        if (!ok)
+        {
+            exception = service.getException();
+            return false;
+        }
+
+        ackOffset = next;
+        --pending;
+
+        if (ackOffset == endOffset && !syncing)
+            rewind();
+        else
+            writeHeader();
+    }
+}
+
+size_t BlockSpool::size()
+{
+    ScopedLock lock(mutex);
+    return pending;
+}
+
+uint64_t BlockSpool::getSyncCount()
+{
+    ScopedLock lock(mutex);
+    return syncCount;
+}
+
+ServiceException BlockSpool::getException()
+{
+    ScopedLock lock(mutex);
+    return exception;
+}
+
+// Set the exception (adding the system's reason, if errno is set) and
+// return false.  Called with the mutex held.  A failure while opening
+// leaves the spool closed.
+
+bool BlockSpool::fail(const std::string &message, const std::string &operation)
+{
+    std::string text = message;
+    if (errno != 0)
+        text += std::string(": ") + strerror(errno);
+
+    exception = ServiceException(text, operation);
+
+    if (operation == "open")
+    {
+        if (map != NULL)
+            munmap(map, size_t(capacity));
+        map = NULL;
+        if (fd >= 0)
+            ::close(fd);
+        fd = -1;
+    }
+
+    return false;
+}
+
+// Check the record at offset.  If it is whole, and of a lap from lastLap
+// up to (not including) the lap of this process, set recordLap to its lap
+// and next to the offset of the record after it.  Only used by open().
+
+bool BlockSpool::readRecord(
+    uint64_t offset,
+    uint32_t lastLap,
+    uint32_t &recordLap,
+    uint64_t &next)
+{
+    RecordHeader h;
+
+    if (offset + sizeof(h) > capacity)
+        return false;
+
+    memcpy(&h, map + offset, sizeof(h));
+
+    if (h.magic != RECORD_MAGIC || h.lap < lastLap || h.lap >= lap)
+        return false;
+
+    uint64_t size = recordSize(h.locationLength, h.payloadLength);
+    if (size > capacity - offset)
+        return false;
+
+    const uint8_t *location = map + offset + sizeof(h);
+    if (recordCrc(h.locationLength, h.payloadLength, location,
+                                    location + h.locationLength) != h.crc)
+        return false;
+
+    recordLap = h.lap;
+    next      = offset + size;
+    return true;
+}
+
+// Write the header into the map.  It reaches the disk with the next sync
+// of the first page, or when the kernel writes it back; an ackOffset which
+// is lost to a crash only means records are posted again.
+
+void BlockSpool::writeHeader()
+{
+    SpoolHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, SPOOL_MAGIC, sizeof(h.magic));
+    h.version   = SPOOL_VERSION;
+    h.lap       = lap;
+    h.firstLap  = firstLap;
+    h.ackOffset = ackOffset;
+
+    memcpy(map, &h, sizeof(h));
+}
+
+bool BlockSpool::syncRange(uint64_t begin, uint64_t end)
+{
+    if (end <= begin)
+        return true;
+
+    uint64_t page = uint64_t(sysconf(_SC_PAGESIZE));
+    begin -= begin % page;
+
+    return msync(map + begin, size_t(end - begin), MS_SYNC) == 0;
+}
+
+// Start again at the front of the file, in a new lap.  Called with the
+// mutex held, when every record has been posted and no sync is running.
+
+void BlockSpool::rewind()
+{
+    ++lap;
+    firstLap     = lap;
+    ackOffset    = HEADER_SIZE;
+    endOffset    = HEADER_SIZE;
+    syncedOffset = HEADER_SIZE;
+    durable      = appended;
+
+    // As in open(), the new lap must be on disk before any record of it
+
+    writeHeader();
+    syncRange(0, HEADER_SIZE);
+}
+
+// end BlockSpool.cpp
@@ -0,0 +1,238 @@
+// BlockSpool.h
+
+#ifndef BLOCKSPOOL_H
+#define BLOCKSPOOL_H
+
+#include "Block.h"
+#include "Condition.h"
+#include "Mutex.h"
+#include "ServiceException.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace Yosokumo
+{
+
+class Service;
+
+/**
+ * A durable outbox for blocks waiting to be posted:  an append-only file,
+ * mapped into memory, holding encoded blocks and the URIs of the tables
+ * they are for.  Blocks appended to the spool survive a crash of the
+ * process once committed, and are posted (and removed) by
+ * <code>replay()</code>, which after a restart picks up where the last
+ * process left off.  For example:
+ * <pre>
+ *    BlockSpool spool;
+ *    if (!spool.open("/var/spool/yosokumo/outbox"))
+ *        ...
+ *    uint64_t ticket;
+ *    spool.append(tableLocation, block, ticket);     // On any thread
+ *    spool.commit(ticket);                           // Now durable
+ *    ...
+ *    spool.replay(service);                          // On one thread
+ * </pre>
+ * Each record is framed with a CRC-32, so a record torn by a crash is
+ * found on reopening and dropped, together with anything after it.
+ * <p>
+ * <code>commit()</code> batches its syncs:  while one caller syncs the
+ * file, the others wait, and the next sync covers all their records at
+ * once (group commit).  So many threads committing at once pay for few
+ * syncs.
+ * <p>
+ * <code>replay()</code> sends each record straight from the file with
+ * <code>sendfile()</code> (see <code>Service::postBlockFromFile()</code>),
+ * so a spooled block is not encoded again.  A record is removed once the
+ * server has accepted it.  If the process dies between the post and the
+ * removal, the record is posted again after the restart, so delivery is
+ * at least once.
+ * <p>
+ * The file does not grow:  it is created with a fixed capacity, and
+ * <code>append()</code> fails when the records not yet posted fill it.
+ * Once every record has been posted, the next record goes at the start of
+ * the file again.
+ * <p>
+ * The methods may be called from any thread.  The file is in host byte
+ * order, so it is only meant to be read on the machine which wrote it.
+ */
+class BlockSpool
+{
+public:
+
+    /**
+     * Default size of a new spool file, in bytes.
+     */
+    enum { DEFAULT_CAPACITY = 64 << 20 };
+
+private:
+
+    int                 fd;             // -1 means not open
+    uint8_t             *map;
+    uint64_t            capacity;
+
+    Mutex               replayMutex;    // Serializes replay()
+
+    Mutex               mutex;          // Guards the following
+    Condition           syncDone;
+    uint32_t            lap;            // Written into each record
+    uint32_t            firstLap;       // Lap of the oldest record
+    uint64_t            ackOffset;      // First record not yet posted
+    uint64_t            endOffset;      // Where the next record goes
+    uint64_t            syncedOffset;   // End of what is known durable
+    uint64_t            appended;       // Bytes appended since open
+    uint64_t            durable;        // Of which known durable
+    bool                syncing;
+    size_t              pending;        // Records not yet posted
+    uint64_t            syncCount;
+    ServiceException    exception;
+
+public:
+
+    /**
+     * Initializes a newly created <code>BlockSpool</code> which is not
+     * open.
+     */
+    BlockSpool();
+
+    /**
+     * Destructor - closes the spool.  Records not yet posted stay in the
+     * file.
+     */
+    ~BlockSpool();
+
+    /**
+     * Open a spool file, creating it if it does not exist.  An existing
+     * file is checked record by record; a torn record and anything after
+     * it are dropped.
+     *
+     * @param  path  the path of the file.
+     * @param  capacity  the size of the file, if it is created.  An
+     *             existing file keeps its size.
+     *
+     * @return <code>true</code> means the spool is open.
+     *         <code>false</code> means it is not; <code>getException()</code>
+     *             tells why.
+     */
+    bool open(const std::string &path, uint64_t capacity = DEFAULT_CAPACITY);
+
+    /**
+     * Close the spool.  Records not yet posted stay in the file.  No other
+     * call on the spool may be running.
+     */
+    void close();
+
+    /**
+     * Test if the spool is open.
+     */
+    bool isOpen();
+
+    /**
+     * Append a block to the spool.  The record is written to memory only;
+     * call <code>commit()</code> to make it durable.
+     *
+     * @param  tableLocation  the URI of the table to post the block to.
+     * @param  block  the block.  It is encoded with
+     *             <code>YosokumoProtobuf</code>.
+     * @param  ticket  set to the position just past the record, to pass to
+     *             <code>commit()</code>.
+     *
+     * @return <code>true</code> means the block was appended.
+     *         <code>false</code> means it was not (e.g., the spool is
+     *             full); <code>getException()</code> tells why.
+     */
+    bool append(
+        const std::string &tableLocation,
+        const Block       &block,
+        uint64_t          &ticket);
+
+    /**
+     * Append an encoded block to the spool.  As above, except the block is
+     * given as its encoding.
+     */
+    bool append(
+        const std::string          &tableLocation,
+        const std::vector<uint8_t> &bytes,
+        uint64_t                   &ticket);
+
+    /**
+     * Wait until a record, and every record appended before it, is
+     * durable.
+     *
+     * @param  ticket  the ticket set by <code>append()</code>.
+     *
+     * @return <code>true</code> means the records are durable.
+     */
+    bool commit(uint64_t ticket);
+
+    /**
+     * Wait until every record appended so far is durable.
+     *
+     * @return <code>true</code> means the records are durable.
+     */
+    bool commit();
+
+    /**
+     * Post the records not yet posted, in the order they were appended,
+     * and remove each one the server accepts.  Stops at the first record
+     * which fails, which stays in the spool.  Records appended while
+     * <code>replay()</code> runs are posted too.  Calls run one at a time.
+     *
+     * @param  service  the service through which to post.
+     *
+     * @return <code>true</code> means every record was posted.
+     *         <code>false</code> means a record failed;
+     *             <code>getException()</code> returns the failure.
+     */
+    bool replay(Service &service);
+
+    /**
+     * Return the number of records not yet posted.
+     */
+    size_t size();
+
+    /**
+     * Return the number of syncs done since the spool was opened.
+     */
+    uint64_t getSyncCount();
+
+    /**
+     * Return the reason for the last failure.
+     */
+    ServiceException getException();
+
+private:
+
+    bool fail(const std::string &message, const std::string &operation);
+
+    bool readRecord(
+        uint64_t offset,
+        uint32_t lastLap,
+        uint32_t &recordLap,
+        uint64_t &next);
+
+    void writeHeader();
+
+    bool syncRange(uint64_t begin, uint64_t end);
+
+    void rewind();
+
+    /**
+     * Copy constructor - NOT IMPLEMENTED.
+     */
+    BlockSpool(const BlockSpool &rhs);
+
+    /**
+     * Assignment operator - NOT IMPLEMENTED.
+     */
+    BlockSpool& operator=(const BlockSpool& rhs);
+
+};  // end class BlockSpool
+
+}   // end namespace Yosokumo
+
+#endif  // BLOCKSPOOL_H
+
+// end BlockSpool.h
@@ -1,9 +1,9 @@
 // Catalog.h
 
-#include <cassert>
 #include <sstream>
 
 #include "Catalog.h"
+#include "AllocationTracker.h"
 
 using namespace Yosokumo;
 
@@ -31,6 +31,8 @@ Catalog::~Catalog()
 
 Catalog &Catalog::operator=(const Catalog& rhs)
 {
+    YOSOKUMO_TRACK_ALLOCATIONS("Catalog::operator=");
+
     if (this == &rhs)
         return *this;
 
@@ -52,22 +54,7 @@ bool Catalog::operator==(const Catalog &rhs) const
     ))
         return false;
 
-    StudyConstIterator iter;
- 
-    for (iter = begin();  iter != end();  ++iter)
-    {
-        Study study = iter->second;
-        const std::string studyIdentifier = study.getStudyIdentifier();
-        Study rhsStudy;
-
-        if (!rhs.getStudy(studyIdentifier, rhsStudy))
-            return false;
-        
-        if (study != rhsStudy)
-            return false;
-    }
-
-    return true;
+    return studyCollection == rhs.studyCollection;
 }
 
 bool Catalog::operator!=(const Catalog &rhs) const
@@ -79,10 +66,12 @@ bool Catalog::operator!=(const Catalog &rhs) const
 
 void Catalog::copyCatalog(Catalog &t, const Catalog &s)
 {
-    t.setUserIdentifier (s.getUserIdentifier() );
+    t.userIdentifier = s.userIdentifier;
     t.setUserName       (s.getUserName()       );
     t.setCatalogLocation(s.getCatalogLocation());
 
+    t.reserveStudies(t.size() + s.size());
+
     StudyConstIterator iter;
  
     for (iter = s.begin();  iter != s.end();  ++iter)
@@ -94,10 +83,15 @@ void Catalog::copyCatalog(Catalog &t, const Catalog &s)
 
 void Catalog::setUserIdentifier(const std::string &id)
 {
-    userIdentifier = id;
+    userIdentifier = Identifier(id);
 }
 
 std::string Catalog::getUserIdentifier() const
+{
+    return userIdentifier.str();
+}
+
+const Identifier &Catalog::getUserIdentifierHandle() const
 {
     return userIdentifier;
 }
@@ -126,38 +120,19 @@ std::string Catalog::getCatalogLocation() const
 
 bool Catalog::addStudy(const Study &newStudy, Study &oldStudy)
 {
-    std::pair<std::string, Study> keyStudy = 
-        std::make_pair(newStudy.getStudyIdentifier(), newStudy);
-
-    std::pair<StudyIterator, bool> ret;
-
-    ret = studyCollection.insert(keyStudy);
-
-    if (ret.second)
-        return true;
-
-    StudyIterator iter = ret.first;
-    oldStudy = iter->second;
-
-    studyCollection.erase(ret.first);
-
-    ret = studyCollection.insert(keyStudy);
-
-    assert(ret.second);
-
-    return false;
+    return studyCollection.insert(
+                    newStudy.getStudyIdentifierHandle(), newStudy, &oldStudy);
 }
 
 bool Catalog::addStudy(const Study &newStudy)
- {
-     Study oldStudy;
-
-     return addStudy(newStudy, oldStudy);
- }
+{
+    return studyCollection.insert(
+                    newStudy.getStudyIdentifierHandle(), newStudy);
+}
 
 bool Catalog::removeStudy(const std::string &studyIdentifier)
 {
-    return (studyCollection.erase(studyIdentifier) == 1);
+    return studyCollection.erase(studyIdentifier);
 }
 
 void Catalog::clearStudies()
@@ -167,21 +142,29 @@ void Catalog::clearStudies()
 
 bool Catalog::getStudy(const std::string &studyIdentifier, Study &foundStudy) const
 {
-    StudyConstIterator iter;
-
-    iter = studyCollection.find(studyIdentifier);
+    const Study *study = studyCollection.find(studyIdentifier);
 
-    if (iter == studyCollection.end())
+    if (study == NULL)
         return false;
 
-    foundStudy = iter->second;
+    foundStudy = *study;
 
     return true;
 }
 
 bool Catalog::containsStudy(const std::string &studyIdentifier) const
 {
-    return (studyCollection.find(studyIdentifier) != studyCollection.end());
+    return (studyCollection.find(studyIdentifier) != NULL);
+}
+
+const Study *Catalog::findStudy(const Identifier &studyIdentifier) const
+{
+    return studyCollection.find(studyIdentifier);
+}
+
+bool Catalog::removeStudy(const Identifier &studyIdentifier)
+{
+    return studyCollection.erase(studyIdentifier);
 }
 
 int Catalog::size() const
@@ -189,6 +172,16 @@ int Catalog::size() const
     return studyCollection.size();
 }
 
+void Catalog::reserveStudies(int n)
+{
+    studyCollection.reserve(n);
+}
+
+void Catalog::sortStudies()
+{
+    studyCollection.sort();
+}
+
 bool Catalog::isEmpty() const
 {
     return studyCollection.empty();
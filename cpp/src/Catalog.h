@@ -4,8 +4,8 @@
 #define CATALOG_H
 
 #include <string>
-#include <map>
 
+#include "IdentifierMap.h"
 #include "Study.h"
 
 namespace Yosokumo
@@ -28,7 +28,7 @@ class Catalog
     /**
      * Identifier of the user to whom the catalog belongs.
      */
-    std::string userIdentifier;
+    Identifier userIdentifier;
 
     /**
      * User name of the user to whom the catalog belongs.
@@ -40,12 +40,12 @@ class Catalog
      */
     std::string catalogLocation;
 
-    // At present the studyCollection map is implemented as an STL map
-    // because this implementation has O(ln n) performance for insert, remove,
-    // and find, and O(1) for "next".  The latter is used to iterate 
-    // over the map, and thus we do not want it to be expensive.  
+    // The studyCollection map is implemented as an IdentifierMap, which
+    // has O(1) average performance for insert, remove, and find, and whose
+    // entries lie in one vector, so "next" is cheap.  Catalogs may hold
+    // tens of thousands of studies.
 
-    typedef std::map<std::string, Study> StudyMap;
+    typedef IdentifierMap<Study> StudyMap;
 
     /**
      * Collection of studies comprising the catalog.
@@ -160,6 +160,14 @@ public:
      */
     std::string getUserIdentifier() const;
 
+    /**
+     * Return the user identifier, interned.
+     *
+     * @return the interned identifier of the user to whom the catalog
+     * belongs.
+     */
+    const Identifier &getUserIdentifierHandle() const;
+
     /**
      * Set the user name.
      *
@@ -279,6 +287,27 @@ public:
      */
     bool containsStudy(const std::string &studyIdentifier) const;
 
+    /**
+     * Return a study in the catalog, without copying it.
+     *
+     * @param   studyIdentifier the interned identifier of the study.
+     *
+     * @return  the study, or NULL if there is no study in the catalog with
+     *              the identifier.  The pointer is valid until the catalog
+     *              is next changed.
+     */
+    const Study *findStudy(const Identifier &studyIdentifier) const;
+
+    /**
+     * Remove a study from the catalog.
+     *
+     * @param   studyIdentifier the interned identifier of the study.
+     *
+     * @return  <code>true</code> means the study was in the catalog and has
+     *              been removed.
+     */
+    bool removeStudy(const Identifier &studyIdentifier);
+
     /**
      * Return the number of studies in the catalog.
      *
@@ -286,6 +315,21 @@ public:
      */
     int size() const;
 
+    /**
+     * Make room for a number of studies, so that adding them allocates no
+     * more space for the study collection.
+     *
+     * @param  n  the number of studies.
+     */
+    void reserveStudies(int n);
+
+    /**
+     * Put the studies in study identifier order, for iteration.  Otherwise
+     * studies are iterated over in the order they were added, except that
+     * removing a study moves the last study into its place.
+     */
+    void sortStudies();
+
     /**
      * Return <code>true</code> if the catalog contains no studies.
      *
@@ -310,6 +354,8 @@ public:
      *   }
      * </pre>
      *
+     * Adding or removing a study invalidates all iterators.
+     *
      * @return an iterator referring to the first study in the catalog.
      */
     StudyIterator begin();
@@ -0,0 +1,165 @@
+// CatalogDelta.cpp
+
+#include <sstream>
+
+#include "CatalogDelta.h"
+
+using namespace Yosokumo;
+
+CatalogDelta::CatalogDelta() :
+    attributesChanged(false)
+{}
+
+CatalogDelta::CatalogDelta(
+    const Catalog &oldCatalog,
+    const Catalog &newCatalog) :
+        attributesChanged(false)
+{
+    compute(oldCatalog, newCatalog);
+}
+
+void CatalogDelta::compute(const Catalog &oldCatalog, const Catalog &newCatalog)
+{
+    userIdentifier  = newCatalog.getUserIdentifier();
+    userName        = newCatalog.getUserName();
+    catalogLocation = newCatalog.getCatalogLocation();
+
+    attributesChanged =
+        oldCatalog.getUserIdentifierHandle() !=
+                                    newCatalog.getUserIdentifierHandle() ||
+        oldCatalog.getUserName()        != userName                      ||
+        oldCatalog.getCatalogLocation() != catalogLocation;
+
+    addedStudies.clear();
+    removedStudies.clear();
+    changedStudies.clear();
+
+    Catalog::StudyConstIterator iter;
+
+    for (iter = newCatalog.begin();  iter != newCatalog.end();  ++iter)
+    {
+        const Study *oldStudy = oldCatalog.findStudy(iter->first);
+
+        if (oldStudy == NULL)
+        {
+            addedStudies.push_back(iter->second);
+            continue;
+        }
+
+        unsigned fields = iter->second.getChangedFields(*oldStudy);
+
+        if (fields != 0)
+        {
+            StudyChange change;
+            change.study  = iter->second;
+            change.fields = fields;
+            changedStudies.push_back(change);
+        }
+    }
+
+    // Every study of the old catalog is either in the new one, found above,
+    // or removed; counting saves the second pass when none were removed
+
+    size_t kept = newCatalog.size() - addedStudies.size();
+
+    if (kept == size_t(oldCatalog.size()))
+        return;
+
+    for (iter = oldCatalog.begin();  iter != oldCatalog.end();  ++iter)
+    {
+        if (newCatalog.findStudy(iter->first) == NULL)
+            removedStudies.push_back(iter->first);
+    }
+}
+
+void CatalogDelta::apply(Catalog &catalog) const
+{
+    if (attributesChanged)
+    {
+        catalog.setUserIdentifier (userIdentifier );
+        catalog.setUserName       (userName       );
+        catalog.setCatalogLocation(catalogLocation);
+    }
+
+    for (size_t i = 0;  i < removedStudies.size();  ++i)
+        catalog.removeStudy(removedStudies[i]);
+
+    for (size_t i = 0;  i < changedStudies.size();  ++i)
+        catalog.addStudy(changedStudies[i].study);
+
+    catalog.reserveStudies(catalog.size() + addedStudies.size());
+
+    for (size_t i = 0;  i < addedStudies.size();  ++i)
+        catalog.addStudy(addedStudies[i]);
+}
+
+bool CatalogDelta::isEmpty() const
+{
+    return !attributesChanged && addedStudies.empty() &&
+                            removedStudies.empty() && changedStudies.empty();
+}
+
+bool CatalogDelta::getAttributesChanged() const
+{
+    return attributesChanged;
+}
+
+const std::string &CatalogDelta::getUserIdentifier() const
+{
+    return userIdentifier;
+}
+
+const std::string &CatalogDelta::getUserName() const
+{
+    return userName;
+}
+
+const std::string &CatalogDelta::getCatalogLocation() const
+{
+    return catalogLocation;
+}
+
+const std::vector<Study> &CatalogDelta::getAddedStudies() const
+{
+    return addedStudies;
+}
+
+const std::vector<Identifier> &CatalogDelta::getRemovedStudies() const
+{
+    return removedStudies;
+}
+
+const std::vector<CatalogDelta::StudyChange> &
+CatalogDelta::getChangedStudies() const
+{
+    return changedStudies;
+}
+
+std::string CatalogDelta::toString() const
+{
+    std::stringstream s;
+
+    s << "CatalogDelta:" << "\n";
+
+    if (attributesChanged)
+        s <<
+            "  userIdentifier  = " << userIdentifier  << "\n" <<
+            "  userName        = " << userName        << "\n" <<
+            "  catalogLocation = " << catalogLocation << "\n"
+        ;
+
+    for (size_t i = 0;  i < addedStudies.size();  ++i)
+        s << "  added    " << addedStudies[i].getStudyIdentifier() << "\n";
+
+    for (size_t i = 0;  i < removedStudies.size();  ++i)
+        s << "  removed  " << removedStudies[i] << "\n";
+
+    for (size_t i = 0;  i < changedStudies.size();  ++i)
+        s << "  changed  " << changedStudies[i].study.getStudyIdentifier() <<
+             "  fields " << std::hex << changedStudies[i].fields << std::dec <<
+             "\n";
+
+    return s.str();
+}
+
+// end CatalogDelta.cpp
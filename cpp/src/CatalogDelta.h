@@ -0,0 +1,143 @@
+// CatalogDelta.h
+
+#ifndef CATALOGDELTA_H
+#define CATALOGDELTA_H
+
+#include <string>
+#include <vector>
+
+#include "Catalog.h"
+#include "Identifier.h"
+#include "Study.h"
+
+namespace Yosokumo
+{
+/**
+ * The difference between two versions of a catalog:  the studies added, the
+ * studies removed, and the studies changed, with the attributes which
+ * changed.  A client which keeps a copy of its catalog can fetch a fresh
+ * catalog, compute the delta from its copy, and apply the delta to the copy
+ * in place; the cost then depends on the number of studies which changed,
+ * not on the size of the catalog, and caches kept per study need only
+ * hear about the studies in the delta.
+ * <p>
+ * Computing a delta takes O(n) time, n being the number of studies, as
+ * studies are matched up by interned identifier.
+ */
+class CatalogDelta
+{
+public:
+
+    /**
+     * A study which is in both catalogs, but differs.
+     */
+    struct StudyChange
+    {
+        /**
+         * The study as it is in the new catalog.
+         */
+        Study    study;
+
+        /**
+         * The <code>Study::Field</code> bits of the attributes which changed.
+         */
+        unsigned fields;
+    };
+
+private:
+
+    // Attributes of the new catalog
+
+    std::string userIdentifier;
+    std::string userName;
+    std::string catalogLocation;
+    bool        attributesChanged;
+
+    std::vector<Study>       addedStudies;
+    std::vector<Identifier>  removedStudies;
+    std::vector<StudyChange> changedStudies;
+
+public:
+
+    /**
+     * Initializes a newly created <code>CatalogDelta</code> which changes
+     * nothing.
+     */
+    CatalogDelta();
+
+    /**
+     * Initializes a newly created <code>CatalogDelta</code> to the
+     * difference between two catalogs.
+     *
+     * @param  oldCatalog  the catalog as it was.
+     * @param  newCatalog  the catalog as it is.
+     */
+    CatalogDelta(const Catalog &oldCatalog, const Catalog &newCatalog);
+
+    /**
+     * Set this delta to the difference between two catalogs.
+     *
+     * @param  oldCatalog  the catalog as it was.
+     * @param  newCatalog  the catalog as it is.
+     */
+    void compute(const Catalog &oldCatalog, const Catalog &newCatalog);
+
+    /**
+     * Apply this delta to a catalog in place.  If the catalog equals the old
+     * catalog of the delta, it then equals the new catalog (though its
+     * studies may be in a different order).  Studies not mentioned in the
+     * delta are not touched.
+     *
+     * @param  catalog  the catalog to change.
+     */
+    void apply(Catalog &catalog) const;
+
+    /**
+     * Return <code>true</code> if the two catalogs were equal.
+     */
+    bool isEmpty() const;
+
+    /**
+     * Return <code>true</code> if the user identifier, user name, or
+     * catalog location changed.
+     */
+    bool getAttributesChanged() const;
+
+    /**
+     * Return the user identifier, user name, and catalog location of the
+     * new catalog.
+     */
+    const std::string &getUserIdentifier() const;
+    const std::string &getUserName() const;
+    const std::string &getCatalogLocation() const;
+
+    /**
+     * Return the studies in the new catalog but not the old.
+     */
+    const std::vector<Study> &getAddedStudies() const;
+
+    /**
+     * Return the identifiers of the studies in the old catalog but not the
+     * new.
+     */
+    const std::vector<Identifier> &getRemovedStudies() const;
+
+    /**
+     * Return the studies in both catalogs which differ.
+     */
+    const std::vector<StudyChange> &getChangedStudies() const;
+
+    /**
+     * Return a string representation of this <code>CatalogDelta</code>.
+     *
+     * @return  the string representation of this <code>CatalogDelta</code>.
+     */
+    std::string toString() const;
+
+};  // end class CatalogDelta
+
+}   // end namespace Yosokumo
+
+#endif  // CATALOGDELTA_H
+
+// end CatalogDelta.h
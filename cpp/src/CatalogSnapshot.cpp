@@ -0,0 +1,1021 @@
+// CatalogSnapshot.cpp
+
+#include "CatalogSnapshot.h"
+#include "Privilege.h"
+#include "Role.h"
+#include "Thread.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <map>
+
+using namespace Yosokumo;
+
+namespace
+{
+
+// The file is a SnapshotHeader followed by sections, each an array of
+// fixed-size records aligned to 8 bytes:  the studies, the rosters, the
+// roles of all the rosters, the panels, an index for each of studies,
+// rosters, and panels, and last a pool of the bytes of all the strings.
+// A string is a SnapString:  an offset into the pool, and a length.  An
+// index is an array of record numbers, sorted by the key of the record
+// (as bytes), for binary search.
+
+const char     SNAPSHOT_MAGIC[8] = { 'Y', 'S', 'K', 'S', 'N', 'A', 'P', 0 };
+const uint32_t SNAPSHOT_VERSION  = 1;
+const uint32_t BYTE_ORDER_MARK   = 0x01020304;
+
+struct SnapString
+{
+    uint32_t offset;
+    uint32_t length;
+};
+
+struct Section
+{
+    uint64_t offset;
+    uint64_t count;             // Of records, or of bytes for the pool
+};
+
+struct SnapshotHeader
+{
+    char       magic[8];
+    uint32_t   version;
+    uint32_t   byteOrder;
+    uint64_t   fileSize;
+    uint64_t   creationTime;
+    uint32_t   headerCrc;       // Of the header, with this field 0
+    uint32_t   bodyCrc;         // Of everything after the header
+    uint32_t   hasCatalog;
+    uint32_t   reserved;
+    SnapString userIdentifier;
+    SnapString userName;
+    SnapString catalogLocation;
+    SnapString catalogETag;
+    SnapString catalogLastModified;
+    Section    studies;
+    Section    rosters;
+    Section    roles;
+    Section    panels;
+    Section    studyIndex;
+    Section    rosterIndex;
+    Section    panelIndex;
+    Section    strings;
+};
+
+struct StudyRecord
+{
+    SnapString studyIdentifier;             // The key
+    SnapString studyName;
+    SnapString studyLocation;
+    SnapString ownerIdentifier;
+    SnapString ownerName;
+    SnapString tableLocation;
+    SnapString modelLocation;
+    SnapString panelLocation;
+    SnapString rosterLocation;
+    SnapString nameControlLocation;
+    SnapString statusControlLocation;
+    SnapString visibilityControlLocation;
+    SnapString creationTime;
+    SnapString latestBlockTime;
+    SnapString latestProspectTime;
+    uint32_t   type;
+    uint32_t   status;
+    uint32_t   visibility;
+    uint32_t   reserved;
+    uint64_t   blockCount;
+    uint64_t   cellCount;
+    uint64_t   prospectCount;
+};
+
+struct RosterRecord
+{
+    SnapString rosterLocation;              // The key
+    SnapString studyIdentifier;
+    SnapString studyName;
+    SnapString eTag;
+    SnapString lastModified;
+    uint32_t   firstRole;
+    uint32_t   roleCount;
+};
+
+struct RoleRecord
+{
+    SnapString userIdentifier;
+    SnapString userName;
+    SnapString studyIdentifier;
+    SnapString studyName;
+    SnapString roleLocation;
+    uint32_t   privileges;                  // Bit n is privilege n
+    uint32_t   reserved;
+};
+
+struct PanelRecord
+{
+    SnapString panelLocation;               // The key
+    SnapString nameControlLocation;
+    SnapString statusControlLocation;
+    SnapString visibilityControlLocation;
+    SnapString creationTime;
+    SnapString latestBlockTime;
+    SnapString latestProspectTime;
+    SnapString eTag;
+    SnapString lastModified;
+    uint32_t   reserved[2];
+    uint64_t   blockCount;
+    uint64_t   cellCount;
+    uint64_t   prospectCount;
+};
+
+uint64_t align8(uint64_t n)
+{
+    return (n + 7) & ~uint64_t(7);
+}
+
+uint32_t headerCrc(const SnapshotHeader &header)
+{
+    SnapshotHeader h;
+    memcpy(&h, &header, sizeof(h));
+    h.headerCrc = 0;
+
+    return uint32_t(crc32(crc32(0L, Z_NULL, 0), (const Bytef *)&h,
+                                                                sizeof(h)));
+}
+
+//********************************   Writing   ****************************
+
+// The strings of a snapshot being written, each kept once
+
+class StringPool
+{
+    std::vector<uint8_t>            bytes;
+    std::map<std::string, uint32_t> offsets;
+
+public:
+
+    bool overflow;
+
+    StringPool() : overflow(false)
+    {}
+
+    SnapString add(const std::string &s)
+    {
+        SnapString r = { 0, uint32_t(s.size()) };
+        if (s.empty())
+            return r;
+
+        std::map<std::string, uint32_t>::iterator it = offsets.find(s);
+        if (it != offsets.end())
+        {
+            r.offset = it->second;
+            return r;
+        }
+
+        if (bytes.size() + s.size() > 0xffffffffu)
+        {
+            overflow = true;
+            r.length = 0;
+            return r;
+        }
+
+        r.offset = uint32_t(bytes.size());
+        bytes.insert(bytes.end(), s.begin(), s.end());
+        offsets[s] = r.offset;
+        return r;
+    }
+
+    const std::vector<uint8_t> &getBytes() const
+    {
+        return bytes;
+    }
+};
+
+// Orders record numbers by the keys of the records
+
+class KeyLess
+{
+    const std::vector<std::string> &keys;
+
+public:
+
+    KeyLess(const std::vector<std::string> &keys) : keys(keys)
+    {}
+
+    bool operator()(uint32_t a, uint32_t b) const
+    {
+        return keys[a] < keys[b];
+    }
+};
+
+std::vector<uint32_t> makeIndex(const std::vector<std::string> &keys)
+{
+    std::vector<uint32_t> index(keys.size());
+    for (size_t i = 0;  i < index.size();  ++i)
+        index[i] = uint32_t(i);
+
+    std::stable_sort(index.begin(), index.end(), KeyLess(keys));
+    return index;
+}
+
+// Append the bytes of an array of records to the file, aligned to 8, and
+// return where they went
+
+template <class T>
+Section appendSection(std::vector<uint8_t> &file, const std::vector<T> &v)
+{
+    file.resize(align8(file.size()), 0);
+
+    Section s = { file.size(), v.size() };
+    if (!v.empty())
+    {
+        const uint8_t *p = (const uint8_t *)&v[0];
+        file.insert(file.end(), p, p + v.size() * sizeof(T));
+    }
+    return s;
+}
+
+bool writeAll(int fd, const uint8_t *p, size_t n)
+{
+    while (n > 0)
+    {
+        ssize_t k = ::write(fd, p, n);
+        if (k < 0 && errno == EINTR)
+            continue;
+        if (k == 0)
+            errno = EIO;
+        if (k <= 0)
+            return false;
+        p += k;
+        n -= size_t(k);
+    }
+    return true;
+}
+
+// Flush the directory holding path, so that a file created or renamed in
+// it survives a crash.  On failure set reason.
+
+bool syncDirectoryOf(const std::string &path, std::string &reason)
+{
+    std::string::size_type slash = path.rfind('/');
+    std::string directory = (slash == std::string::npos) ? "." :
+                            (slash == 0) ? "/" : path.substr(0, slash);
+
+    int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd < 0)
+    {
+        reason = strerror(errno);
+        return false;
+    }
+
+    bool ok = (fsync(fd) == 0);
+    if (!ok)
+        reason = strerror(errno);
+
+    ::close(fd);
+
+    return ok;
+}
+
+//********************************   Reading   ****************************
+
+const SnapshotHeader &headerOf(const uint8_t *map)
+{
+    return *(const SnapshotHeader *)map;
+}
+
+// Return a record of a section, or NULL if the section does not hold it.
+// open() has checked that every section lies within the file.
+
+template <class T>
+const T *recordOf(const uint8_t *map, const Section &section, uint64_t i)
+{
+    if (i >= section.count)
+        return NULL;
+
+    return (const T *)(map + section.offset) + i;
+}
+
+bool getString(const uint8_t *map, const SnapString &s, std::string &out)
+{
+    const Section &pool = headerOf(map).strings;
+
+    if (uint64_t(s.offset) + s.length > pool.count)
+    {
+        out.clear();
+        return false;
+    }
+
+    out.assign((const char *)map + pool.offset + s.offset, s.length);
+    return true;
+}
+
+std::string stringOf(const uint8_t *map, const SnapString &s, bool &ok)
+{
+    std::string out;
+    if (!getString(map, s, out))
+        ok = false;
+    return out;
+}
+
+// Compare a key with a string of the pool, as bytes
+
+int compareKey(const uint8_t *map, const std::string &key, const SnapString &s)
+{
+    const Section &pool = headerOf(map).strings;
+
+    if (uint64_t(s.offset) + s.length > pool.count)
+        return 1;
+
+    size_t n = std::min(key.size(), size_t(s.length));
+    int c = memcmp(key.data(), map + pool.offset + s.offset, n);
+    if (c != 0)
+        return c;
+
+    return (key.size() < s.length) ? -1 : (key.size() > s.length) ? 1 : 0;
+}
+
+// Find a record by its key (its first field) with a binary search of the
+// index of its section
+
+template <class T>
+const T *findRecord(
+    const uint8_t     *map,
+    const Section     &records,
+    const Section     &index,
+    const std::string &key)
+{
+    const uint32_t *numbers = (const uint32_t *)(map + index.offset);
+
+    uint64_t low  = 0;
+    uint64_t high = index.count;
+
+    while (low < high)
+    {
+        uint64_t middle = low + (high - low) / 2;
+        const T *r = recordOf<T>(map, records, numbers[middle]);
+        if (r == NULL)
+            return NULL;
+
+        int c = compareKey(map, key, *(const SnapString *)r);
+        if (c == 0)
+            return r;
+        if (c < 0)
+            high = middle;
+        else
+            low = middle + 1;
+    }
+
+    return NULL;
+}
+
+bool makeStudy(const uint8_t *map, const StudyRecord &r, Study &study)
+{
+    bool ok = true;
+
+    study = Study();
+    study.setStudyIdentifier(stringOf(map, r.studyIdentifier, ok));
+    study.setStudyName      (stringOf(map, r.studyName,       ok));
+    study.setStudyLocation  (stringOf(map, r.studyLocation,   ok));
+    study.setType           (Study::Type(r.type));
+    study.setStatus         (Study::Status(r.status));
+    study.setVisibility     (Study::Visibility(r.visibility));
+    study.setOwnerIdentifier(stringOf(map, r.ownerIdentifier, ok));
+    study.setOwnerName      (stringOf(map, r.ownerName,       ok));
+    study.setTableLocation  (stringOf(map, r.tableLocation,   ok));
+    study.setModelLocation  (stringOf(map, r.modelLocation,   ok));
+    study.setPanelLocation  (stringOf(map, r.panelLocation,   ok));
+    study.setRosterLocation (stringOf(map, r.rosterLocation,  ok));
+
+    study.setNameControlLocation(
+                        stringOf(map, r.nameControlLocation, ok));
+    study.setStatusControlLocation(
+                        stringOf(map, r.statusControlLocation, ok));
+    study.setVisibilityControlLocation(
+                        stringOf(map, r.visibilityControlLocation, ok));
+
+    study.setBlockCount        (r.blockCount);
+    study.setCellCount         (r.cellCount);
+    study.setProspectCount     (r.prospectCount);
+    study.setCreationTime      (stringOf(map, r.creationTime,       ok));
+    study.setLatestBlockTime   (stringOf(map, r.latestBlockTime,    ok));
+    study.setLatestProspectTime(stringOf(map, r.latestProspectTime, ok));
+
+    return ok;
+}
+
+}   // end anonymous namespace
+
+//*************************   CatalogSnapshotWriter   *********************
+
+CatalogSnapshotWriter::CatalogSnapshotWriter() :
+    hasCatalog(false)
+{}
+
+void CatalogSnapshotWriter::setCatalog(
+    const Catalog     &catalog,
+    const std::string &eTag,
+    const std::string &lastModified)
+{
+    this->catalog       = catalog;
+    catalogETag         = eTag;
+    catalogLastModified = lastModified;
+    hasCatalog          = true;
+}
+
+void CatalogSnapshotWriter::addRoster(
+    const Roster      &roster,
+    const std::string &eTag,
+    const std::string &lastModified)
+{
+    rosters.push_back(RosterEntry());
+    rosters.back().roster       = roster;
+    rosters.back().eTag         = eTag;
+    rosters.back().lastModified = lastModified;
+}
+
+void CatalogSnapshotWriter::addPanel(
+    const std::string &panelLocation,
+    const Panel       &panel,
+    const std::string &eTag,
+    const std::string &lastModified)
+{
+    panels.push_back(PanelEntry());
+    panels.back().panelLocation = panelLocation;
+    panels.back().panel         = panel;
+    panels.back().eTag          = eTag;
+    panels.back().lastModified  = lastModified;
+}
+
+void CatalogSnapshotWriter::clear()
+{
+    hasCatalog = false;
+    catalog = Catalog();
+    catalogETag.clear();
+    catalogLastModified.clear();
+    rosters.clear();
+    panels.clear();
+}
+
+bool CatalogSnapshotWriter::write(const std::string &path)
+{
+    exception = ServiceException();
+
+    StringPool               pool;
+    std::vector<StudyRecord> studyRecords;
+    std::vector<std::string> studyKeys;
+
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version      = SNAPSHOT_VERSION;
+    header.byteOrder    = BYTE_ORDER_MARK;
+    header.creationTime = Thread::currentTimeMillis();
+
+    if (hasCatalog)
+    {
+        header.hasCatalog          = 1;
+        header.userIdentifier      = pool.add(catalog.getUserIdentifier());
+        header.userName            = pool.add(catalog.getUserName());
+        header.catalogLocation     = pool.add(catalog.getCatalogLocation());
+        header.catalogETag         = pool.add(catalogETag);
+        header.catalogLastModified = pool.add(catalogLastModified);
+
+        Catalog::StudyConstIterator it;
+        for (it = catalog.begin();  it != catalog.end();  ++it)
+        {
+            const Study &s = it->second;
+            StudyRecord r;
+            memset(&r, 0, sizeof(r));
+
+            r.studyIdentifier    = pool.add(s.getStudyIdentifier());
+            r.studyName          = pool.add(s.getStudyName());
+            r.studyLocation      = pool.add(s.getStudyLocation());
+            r.ownerIdentifier    = pool.add(s.getOwnerIdentifier());
+            r.ownerName          = pool.add(s.getOwnerName());
+            r.tableLocation      = pool.add(s.getTableLocation());
+            r.modelLocation      = pool.add(s.getModelLocation());
+            r.panelLocation      = pool.add(s.getPanelLocation());
+            r.rosterLocation     = pool.add(s.getRosterLocation());
+            r.nameControlLocation =
+                                pool.add(s.getNameControlLocation());
+            r.statusControlLocation =
+                                pool.add(s.getStatusControlLocation());
+            r.visibilityControlLocation =
+                                pool.add(s.getVisibilityControlLocation());
+            r.creationTime       = pool.add(s.getCreationTime());
+            r.latestBlockTime    = pool.add(s.getLatestBlockTime());
+            r.latestProspectTime = pool.add(s.getLatestProspectTime());
+            r.type               = uint32_t(s.getType());
+            r.status             = uint32_t(s.getStatus());
+            r.visibility         = uint32_t(s.getVisibility());
+            r.blockCount         = s.getBlockCount();
+            r.cellCount          = s.getCellCount();
+            r.prospectCount      = s.getProspectCount();
+
+            studyRecords.push_back(r);
+            studyKeys.push_back(s.getStudyIdentifier());
+        }
+    }
+
+    std::vector<RosterRecord> rosterRecords;
+    std::vector<RoleRecord>   roleRecords;
+    std::vector<std::string>  rosterKeys;
+
+    for (size_t i = 0;  i < rosters.size();  ++i)
+    {
+        const Roster &roster = rosters[i].roster;
+        RosterRecord r;
+        memset(&r, 0, sizeof(r));
+
+        r.rosterLocation  = pool.add(roster.getRosterLocation());
+        r.studyIdentifier = pool.add(roster.getStudyIdentifier());
+        r.studyName       = pool.add(roster.getStudyName());
+        r.eTag            = pool.add(rosters[i].eTag);
+        r.lastModified    = pool.add(rosters[i].lastModified);
+        r.firstRole       = uint32_t(roleRecords.size());
+        r.roleCount       = uint32_t(roster.size());
+
+        Roster::RoleConstIterator it;
+        for (it = roster.begin();  it != roster.end();  ++it)
+        {
+            const Role &role = it->second;
+            RoleRecord rr;
+            memset(&rr, 0, sizeof(rr));
+
+            rr.userIdentifier  = pool.add(role.getUserIdentifier());
+            rr.userName        = pool.add(role.getUserName());
+            rr.studyIdentifier = pool.add(role.getStudyIdentifier());
+            rr.studyName       = pool.add(role.getStudyName());
+            rr.roleLocation    = pool.add(role.getRoleLocation());
+
+            for (int p = 1;  p <= Privilege::NUMBER_OF_PRIVILEGES;  ++p)
+                if (role.getPrivilege(Privilege(p)))
+                    rr.privileges |= uint32_t(1) << p;
+
+            roleRecords.push_back(rr);
+        }
+
+        rosterRecords.push_back(r);
+        rosterKeys.push_back(roster.getRosterLocation());
+    }
+
+    std::vector<PanelRecord> panelRecords;
+    std::vector<std::string> panelKeys;
+
+    for (size_t i = 0;  i < panels.size();  ++i)
+    {
+        const Panel &p = panels[i].panel;
+        PanelRecord r;
+        memset(&r, 0, sizeof(r));
+
+        r.panelLocation      = pool.add(panels[i].panelLocation);
+        r.nameControlLocation =
+                            pool.add(p.getNameControlLocation());
+        r.statusControlLocation =
+                            pool.add(p.getStatusControlLocation());
+        r.visibilityControlLocation =
+                            pool.add(p.getVisibilityControlLocation());
+        r.creationTime       = pool.add(p.getCreationTime());
+        r.latestBlockTime    = pool.add(p.getLatestBlockTime());
+        r.latestProspectTime = pool.add(p.getLatestProspectTime());
+        r.eTag               = pool.add(panels[i].eTag);
+        r.lastModified       = pool.add(panels[i].lastModified);
+        r.blockCount         = p.getBlockCount();
+        r.cellCount          = p.getCellCount();
+        r.prospectCount      = p.getProspectCount();
+
+        panelRecords.push_back(r);
+        panelKeys.push_back(panels[i].panelLocation);
+    }
+
+    if (pool.overflow)
+    {
+        exception = ServiceException("Snapshot strings exceed 4 GB",
+                                                                    "write");
+        return false;
+    }
+
+    // Lay out the file
+
+    std::vector<uint8_t> file(sizeof(header), 0);
+
+    header.studies     = appendSection(file, studyRecords);
+    header.rosters     = appendSection(file, rosterRecords);
+    header.roles       = appendSection(file, roleRecords);
+    header.panels      = appendSection(file, panelRecords);
+    header.studyIndex  = appendSection(file, makeIndex(studyKeys));
+    header.rosterIndex = appendSection(file, makeIndex(rosterKeys));
+    header.panelIndex  = appendSection(file, makeIndex(panelKeys));
+    header.strings     = appendSection(file, pool.getBytes());
+
+    header.fileSize = file.size();
+    header.bodyCrc  = uint32_t(crc32(crc32(0L, Z_NULL, 0),
+                    &file[sizeof(header)], uInt(file.size() - sizeof(header))));
+    header.headerCrc = headerCrc(header);
+    memcpy(&file[0], &header, sizeof(header));
+
+    // Write it under a temporary name, rename it over the old file only
+    // once it is durable, and then make the rename durable
+
+    std::string temporary = path + ".tmp";
+
+    int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        exception = ServiceException("Cannot create " + temporary + ": " +
+                                                    strerror(errno), "write");
+        return false;
+    }
+
+    std::string reason;
+
+    bool ok = writeAll(fd, &file[0], file.size()) && fsync(fd) == 0;
+    if (!ok)
+        reason = strerror(errno);
+
+    if (::close(fd) != 0 && ok)
+    {
+        ok = false;
+        reason = strerror(errno);
+    }
+
+    if (ok && rename(temporary.c_str(), path.c_str()) != 0)
+    {
+        ok = false;
+        reason = strerror(errno);
+    }
+
+    if (!ok)
+    {
+        unlink(temporary.c_str());
+        exception = ServiceException("Cannot write " + path + ": " + reason,
+                                                                    "write");
+        return false;
+    }
+
+    if (!syncDirectoryOf(path, reason))
+    {
+        exception = ServiceException("Cannot sync the directory of " + path +
+                                                    ": " + reason, "write");
+        return false;
+    }
+
+    return true;
+}
+
+ServiceException CatalogSnapshotWriter::getException() const
+{
+    return exception;
+}
+
+//****************************   CatalogSnapshot   ************************
+
+CatalogSnapshot::CatalogSnapshot() :
+    map (NULL),
+    size(0)
+{}
+
+CatalogSnapshot::~CatalogSnapshot()
+{
+    close();
+}
+
+bool CatalogSnapshot::open(const std::string &path)
+{
+    close();
+
+    exception = ServiceException();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return fail("Cannot open " + path + ": " + strerror(errno), "open");
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        int error = errno;
+        ::close(fd);
+        return fail("Cannot stat " + path + ": " + strerror(error), "open");
+    }
+
+    if (uint64_t(st.st_size) < sizeof(SnapshotHeader))
+    {
+        ::close(fd);
+        return fail(path + " is not a snapshot", "open");
+    }
+
+    size_t length = size_t(st.st_size);
+    void *p = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+    int error = errno;
+    ::close(fd);
+
+    if (p == MAP_FAILED)
+        return fail("Cannot map " + path + ": " + strerror(error), "open");
+
+    map  = (const uint8_t *)p;
+    size = length;
+
+    // Check the header, and that each section lies within the file
+
+    const SnapshotHeader &h = headerOf(map);
+
+    if (memcmp(h.magic, SNAPSHOT_MAGIC, sizeof(h.magic)) != 0)
+        return fail(path + " is not a snapshot", "open");
+
+    if (h.byteOrder != BYTE_ORDER_MARK)
+        return fail(path + " has the wrong byte order", "open");
+
+    if (h.version != SNAPSHOT_VERSION)
+        return fail(path + " has an unknown version", "open");
+
+    if (h.headerCrc != headerCrc(h) || h.fileSize != size)
+        return fail(path + " is damaged", "open");
+
+    const Section *sections[] =
+    {
+        &h.studies, &h.rosters, &h.roles, &h.panels,
+        &h.studyIndex, &h.rosterIndex, &h.panelIndex, &h.strings
+    };
+    const uint64_t recordSizes[] =
+    {
+        sizeof(StudyRecord), sizeof(RosterRecord), sizeof(RoleRecord),
+        sizeof(PanelRecord), sizeof(uint32_t), sizeof(uint32_t),
+        sizeof(uint32_t), 1
+    };
+
+    for (size_t i = 0;  i < sizeof(sections) / sizeof(sections[0]);  ++i)
+    {
+        const Section &s = *sections[i];
+
+        if (s.offset % 8 != 0 || s.offset < sizeof(SnapshotHeader) ||
+                s.offset > size ||
+                s.count > (size - s.offset) / recordSizes[i])
+            return fail(path + " is damaged", "open");
+    }
+
+    if (h.studyIndex.count  != h.studies.count ||
+        h.rosterIndex.count != h.rosters.count ||
+        h.panelIndex.count  != h.panels.count)
+        return fail(path + " is damaged", "open");
+
+    return true;
+}
+
+void CatalogSnapshot::close()
+{
+    if (map != NULL)
+        munmap((void *)map, size);
+
+    map  = NULL;
+    size = 0;
+}
+
+bool CatalogSnapshot::isOpen() const
+{
+    return map != NULL;
+}
+
+bool CatalogSnapshot::verify()
+{
+    exception = ServiceException();
+
+    if (map == NULL)
+    {
+        exception = ServiceException("Snapshot is not open", "verify");
+        return false;
+    }
+
+    uLong crc = crc32(crc32(0L, Z_NULL, 0), map + sizeof(SnapshotHeader),
+                                        uInt(size - sizeof(SnapshotHeader)));
+
+    if (uint32_t(crc) != headerOf(map).bodyCrc)
+    {
+        exception = ServiceException("Snapshot is damaged", "verify");
+        return false;
+    }
+
+    return true;
+}
+
+uint64_t CatalogSnapshot::getCreationTime() const
+{
+    return (map != NULL) ? headerOf(map).creationTime : 0;
+}
+
+bool CatalogSnapshot::hasCatalog() const
+{
+    return map != NULL && headerOf(map).hasCatalog != 0;
+}
+
+bool CatalogSnapshot::getCatalog(Catalog &catalog) const
+{
+    if (!hasCatalog())
+        return false;
+
+    const SnapshotHeader &h = headerOf(map);
+    bool ok = true;
+
+    catalog = Catalog(stringOf(map, h.userIdentifier, ok),
+                                            stringOf(map, h.userName, ok));
+    catalog.setCatalogLocation(stringOf(map, h.catalogLocation, ok));
+    catalog.reserveStudies(int(h.studies.count));
+
+    Study study;
+    for (uint64_t i = 0;  i < h.studies.count;  ++i)
+    {
+        if (!makeStudy(map, *recordOf<StudyRecord>(map, h.studies, i), study))
+            ok = false;
+        catalog.addStudy(study);
+    }
+
+    return ok;
+}
+
+bool CatalogSnapshot::getCatalogValidators(
+    std::string &catalogLocation,
+    std::string &eTag,
+    std::string &lastModified) const
+{
+    if (!hasCatalog())
+        return false;
+
+    const SnapshotHeader &h = headerOf(map);
+
+    return getString(map, h.catalogLocation,     catalogLocation) &&
+           getString(map, h.catalogETag,         eTag)            &&
+           getString(map, h.catalogLastModified, lastModified);
+}
+
+size_t CatalogSnapshot::getStudyCount() const
+{
+    return (map != NULL) ? size_t(headerOf(map).studies.count) : 0;
+}
+
+bool CatalogSnapshot::getStudy(size_t index, Study &study) const
+{
+    if (map == NULL)
+        return false;
+
+    const StudyRecord *r =
+                    recordOf<StudyRecord>(map, headerOf(map).studies, index);
+
+    return r != NULL && makeStudy(map, *r, study);
+}
+
+bool CatalogSnapshot::findStudy(
+    const std::string &studyIdentifier,
+    Study             &study) const
+{
+    if (map == NULL)
+        return false;
+
+    const SnapshotHeader &h = headerOf(map);
+    const StudyRecord *r = findRecord<StudyRecord>(map, h.studies,
+                                            h.studyIndex, studyIdentifier);
+
+    return r != NULL && makeStudy(map, *r, study);
+}
+
+size_t CatalogSnapshot::getRosterCount() const
+{
+    return (map != NULL) ? size_t(headerOf(map).rosters.count) : 0;
+}
+
+bool CatalogSnapshot::findRoster(
+    const std::string &rosterLocation,
+    Roster            &roster) const
+{
+    if (map == NULL)
+        return false;
+
+    const SnapshotHeader &h = headerOf(map);
+    const RosterRecord *r = findRecord<RosterRecord>(map, h.rosters,
+                                            h.rosterIndex, rosterLocation);
+    if (r == NULL)
+        return false;
+
+    if (uint64_t(r->firstRole) + r->roleCount > h.roles.count)
+        return false;
+
+    bool ok = true;
+
+    roster = Roster(stringOf(map, r->studyIdentifier, ok),
+                                        stringOf(map, r->studyName, ok));
+    roster.setRosterLocation(stringOf(map, r->rosterLocation, ok));
+    roster.reserveRoles(int(r->roleCount));
+
+    for (uint32_t i = 0;  i < r->roleCount;  ++i)
+    {
+        const RoleRecord &rr =
+                    *recordOf<RoleRecord>(map, h.roles, r->firstRole + i);
+
+        Role role(stringOf(map, rr.userIdentifier,  ok),
+                  stringOf(map, rr.studyIdentifier, ok));
+        role.setUserName    (stringOf(map, rr.userName,     ok));
+        role.setStudyName   (stringOf(map, rr.studyName,    ok));
+        role.setRoleLocation(stringOf(map, rr.roleLocation, ok));
+
+        for (int p = 1;  p <= Privilege::NUMBER_OF_PRIVILEGES;  ++p)
+            if ((rr.privileges >> p) & 1)
+                role.addPrivilege(Privilege(p));
+
+        roster.addRole(role);
+    }
+
+    return ok;
+}
+
+bool CatalogSnapshot::getRosterValidators(
+    const std::string &rosterLocation,
+    std::string       &eTag,
+    std::string       &lastModified) const
+{
+    if (map == NULL)
+        return false;
+
+    const SnapshotHeader &h = headerOf(map);
+    const RosterRecord *r = findRecord<RosterRecord>(map, h.rosters,
+                                            h.rosterIndex, rosterLocation);
+
+    return r != NULL && getString(map, r->eTag, eTag) &&
+                            getString(map, r->lastModified, lastModified);
+}
+
+size_t CatalogSnapshot::getPanelCount() const
+{
+    return (map != NULL) ? size_t(headerOf(map).panels.count) : 0;
+}
+
+bool CatalogSnapshot::findPanel(
+    const std::string &panelLocation,
+    Panel             &panel) const
+{
+    if (map == NULL)
+        return false;
+
+    const SnapshotHeader &h = headerOf(map);
+    const PanelRecord *r = findRecord<PanelRecord>(map, h.panels,
+                                            h.panelIndex, panelLocation);
+    if (r == NULL)
+        return false;
+
+    bool ok = true;
+
+    panel = Panel();
+    panel.setNameControlLocation(
+                        stringOf(map, r->nameControlLocation, ok));
+    panel.setStatusControlLocation(
+                        stringOf(map, r->statusControlLocation, ok));
+    panel.setVisibilityControlLocation(
+                        stringOf(map, r->visibilityControlLocation, ok));
+    panel.setBlockCount        (r->blockCount);
+    panel.setCellCount         (r->cellCount);
+    panel.setProspectCount     (r->prospectCount);
+    panel.setCreationTime      (stringOf(map, r->creationTime,       ok));
+    panel.setLatestBlockTime   (stringOf(map, r->latestBlockTime,    ok));
+    panel.setLatestProspectTime(stringOf(map, r->latestProspectTime, ok));
+
+    return ok;
+}
+
+bool CatalogSnapshot::getPanelValidators(
+    const std::string &panelLocation,
+    std::string       &eTag,
+    std::string       &lastModified) const
+{
+    if (map == NULL)
+        return false;
+
+    const SnapshotHeader &h = headerOf(map);
+    const PanelRecord *r = findRecord<PanelRecord>(map, h.panels,
+                                            h.panelIndex, panelLocation);
+
+    return r != NULL && getString(map, r->eTag, eTag) &&
+                            getString(map, r->lastModified, lastModified);
+}
+
+ServiceException CatalogSnapshot::getException() const
+{
+    return exception;
+}
+
+bool CatalogSnapshot::fail(
+    const std::string &message,
+    const std::string &operation)
+{
+    close();
+    exception = ServiceException(message, operation);
+    return false;
+}
+
+// end CatalogSnapshot.cpp
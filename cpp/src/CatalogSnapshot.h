@@ -0,0 +1,357 @@
+// CatalogSnapshot.h
+
+#ifndef CATALOGSNAPSHOT_H
+#define CATALOGSNAPSHOT_H
+
+#include "Catalog.h"
+#include "Panel.h"
+#include "Roster.h"
+#include "ServiceException.h"
+#include "Study.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace Yosokumo
+{
+
+/**
+ * Writes a snapshot file of a catalog, the rosters of its studies, and
+ * their panels, together with the validators (ETag and Last-Modified) the
+ * server sent with each, to be read back by <code>CatalogSnapshot</code>.
+ * For example:
+ * <pre>
+ *    CatalogSnapshotWriter writer;
+ *    writer.setCatalog(catalog, eTag, lastModified);
+ *    writer.addRoster(roster, rosterETag, rosterLastModified);
+ *    if (!writer.write("/var/cache/yosokumo/catalog.snap"))
+ *        ...
+ * </pre>
+ * The file is written under a temporary name, synced, and renamed over
+ * the old one, so a reader sees either the old snapshot or the new one,
+ * never a mix.
+ */
+class CatalogSnapshotWriter
+{
+    struct RosterEntry
+    {
+        Roster      roster;
+        std::string eTag;
+        std::string lastModified;
+    };
+
+    struct PanelEntry
+    {
+        std::string panelLocation;
+        Panel       panel;
+        std::string eTag;
+        std::string lastModified;
+    };
+
+    bool                     hasCatalog;
+    Catalog                  catalog;
+    std::string              catalogETag;
+    std::string              catalogLastModified;
+    std::vector<RosterEntry> rosters;
+    std::vector<PanelEntry>  panels;
+    ServiceException         exception;
+
+public:
+
+    /**
+     * Initializes a newly created <code>CatalogSnapshotWriter</code> with
+     * nothing to write.
+     */
+    CatalogSnapshotWriter();
+
+    /**
+     * Set the catalog.
+     *
+     * @param  catalog  the catalog.
+     * @param  eTag  the ETag the server sent with it, or empty.
+     * @param  lastModified  the Last-Modified time the server sent with
+     *             it, or empty.
+     */
+    void setCatalog(
+        const Catalog     &catalog,
+        const std::string &eTag         = "",
+        const std::string &lastModified = "");
+
+    /**
+     * Add a roster.  It is found again by its roster location.
+     *
+     * @param  roster  the roster.
+     * @param  eTag  the ETag the server sent with it, or empty.
+     * @param  lastModified  the Last-Modified time the server sent with
+     *             it, or empty.
+     */
+    void addRoster(
+        const Roster      &roster,
+        const std::string &eTag         = "",
+        const std::string &lastModified = "");
+
+    /**
+     * Add a panel.
+     *
+     * @param  panelLocation  the URI of the panel, by which it is found
+     *             again (see <code>Study::getPanelLocation()</code>).
+     * @param  panel  the panel.
+     * @param  eTag  the ETag the server sent with it, or empty.
+     * @param  lastModified  the Last-Modified time the server sent with
+     *             it, or empty.
+     */
+    void addPanel(
+        const std::string &panelLocation,
+        const Panel       &panel,
+        const std::string &eTag         = "",
+        const std::string &lastModified = "");
+
+    /**
+     * Forget everything set or added.
+     */
+    void clear();
+
+    /**
+     * Write the snapshot file, replacing any file of the same name.
+     *
+     * @param  path  the path of the file.
+     *
+     * @return <code>true</code> means the file was written.
+     *         <code>false</code> means it was not; <code>getException()</code>
+     *             tells why.  Any old file is left as it was.
+     */
+    bool write(const std::string &path);
+
+    /**
+     * Return the reason the last write failed.
+     */
+    ServiceException getException() const;
+
+};  // end class CatalogSnapshotWriter
+
+
+/**
+ * A snapshot file of a catalog, rosters, and panels, as written by
+ * <code>CatalogSnapshotWriter</code>, opened for reading.  A process can
+ * serve from a snapshot as soon as it starts, instead of first fetching
+ * and decoding everything from the server, and then bring it up to date
+ * with conditional requests (see <code>Service::revalidateCatalog()</code>
+ * and friends).  For example:
+ * <pre>
+ *    CatalogSnapshot snapshot;
+ *    if (snapshot.open("/var/cache/yosokumo/catalog.snap"))
+ *    {
+ *        Study study;
+ *        if (snapshot.findStudy(studyIdentifier, study))
+ *            ...
+ *    }
+ * </pre>
+ * The file is mapped into memory and used in place:  the records have a
+ * fixed size, strings are offsets into one pool of bytes, and there are
+ * no pointers to fix up.  So <code>open()</code> takes the same time for
+ * any size of catalog; it checks only the header.  A study, roster, or
+ * panel is decoded when asked for, and found by a binary search of a
+ * sorted index of its key.  Every offset is checked against the bounds of
+ * the file as it is used, so a damaged file gives failures, not crashes;
+ * <code>verify()</code> checks the whole file against its checksum.
+ * <p>
+ * The format is versioned; a file of another version, or written with
+ * the other byte order, is refused by <code>open()</code>.
+ * <p>
+ * Once open, the methods may be called from any number of threads.
+ */
+class CatalogSnapshot
+{
+    const uint8_t    *map;          // NULL means not open
+    size_t           size;
+    ServiceException exception;
+
+public:
+
+    /**
+     * Initializes a newly created <code>CatalogSnapshot</code> which is not
+     * open.
+     */
+    CatalogSnapshot();
+
+    /**
+     * Destructor - closes the snapshot.
+     */
+    ~CatalogSnapshot();
+
+    /**
+     * Open a snapshot file.
+     *
+     * @param  path  the path of the file.
+     *
+     * @return <code>true</code> means the snapshot is open.
+     *         <code>false</code> means it is not; <code>getException()</code>
+     *             tells why.
+     */
+    bool open(const std::string &path);
+
+    /**
+     * Close the snapshot.  No other call on it may be running.
+     */
+    void close();
+
+    /**
+     * Test if the snapshot is open.
+     */
+    bool isOpen() const;
+
+    /**
+     * Check the whole file against its checksum.  Takes time in proportion
+     * to the size of the file.
+     *
+     * @return <code>true</code> means the file is intact.
+     */
+    bool verify();
+
+    /**
+     * Return the time the snapshot was written, in milliseconds since the
+     * epoch.
+     */
+    uint64_t getCreationTime() const;
+
+    /**
+     * Test if the snapshot holds a catalog.
+     */
+    bool hasCatalog() const;
+
+    /**
+     * Get the whole catalog, with every study.  Takes time in proportion to
+     * the number of studies.
+     *
+     * @param  catalog  where to place the catalog.
+     *
+     * @return <code>true</code> means success.
+     */
+    bool getCatalog(Catalog &catalog) const;
+
+    /**
+     * Get the validators of the catalog, to revalidate it with the server.
+     *
+     * @param  catalogLocation  set to the URI of the catalog.
+     * @param  eTag  set to the ETag, or empty.
+     * @param  lastModified  set to the Last-Modified time, or empty.
+     *
+     * @return <code>true</code> means success.
+     */
+    bool getCatalogValidators(
+        std::string &catalogLocation,
+        std::string &eTag,
+        std::string &lastModified) const;
+
+    /**
+     * Return the number of studies in the catalog.
+     */
+    size_t getStudyCount() const;
+
+    /**
+     * Get a study by its position in the catalog.
+     *
+     * @param  index  the position, less than <code>getStudyCount()</code>.
+     * @param  study  where to place the study.
+     *
+     * @return <code>true</code> means success.
+     */
+    bool getStudy(size_t index, Study &study) const;
+
+    /**
+     * Find a study by its identifier.
+     *
+     * @param  studyIdentifier  the study identifier.
+     * @param  study  where to place the study.
+     *
+     * @return <code>true</code> means it was found.
+     */
+    bool findStudy(const std::string &studyIdentifier, Study &study) const;
+
+    /**
+     * Return the number of rosters.
+     */
+    size_t getRosterCount() const;
+
+    /**
+     * Find a roster by its location.
+     *
+     * @param  rosterLocation  the URI of the roster.
+     * @param  roster  where to place the roster.
+     *
+     * @return <code>true</code> means it was found.
+     */
+    bool findRoster(const std::string &rosterLocation, Roster &roster) const;
+
+    /**
+     * Get the validators of a roster, to revalidate it with the server.
+     *
+     * @param  rosterLocation  the URI of the roster.
+     * @param  eTag  set to the ETag, or empty.
+     * @param  lastModified  set to the Last-Modified time, or empty.
+     *
+     * @return <code>true</code> means the roster was found.
+     */
+    bool getRosterValidators(
+        const std::string &rosterLocation,
+        std::string       &eTag,
+        std::string       &lastModified) const;
+
+    /**
+     * Return the number of panels.
+     */
+    size_t getPanelCount() const;
+
+    /**
+     * Find a panel by its location.
+     *
+     * @param  panelLocation  the URI of the panel.
+     * @param  panel  where to place the panel.
+     *
+     * @return <code>true</code> means it was found.
+     */
+    bool findPanel(const std::string &panelLocation, Panel &panel) const;
+
+    /**
+     * Get the validators of a panel, to revalidate it with the server.
+     *
+     * @param  panelLocation  the URI of the panel.
+     * @param  eTag  set to the ETag, or empty.
+     * @param  lastModified  set to the Last-Modified time, or empty.
+     *
+     * @return <code>true</code> means the panel was found.
+     */
+    bool getPanelValidators(
+        const std::string &panelLocation,
+        std::string       &eTag,
+        std::string       &lastModified) const;
+
+    /**
+     * Return the reason for the last failure of <code>open()</code> or
+     * <code>verify()</code>.
+     */
+    ServiceException getException() const;
+
+private:
+
+    bool fail(const std::string &message, const std::string &operation);
+
+    /**
+     * Copy constructor - NOT IMPLEMENTED.
+     */
+    CatalogSnapshot(const CatalogSnapshot &rhs);
+
+    /**
+     * Assignment operator - NOT IMPLEMENTED.
+     */
+    CatalogSnapshot& operator=(const CatalogSnapshot& rhs);
+
+};  // end class CatalogSnapshot
+
+}   // end namespace Yosokumo
+
+#endif  // CATALOGSNAPSHOT_H
+
+// end CatalogSnapshot.h
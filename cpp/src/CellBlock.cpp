@@ -1,6 +1,7 @@
 // CellBlock.cpp
 
 #include "CellBlock.h"
+#include "Hash.h"
 
 using namespace Yosokumo;
 
@@ -58,6 +59,7 @@ CellBlock::~CellBlock()
 
 void CellBlock::addCell(const Cell &cell)
 {
+    cellsFingerprint += hashCellAt(cellSequence.size(), cell);
     cellSequence.push_back(cell);
 }
 
@@ -67,6 +69,7 @@ bool CellBlock::addCells(
 {
     unsigned old_size = cellSequence.size();
     cellSequence.insert(cellSequence.end(), begin, end);
+    addCellsFingerprint(old_size);
     return cellSequence.size() != old_size;
 }
 
@@ -76,6 +79,7 @@ bool CellBlock::addCells(
 {
     unsigned old_size = cellSequence.size();
     cellSequence.insert(cellSequence.end(), begin, end);
+    addCellsFingerprint(old_size);
     return cellSequence.size() != old_size;
 }
 
@@ -87,9 +91,13 @@ bool CellBlock::removeCells(uint64_t numCellsToRemove)
     if (numCellsToRemove >= size())
         clearCells();
     else
+    {
+        subtractCellsFingerprint(size() - numCellsToRemove);
+
         cellSequence.erase(
             cellSequence.end()-numCellsToRemove, 
             cellSequence.end());
+    }
 
     return true;
 }
@@ -104,6 +112,14 @@ Cell CellBlock::getCell(uint64_t index) const
 void CellBlock::clearCells()
 {
     cellSequence.clear();
+    cellsFingerprint = 0;
+}
+
+void CellBlock::swapCells(std::vector<Cell> &cells)
+{
+    cellSequence.swap(cells);
+    cellsFingerprint = 0;
+    addCellsFingerprint(0);
 }
 
 uint64_t CellBlock::size() const
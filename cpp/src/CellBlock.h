@@ -201,6 +201,16 @@ public:
      */
     void clearCells();
 
+    /**
+     * Exchange the cell sequence of the block with a vector of cells, 
+     * without copying either.  Lets a decoder fill in a vector of known 
+     * size, in any order, and then hand it to the block.
+     *
+     * @param  cells  the cells to place in the block; set to the cells 
+     *             which were in the block.
+     */
+    void swapCells(std::vector<Cell> &cells);
+
     /**
      * Return the number of cells in the block.
      *
@@ -0,0 +1,759 @@
+// CompactStudy.cpp
+
+#include "CompactStudy.h"
+#include "LazyCatalog.h"
+
+#include <string.h>
+
+using namespace Yosokumo;
+
+namespace
+{
+
+// For each location slot, the path between the base and the study
+// identifier in the standard layout
+
+const char *const derivedPaths[CompactStudy::SLOT_COUNT] =
+{
+    NULL,                           // STUDY_NAME
+    "/study/",                      // STUDY_LOCATION
+    NULL,                           // OWNER_NAME
+    "/table/",                      // TABLE_LOCATION
+    "/model/",                      // MODEL_LOCATION
+    "/panel/",                      // PANEL_LOCATION
+    "/roster/",                     // ROSTER_LOCATION
+    "/control/name/",               // NAME_CONTROL_LOCATION
+    "/control/status/",             // STATUS_CONTROL_LOCATION
+    "/control/visibility/",         // VISIBILITY_CONTROL_LOCATION
+    NULL,                           // CREATION_TIME
+    NULL,                           // LATEST_BLOCK_TIME
+    NULL                            // LATEST_PROSPECT_TIME
+};
+
+inline bool isTimeSlot(unsigned slot)
+{
+    return slot >= CompactStudy::CREATION_TIME;
+}
+
+std::string getStudySlot(const Study &study, unsigned slot)
+{
+    switch (slot)
+    {
+    case CompactStudy::STUDY_NAME:
+        return study.getStudyName();
+    case CompactStudy::STUDY_LOCATION:
+        return study.getStudyLocation();
+    case CompactStudy::OWNER_NAME:
+        return study.getOwnerName();
+    case CompactStudy::TABLE_LOCATION:
+        return study.getTableLocation();
+    case CompactStudy::MODEL_LOCATION:
+        return study.getModelLocation();
+    case CompactStudy::PANEL_LOCATION:
+        return study.getPanelLocation();
+    case CompactStudy::ROSTER_LOCATION:
+        return study.getRosterLocation();
+    case CompactStudy::NAME_CONTROL_LOCATION:
+        return study.getNameControlLocation();
+    case CompactStudy::STATUS_CONTROL_LOCATION:
+        return study.getStatusControlLocation();
+    case CompactStudy::VISIBILITY_CONTROL_LOCATION:
+        return study.getVisibilityControlLocation();
+    case CompactStudy::CREATION_TIME:
+        return study.getCreationTime();
+    case CompactStudy::LATEST_BLOCK_TIME:
+        return study.getLatestBlockTime();
+    default:
+        return study.getLatestProspectTime();
+    }
+}
+
+void setStudySlot(Study &study, unsigned slot, const std::string &value)
+{
+    switch (slot)
+    {
+    case CompactStudy::STUDY_NAME:
+        study.setStudyName(value);
+        break;
+    case CompactStudy::STUDY_LOCATION:
+        study.setStudyLocation(value);
+        break;
+    case CompactStudy::OWNER_NAME:
+        study.setOwnerName(value);
+        break;
+    case CompactStudy::TABLE_LOCATION:
+        study.setTableLocation(value);
+        break;
+    case CompactStudy::MODEL_LOCATION:
+        study.setModelLocation(value);
+        break;
+    case CompactStudy::PANEL_LOCATION:
+        study.setPanelLocation(value);
+        break;
+    case CompactStudy::ROSTER_LOCATION:
+        study.setRosterLocation(value);
+        break;
+    case CompactStudy::NAME_CONTROL_LOCATION:
+        study.setNameControlLocation(value);
+        break;
+    case CompactStudy::STATUS_CONTROL_LOCATION:
+        study.setStatusControlLocation(value);
+        break;
+    case CompactStudy::VISIBILITY_CONTROL_LOCATION:
+        study.setVisibilityControlLocation(value);
+        break;
+    case CompactStudy::CREATION_TIME:
+        study.setCreationTime(value);
+        break;
+    case CompactStudy::LATEST_BLOCK_TIME:
+        study.setLatestBlockTime(value);
+        break;
+    default:
+        study.setLatestProspectTime(value);
+        break;
+    }
+}
+
+// The arena is, for each slot in order, a base 128 varint length and
+// then that many bytes
+
+void appendVarint(std::string &out, size_t n)
+{
+    while (n >= 0x80)
+    {
+        out += char((n & 0x7F) | 0x80);
+        n >>= 7;
+    }
+    out += char(n);
+}
+
+size_t readVarint(const char *&p)
+{
+    size_t n = 0;
+
+    for (unsigned shift = 0;  ;  shift += 7)
+    {
+        uint8_t b = uint8_t(*p++);
+        n |= size_t(b & 0x7F) << shift;
+        if ((b & 0x80) == 0)
+            return n;
+    }
+}
+
+size_t arenaSize(const char *arena)
+{
+    if (arena == NULL)
+        return 0;
+
+    const char *p = arena;
+    for (unsigned slot = 0;  slot < CompactStudy::SLOT_COUNT;  ++slot)
+    {
+        size_t n = readVarint(p);
+        p += n;
+    }
+
+    return size_t(p - arena);
+}
+
+char *copyArena(const char *arena)
+{
+    if (arena == NULL)
+        return NULL;
+
+    size_t n = arenaSize(arena);
+    char *copy = new char[n];
+    memcpy(copy, arena, n);
+
+    return copy;
+}
+
+// Timestamps:  days since the epoch of a date in the proleptic Gregorian
+// calendar, and back (see H. Hinnant, "chrono-Compatible Low-Level Date
+// Algorithms")
+
+int64_t daysFromCivil(int64_t y, unsigned m, unsigned d)
+{
+    y -= m <= 2;
+    int64_t  era = (y >= 0 ? y : y - 399) / 400;
+    unsigned yoe = unsigned(y - era * 400);
+    unsigned doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+
+    return era * 146097 + int64_t(doe) - 719468;
+}
+
+void civilFromDays(int64_t z, int64_t &y, unsigned &m, unsigned &d)
+{
+    z += 719468;
+    int64_t  era = (z >= 0 ? z : z - 146096) / 146097;
+    unsigned doe = unsigned(z - era * 146097);
+    unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    unsigned mp  = (5 * doy + 2) / 153;
+
+    d = doy - (153 * mp + 2) / 5 + 1;
+    m = mp < 10 ? mp + 3 : mp - 9;
+    y = int64_t(yoe) + era * 400 + (m <= 2);
+}
+
+void appendDigits(std::string &out, unsigned value, unsigned width)
+{
+    char digits[10];
+    for (unsigned i = width;  i > 0;  --i)
+    {
+        digits[i - 1] = char('0' + value % 10);
+        value /= 10;
+    }
+    out.append(digits, width);
+}
+
+std::string formatTime(int64_t t, bool withMillis)
+{
+    const int64_t DAY = 86400000;
+
+    int64_t days = (t >= 0 ? t : t - (DAY - 1)) / DAY;
+    unsigned ms  = unsigned(t - days * DAY);
+
+    int64_t y;
+    unsigned m, d;
+    civilFromDays(days, y, m, d);
+
+    std::string s;
+    s.reserve(24);
+    appendDigits(s, unsigned(y), 4);
+    s += '-';
+    appendDigits(s, m, 2);
+    s += '-';
+    appendDigits(s, d, 2);
+    s += 'T';
+    appendDigits(s, ms / 3600000, 2);
+    s += ':';
+    appendDigits(s, ms / 60000 % 60, 2);
+    s += ':';
+    appendDigits(s, ms / 1000 % 60, 2);
+    if (withMillis)
+    {
+        s += '.';
+        appendDigits(s, ms % 1000, 3);
+    }
+    s += 'Z';
+
+    return s;
+}
+
+bool readDigits(const std::string &s, size_t at, size_t n, unsigned &value)
+{
+    value = 0;
+    for (size_t i = at;  i < at + n;  ++i)
+    {
+        if (s[i] < '0' || s[i] > '9')
+            return false;
+        value = value * 10 + unsigned(s[i] - '0');
+    }
+    return true;
+}
+
+// Parse a timestamp of the form 2012-01-31T23:59:59Z or
+// 2012-01-31T23:59:59.999Z, accepting it only if formatting the result
+// gives back the same text
+
+bool parseTime(const std::string &s, int64_t &t, bool &withMillis)
+{
+    withMillis = (s.size() == 24);
+    if (s.size() != 20 && !withMillis)
+        return false;
+
+    unsigned y, m, d, hh, mm, ss, ms = 0;
+    if (!readDigits(s, 0, 4, y)  || !readDigits(s, 5, 2, m)   ||
+        !readDigits(s, 8, 2, d)  || !readDigits(s, 11, 2, hh) ||
+        !readDigits(s, 14, 2, mm) || !readDigits(s, 17, 2, ss) ||
+        (withMillis && !readDigits(s, 20, 3, ms)))
+        return false;
+
+    if (m < 1 || m > 12 || d < 1 || d > 31 || hh > 23 || mm > 59 || ss > 59)
+        return false;
+
+    t = ((daysFromCivil(y, m, d) * 24 + hh) * 60 + mm) * 60 + ss;
+    t = t * 1000 + ms;
+
+    return formatTime(t, withMillis) == s;
+}
+
+}   // end anonymous namespace
+
+//****************************   CompactStudy   ****************************
+
+CompactStudy::CompactStudy() : arena(NULL)
+{
+    setStudy(Study());
+}
+
+CompactStudy::CompactStudy(const Study &study) : arena(NULL)
+{
+    setStudy(study);
+}
+
+CompactStudy::CompactStudy(const CompactStudy &rhs) : arena(NULL)
+{
+    operator=(rhs);
+}
+
+CompactStudy::~CompactStudy()
+{
+    delete [] arena;
+}
+
+CompactStudy &CompactStudy::operator=(const CompactStudy& rhs)
+{
+    if (this == &rhs)
+        return *this;
+
+    char *copy = copyArena(rhs.arena);
+    delete [] arena;
+    arena = copy;
+
+    studyIdentifier = rhs.studyIdentifier;
+    ownerIdentifier = rhs.ownerIdentifier;
+    blockCount      = rhs.blockCount;
+    cellCount       = rhs.cellCount;
+    prospectCount   = rhs.prospectCount;
+    for (unsigned i = 0;  i < 3;  ++i)
+        times[i] = rhs.times[i];
+    derived         = rhs.derived;
+    millis          = rhs.millis;
+    type            = rhs.type;
+    status          = rhs.status;
+    visibility      = rhs.visibility;
+
+    return *this;
+}
+
+bool CompactStudy::operator==(const CompactStudy &rhs) const
+{
+    // The layout is made the same way from equal studies, so equal studies
+    // have equal arenas
+
+    size_t n = arenaSize(arena);
+
+    return
+    (
+        studyIdentifier == rhs.studyIdentifier &&
+        ownerIdentifier == rhs.ownerIdentifier &&
+        blockCount      == rhs.blockCount      &&
+        cellCount       == rhs.cellCount       &&
+        prospectCount   == rhs.prospectCount   &&
+        times[0]        == rhs.times[0]        &&
+        times[1]        == rhs.times[1]        &&
+        times[2]        == rhs.times[2]        &&
+        derived         == rhs.derived         &&
+        millis          == rhs.millis          &&
+        type            == rhs.type            &&
+        status          == rhs.status          &&
+        visibility      == rhs.visibility      &&
+        n               == arenaSize(rhs.arena) &&
+        (n == 0 || memcmp(arena, rhs.arena, n) == 0)
+    );
+}
+
+bool CompactStudy::operator!=(const CompactStudy &rhs) const
+{
+    return !(*this == rhs);
+}
+
+void CompactStudy::setStudy(const Study &study)
+{
+    studyIdentifier = study.getStudyIdentifierHandle();
+    ownerIdentifier = study.getOwnerIdentifierHandle();
+    blockCount      = study.getBlockCount();
+    cellCount       = study.getCellCount();
+    prospectCount   = study.getProspectCount();
+    derived         = 0;
+    millis          = 0;
+    type            = uint8_t(study.getType());
+    status          = uint8_t(study.getStatus());
+    visibility      = uint8_t(study.getVisibility());
+
+    const std::string &id = studyIdentifier.str();
+
+    // The base, if the study location follows the standard layout
+
+    std::string location = study.getStudyLocation();
+    std::string suffix   = derivedPaths[STUDY_LOCATION] + id;
+    bool hasBase = !id.empty() && location.size() >= suffix.size() &&
+        location.compare(location.size() - suffix.size(), suffix.size(),
+                                                                suffix) == 0;
+    std::string base = hasBase ?
+                    location.substr(0, location.size() - suffix.size()) : "";
+
+    std::string text;
+    bool empty = true;
+
+    for (unsigned slot = 0;  slot < SLOT_COUNT;  ++slot)
+    {
+        std::string value = getStudySlot(study, slot);
+
+        if (slot == STUDY_LOCATION && hasBase)
+        {
+            derived |= 1u << slot;
+            value = base;
+        }
+        else if (hasBase && derivedPaths[slot] != NULL &&
+                                    value == base + derivedPaths[slot] + id)
+        {
+            derived |= 1u << slot;
+            value.clear();
+        }
+        else if (isTimeSlot(slot))
+        {
+            unsigned i = slot - CREATION_TIME;
+            bool withMillis;
+
+            times[i] = 0;
+            if (parseTime(value, times[i], withMillis))
+            {
+                derived |= 1u << slot;
+                if (withMillis)
+                    millis |= uint8_t(1u << i);
+                value.clear();
+            }
+        }
+
+        appendVarint(text, value.size());
+        text += value;
+        empty = empty && value.empty();
+    }
+
+    delete [] arena;
+    arena = NULL;
+
+    if (!empty)
+    {
+        arena = new char[text.size()];
+        memcpy(arena, text.data(), text.size());
+    }
+}
+
+void CompactStudy::getStudy(Study &study) const
+{
+    study = Study();
+
+    study.setStudyIdentifier(studyIdentifier);
+    study.setOwnerIdentifier(ownerIdentifier);
+    study.setType(getType());
+    study.setStatus(getStatus());
+    study.setVisibility(getVisibility());
+    study.setBlockCount(blockCount);
+    study.setCellCount(cellCount);
+    study.setProspectCount(prospectCount);
+
+    for (unsigned slot = 0;  slot < SLOT_COUNT;  ++slot)
+    {
+        if (slot == OWNER_NAME || slot == STUDY_NAME)
+            setStudySlot(study, slot, getSlot(Slot(slot)));
+        else if (isTimeSlot(slot))
+            setStudySlot(study, slot, getTime(Slot(slot)));
+        else
+            setStudySlot(study, slot, getLocation(Slot(slot)));
+    }
+}
+
+std::string CompactStudy::getStudyIdentifier() const
+{
+    return studyIdentifier.str();
+}
+
+const Identifier &CompactStudy::getStudyIdentifierHandle() const
+{
+    return studyIdentifier;
+}
+
+std::string CompactStudy::getStudyName() const
+{
+    return getSlot(STUDY_NAME);
+}
+
+std::string CompactStudy::getStudyLocation() const
+{
+    return getLocation(STUDY_LOCATION);
+}
+
+Study::Type CompactStudy::getType() const
+{
+    return Study::Type(type);
+}
+
+Study::Status CompactStudy::getStatus() const
+{
+    return Study::Status(status);
+}
+
+Study::Visibility CompactStudy::getVisibility() const
+{
+    return Study::Visibility(visibility);
+}
+
+std::string CompactStudy::getOwnerIdentifier() const
+{
+    return ownerIdentifier.str();
+}
+
+std::string CompactStudy::getOwnerName() const
+{
+    return getSlot(OWNER_NAME);
+}
+
+std::string CompactStudy::getTableLocation() const
+{
+    return getLocation(TABLE_LOCATION);
+}
+
+std::string CompactStudy::getModelLocation() const
+{
+    return getLocation(MODEL_LOCATION);
+}
+
+std::string CompactStudy::getPanelLocation() const
+{
+    return getLocation(PANEL_LOCATION);
+}
+
+std::string CompactStudy::getRosterLocation() const
+{
+    return getLocation(ROSTER_LOCATION);
+}
+
+std::string CompactStudy::getNameControlLocation() const
+{
+    return getLocation(NAME_CONTROL_LOCATION);
+}
+
+std::string CompactStudy::getStatusControlLocation() const
+{
+    return getLocation(STATUS_CONTROL_LOCATION);
+}
+
+std::string CompactStudy::getVisibilityControlLocation() const
+{
+    return getLocation(VISIBILITY_CONTROL_LOCATION);
+}
+
+uint64_t CompactStudy::getBlockCount() const
+{
+    return blockCount;
+}
+
+uint64_t CompactStudy::getCellCount() const
+{
+    return cellCount;
+}
+
+uint64_t CompactStudy::getProspectCount() const
+{
+    return prospectCount;
+}
+
+std::string CompactStudy::getCreationTime() const
+{
+    return getTime(CREATION_TIME);
+}
+
+std::string CompactStudy::getLatestBlockTime() const
+{
+    return getTime(LATEST_BLOCK_TIME);
+}
+
+std::string CompactStudy::getLatestProspectTime() const
+{
+    return getTime(LATEST_PROSPECT_TIME);
+}
+
+bool CompactStudy::isDerived(Slot slot) const
+{
+    return derivedPaths[slot] != NULL && (derived & (1u << slot)) != 0;
+}
+
+size_t CompactStudy::getMemoryUsage() const
+{
+    return sizeof(*this) + arenaSize(arena);
+}
+
+std::string CompactStudy::getSlot(Slot slot) const
+{
+    if (arena == NULL)
+        return "";
+
+    const char *p = arena;
+    for (unsigned i = 0;  i < unsigned(slot);  ++i)
+    {
+        size_t n = readVarint(p);
+        p += n;
+    }
+
+    size_t n = readVarint(p);
+    return std::string(p, n);
+}
+
+std::string CompactStudy::getLocation(Slot slot) const
+{
+    if ((derived & (1u << slot)) == 0)
+        return getSlot(slot);
+
+    std::string location = getSlot(STUDY_LOCATION);
+    location += derivedPaths[slot];
+    location += studyIdentifier.str();
+
+    return location;
+}
+
+std::string CompactStudy::getTime(Slot slot) const
+{
+    if ((derived & (1u << slot)) == 0)
+        return getSlot(slot);
+
+    unsigned i = slot - CREATION_TIME;
+    return formatTime(times[i], (millis & (1u << i)) != 0);
+}
+
+//***************************   CompactCatalog   ***************************
+
+CompactCatalog::CompactCatalog()
+{}
+
+CompactCatalog::CompactCatalog(const Catalog &catalog)
+{
+    setCatalog(catalog);
+}
+
+void CompactCatalog::setCatalog(const Catalog &catalog)
+{
+    userIdentifier  = catalog.getUserIdentifier();
+    userName        = catalog.getUserName();
+    catalogLocation = catalog.getCatalogLocation();
+
+    studyCollection.clear();
+    studyCollection.reserve(catalog.size());
+
+    Catalog::StudyConstIterator iter;
+    for (iter = catalog.begin();  iter != catalog.end();  ++iter)
+        studyCollection.insert(iter->first, CompactStudy(iter->second));
+}
+
+bool CompactCatalog::setCatalog(const LazyCatalog &catalog)
+{
+    userIdentifier  = catalog.getUserIdentifier();
+    userName        = catalog.getUserName();
+    catalogLocation = catalog.getCatalogLocation();
+
+    studyCollection.clear();
+    studyCollection.reserve(catalog.size());
+
+    Study study;
+    for (size_t i = 0;  i < catalog.size();  ++i)
+    {
+        if (!catalog.getStudy(i, study))
+            return false;
+
+        addStudy(study);
+    }
+
+    return true;
+}
+
+void CompactCatalog::getCatalog(Catalog &catalog) const
+{
+    catalog.setUserIdentifier (userIdentifier );
+    catalog.setUserName       (userName       );
+    catalog.setCatalogLocation(catalogLocation);
+
+    catalog.clearStudies();
+    catalog.reserveStudies(int(studyCollection.size()));
+
+    Study study;
+    for (StudyConstIterator iter = begin();  iter != end();  ++iter)
+    {
+        iter->second.getStudy(study);
+        catalog.addStudy(study);
+    }
+}
+
+std::string CompactCatalog::getUserIdentifier() const
+{
+    return userIdentifier;
+}
+
+std::string CompactCatalog::getUserName() const
+{
+    return userName;
+}
+
+std::string CompactCatalog::getCatalogLocation() const
+{
+    return catalogLocation;
+}
+
+bool CompactCatalog::addStudy(const Study &study)
+{
+    return studyCollection.insert(study.getStudyIdentifierHandle(),
+                                                        CompactStudy(study));
+}
+
+bool CompactCatalog::getStudy(
+    const std::string &studyIdentifier,
+    Study             &study) const
+{
+    const CompactStudy *compact = studyCollection.find(studyIdentifier);
+
+    if (compact == NULL)
+        return false;
+
+    compact->getStudy(study);
+
+    return true;
+}
+
+const CompactStudy *CompactCatalog::findStudy(
+    const Identifier &studyIdentifier) const
+{
+    return studyCollection.find(studyIdentifier);
+}
+
+bool CompactCatalog::containsStudy(const std::string &studyIdentifier) const
+{
+    return studyCollection.find(studyIdentifier) != NULL;
+}
+
+bool CompactCatalog::removeStudy(const std::string &studyIdentifier)
+{
+    return studyCollection.erase(studyIdentifier);
+}
+
+void CompactCatalog::clearStudies()
+{
+    studyCollection.clear();
+}
+
+size_t CompactCatalog::size() const
+{
+    return studyCollection.size();
+}
+
+CompactCatalog::StudyConstIterator CompactCatalog::begin() const
+{
+    return studyCollection.begin();
+}
+
+CompactCatalog::StudyConstIterator CompactCatalog::end() const
+{
+    return studyCollection.end();
+}
+
+size_t CompactCatalog::getMemoryUsage() const
+{
+    size_t bytes = 0;
+    for (StudyConstIterator iter = begin();  iter != end();  ++iter)
+        bytes += iter->second.getMemoryUsage();
+
+    return bytes;
+}
+
+// end CompactStudy.cpp
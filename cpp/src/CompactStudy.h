@@ -0,0 +1,510 @@
+// CompactStudy.h
+
+#ifndef COMPACTSTUDY_H
+#define COMPACTSTUDY_H
+
+#include "Catalog.h"
+#include "Identifier.h"
+#include "IdentifierMap.h"
+#include "Study.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+namespace Yosokumo
+{
+
+class LazyCatalog;
+
+/**
+ * A study held in a fraction of the memory of a <code>Study</code>, for
+ * keeping many studies at once.  A <code>Study</code> has fifteen
+ * <code>std::string</code> members, most of them locations, and each
+ * location longer than a few characters is a heap block of its own.  A
+ * <code>CompactStudy</code> holds:
+ * <ul>
+ * <li>the study and owner identifiers as <code>Identifier</code>s, which
+ *          are interned, so a study shares them with everything else
+ * <li>its other strings in one heap block, the arena, each with a length
+ *          in front of it
+ * <li>no location which follows the standard layout:  if the study
+ *          location is <i>base</i><code>/study/</code><i>id</i>, where
+ *          <i>id</i> is the study identifier, only <i>base</i> is kept,
+ *          and each other location of the form
+ *          <i>base</i><code>/table/</code><i>id</i>,
+ *          <i>base</i><code>/model/</code><i>id</i>,
+ *          <i>base</i><code>/panel/</code><i>id</i>,
+ *          <i>base</i><code>/roster/</code><i>id</i>, or
+ *          <i>base</i><code>/control/</code><i>name</i><code>/</code><i>id</i>
+ *          (<i>name</i> is <code>name</code>, <code>status</code>, or
+ *          <code>visibility</code>) is made again when asked for
+ * <li>timestamps of the form <code>2012-01-31T23:59:59Z</code> or
+ *          <code>2012-01-31T23:59:59.999Z</code> as milliseconds since the
+ *          epoch
+ * </ul>
+ * Anything which does not follow these forms is kept as it is, so a
+ * <code>CompactStudy</code> always gives back the <code>Study</code> it was
+ * made from.
+ */
+class CompactStudy
+{
+public:
+
+    // The strings, in the order they lie in the arena
+
+    enum Slot
+    {
+        STUDY_NAME,
+        STUDY_LOCATION,             // just the base if derived
+        OWNER_NAME,
+        TABLE_LOCATION,
+        MODEL_LOCATION,
+        PANEL_LOCATION,
+        ROSTER_LOCATION,
+        NAME_CONTROL_LOCATION,
+        STATUS_CONTROL_LOCATION,
+        VISIBILITY_CONTROL_LOCATION,
+        CREATION_TIME,
+        LATEST_BLOCK_TIME,
+        LATEST_PROSPECT_TIME,
+        SLOT_COUNT
+    };
+
+private:
+
+    Identifier studyIdentifier;
+    Identifier ownerIdentifier;
+    char       *arena;              // NULL means every slot is empty
+
+    uint64_t   blockCount   ;
+    uint64_t   cellCount    ;
+    uint64_t   prospectCount;
+    int64_t    times[3];            // creation, latest block, latest prospect
+
+    uint32_t   derived;             // bit per slot:  derived, not kept
+    uint8_t    millis;              // bit per time:  has milliseconds
+    uint8_t    type;
+    uint8_t    status;
+    uint8_t    visibility;
+
+public:
+
+    /**
+     * Initializes a newly created <code>CompactStudy</code> which holds a
+     * default <code>Study</code>.
+     */
+    CompactStudy();
+
+    /**
+     * Initializes a newly created <code>CompactStudy</code> which holds a
+     * given study.
+     *
+     * @param  study  the study.
+     */
+    explicit CompactStudy(const Study &study);
+
+    /**
+     * Copy constructor - initializes a newly created
+     * <code>CompactStudy</code> object with a copy of another
+     * <code>CompactStudy</code> object.
+     *
+     * @param  rhs  the <code>CompactStudy</code> to make a copy of.
+     */
+    CompactStudy(const CompactStudy &rhs);
+
+    /**
+     * Destructor - destroy a <code>CompactStudy</code> object, freeing its
+     * arena.
+     */
+    ~CompactStudy();
+
+    /**
+     * Assignment operator - assign one <code>CompactStudy</code> to
+     * another.
+     *
+     * @param  rhs  the righthand side of the assignment.
+     *
+     * @return a reference to <code>this</code> CompactStudy.
+     */
+    CompactStudy& operator=(const CompactStudy& rhs);
+
+    /**
+     * Equality operator - compare two <code>CompactStudy</code> for
+     * equality.
+     *
+     * @param  rhs  the righthand side of the equality.
+     *
+     * @return <code>true</code> if and only if the studies held are
+     *              identically equal.
+     */
+    bool operator==(const CompactStudy &rhs) const;
+
+    /**
+     * Inequality operator - compare two <code>CompactStudy</code> for
+     * inequality.
+     *
+     * @param  rhs  the righthand side of the inequality.
+     *
+     * @return <code>true</code> if and only if the studies held are not
+     *              identically equal.
+     */
+    bool operator!=(const CompactStudy &rhs) const;
+
+    /**
+     * Set the study held.
+     *
+     * @param  study  the study.
+     */
+    void setStudy(const Study &study);
+
+    /**
+     * Get the study held.
+     *
+     * @param  study  set to the study.
+     */
+    void getStudy(Study &study) const;
+
+    // Getters, as in Study
+
+    /**
+     * Return the study identifier.
+     *
+     * @return the identifier of this study.
+     */
+    std::string getStudyIdentifier() const;
+
+    /**
+     * Return the study identifier, interned.
+     *
+     * @return the interned identifier of this study.
+     */
+    const Identifier &getStudyIdentifierHandle() const;
+
+    /**
+     * Return the study name.
+     *
+     * @return the name of this study.
+     */
+    std::string getStudyName() const;
+
+    /**
+     * Return the study location.
+     *
+     * @return the location of this study.
+     */
+    std::string getStudyLocation() const;
+
+    /**
+     * Return the study type.
+     *
+     * @return the type of this study.
+     */
+    Study::Type getType() const;
+
+    /**
+     * Return the study status.
+     *
+     * @return the status of this study.
+     */
+    Study::Status getStatus() const;
+
+    /**
+     * Return the study visibility.
+     *
+     * @return the visibility of this study.
+     */
+    Study::Visibility getVisibility() const;
+
+    /**
+     * Return the owner identifier.
+     *
+     * @return the identifier of the owner of this study.
+     */
+    std::string getOwnerIdentifier() const;
+
+    /**
+     * Return the owner name.
+     *
+     * @return the name of the owner of this study.
+     */
+    std::string getOwnerName() const;
+
+    /**
+     * Return the table location, made again if it is derived.
+     *
+     * @return the location of the table for this study.
+     */
+    std::string getTableLocation() const;
+
+    /**
+     * Return the model location, made again if it is derived.
+     *
+     * @return the location of the model for this study.
+     */
+    std::string getModelLocation() const;
+
+    /**
+     * Return the panel location, made again if it is derived.
+     *
+     * @return the location of the panel for this study.
+     */
+    std::string getPanelLocation() const;
+
+    /**
+     * Return the roster location, made again if it is derived.
+     *
+     * @return the location of the roster for this study.
+     */
+    std::string getRosterLocation() const;
+
+    /**
+     * Return the name control location, made again if it is derived.
+     *
+     * @return the URI to use to change the name of this study.
+     */
+    std::string getNameControlLocation() const;
+
+    /**
+     * Return the status control location, made again if it is derived.
+     *
+     * @return the URI to use to change the status of this study.
+     */
+    std::string getStatusControlLocation() const;
+
+    /**
+     * Return the visibility control location, made again if it is derived.
+     *
+     * @return the URI to use to change the visibility of this study.
+     */
+    std::string getVisibilityControlLocation() const;
+
+    /**
+     * Return the block count.
+     *
+     * @return the number of posted blocks that have been accepted into
+     *         the study table.
+     */
+    uint64_t getBlockCount() const;
+
+    /**
+     * Return the cell count.
+     *
+     * @return the total number of cells contained in the blocks reported
+     *         in the block count.
+     */
+    uint64_t getCellCount() const;
+
+    /**
+     * Return the prospect count.
+     *
+     * @return the total number of specimens contained in all Post Model
+     *         and Get Model requests for the study.
+     */
+    uint64_t getProspectCount() const;
+
+    /**
+     * Return the creation time, formatted again if it is kept as a
+     * number.
+     *
+     * @return the UTC time the study was created.
+     */
+    std::string getCreationTime() const;
+
+    /**
+     * Return the latest block time, formatted again if it is kept as a
+     * number.
+     *
+     * @return the UTC time that the service accepted the most recent block
+     *         into the study table.
+     */
+    std::string getLatestBlockTime() const;
+
+    /**
+     * Return the latest prospect time, formatted again if it is kept as a
+     * number.
+     *
+     * @return the UTC time of the most recent Post Model or Get Model
+     *         request.
+     */
+    std::string getLatestProspectTime() const;
+
+    /**
+     * Test if a location is derived from the study location and identifier
+     * instead of being kept.
+     *
+     * @param  slot  one of the location slots, e.g.,
+     *             <code>TABLE_LOCATION</code>.
+     */
+    bool isDerived(Slot slot) const;
+
+    /**
+     * Return the number of bytes of memory used, counting the arena.
+     */
+    size_t getMemoryUsage() const;
+
+private:
+
+    std::string getSlot(Slot slot) const;
+    std::string getLocation(Slot slot) const;
+    std::string getTime(Slot slot) const;
+
+};  // end class CompactStudy
+
+
+/**
+ * The studies of a catalog, each held as a <code>CompactStudy</code>.  A
+ * <code>Catalog</code> is for working with a catalog; a
+ * <code>CompactCatalog</code> is for keeping a large one at hand, e.g., to
+ * answer which studies a user has, in a fraction of the memory.  It may be
+ * filled from a <code>Catalog</code> or, so that the whole catalog is
+ * never decoded at once, from a <code>LazyCatalog</code>.
+ */
+class CompactCatalog
+{
+    typedef IdentifierMap<CompactStudy> StudyMap;
+
+    std::string userIdentifier;
+    std::string userName;
+    std::string catalogLocation;
+    StudyMap    studyCollection;
+
+public:
+
+    typedef StudyMap::const_iterator StudyConstIterator;
+
+    /**
+     * Initializes a newly created <code>CompactCatalog</code> with no
+     * studies.
+     */
+    CompactCatalog();
+
+    /**
+     * Initializes a newly created <code>CompactCatalog</code> with the
+     * studies of a catalog.
+     *
+     * @param  catalog  the catalog.
+     */
+    explicit CompactCatalog(const Catalog &catalog);
+
+    /**
+     * Replace the contents with a catalog.
+     *
+     * @param  catalog  the catalog.
+     */
+    void setCatalog(const Catalog &catalog);
+
+    /**
+     * Replace the contents with a lazy catalog, decoding one study at a
+     * time.
+     *
+     * @param  catalog  the catalog.
+     *
+     * @return <code>true</code> means success.  <code>false</code> means a
+     *             study could not be decoded; the contents are incomplete.
+     */
+    bool setCatalog(const LazyCatalog &catalog);
+
+    /**
+     * Get the whole catalog.
+     *
+     * @param  catalog  where to place the catalog.
+     */
+    void getCatalog(Catalog &catalog) const;
+
+    /**
+     * Return the user identifier.
+     *
+     * @return the identifier of the user to whom the catalog belongs.
+     */
+    std::string getUserIdentifier() const;
+
+    /**
+     * Return the user name.
+     *
+     * @return the name of the user to whom the catalog belongs.
+     */
+    std::string getUserName() const;
+
+    /**
+     * Return the catalog location.
+     *
+     * @return the location of this catalog.
+     */
+    std::string getCatalogLocation() const;
+
+    /**
+     * Add a study, replacing any study with the same identifier.
+     *
+     * @param  study  the study.
+     *
+     * @return <code>true</code> means the study was new.
+     */
+    bool addStudy(const Study &study);
+
+    /**
+     * Get a study by its identifier.
+     *
+     * @param  studyIdentifier  the study identifier.
+     * @param  study  where to place the study.
+     *
+     * @return <code>true</code> means it was found.
+     */
+    bool getStudy(const std::string &studyIdentifier, Study &study) const;
+
+    /**
+     * Return the compact study with an identifier, or NULL if there is none.
+     */
+    const CompactStudy *findStudy(const Identifier &studyIdentifier) const;
+
+    /**
+     * Test if the catalog holds a study.
+     *
+     * @param  studyIdentifier  the study identifier.
+     *
+     * @return <code>true</code> means the study is in the catalog.
+     */
+    bool containsStudy(const std::string &studyIdentifier) const;
+
+    /**
+     * Remove a study from the catalog.
+     *
+     * @param  studyIdentifier  the identifier of the study to remove.
+     *
+     * @return <code>true</code> means the study was found and removed.
+     */
+    bool removeStudy(const std::string &studyIdentifier);
+
+    /**
+     * Remove all studies from the catalog.
+     */
+    void clearStudies();
+
+    /**
+     * Return the number of studies in the catalog.
+     */
+    size_t size() const;
+
+    /**
+     * Return an iterator to the first study, for iterating over the
+     * studies in no particular order.
+     */
+    StudyConstIterator begin() const;
+
+    /**
+     * Return an iterator just past the last study.
+     */
+    StudyConstIterator end() const;
+
+    /**
+     * Return the number of bytes of memory used by the studies.
+     */
+    size_t getMemoryUsage() const;
+
+};  // end class CompactCatalog
+
+}   // end namespace Yosokumo
+
+#endif  // COMPACTSTUDY_H
+
+// end CompactStudy.h
@@ -0,0 +1,595 @@
+// Compression.cpp
+
+#include "Compression.h"
+
+#include <zlib.h>
+
+#ifdef YOSOKUMO_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include <ctype.h>
+
+using namespace Yosokumo;
+
+// zlib's windowBits for the largest window plus a gzip (not zlib) wrapper
+
+static const int GZIP_WINDOW_BITS = 15 + 16;
+
+// Room added to the output vector each time the decompressor runs out
+
+static const size_t OUTPUT_STEP = 16384;
+
+//*****************************   Compression   ***************************
+
+bool Compression::isAvailable(Coding coding)
+{
+    switch (coding)
+    {
+    case IDENTITY:
+    case GZIP:
+        return true;
+    case ZSTD:
+#ifdef YOSOKUMO_HAVE_ZSTD
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    return false;
+}
+
+std::string Compression::getCodingName(Coding coding)
+{
+    switch (coding)
+    {
+    case IDENTITY:
+        return "identity";
+    case GZIP:
+        return "gzip";
+    case ZSTD:
+        return "zstd";
+    }
+
+    return "";
+}
+
+bool Compression::getCodingFromName(const std::string &name, Coding &coding)
+{
+    std::string lower;
+    for (unsigned i = 0;  i < name.size();  ++i)
+        lower += char(tolower((unsigned char)name[i]));
+
+    if (lower == "identity" || lower.empty())
+        coding = IDENTITY;
+    else if (lower == "gzip" || lower == "x-gzip")
+        coding = GZIP;
+    else if (lower == "zstd")
+        coding = ZSTD;
+    else
+        return false;
+
+    return true;
+}
+
+//*****************************   Compressor   ****************************
+
+Compressor::Compressor(Compression::Coding coding, int level) :
+    coding(coding), stream(NULL)
+{
+    int low = 1, high = 9, usual = 6;
+
+#ifdef YOSOKUMO_HAVE_ZSTD
+    if (coding == Compression::ZSTD)
+    {
+        high  = ZSTD_maxCLevel();
+        usual = 3;
+    }
+#endif
+
+    if (level == Compression::DEFAULT_LEVEL)
+        this->level = usual;
+    else if (level < low)
+        this->level = low;
+    else if (level > high)
+        this->level = high;
+    else
+        this->level = level;
+}
+
+bool Compressor::compress(
+    const std::vector<uint8_t> &in,
+    std::vector<uint8_t>       &out)
+{
+    exception = ServiceException();
+
+    if (coding == Compression::IDENTITY)
+    {
+        out = in;
+        return true;
+    }
+
+    if (coding == Compression::GZIP)
+    {
+        z_stream z;
+        z.zalloc = Z_NULL;
+        z.zfree  = Z_NULL;
+        z.opaque = Z_NULL;
+
+        if (deflateInit2(&z, level, Z_DEFLATED, GZIP_WINDOW_BITS, 8,
+                                                Z_DEFAULT_STRATEGY) != Z_OK)
+        {
+            exception = ServiceException("deflateInit2 failed", "compress");
+            return false;
+        }
+
+        // deflateBound() is enough for a single Z_FINISH call
+
+        out.resize(deflateBound(&z, uLong(in.size())));
+
+        z.next_in   = in.empty() ? Z_NULL : const_cast<Bytef *>(&in[0]);
+        z.avail_in  = uInt(in.size());
+        z.next_out  = &out[0];
+        z.avail_out = uInt(out.size());
+
+        int rc = deflate(&z, Z_FINISH);
+        out.resize(z.total_out);
+        deflateEnd(&z);
+
+        if (rc != Z_STREAM_END)
+        {
+            exception = ServiceException("deflate failed", "compress");
+            return false;
+        }
+
+        return true;
+    }
+
+#ifdef YOSOKUMO_HAVE_ZSTD
+    if (coding == Compression::ZSTD)
+    {
+        out.resize(ZSTD_compressBound(in.size()));
+
+        size_t n = ZSTD_compress(&out[0], out.size(),
+                        in.empty() ? NULL : &in[0], in.size(), level);
+        if (ZSTD_isError(n))
+        {
+            out.clear();
+            exception = ServiceException(
+                std::string("ZSTD_compress failed: ") + ZSTD_getErrorName(n),
+                                                                "compress");
+            return false;
+        }
+
+        out.resize(n);
+        return true;
+    }
+#endif
+
+    exception = ServiceException("Content coding " +
+        Compression::getCodingName(coding) + " is not available", "compress");
+    return false;
+}
+
+Compressor::Compressor(const Compressor &rhs) :
+    coding(rhs.coding), level(rhs.level), stream(NULL)
+{}
+
+Compressor::~Compressor()
+{
+    release();
+}
+
+Compressor& Compressor::operator=(const Compressor& rhs)
+{
+    if (this != &rhs)
+    {
+        release();
+        coding    = rhs.coding;
+        level     = rhs.level;
+        exception = rhs.exception;
+    }
+
+    return *this;
+}
+
+void Compressor::release()
+{
+    if (stream == NULL)
+        return;
+
+    if (coding == Compression::GZIP)
+    {
+        z_stream *z = static_cast<z_stream *>(stream);
+        deflateEnd(z);
+        delete z;
+    }
+#ifdef YOSOKUMO_HAVE_ZSTD
+    else if (coding == Compression::ZSTD)
+        ZSTD_freeCStream(static_cast<ZSTD_CStream *>(stream));
+#endif
+
+    stream = NULL;
+}
+
+bool Compressor::start()
+{
+    release();
+
+    exception = ServiceException();
+
+    if (coding == Compression::IDENTITY)
+        return true;
+
+    if (coding == Compression::GZIP)
+    {
+        z_stream *z = new z_stream;
+        z->zalloc   = Z_NULL;
+        z->zfree    = Z_NULL;
+        z->opaque   = Z_NULL;
+
+        if (deflateInit2(z, level, Z_DEFLATED, GZIP_WINDOW_BITS, 8,
+                                                Z_DEFAULT_STRATEGY) != Z_OK)
+        {
+            delete z;
+            exception = ServiceException("deflateInit2 failed", "start");
+            return false;
+        }
+
+        stream = z;
+        return true;
+    }
+
+#ifdef YOSOKUMO_HAVE_ZSTD
+    if (coding == Compression::ZSTD)
+    {
+        ZSTD_CStream *c = ZSTD_createCStream();
+        if (c == NULL || ZSTD_isError(ZSTD_initCStream(c, level)))
+        {
+            ZSTD_freeCStream(c);
+            exception = ServiceException("ZSTD_initCStream failed", "start");
+            return false;
+        }
+
+        stream = c;
+        return true;
+    }
+#endif
+
+    exception = ServiceException("Content coding " +
+        Compression::getCodingName(coding) + " is not available", "start");
+    return false;
+}
+
+bool Compressor::update(
+    const uint8_t        *data,
+    size_t               n,
+    std::vector<uint8_t> &out)
+{
+    if (n == 0)
+        return true;
+
+    if (coding == Compression::IDENTITY)
+    {
+        out.insert(out.end(), data, data + n);
+        return true;
+    }
+
+    return run(data, n, false, out);
+}
+
+bool Compressor::finish(std::vector<uint8_t> &out)
+{
+    bool ok = (coding == Compression::IDENTITY) || run(NULL, 0, true, out);
+
+    release();
+
+    return ok;
+}
+
+// Compress straight into out, growing it a step at a time.  With last, 
+// flush the end of the stream.
+
+bool Compressor::run(
+    const uint8_t        *data,
+    size_t               n,
+    bool                 last,
+    std::vector<uint8_t> &out)
+{
+    if (stream == NULL)
+    {
+        exception = ServiceException("No compressed stream started", "run");
+        return false;
+    }
+
+    if (coding == Compression::GZIP)
+    {
+        z_stream *z = static_cast<z_stream *>(stream);
+        z->next_in  = const_cast<Bytef *>(data);
+        z->avail_in = uInt(n);
+
+        int rc;
+        do
+        {
+            size_t used = out.size();
+            out.resize(used + OUTPUT_STEP);
+            z->next_out  = &out[used];
+            z->avail_out = uInt(OUTPUT_STEP);
+
+            rc = deflate(z, last ? Z_FINISH : Z_NO_FLUSH);
+            out.resize(used + OUTPUT_STEP - z->avail_out);
+
+            if (rc == Z_STREAM_ERROR)
+            {
+                exception = ServiceException("deflate failed", "run");
+                return false;
+            }
+        } while (last ? rc != Z_STREAM_END : z->avail_in > 0);
+
+        return true;
+    }
+
+#ifdef YOSOKUMO_HAVE_ZSTD
+    if (coding == Compression::ZSTD)
+    {
+        ZSTD_CStream *c = static_cast<ZSTD_CStream *>(stream);
+        ZSTD_inBuffer input = { data, n, 0 };
+
+        size_t rc;
+        do
+        {
+            size_t used = out.size();
+            out.resize(used + OUTPUT_STEP);
+            ZSTD_outBuffer output = { &out[used], OUTPUT_STEP, 0 };
+
+            rc = last ? ZSTD_endStream(c, &output) :
+                        ZSTD_compressStream(c, &output, &input);
+            out.resize(used + output.pos);
+
+            if (ZSTD_isError(rc))
+            {
+                exception = ServiceException(
+                    std::string("ZSTD_compressStream failed: ") +
+                                            ZSTD_getErrorName(rc), "run");
+                return false;
+            }
+        } while (last ? rc != 0 : input.pos < input.size);
+
+        return true;
+    }
+#endif
+
+    exception = ServiceException("No compressed stream started", "run");
+    return false;
+}
+
+Compression::Coding Compressor::getCoding() const
+{
+    return coding;
+}
+
+int Compressor::getLevel() const
+{
+    return level;
+}
+
+ServiceException Compressor::getException() const
+{
+    return exception;
+}
+
+//****************************   Decompressor   ***************************
+
+Decompressor::Decompressor() :
+    coding(Compression::IDENTITY), stream(NULL), finished(true)
+{}
+
+Decompressor::~Decompressor()
+{
+    release();
+}
+
+void Decompressor::release()
+{
+    if (stream == NULL)
+        return;
+
+    if (coding == Compression::GZIP)
+    {
+        z_stream *z = static_cast<z_stream *>(stream);
+        inflateEnd(z);
+        delete z;
+    }
+#ifdef YOSOKUMO_HAVE_ZSTD
+    else if (coding == Compression::ZSTD)
+        ZSTD_freeDStream(static_cast<ZSTD_DStream *>(stream));
+#endif
+
+    stream = NULL;
+}
+
+bool Decompressor::start(Compression::Coding coding)
+{
+    release();
+
+    this->coding = coding;
+    finished     = false;
+    exception    = ServiceException();
+
+    if (coding == Compression::GZIP)
+    {
+        z_stream *z = new z_stream;
+        z->zalloc   = Z_NULL;
+        z->zfree    = Z_NULL;
+        z->opaque   = Z_NULL;
+        z->next_in  = Z_NULL;
+        z->avail_in = 0;
+
+        if (inflateInit2(z, GZIP_WINDOW_BITS) != Z_OK)
+        {
+            delete z;
+            finished  = true;
+            exception = ServiceException("inflateInit2 failed", "start");
+            return false;
+        }
+
+        stream = z;
+        return true;
+    }
+
+#ifdef YOSOKUMO_HAVE_ZSTD
+    if (coding == Compression::ZSTD)
+    {
+        ZSTD_DStream *d = ZSTD_createDStream();
+        if (d == NULL || ZSTD_isError(ZSTD_initDStream(d)))
+        {
+            ZSTD_freeDStream(d);
+            finished  = true;
+            exception = ServiceException("ZSTD_initDStream failed", "start");
+            return false;
+        }
+
+        stream = d;
+        return true;
+    }
+#endif
+
+    if (coding == Compression::IDENTITY)
+        return true;
+
+    finished  = true;
+    exception = ServiceException("Content coding " +
+        Compression::getCodingName(coding) + " is not available", "start");
+    return false;
+}
+
+bool Decompressor::isActive() const
+{
+    return !finished;
+}
+
+bool Decompressor::update(
+    const uint8_t        *data,
+    size_t               n,
+    std::vector<uint8_t> &out)
+{
+    if (n == 0)
+        return true;
+
+    if (finished)
+    {
+        exception = ServiceException("Data after end of compressed stream",
+                                                                    "update");
+        return false;
+    }
+
+    if (coding == Compression::IDENTITY)
+    {
+        out.insert(out.end(), data, data + n);
+        return true;
+    }
+
+    // Decompress straight into out, growing it a step at a time
+
+    if (coding == Compression::GZIP)
+    {
+        z_stream *z = static_cast<z_stream *>(stream);
+        z->next_in  = const_cast<Bytef *>(data);
+        z->avail_in = uInt(n);
+
+        while (z->avail_in > 0)
+        {
+            size_t used = out.size();
+            out.resize(used + OUTPUT_STEP);
+            z->next_out  = &out[used];
+            z->avail_out = uInt(OUTPUT_STEP);
+
+            int rc = inflate(z, Z_NO_FLUSH);
+            out.resize(used + OUTPUT_STEP - z->avail_out);
+
+            if (rc == Z_STREAM_END)
+            {
+                finished = true;
+                if (z->avail_in > 0)
+                {
+                    exception = ServiceException(
+                        "Data after end of compressed stream", "update");
+                    return false;
+                }
+                break;
+            }
+
+            if (rc != Z_OK && rc != Z_BUF_ERROR)
+            {
+                exception = ServiceException(std::string("inflate failed: ")
+                                + (z->msg != NULL ? z->msg : "?"), "update");
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+#ifdef YOSOKUMO_HAVE_ZSTD
+    if (coding == Compression::ZSTD)
+    {
+        ZSTD_DStream *d = static_cast<ZSTD_DStream *>(stream);
+        ZSTD_inBuffer input = { data, n, 0 };
+
+        while (input.pos < input.size)
+        {
+            size_t used = out.size();
+            out.resize(used + OUTPUT_STEP);
+            ZSTD_outBuffer output = { &out[used], OUTPUT_STEP, 0 };
+
+            size_t rc = ZSTD_decompressStream(d, &output, &input);
+            out.resize(used + output.pos);
+
+            if (ZSTD_isError(rc))
+            {
+                exception = ServiceException(
+                    std::string("ZSTD_decompressStream failed: ") +
+                                        ZSTD_getErrorName(rc), "update");
+                return false;
+            }
+
+            if (rc == 0)
+            {
+                finished = true;
+                if (input.pos < input.size)
+                {
+                    exception = ServiceException(
+                        "Data after end of compressed stream", "update");
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+#endif
+
+    exception = ServiceException("No compressed stream started", "update");
+    return false;
+}
+
+bool Decompressor::finish()
+{
+    bool complete = finished || coding == Compression::IDENTITY;
+
+    release();
+    finished = true;
+
+    if (!complete)
+        exception = ServiceException("Compressed stream is truncated",
+                                                                    "finish");
+    return complete;
+}
+
+ServiceException Decompressor::getException() const
+{
+    return exception;
+}
+
+// end Compression.cpp
@@ -0,0 +1,262 @@
+// Compression.h
+
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+#include "ServiceException.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace Yosokumo
+{
+/**
+ * Compression of HTTP entities.  gzip (RFC 1952, via zlib) is always
+ * available.  zstd (RFC 8878) is available when the library is built with
+ * <code>YOSOKUMO_HAVE_ZSTD</code> defined and linked with libzstd.
+ * <p>
+ * A <code>Compressor</code> compresses a whole entity in one pass, or an
+ * entity given to it piece by piece, so that the pieces need not first be
+ * joined.  A <code>Decompressor</code> works on a stream:  the bytes of a
+ * compressed entity are given to it piece by piece as they arrive, so the
+ * compressed entity is never held in memory as a whole.
+ */
+
+class Compression
+{
+public:
+    /**
+     * The content codings.  <code>IDENTITY</code> means no compression.
+     */
+    enum Coding
+    {
+        IDENTITY,
+        GZIP,
+        ZSTD
+    };
+
+    /**
+     * The level meaning "the usual level for the coding":  6 for gzip and
+     * 3 for zstd.
+     */
+    enum { DEFAULT_LEVEL = 0 };
+
+    /**
+     * Test if a coding can be used in this build.
+     *
+     * @param  coding  the coding.
+     *
+     * @return <code>true</code> means the coding is available.
+     */
+    static bool isAvailable(Coding coding);
+
+    /**
+     * Return the HTTP name of a coding, e.g., "gzip".
+     *
+     * @param  coding  the coding.
+     *
+     * @return the name used in Content-Encoding and Accept-Encoding headers.
+     */
+    static std::string getCodingName(Coding coding);
+
+    /**
+     * Find the coding named in a Content-Encoding header.  The comparison
+     * ignores case, and "x-gzip" is taken to mean "gzip".
+     *
+     * @param  name  the header value.
+     * @param  coding  where to place the coding.
+     *
+     * @return <code>true</code> means the name is known.
+     */
+    static bool getCodingFromName(const std::string &name, Coding &coding);
+
+};  // end class Compression
+
+
+class Compressor
+{
+private:
+    Compression::Coding coding;
+    int                 level;
+    void                *stream;    // z_stream or ZSTD_CStream, if started
+    ServiceException    exception;
+
+public:
+    /**
+     * Initializes a newly created <code>Compressor</code>.
+     *
+     * @param  coding  the coding to produce.
+     * @param  level  the compression level:  1 (fastest) to 9 for gzip, 1 to
+     *             22 for zstd, or <code>Compression::DEFAULT_LEVEL</code>.
+     *             Levels out of range are clamped.
+     */
+    Compressor(
+        Compression::Coding coding,
+        int                 level = Compression::DEFAULT_LEVEL);
+
+    /**
+     * Copy constructor - copies the coding and level, not a stream being
+     * compressed.
+     */
+    Compressor(const Compressor &rhs);
+
+    /**
+     * Destructor - releases the stream state.
+     */
+    ~Compressor();
+
+    /**
+     * Assignment operator - copies the coding and level, abandoning any
+     * stream being compressed.
+     */
+    Compressor& operator=(const Compressor& rhs);
+
+    /**
+     * Compress an entity.  <code>IDENTITY</code> copies it unchanged.
+     *
+     * @param  in  the entity to compress.
+     * @param  out  where to place the compressed entity.
+     *
+     * @return <code>true</code> means success.  <code>false</code> means
+     *         failure; call <code>getException()</code> for the cause.
+     */
+    bool compress(const std::vector<uint8_t> &in, std::vector<uint8_t> &out);
+
+    /**
+     * Start compressing an entity given piece by piece, abandoning any
+     * previous one.
+     *
+     * @return <code>true</code> means success.  <code>false</code> means
+     *         failure; call <code>getException()</code> for the cause.
+     */
+    bool start();
+
+    /**
+     * Compress the next piece of the entity, appending any result to
+     * <code>out</code>.
+     *
+     * @param  data  the bytes of the piece.
+     * @param  n  the number of bytes.
+     * @param  out  where to append the compressed bytes.
+     *
+     * @return <code>true</code> means success.
+     */
+    bool update(const uint8_t *data, size_t n, std::vector<uint8_t> &out);
+
+    /**
+     * Finish the entity, appending the rest of the compressed bytes to
+     * <code>out</code>.
+     *
+     * @param  out  where to append the compressed bytes.
+     *
+     * @return <code>true</code> means success.
+     */
+    bool finish(std::vector<uint8_t> &out);
+
+    /**
+     * Return the coding.
+     */
+    Compression::Coding getCoding() const;
+
+    /**
+     * Return the level in effect (never <code>DEFAULT_LEVEL</code>).
+     */
+    int getLevel() const;
+
+    /**
+     * Return the exception from the most recent failure.
+     */
+    ServiceException getException() const;
+
+private:
+
+    bool run(const uint8_t *data, size_t n, bool last, 
+                                                std::vector<uint8_t> &out);
+    void release();
+
+};  // end class Compressor
+
+
+class Decompressor
+{
+private:
+    Compression::Coding coding;
+    void                *stream;    // z_stream or ZSTD_DStream
+    bool                finished;   // The end of the stream has been seen
+    ServiceException    exception;
+
+public:
+    /**
+     * Initializes a newly created <code>Decompressor</code> which is not yet
+     * decompressing anything.
+     */
+    Decompressor();
+
+    /**
+     * Destructor - releases the stream state.
+     */
+    ~Decompressor();
+
+    /**
+     * Start decompressing a new stream, abandoning any previous one.
+     *
+     * @param  coding  the coding of the stream.
+     *
+     * @return <code>true</code> means success.  <code>false</code> means the
+     *         coding is not available.
+     */
+    bool start(Compression::Coding coding);
+
+    /**
+     * Test if a stream has been started and not yet finished.
+     */
+    bool isActive() const;
+
+    /**
+     * Decompress the next piece of the stream, appending the result to
+     * <code>out</code>.
+     *
+     * @param  data  the compressed bytes.
+     * @param  n  the number of compressed bytes.
+     * @param  out  where to append the decompressed bytes.
+     *
+     * @return <code>true</code> means success.  <code>false</code> means the
+     *         data is corrupt or follows the end of the stream.
+     */
+    bool update(const uint8_t *data, size_t n, std::vector<uint8_t> &out);
+
+    /**
+     * Finish the stream.
+     *
+     * @return <code>true</code> means the whole stream was seen.
+     *         <code>false</code> means it was cut short.
+     */
+    bool finish();
+
+    /**
+     * Return the exception from the most recent failure.
+     */
+    ServiceException getException() const;
+
+private:
+
+    void release();
+
+    /**
+     * Copy constructor - NOT IMPLEMENTED.
+     */
+    Decompressor(const Decompressor &rhs);
+
+    /**
+     * Assignment operator - NOT IMPLEMENTED.
+     */
+    Decompressor& operator=(const Decompressor& rhs);
+
+};  // end class Decompressor
+
+}   // end namespace Yosokumo
+
+#endif  // COMPRESSION_H
+
+// end Compression.h
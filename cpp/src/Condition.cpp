@@ -0,0 +1,50 @@
+// Condition.cpp
+
+#include <errno.h>
+#include <stdint.h>
+#include <sys/time.h>
+
+#include "Condition.h"
+
+using namespace Yosokumo;
+
+Condition::Condition()
+{
+    pthread_cond_init(&cond, NULL);
+}
+
+Condition::~Condition()
+{
+    pthread_cond_destroy(&cond);
+}
+
+void Condition::wait(Mutex &mutex)
+{
+    pthread_cond_wait(&cond, &mutex.mutex);
+}
+
+bool Condition::waitFor(Mutex &mutex, unsigned milliseconds)
+{
+    struct timeval now;
+    gettimeofday(&now, NULL);
+
+    struct timespec deadline;
+    uint64_t nsec = uint64_t(now.tv_usec) * 1000 + 
+                    uint64_t(milliseconds % 1000) * 1000000;
+    deadline.tv_sec  = now.tv_sec + milliseconds / 1000 + nsec / 1000000000;
+    deadline.tv_nsec = nsec % 1000000000;
+
+    return pthread_cond_timedwait(&cond, &mutex.mutex, &deadline) != ETIMEDOUT;
+}
+
+void Condition::signal()
+{
+    pthread_cond_signal(&cond);
+}
+
+void Condition::broadcast()
+{
+    pthread_cond_broadcast(&cond);
+}
+
+// end Condition.cpp
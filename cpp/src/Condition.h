@@ -0,0 +1,86 @@
+// Condition.h
+
+#ifndef CONDITION_H
+#define CONDITION_H
+
+#include <pthread.h>
+
+#include "Mutex.h"
+
+namespace Yosokumo
+{
+
+/**
+ * A thin wrapper around a POSIX condition variable.  A 
+ * <code>Condition</code> is always used together with a <code>Mutex</code>
+ * which guards the data the condition refers to.
+ */
+class Condition
+{
+    pthread_cond_t cond;
+
+public:
+
+    /**
+     * Initializes a newly created <code>Condition</code> object.
+     */
+    Condition();
+
+    /**
+     * Destructor - destroy a <code>Condition</code> object.  No thread may 
+     * be waiting on the condition.
+     */
+    ~Condition();
+
+    /**
+     * Wait for the condition to be signaled.  The mutex must be locked by 
+     * the calling thread; it is unlocked while waiting and locked again 
+     * before the method returns.  As with all condition variables, the 
+     * caller must recheck its predicate after wait() returns.
+     *
+     * @param  mutex  the locked mutex guarding the condition.
+     */
+    void wait(Mutex &mutex);
+
+    /**
+     * Wait for the condition to be signaled, but for no longer than the 
+     * specified time.
+     *
+     * @param  mutex         the locked mutex guarding the condition.
+     * @param  milliseconds  the maximum time to wait.
+     *
+     * @return <code>true</code> means the condition was signaled (or the 
+     *             wait ended spuriously).
+     *         <code>false</code> means the time ran out.
+     */
+    bool waitFor(Mutex &mutex, unsigned milliseconds);
+
+    /**
+     * Wake up one thread waiting on the condition.
+     */
+    void signal();
+
+    /**
+     * Wake up all threads waiting on the condition.
+     */
+    void broadcast();
+
+private:
+
+    /**
+     * Copy constructor - NOT IMPLEMENTED.
+     */
+    Condition(const Condition &rhs);
+
+    /**
+     * Assignment operator - NOT IMPLEMENTED.
+     */
+    Condition& operator=(const Condition& rhs);
+
+};  // end class Condition
+
+}   // end namespace Yosokumo
+
+#endif  // CONDITION_H
+
+// end Condition.h
@@ -0,0 +1,216 @@
+// Hash.h
+
+#ifndef HASH_H
+#define HASH_H
+
+#include <stdint.h>
+#include <string.h>
+#include <string>
+
+#include "Cell.h"
+#include "Identifier.h"
+#include "Specimen.h"
+#include "Value.h"
+
+namespace Yosokumo
+{
+/**
+ * 64-bit hash functions, using FNV-1a.  Each function takes the hash so far
+ * and returns it updated, so hashes of compound objects are built up by
+ * chaining calls, starting from <code>HASH_SEED</code>.
+ */
+
+    /**
+     * The starting value for a hash (the FNV-1a offset basis).
+     */
+    static const uint64_t HASH_SEED = 
+                                (uint64_t(0xcbf29ce4) << 32) | 0x84222325;
+
+    /**
+     * The FNV-1a 64-bit prime.  (Built from 32-bit halves because C++98 has
+     * no long long literals.)
+     */
+    static const uint64_t HASH_PRIME = 
+                                (uint64_t(0x00000100) << 32) | 0x000001b3;
+
+    /**
+     * Add bytes to a hash.
+     *
+     * @param  h      the hash so far.
+     * @param  bytes  the bytes to add.
+     * @param  n      the number of bytes.
+     *
+     * @return the updated hash.
+     */
+    static inline uint64_t hashBytes(uint64_t h, const void *bytes, size_t n)
+    {
+        const uint8_t *p = static_cast<const uint8_t *>(bytes);
+
+        for (size_t i = 0;  i < n;  ++i)
+        {
+            h ^= p[i];
+            h *= HASH_PRIME;
+        }
+
+        return h;
+    }
+
+    /**
+     * Add a 64-bit integer to a hash.
+     */
+    static inline uint64_t hashUint64(uint64_t h, uint64_t v)
+    {
+        return hashBytes(h, &v, sizeof(v));
+    }
+
+    /**
+     * Add a string to a hash.  The length is included, so that ("ab", "c")
+     * and ("a", "bc") hash differently.
+     */
+    static inline uint64_t hashString(uint64_t h, const std::string &s)
+    {
+        h = hashUint64(h, s.size());
+        return hashBytes(h, s.data(), s.size());
+    }
+
+    /**
+     * Scramble a hash so that each bit of the result depends on every bit
+     * of it (the finalizer of SplitMix64).  Hashes combined by XOR or by
+     * addition are scrambled first, so that similar ones do not cancel.
+     */
+    static inline uint64_t mixHash(uint64_t h)
+    {
+        h ^= h >> 30;
+        h *= (uint64_t(0xbf58476d) << 32) | 0x1ce4e5b9;
+        h ^= h >> 27;
+        h *= (uint64_t(0x94d049bb) << 32) | 0x133111eb;
+        h ^= h >> 31;
+
+        return h;
+    }
+
+    /**
+     * Return the hash of one attribute of an object.  The fingerprint of an
+     * object such as a <code>Study</code> is the XOR of the hashes of all its
+     * attributes, so a setter updates it by taking out the hash of the old
+     * value and putting in that of the new (see <code>setAttribute()</code>).
+     *
+     * @param  field  a number for the attribute, different for each.
+     * @param  value  the value of the attribute.
+     *
+     * @return the hash.
+     */
+    static inline uint64_t hashAttribute(unsigned field, uint64_t value)
+    {
+        return mixHash(hashUint64(hashUint64(HASH_SEED, field), value));
+    }
+
+    static inline uint64_t hashAttribute(unsigned field, const std::string &s)
+    {
+        return mixHash(hashString(hashUint64(HASH_SEED, field), s));
+    }
+
+    static inline uint64_t hashAttribute(unsigned field, const Identifier &id)
+    {
+        return hashAttribute(field, id.getHash());
+    }
+
+    /**
+     * Set an attribute of an object, updating the fingerprint of the object.
+     *
+     * @param  fingerprint  the fingerprint of the object.
+     * @param  field        a number for the attribute.
+     * @param  attribute    the attribute.
+     * @param  value        the new value.
+     */
+    template <typename T>
+    inline void setAttribute(
+        uint64_t &fingerprint, unsigned field, T &attribute, const T &value)
+    {
+        fingerprint ^= hashAttribute(field, attribute) ^
+                                                hashAttribute(field, value);
+        attribute = value;
+    }
+
+    /**
+     * Add a value to a hash:  its type and its contents.  Values which are
+     * equal by <code>Value::operator==</code> hash alike:  a real zero is
+     * hashed as +0.0 whatever its sign, and every NaN (which equals nothing)
+     * is hashed as the same quiet NaN.
+     */
+    static inline uint64_t hashValue(uint64_t h, const Value &v)
+    {
+        h = hashUint64(h, v.getType());
+
+        uint64_t bits = 0;
+
+        switch (v.getType())
+        {
+        case Value::NATURAL:
+            bits = v.getNaturalValue();
+            break;
+        case Value::INTEGER:
+            bits = uint64_t(v.getIntegerValue());
+            break;
+        case Value::REAL:
+        {
+            double d = v.getRealValue();
+            if (d == 0.0)
+                d = 0.0;
+            if (d != d)
+                bits = uint64_t(0x7ff80000) << 32;
+            else
+                memcpy(&bits, &d, sizeof(bits));
+            break;
+        }
+        case Value::SPECIAL:
+            bits = v.getSpecialValue();
+            break;
+        default:
+            break;
+        }
+
+        return hashUint64(h, bits);
+    }
+
+    /**
+     * Add a cell to a hash:  its name or key, and its value.
+     */
+    static inline uint64_t hashCell(uint64_t h, const Cell &c)
+    {
+        h = hashUint64(h, c.getKey());
+        return hashValue(h, c.getValue());
+    }
+
+    /**
+     * Return the hash of a cell at a position in a sequence.  The
+     * fingerprint of a cell sequence is the sum of these, so cells are added
+     * to or taken off the end of the sequence without hashing the others
+     * again.
+     */
+    static inline uint64_t hashCellAt(uint64_t position, const Cell &c)
+    {
+        return mixHash(hashCell(hashUint64(HASH_SEED, position), c));
+    }
+
+    /**
+     * Add the contents of a specimen to a hash:  its predictand and its
+     * cells, in order.  The key, status, and weight are not included, so
+     * specimens with the same content hash alike.
+     */
+    static inline uint64_t hashSpecimenContent(uint64_t h, const Specimen &s)
+    {
+        h = hashValue(h, s.getPredictand());
+        h = hashUint64(h, s.size());
+
+        for (uint64_t i = 0;  i < s.size();  ++i)
+            h = hashCell(h, s.getCell(int(i)));
+
+        return h;
+    }
+
+}   // end namespace Yosokumo
+
+#endif  // HASH_H
+
+// end Hash.h
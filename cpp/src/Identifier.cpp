@@ -0,0 +1,143 @@
+// Identifier.cpp
+
+#include "Identifier.h"
+#include "Hash.h"
+
+#include <pthread.h>
+
+#include <vector>
+
+using namespace Yosokumo;
+
+namespace
+{
+
+// The intern table:  an open-addressing hash table of interned strings,
+// with linear probing.  It is at most half full.  Lookups of strings already
+// interned, by far the commonest case, take only the read lock.
+
+pthread_rwlock_t                        tableLock = PTHREAD_RWLOCK_INITIALIZER;
+std::vector<const Identifier::Text *>   *table    = NULL;
+size_t                                  count     = 0;
+
+// Return the slot holding s, or else the empty slot where s belongs.
+// The caller holds the lock, and the table exists.
+
+size_t findSlot(const std::string &s, uint64_t h)
+{
+    size_t mask = table->size() - 1;
+    size_t i;
+
+    for (i = size_t(h) & mask;  (*table)[i] != NULL;  i = (i + 1) & mask)
+    {
+        const Identifier::Text *t = (*table)[i];
+        if (t->hash == h && t->text == s)
+            break;
+    }
+
+    return i;
+}
+
+// Double the table.  The caller holds the write lock.
+
+void grow()
+{
+    std::vector<const Identifier::Text *> *old = table;
+
+    table = new std::vector<const Identifier::Text *>(
+                            (old == NULL) ? 1024 : 2 * old->size(), NULL);
+
+    if (old == NULL)
+        return;
+
+    for (size_t i = 0;  i < old->size();  ++i)
+    {
+        const Identifier::Text *t = (*old)[i];
+        if (t != NULL)
+            (*table)[findSlot(t->text, t->hash)] = t;
+    }
+
+    delete old;
+}
+
+}   // end anonymous namespace
+
+Identifier::Identifier(const std::string &s) :
+    text(NULL)
+{
+    if (s.empty())
+        return;
+
+    uint64_t h = hashString(HASH_SEED, s);
+
+    pthread_rwlock_rdlock(&tableLock);
+    if (table != NULL)
+        text = (*table)[findSlot(s, h)];
+    pthread_rwlock_unlock(&tableLock);
+
+    if (text != NULL)
+        return;
+
+    // Not interned yet; look again under the write lock, as another thread
+    // may have interned s meanwhile
+
+    pthread_rwlock_wrlock(&tableLock);
+
+    if (table == NULL || 2 * (count + 1) > table->size())
+        grow();
+
+    size_t i = findSlot(s, h);
+
+    if ((*table)[i] == NULL)
+    {
+        Text *t = new Text;
+        t->text = s;
+        t->hash = h;
+        (*table)[i] = t;
+        ++count;
+    }
+
+    text = (*table)[i];
+
+    pthread_rwlock_unlock(&tableLock);
+}
+
+bool Identifier::find(const std::string &s, Identifier &id)
+{
+    if (s.empty())
+    {
+        id = Identifier();
+        return true;
+    }
+
+    uint64_t h = hashString(HASH_SEED, s);
+    const Text *t = NULL;
+
+    pthread_rwlock_rdlock(&tableLock);
+    if (table != NULL)
+        t = (*table)[findSlot(s, h)];
+    pthread_rwlock_unlock(&tableLock);
+
+    if (t == NULL)
+        return false;
+
+    id.text = t;
+    return true;
+}
+
+size_t Identifier::getInternedCount()
+{
+    pthread_rwlock_rdlock(&tableLock);
+    size_t n = count;
+    pthread_rwlock_unlock(&tableLock);
+
+    return n;
+}
+
+const std::string &Identifier::emptyString()
+{
+    static const std::string empty;
+    return empty;
+}
+
+// end Identifier.cpp
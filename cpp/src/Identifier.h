@@ -0,0 +1,133 @@
+// Identifier.h
+
+#ifndef IDENTIFIER_H
+#define IDENTIFIER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <ostream>
+#include <string>
+
+namespace Yosokumo
+{
+/**
+ * A user or study identifier, interned.  Each distinct identifier string is
+ * stored once, in a table shared by all threads, and an
+ * <code>Identifier</code> refers to it with a pointer.  So an
+ * <code>Identifier</code> is as small as a pointer, copying one allocates
+ * nothing, and two are compared for equality by comparing pointers.
+ * <p>
+ * The hash of the string is computed once, when it is interned, and kept
+ * with it.
+ * <p>
+ * Interned strings are never freed.  This suits identifiers, of which a
+ * client sees a bounded number; do not intern arbitrary text.
+ */
+class Identifier
+{
+public:
+
+    /**
+     * An interned string and its hash.
+     */
+    struct Text
+    {
+        std::string text;
+        uint64_t    hash;
+    };
+
+private:
+
+    const Text *text;               // NULL means the empty identifier
+
+public:
+
+    /**
+     * Initializes a newly created <code>Identifier</code> to the empty
+     * identifier.
+     */
+    Identifier() : text(NULL)
+    {}
+
+    /**
+     * Initializes a newly created <code>Identifier</code> to a string,
+     * interning the string if it has not been seen before.
+     *
+     * @param  s  the identifier string.
+     */
+    explicit Identifier(const std::string &s);
+
+    /**
+     * Find the identifier for a string without interning it.  A string
+     * which has never been interned cannot be the identifier of anything,
+     * so lookups by string use this to avoid growing the table.
+     *
+     * @param  s   the identifier string.
+     * @param  id  where to place the identifier.
+     *
+     * @return <code>true</code> means s has been interned (or is empty), and
+     *             id is its identifier.  <code>false</code> means it has
+     *             not, and id is unchanged.
+     */
+    static bool find(const std::string &s, Identifier &id);
+
+    /**
+     * Return the number of strings interned so far.
+     */
+    static size_t getInternedCount();
+
+    /**
+     * Return the identifier string.
+     */
+    const std::string &str() const
+    {
+        return (text != NULL) ? text->text : emptyString();
+    }
+
+    /**
+     * Return the hash of the identifier string.
+     */
+    uint64_t getHash() const
+    {
+        return (text != NULL) ? text->hash : 0;
+    }
+
+    bool empty() const
+    {
+        return text == NULL;
+    }
+
+    bool operator==(const Identifier &rhs) const
+    {
+        return text == rhs.text;
+    }
+
+    bool operator!=(const Identifier &rhs) const
+    {
+        return text != rhs.text;
+    }
+
+    /**
+     * Order identifiers by their strings.
+     */
+    bool operator<(const Identifier &rhs) const
+    {
+        return text != rhs.text && str() < rhs.str();
+    }
+
+private:
+
+    static const std::string &emptyString();
+
+};  // end class Identifier
+
+inline std::ostream &operator<<(std::ostream &out, const Identifier &id)
+{
+    return out << id.str();
+}
+
+}   // end namespace Yosokumo
+
+#endif  // IDENTIFIER_H
+
+// end Identifier.h
@@ -0,0 +1,341 @@
+// IdentifierMap.h
+
+#ifndef IDENTIFIERMAP_H
+#define IDENTIFIERMAP_H
+
+#include <stdint.h>
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Identifier.h"
+
+namespace Yosokumo
+{
+/**
+ * A collection of objects indexed by <code>Identifier</code> (e.g., the
+ * studies of a catalog, indexed by study identifier).  Add, find, and remove
+ * take O(1) time on average, and compare identifiers, not strings.
+ * <p>
+ * The entries are kept in a vector, in the order they were added (a removed
+ * entry is replaced by the last entry), and iterating over them visits
+ * consecutive memory.  Call <code>sort()</code> to put the entries in
+ * identifier order.  Iterators are <code>std::pair</code> iterators, as for
+ * <code>std::map</code>:  <code>iter->first</code> is the identifier and
+ * <code>iter->second</code> is the object.  Unlike <code>std::map</code>,
+ * adding or removing an entry invalidates all iterators.
+ * <p>
+ * The index is an open-addressing hash table with linear probing.  Each slot
+ * holds the position of an entry and 32 bits of the entry's hash, so a probe
+ * almost never touches an entry whose identifier does not match.  The full
+ * hash of each entry is cached alongside the entries, so the table can be
+ * grown without touching the interned strings.
+ */
+template <class T>
+class IdentifierMap
+{
+public:
+
+    typedef std::pair<Identifier, T> Entry;
+    typedef typename std::vector<Entry>::iterator iterator;
+    typedef typename std::vector<Entry>::const_iterator const_iterator;
+
+private:
+
+    struct Slot
+    {
+        uint32_t entry;             // Position of the entry + 1; 0 means empty
+        uint32_t tag;               // The high half of the entry's hash
+    };
+
+    enum { MIN_SLOTS = 8 };
+
+    std::vector<Entry>    entries;
+    std::vector<uint64_t> hashes;   // hashes[i] is the hash of entries[i]
+    std::vector<Slot>     slots;    // Empty, or a power of 2 in size
+
+public:
+
+    size_t size() const
+    {
+        return entries.size();
+    }
+
+    bool empty() const
+    {
+        return entries.empty();
+    }
+
+    iterator       begin()       { return entries.begin(); }
+    const_iterator begin() const { return entries.begin(); }
+    iterator       end()         { return entries.end();   }
+    const_iterator end()   const { return entries.end();   }
+
+    /**
+     * Make room for n entries, so that adding up to n entries allocates
+     * nothing more.
+     */
+    void reserve(size_t n)
+    {
+        entries.reserve(n);
+        hashes.reserve(n);
+
+        if (slots.size() < slotsFor(n))
+            rebuild(slotsFor(n));
+    }
+
+    /**
+     * Add an object, or replace the object with the same identifier.
+     *
+     * @param  id     the identifier of the object.
+     * @param  value  the object.
+     * @param  old    where to save the replaced object.  May be NULL.
+     *
+     * @return <code>true</code> means the identifier was not in the map.
+     *         <code>false</code> means an object was replaced.
+     */
+    bool insert(const Identifier &id, const T &value, T *old = NULL)
+    {
+        uint64_t h = id.getHash();
+        size_t s = findSlot(id, h);
+
+        if (s != NOT_FOUND)
+        {
+            T &current = entries[slots[s].entry - 1].second;
+            if (old != NULL)
+                *old = current;
+            current = value;
+            return false;
+        }
+
+        if (slots.size() < slotsFor(entries.size() + 1))
+            rebuild(slotsFor(entries.size() + 1));
+
+        entries.push_back(Entry(id, value));
+        hashes.push_back(h);
+        place(entries.size() - 1);
+
+        return true;
+    }
+
+    /**
+     * Remove the object with an identifier.
+     *
+     * @return <code>true</code> means the identifier was in the map.
+     */
+    bool erase(const Identifier &id)
+    {
+        size_t s = findSlot(id, id.getHash());
+
+        if (s == NOT_FOUND)
+            return false;
+
+        size_t i    = slots[s].entry - 1;
+        size_t last = entries.size() - 1;
+
+        removeSlot(s);
+
+        // Move the last entry into the hole
+
+        if (i != last)
+        {
+            slots[findSlot(entries[last].first, hashes[last])].entry = i + 1;
+            entries[i] = entries[last];
+            hashes[i]  = hashes[last];
+        }
+
+        entries.pop_back();
+        hashes.pop_back();
+
+        return true;
+    }
+
+    /**
+     * Remove the object with an identifier string.
+     *
+     * @return <code>true</code> means the identifier was in the map.
+     */
+    bool erase(const std::string &id)
+    {
+        Identifier interned;
+        return Identifier::find(id, interned) && erase(interned);
+    }
+
+    void clear()
+    {
+        entries.clear();
+        hashes.clear();
+        slots.clear();
+    }
+
+    /**
+     * Return the object with an identifier, or NULL if there is none.
+     */
+    const T *find(const Identifier &id) const
+    {
+        size_t s = findSlot(id, id.getHash());
+        return (s == NOT_FOUND) ? NULL : &entries[slots[s].entry - 1].second;
+    }
+
+    T *find(const Identifier &id)
+    {
+        size_t s = findSlot(id, id.getHash());
+        return (s == NOT_FOUND) ? NULL : &entries[slots[s].entry - 1].second;
+    }
+
+    /**
+     * Return the object with an identifier string, or NULL if there is none.
+     */
+    const T *find(const std::string &id) const
+    {
+        Identifier interned;
+        return Identifier::find(id, interned) ? find(interned) : NULL;
+    }
+
+    T *find(const std::string &id)
+    {
+        Identifier interned;
+        return Identifier::find(id, interned) ? find(interned) : NULL;
+    }
+
+    /**
+     * Put the entries in identifier order.
+     */
+    void sort()
+    {
+        std::vector<std::pair<std::string, size_t> > order;
+        order.reserve(entries.size());
+        for (size_t i = 0;  i < entries.size();  ++i)
+            order.push_back(std::make_pair(entries[i].first.str(), i));
+        std::sort(order.begin(), order.end());
+
+        std::vector<Entry>    sortedEntries;
+        std::vector<uint64_t> sortedHashes;
+        sortedEntries.reserve(entries.size());
+        sortedHashes.reserve(entries.size());
+        for (size_t i = 0;  i < order.size();  ++i)
+        {
+            sortedEntries.push_back(entries[order[i].second]);
+            sortedHashes.push_back(hashes[order[i].second]);
+        }
+
+        entries.swap(sortedEntries);
+        hashes.swap(sortedHashes);
+        rebuild(slots.size());
+    }
+
+    /**
+     * Test if two maps hold equal objects under the same identifiers,
+     * regardless of order.
+     */
+    bool operator==(const IdentifierMap &rhs) const
+    {
+        if (size() != rhs.size())
+            return false;
+
+        for (size_t i = 0;  i < entries.size();  ++i)
+        {
+            const T *r = rhs.find(entries[i].first);
+            if (r == NULL || !(entries[i].second == *r))
+                return false;
+        }
+
+        return true;
+    }
+
+    bool operator!=(const IdentifierMap &rhs) const
+    {
+        return !(*this == rhs);
+    }
+
+private:
+
+    static const size_t NOT_FOUND = size_t(-1);
+
+    // The number of slots for n entries:  the table is at most half full
+
+    static size_t slotsFor(size_t n)
+    {
+        size_t s = MIN_SLOTS;
+        while (s < 2 * n)
+            s *= 2;
+        return s;
+    }
+
+    size_t findSlot(const Identifier &id, uint64_t h) const
+    {
+        if (slots.empty())
+            return NOT_FOUND;
+
+        size_t   mask = slots.size() - 1;
+        uint32_t tag  = uint32_t(h >> 32);
+
+        for (size_t s = size_t(h) & mask;  slots[s].entry != 0;
+                                                        s = (s + 1) & mask)
+        {
+            if (slots[s].tag == tag && entries[slots[s].entry - 1].first == id)
+                return s;
+        }
+
+        return NOT_FOUND;
+    }
+
+    // Put entry i in the first free slot of its probe sequence
+
+    void place(size_t i)
+    {
+        size_t s, mask = slots.size() - 1;
+
+        for (s = size_t(hashes[i]) & mask;  slots[s].entry != 0;
+                                                        s = (s + 1) & mask)
+            ;
+
+        slots[s].entry = uint32_t(i + 1);
+        slots[s].tag   = uint32_t(hashes[i] >> 32);
+    }
+
+    // Empty slot s, moving back later slots of the same run which would
+    // otherwise no longer be found
+
+    void removeSlot(size_t s)
+    {
+        size_t mask = slots.size() - 1;
+        size_t j = s;
+
+        for (;;)
+        {
+            j = (j + 1) & mask;
+            if (slots[j].entry == 0)
+                break;
+
+            size_t home = size_t(hashes[slots[j].entry - 1]) & mask;
+
+            // Leave slot j alone if its home lies cyclically in (s, j]
+
+            if (s <= j ? (s < home && home <= j) : (s < home || home <= j))
+                continue;
+
+            slots[s] = slots[j];
+            s = j;
+        }
+
+        slots[s].entry = 0;
+    }
+
+    void rebuild(size_t nSlots)
+    {
+        Slot empty = { 0, 0 };
+        slots.assign(nSlots, empty);
+
+        for (size_t i = 0;  i < entries.size();  ++i)
+            place(i);
+    }
+
+};  // end class IdentifierMap
+
+}   // end namespace Yosokumo
+
+#endif  // IDENTIFIERMAP_H
+
+// end IdentifierMap.h
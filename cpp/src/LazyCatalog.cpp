@@ -0,0 +1,176 @@
+// LazyCatalog.cpp
+
+#include "LazyCatalog.h"
+#include "YosokumoProtobuf.h"
+
+#include <algorithm>
+#include <string.h>
+
+using namespace Yosokumo;
+
+LazyCatalog::LazyCatalog()
+{}
+
+void LazyCatalog::clear()
+{
+    std::vector<uint8_t>().swap(bytes);
+    userIdentifier.clear();
+    userName.clear();
+    catalogLocation.clear();
+    std::vector<StudyEntry>().swap(studies);
+    std::vector<uint32_t>().swap(byIdentifier);
+}
+
+const std::string &LazyCatalog::getUserIdentifier() const
+{
+    return userIdentifier;
+}
+
+const std::string &LazyCatalog::getUserName() const
+{
+    return userName;
+}
+
+const std::string &LazyCatalog::getCatalogLocation() const
+{
+    return catalogLocation;
+}
+
+size_t LazyCatalog::size() const
+{
+    return studies.size();
+}
+
+std::string LazyCatalog::getStudyIdentifier(size_t index) const
+{
+    if (index >= studies.size())
+        return "";
+
+    const StudyEntry &entry = studies[index];
+
+    return std::string((const char *)&bytes[0] + entry.identifierOffset,
+                                                    entry.identifierLength);
+}
+
+bool LazyCatalog::getStudy(size_t index, Study &study) const
+{
+    if (index >= studies.size())
+        return false;
+
+    const StudyEntry &entry = studies[index];
+
+    YosokumoProtobuf dif;
+    return dif.makeStudyFromBytes(&bytes[0] + entry.studyOffset,
+                                                    entry.studyLength, study);
+}
+
+bool LazyCatalog::findStudy(
+    const std::string &studyIdentifier,
+    Study             &study) const
+{
+    return getStudy(find(studyIdentifier), study);
+}
+
+bool LazyCatalog::containsStudy(const std::string &studyIdentifier) const
+{
+    return find(studyIdentifier) < studies.size();
+}
+
+bool LazyCatalog::getCatalog(Catalog &catalog) const
+{
+    catalog.setUserIdentifier (userIdentifier );
+    catalog.setUserName       (userName       );
+    catalog.setCatalogLocation(catalogLocation);
+
+    catalog.clearStudies();
+    catalog.reserveStudies(int(studies.size()));
+
+    for (size_t i = 0;  i < studies.size();  ++i)
+    {
+        Study study;
+
+        if (!getStudy(i, study) || !catalog.addStudy(study))
+            return false;
+    }
+
+    return true;
+}
+
+// Orders positions in studies by the identifiers of the studies
+
+struct LazyCatalog::IdentifierLess
+{
+    const LazyCatalog &catalog;
+
+    IdentifierLess(const LazyCatalog &catalog) : catalog(catalog)
+    {}
+
+    int compare(uint32_t a, uint32_t b) const
+    {
+        const StudyEntry &x = catalog.studies[a];
+        const StudyEntry &y = catalog.studies[b];
+
+        size_t n = std::min(x.identifierLength, y.identifierLength);
+        int c = n == 0 ? 0 : memcmp(&catalog.bytes[0] + x.identifierOffset,
+                                    &catalog.bytes[0] + y.identifierOffset, n);
+        if (c != 0)
+            return c;
+
+        return x.identifierLength < y.identifierLength ? -1 :
+               x.identifierLength > y.identifierLength ?  1 : 0;
+    }
+
+    bool operator()(uint32_t a, uint32_t b) const
+    {
+        return compare(a, b) < 0;
+    }
+};
+
+bool LazyCatalog::sortIdentifiers()
+{
+    byIdentifier.resize(studies.size());
+    for (size_t i = 0;  i < studies.size();  ++i)
+        byIdentifier[i] = uint32_t(i);
+
+    IdentifierLess less(*this);
+    std::sort(byIdentifier.begin(), byIdentifier.end(), less);
+
+    for (size_t i = 1;  i < byIdentifier.size();  ++i)
+        if (less.compare(byIdentifier[i - 1], byIdentifier[i]) == 0)
+            return false;
+
+    return true;
+}
+
+size_t LazyCatalog::find(const std::string &studyIdentifier) const
+{
+    // Binary search of byIdentifier, comparing bytes as std::string does
+
+    size_t lo = 0, hi = byIdentifier.size();
+
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        const StudyEntry &entry = studies[byIdentifier[mid]];
+
+        size_t n = std::min(size_t(entry.identifierLength),
+                                                    studyIdentifier.size());
+        int c = n == 0 ? 0 : memcmp(&bytes[0] + entry.identifierOffset,
+                                                    studyIdentifier.data(), n);
+        if (c == 0)
+        {
+            if (entry.identifierLength == studyIdentifier.size())
+                return byIdentifier[mid];
+            c = entry.identifierLength < studyIdentifier.size() ? -1 : 1;
+        }
+
+        if (c < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return studies.size();
+}
+
+// end LazyCatalog.cpp
@@ -0,0 +1,165 @@
+// LazyCatalog.h
+
+#ifndef LAZYCATALOG_H
+#define LAZYCATALOG_H
+
+#include "Catalog.h"
+#include "Study.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace Yosokumo
+{
+
+class YosokumoProtobuf;
+
+/**
+ * A catalog which keeps the encoded catalog as it came from the server and
+ * decodes a study only when it is asked for.  Decoding a
+ * <code>Catalog</code> builds every study of it, which for a user with
+ * tens of thousands of studies takes far more time and memory than most
+ * callers need, as they look at a handful of studies and ignore the rest.
+ * <p>
+ * A <code>LazyCatalog</code> is filled by
+ * <code>Service::getLazyCatalog()</code>, or by
+ * <code>YosokumoProtobuf::makeLazyCatalogFromBytes()</code>, in one pass
+ * over the bytes which finds where each study lies and reads its
+ * identifier, and nothing else.  What is kept is the bytes themselves
+ * plus 20 bytes of index per study.  For example:
+ * <pre>
+ *    LazyCatalog catalog;
+ *    if (service.getLazyCatalog(catalog))
+ *    {
+ *        Study study;
+ *        if (catalog.findStudy(studyIdentifier, study))
+ *            ...
+ *    }
+ * </pre>
+ * The const methods may be called from any number of threads at once.
+ */
+class LazyCatalog
+{
+    friend class YosokumoProtobuf;
+
+    // Where a study and its identifier lie in the bytes
+
+    struct StudyEntry
+    {
+        uint32_t studyOffset;
+        uint32_t studyLength;
+        uint32_t identifierOffset;
+        uint32_t identifierLength;
+    };
+
+    struct IdentifierLess;
+
+    std::vector<uint8_t>    bytes;
+    std::string             userIdentifier;
+    std::string             userName;
+    std::string             catalogLocation;
+    std::vector<StudyEntry> studies;        // in the order of the catalog
+    std::vector<uint32_t>   byIdentifier;   // studies, sorted by identifier
+
+public:
+
+    /**
+     * Initializes a newly created <code>LazyCatalog</code> with no studies.
+     */
+    LazyCatalog();
+
+    /**
+     * Forget the catalog, leaving no studies.
+     */
+    void clear();
+
+    /**
+     * Return the identifier of the user to whom the catalog belongs.
+     */
+    const std::string &getUserIdentifier() const;
+
+    /**
+     * Return the name of the user to whom the catalog belongs.
+     */
+    const std::string &getUserName() const;
+
+    /**
+     * Return the URI of the catalog.
+     */
+    const std::string &getCatalogLocation() const;
+
+    /**
+     * Return the number of studies in the catalog.
+     */
+    size_t size() const;
+
+    /**
+     * Get the identifier of a study by its position in the catalog, without
+     * decoding the study.
+     *
+     * @param  index  the position, less than <code>size()</code>.
+     *
+     * @return the study identifier, or empty if there is no such study.
+     */
+    std::string getStudyIdentifier(size_t index) const;
+
+    /**
+     * Get a study by its position in the catalog.
+     *
+     * @param  index  the position, less than <code>size()</code>.
+     * @param  study  where to place the study.
+     *
+     * @return <code>true</code> means success.
+     *         <code>false</code> means there is no such study, or it could
+     *             not be decoded.
+     */
+    bool getStudy(size_t index, Study &study) const;
+
+    /**
+     * Find a study by its identifier.  Takes time in proportion to the log
+     * of the number of studies, plus the decoding of the one study.
+     *
+     * @param  studyIdentifier  the study identifier.
+     * @param  study  where to place the study.
+     *
+     * @return <code>true</code> means it was found and decoded.
+     */
+    bool findStudy(const std::string &studyIdentifier, Study &study) const;
+
+    /**
+     * Test if the catalog contains a study, without decoding it.
+     *
+     * @param  studyIdentifier  the study identifier.
+     *
+     * @return <code>true</code> means the catalog contains the study.
+     */
+    bool containsStudy(const std::string &studyIdentifier) const;
+
+    /**
+     * Decode the whole catalog, with every study.
+     *
+     * @param  catalog  where to place the catalog.
+     *
+     * @return <code>true</code> means success.
+     */
+    bool getCatalog(Catalog &catalog) const;
+
+private:
+
+    // Sort byIdentifier; false means two studies have the same identifier
+
+    bool sortIdentifiers();
+
+    // Return the position in studies of a study identifier, or size()
+
+    size_t find(const std::string &studyIdentifier) const;
+
+};  // end class LazyCatalog
+
+}   // end namespace Yosokumo
+
+#endif  // LAZYCATALOG_H
+
+// end LazyCatalog.h
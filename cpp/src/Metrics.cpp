@@ -0,0 +1,432 @@
+// Metrics.cpp
+
+#include "Metrics.h"
+
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+
+#include <sstream>
+
+using namespace Yosokumo;
+
+//***************************   LatencyHistogram   ************************
+
+LatencyHistogram::LatencyHistogram() : count(0), sum(0), max(0)
+{
+    memset(counts, 0, sizeof(counts));
+}
+
+unsigned LatencyHistogram::getBucketIndex(uint64_t v)
+{
+    if (v < SUB_BUCKETS)
+        return unsigned(v);
+
+    unsigned e = 4;                     // 2^4 == SUB_BUCKETS
+    while (e < 63 && (v >> (e + 1)) != 0)
+        ++e;
+
+    if (e >= MAX_EXPONENT)
+        return NUM_BUCKETS - 1;
+
+    unsigned sub = unsigned(v >> (e - 4)) - SUB_BUCKETS;
+    return SUB_BUCKETS + (e - 4) * SUB_BUCKETS + sub;
+}
+
+uint64_t LatencyHistogram::getBucketUpperBound(unsigned bucket)
+{
+    if (bucket < SUB_BUCKETS)
+        return bucket;
+
+    unsigned e   = 4 + (bucket - SUB_BUCKETS) / SUB_BUCKETS;
+    unsigned sub = (bucket - SUB_BUCKETS) % SUB_BUCKETS;
+
+    return (uint64_t(SUB_BUCKETS + sub + 1) << (e - 4)) - 1;
+}
+
+void LatencyHistogram::record(uint64_t microseconds)
+{
+    ++counts[getBucketIndex(microseconds)];
+    ++count;
+    sum += microseconds;
+    if (microseconds > max)
+        max = microseconds;
+}
+
+void LatencyHistogram::addToBucket(unsigned bucket, uint64_t n)
+{
+    if (bucket < NUM_BUCKETS)
+        counts[bucket] += n;
+}
+
+void LatencyHistogram::addTotals(uint64_t count, uint64_t sum, uint64_t max)
+{
+    this->count += count;
+    this->sum   += sum;
+    if (max > this->max)
+        this->max = max;
+}
+
+void LatencyHistogram::subtract(const LatencyHistogram &earlier)
+{
+    for (unsigned i = 0;  i < NUM_BUCKETS;  ++i)
+        counts[i] -= earlier.counts[i];
+    count -= earlier.count;
+    sum   -= earlier.sum;
+}
+
+uint64_t LatencyHistogram::getCount() const
+{
+    return count;
+}
+
+uint64_t LatencyHistogram::getSum() const
+{
+    return sum;
+}
+
+uint64_t LatencyHistogram::getMax() const
+{
+    return max;
+}
+
+uint64_t LatencyHistogram::getBucketCount(unsigned bucket) const
+{
+    return bucket < NUM_BUCKETS ? counts[bucket] : 0;
+}
+
+uint64_t LatencyHistogram::getPercentile(double percentile) const
+{
+    if (count == 0)
+        return 0;
+
+    // The rank of the value wanted, counting from one
+
+    uint64_t rank = uint64_t(percentile / 100.0 * count + 0.5);
+    if (rank < 1)
+        rank = 1;
+    if (rank > count)
+        rank = count;
+
+    uint64_t seen = 0;
+    for (unsigned i = 0;  i < NUM_BUCKETS;  ++i)
+    {
+        seen += counts[i];
+        if (seen >= rank)
+        {
+            uint64_t bound = getBucketUpperBound(i);
+            return bound < max ? bound : max;
+        }
+    }
+
+    return max;
+}
+
+uint64_t LatencyHistogram::getCountAtOrBelow(uint64_t microseconds) const
+{
+    uint64_t n = 0;
+    for (unsigned i = 0;  i < NUM_BUCKETS;  ++i)
+    {
+        if (getBucketUpperBound(i) > microseconds)
+            break;
+        n += counts[i];
+    }
+
+    return n;
+}
+
+//*******************************   Metrics   *****************************
+
+// The metrics of one thread.  Only the owning thread writes a slot; other
+// threads read it for a snapshot.  Both use relaxed atomic loads and stores
+// so that the values read are never torn, and the owner need not use a
+// locked read-modify-write.
+
+namespace
+{
+
+struct MetricsSlot
+{
+    uint64_t counters[Metrics::NUM_COUNTERS];
+    uint64_t buckets [Metrics::NUM_HISTOGRAMS][LatencyHistogram::NUM_BUCKETS];
+    uint64_t counts  [Metrics::NUM_HISTOGRAMS];
+    uint64_t sums    [Metrics::NUM_HISTOGRAMS];
+    uint64_t maxes   [Metrics::NUM_HISTOGRAMS];
+
+    bool        inUse;              // Owned by a live thread
+    MetricsSlot *next;
+};
+
+inline uint64_t peek(const uint64_t *p)
+{
+    return __atomic_load_n(p, __ATOMIC_RELAXED);
+}
+
+inline void bump(uint64_t *p, uint64_t n)
+{
+    __atomic_store_n(p, peek(p) + n, __ATOMIC_RELAXED);
+}
+
+// The slots of all threads which have recorded anything.  A slot is never
+// freed:  when its thread ends it is kept for the totals and given to the
+// next new thread.
+
+pthread_mutex_t slotsMutex = PTHREAD_MUTEX_INITIALIZER;
+MetricsSlot     *slots     = NULL;
+
+pthread_once_t  keyOnce = PTHREAD_ONCE_INIT;
+pthread_key_t   slotKey;
+
+bool enabled = true;
+
+extern "C" void releaseSlot(void *p)
+{
+    pthread_mutex_lock(&slotsMutex);
+    static_cast<MetricsSlot *>(p)->inUse = false;
+    pthread_mutex_unlock(&slotsMutex);
+}
+
+extern "C" void createSlotKey()
+{
+    pthread_key_create(&slotKey, releaseSlot);
+}
+
+MetricsSlot *getSlot()
+{
+    pthread_once(&keyOnce, createSlotKey);
+
+    MetricsSlot *slot = static_cast<MetricsSlot *>(
+                                            pthread_getspecific(slotKey));
+    if (slot != NULL)
+        return slot;
+
+    pthread_mutex_lock(&slotsMutex);
+
+    for (slot = slots;  slot != NULL;  slot = slot->next)
+        if (!slot->inUse)
+            break;
+
+    if (slot == NULL)
+    {
+        slot = new MetricsSlot;
+        memset(slot, 0, sizeof(*slot));
+        slot->next = slots;
+        slots      = slot;
+    }
+
+    slot->inUse = true;
+
+    pthread_mutex_unlock(&slotsMutex);
+
+    pthread_setspecific(slotKey, slot);
+    return slot;
+}
+
+struct CounterInfo
+{
+    const char *name;
+    const char *help;
+};
+
+// Counters with the same name (before the labels) form one family
+
+const CounterInfo counterInfo[Metrics::NUM_COUNTERS] =
+{
+    { "yosokumo_requests_total{method=\"GET\"}",    "Requests made."  },
+    { "yosokumo_requests_total{method=\"POST\"}",   "Requests made."  },
+    { "yosokumo_requests_total{method=\"PUT\"}",    "Requests made."  },
+    { "yosokumo_requests_total{method=\"DELETE\"}", "Requests made."  },
+    { "yosokumo_bytes_sent_total",      "Bytes sent to the server."   },
+    { "yosokumo_bytes_received_total",  "Bytes received from the server." },
+    { "yosokumo_responses_total{class=\"1xx\"}", "Responses by status."  },
+    { "yosokumo_responses_total{class=\"2xx\"}", "Responses by status."  },
+    { "yosokumo_responses_total{class=\"3xx\"}", "Responses by status."  },
+    { "yosokumo_responses_total{class=\"4xx\"}", "Responses by status."  },
+    { "yosokumo_responses_total{class=\"5xx\"}", "Responses by status."  },
+    { "yosokumo_transport_errors_total", "Requests which got no response." },
+    { "yosokumo_connections_opened_total", "TCP connections opened."    }
+};
+
+const CounterInfo histogramInfo[Metrics::NUM_HISTOGRAMS] =
+{
+    { "yosokumo_dns_seconds",        "Time to resolve the host name."      },
+    { "yosokumo_connect_seconds",    "Time to open a TCP connection."      },
+    { "yosokumo_send_seconds",       "Time to send a request."             },
+    { "yosokumo_first_byte_seconds", "Time from send to the status line."  },
+    { "yosokumo_receive_seconds",    "Time to receive the response."       },
+    { "yosokumo_request_seconds",    "Time for a whole request."           },
+    { "yosokumo_serialize_seconds",  "Time to encode an entity."           },
+    { "yosokumo_parse_seconds",      "Time to decode an entity."           }
+};
+
+// The bucket bounds given in the Prometheus text
+
+const uint64_t     promBounds[] = { 100, 250, 500, 1000, 2500, 5000, 10000,
+                        25000, 50000, 100000, 250000, 500000, 1000000,
+                        2500000, 5000000, 10000000 };
+const char * const promLabels[] = { "0.0001", "0.00025", "0.0005", "0.001",
+                        "0.0025", "0.005", "0.01", "0.025", "0.05", "0.1",
+                        "0.25", "0.5", "1", "2.5", "5", "10" };
+
+std::string familyOf(const char *name)
+{
+    std::string s(name);
+    return s.substr(0, s.find('{'));
+}
+
+}   // end anonymous namespace
+
+void Metrics::increment(Counter counter, uint64_t n)
+{
+    if (!isEnabled() || counter >= NUM_COUNTERS)
+        return;
+
+    bump(&getSlot()->counters[counter], n);
+}
+
+void Metrics::record(Histogram histogram, uint64_t microseconds)
+{
+    if (!isEnabled() || histogram >= NUM_HISTOGRAMS)
+        return;
+
+    MetricsSlot *slot = getSlot();
+    unsigned bucket = LatencyHistogram::getBucketIndex(microseconds);
+
+    bump(&slot->buckets[histogram][bucket], 1);
+    bump(&slot->counts [histogram],         1);
+    bump(&slot->sums   [histogram],         microseconds);
+    if (microseconds > peek(&slot->maxes[histogram]))
+        __atomic_store_n(&slot->maxes[histogram], microseconds,
+                                                        __ATOMIC_RELAXED);
+}
+
+void Metrics::snapshot(MetricsSnapshot &s)
+{
+    s = MetricsSnapshot();
+
+    pthread_mutex_lock(&slotsMutex);
+    MetricsSlot *first = slots;
+    pthread_mutex_unlock(&slotsMutex);
+
+    // Slots are only ever added at the head, so the list from first on
+    // does not change
+
+    for (MetricsSlot *slot = first;  slot != NULL;  slot = slot->next)
+    {
+        for (unsigned c = 0;  c < NUM_COUNTERS;  ++c)
+            s.counters[c] += peek(&slot->counters[c]);
+
+        for (unsigned h = 0;  h < NUM_HISTOGRAMS;  ++h)
+        {
+            for (unsigned b = 0;  b < LatencyHistogram::NUM_BUCKETS;  ++b)
+                s.histograms[h].addToBucket(b, peek(&slot->buckets[h][b]));
+            s.histograms[h].addTotals(peek(&slot->counts[h]),
+                                      peek(&slot->sums[h]),
+                                      peek(&slot->maxes[h]));
+        }
+    }
+}
+
+void Metrics::setEnabled(bool on)
+{
+    __atomic_store_n(&enabled, on, __ATOMIC_RELAXED);
+}
+
+bool Metrics::isEnabled()
+{
+    return __atomic_load_n(&enabled, __ATOMIC_RELAXED);
+}
+
+uint64_t Metrics::currentTimeMicros()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return uint64_t(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+std::string Metrics::getCounterName(Counter counter)
+{
+    return counter < NUM_COUNTERS ? counterInfo[counter].name : "";
+}
+
+std::string Metrics::getHistogramName(Histogram histogram)
+{
+    return histogram < NUM_HISTOGRAMS ? histogramInfo[histogram].name : "";
+}
+
+//***************************   MetricsSnapshot   *************************
+
+MetricsSnapshot::MetricsSnapshot()
+{
+    memset(counters, 0, sizeof(counters));
+}
+
+uint64_t MetricsSnapshot::getCounter(Metrics::Counter counter) const
+{
+    return counter < Metrics::NUM_COUNTERS ? counters[counter] : 0;
+}
+
+const LatencyHistogram &MetricsSnapshot::getHistogram(
+    Metrics::Histogram histogram) const
+{
+    return histograms[histogram];
+}
+
+void MetricsSnapshot::subtract(const MetricsSnapshot &earlier)
+{
+    for (unsigned c = 0;  c < Metrics::NUM_COUNTERS;  ++c)
+        counters[c] -= earlier.counters[c];
+
+    for (unsigned h = 0;  h < Metrics::NUM_HISTOGRAMS;  ++h)
+        histograms[h].subtract(earlier.histograms[h]);
+}
+
+std::string MetricsSnapshot::toPrometheusText() const
+{
+    std::stringstream s;
+    std::string lastFamily;
+
+    for (unsigned c = 0;  c < Metrics::NUM_COUNTERS;  ++c)
+    {
+        std::string family = familyOf(counterInfo[c].name);
+        if (family != lastFamily)
+        {
+            s << "# HELP " << family << ' ' << counterInfo[c].help << '\n';
+            s << "# TYPE " << family << " counter\n";
+            lastFamily = family;
+        }
+        s << counterInfo[c].name << ' ' << counters[c] << '\n';
+    }
+
+    for (unsigned h = 0;  h < Metrics::NUM_HISTOGRAMS;  ++h)
+    {
+        const char       *name = histogramInfo[h].name;
+        const LatencyHistogram &hist = histograms[h];
+
+        s << "# HELP " << name << ' ' << histogramInfo[h].help << '\n';
+        s << "# TYPE " << name << " histogram\n";
+
+        for (unsigned i = 0;  i < sizeof(promBounds) / sizeof(uint64_t);  ++i)
+            s << name << "_bucket{le=\"" << promLabels[i] << "\"} " <<
+                                hist.getCountAtOrBelow(promBounds[i]) << '\n';
+
+        s << name << "_bucket{le=\"+Inf\"} " << hist.getCount() << '\n';
+        s << name << "_sum "   << hist.getSum() / 1e6 << '\n';
+        s << name << "_count " << hist.getCount() << '\n';
+    }
+
+    return s.str();
+}
+
+//*****************************   ScopedTimer   ***************************
+
+ScopedTimer::ScopedTimer(Metrics::Histogram histogram) :
+    histogram(histogram), start(Metrics::currentTimeMicros())
+{}
+
+ScopedTimer::~ScopedTimer()
+{
+    Metrics::record(histogram, Metrics::currentTimeMicros() - start);
+}
+
+// end Metrics.cpp
@@ -0,0 +1,314 @@
+// Metrics.h
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+#include <string>
+
+namespace Yosokumo
+{
+
+/**
+ * A latency histogram with buckets of bounded relative width, in the manner
+ * of HdrHistogram:  values below 16 microseconds each have a bucket, and
+ * each power of two above that is split into 16 buckets, so a recorded
+ * value is known to within about 6%.  Values up to 2^40 microseconds (about
+ * 12 days) are kept; larger ones go in the last bucket.
+ * <p>
+ * A <code>LatencyHistogram</code> is a plain value, as found in a
+ * <code>MetricsSnapshot</code>; it is not safe for use by more than one
+ * thread at a time.
+ */
+class LatencyHistogram
+{
+public:
+
+    enum
+    {
+        SUB_BUCKETS  = 16,
+        MAX_EXPONENT = 40,
+        NUM_BUCKETS  = SUB_BUCKETS * (MAX_EXPONENT - 3)
+    };
+
+private:
+    uint64_t counts[NUM_BUCKETS];
+    uint64_t count;
+    uint64_t sum;
+    uint64_t max;
+
+public:
+    /**
+     * Initializes a newly created, empty <code>LatencyHistogram</code>.
+     */
+    LatencyHistogram();
+
+    /**
+     * Record a value.
+     *
+     * @param  microseconds  the value.
+     */
+    void record(uint64_t microseconds);
+
+    /**
+     * Add the counts of a bucket, as when merging histograms.
+     *
+     * @param  bucket  the bucket index.
+     * @param  n  the number of values to add to the bucket.
+     */
+    void addToBucket(unsigned bucket, uint64_t n);
+
+    /**
+     * Add to the total and maximum, as when merging histograms.
+     */
+    void addTotals(uint64_t count, uint64_t sum, uint64_t max);
+
+    /**
+     * Subtract an earlier histogram of the same values, leaving the values
+     * recorded since.  The maximum is left as is.
+     *
+     * @param  earlier  the earlier histogram.
+     */
+    void subtract(const LatencyHistogram &earlier);
+
+    /**
+     * Return the number of values recorded.
+     */
+    uint64_t getCount() const;
+
+    /**
+     * Return the sum of the values recorded, in microseconds.
+     */
+    uint64_t getSum() const;
+
+    /**
+     * Return the largest value recorded, in microseconds.
+     */
+    uint64_t getMax() const;
+
+    /**
+     * Return the count of one bucket.
+     */
+    uint64_t getBucketCount(unsigned bucket) const;
+
+    /**
+     * Return an upper bound of the values at a percentile.
+     *
+     * @param  percentile  from 0 to 100.
+     *
+     * @return the upper bound, in microseconds, of the bucket holding the
+     *         value at the percentile; zero if the histogram is empty.
+     */
+    uint64_t getPercentile(double percentile) const;
+
+    /**
+     * Return the number of values not greater than a bound.  Buckets count
+     * only if all their values are under the bound.
+     *
+     * @param  microseconds  the bound.
+     */
+    uint64_t getCountAtOrBelow(uint64_t microseconds) const;
+
+    /**
+     * Return the bucket index for a value.
+     */
+    static unsigned getBucketIndex(uint64_t microseconds);
+
+    /**
+     * Return the largest value which goes in a bucket.
+     */
+    static uint64_t getBucketUpperBound(unsigned bucket);
+
+};  // end class LatencyHistogram
+
+
+class MetricsSnapshot;
+
+/**
+ * Counters and latency histograms for every request made by the library.
+ * <p>
+ * Each thread records into its own slot, which no other thread writes, so
+ * recording never waits for a lock.  <code>snapshot()</code> adds up the
+ * slots of all threads, including threads which have ended.  The snapshot
+ * can be printed in the Prometheus text format, e.g., for a /metrics page:
+ * <pre>
+ *    MetricsSnapshot s;
+ *    Metrics::snapshot(s);
+ *    std::cout << s.toPrometheusText();
+ * </pre>
+ * <p>
+ * The DNS and CONNECT times are only recorded when a new connection is made;
+ * a request over a kept-open connection has none.  Recording may be turned
+ * off with <code>setEnabled(false)</code>.
+ */
+class Metrics
+{
+public:
+
+    enum Counter
+    {
+        REQUESTS_GET,
+        REQUESTS_POST,
+        REQUESTS_PUT,
+        REQUESTS_DELETE,
+        BYTES_SENT,
+        BYTES_RECEIVED,
+        RESPONSES_1XX,
+        RESPONSES_2XX,
+        RESPONSES_3XX,
+        RESPONSES_4XX,
+        RESPONSES_5XX,
+        TRANSPORT_ERRORS,
+        CONNECTIONS_OPENED,
+        NUM_COUNTERS
+    };
+
+    enum Histogram
+    {
+        DNS_TIME,           // Resolving the host name
+        CONNECT_TIME,       // TCP connect
+        SEND_TIME,          // Writing the request
+        FIRST_BYTE_TIME,    // From end of send to the status line
+        RECEIVE_TIME,       // From the status line to the end of the entity
+        REQUEST_TIME,       // The whole request, including retries
+        SERIALIZE_TIME,     // YosokumoProtobuf:  object to bytes
+        PARSE_TIME,         // YosokumoProtobuf:  bytes to object
+        NUM_HISTOGRAMS
+    };
+
+    /**
+     * Add to a counter of the calling thread.
+     *
+     * @param  counter  the counter.
+     * @param  n  the amount to add.
+     */
+    static void increment(Counter counter, uint64_t n = 1);
+
+    /**
+     * Record a time in a histogram of the calling thread.
+     *
+     * @param  histogram  the histogram.
+     * @param  microseconds  the time.
+     */
+    static void record(Histogram histogram, uint64_t microseconds);
+
+    /**
+     * Add up the counters and histograms of all threads.
+     *
+     * @param  s  where to place the totals.
+     */
+    static void snapshot(MetricsSnapshot &s);
+
+    /**
+     * Turn recording on or off.  It is on to start with.
+     */
+    static void setEnabled(bool on);
+
+    /**
+     * Test if recording is on.
+     */
+    static bool isEnabled();
+
+    /**
+     * Return a monotonic time in microseconds, for timing.
+     */
+    static uint64_t currentTimeMicros();
+
+    /**
+     * Return the Prometheus name of a counter, e.g.,
+     * "yosokumo_bytes_sent_total".
+     */
+    static std::string getCounterName(Counter counter);
+
+    /**
+     * Return the Prometheus name of a histogram, e.g.,
+     * "yosokumo_dns_seconds".
+     */
+    static std::string getHistogramName(Histogram histogram);
+
+};  // end class Metrics
+
+
+/**
+ * The totals of all threads' metrics at one moment.
+ */
+class MetricsSnapshot
+{
+private:
+    uint64_t         counters[Metrics::NUM_COUNTERS];
+    LatencyHistogram histograms[Metrics::NUM_HISTOGRAMS];
+
+    friend class Metrics;
+
+public:
+    /**
+     * Initializes a newly created snapshot with everything zero.
+     */
+    MetricsSnapshot();
+
+    /**
+     * Return a counter.
+     */
+    uint64_t getCounter(Metrics::Counter counter) const;
+
+    /**
+     * Return a histogram.
+     */
+    const LatencyHistogram &getHistogram(Metrics::Histogram histogram) const;
+
+    /**
+     * Subtract an earlier snapshot, leaving what happened since.
+     *
+     * @param  earlier  the earlier snapshot.
+     */
+    void subtract(const MetricsSnapshot &earlier);
+
+    /**
+     * Return the snapshot in the Prometheus text exposition format.
+     * Histograms are given with fixed buckets from 100 microseconds to 10
+     * seconds.
+     */
+    std::string toPrometheusText() const;
+
+};  // end class MetricsSnapshot
+
+
+/**
+ * Records the time from its construction to its destruction in a
+ * histogram, e.g.:
+ * <pre>
+ *    {
+ *        ScopedTimer timer(Metrics::PARSE_TIME);
+ *        ...
+ *    }
+ * </pre>
+ */
+class ScopedTimer
+{
+private:
+    Metrics::Histogram histogram;
+    uint64_t           start;
+
+public:
+    ScopedTimer(Metrics::Histogram histogram);
+    ~ScopedTimer();
+
+private:
+
+    /**
+     * Copy constructor - NOT IMPLEMENTED.
+     */
+    ScopedTimer(const ScopedTimer &rhs);
+
+    /**
+     * Assignment operator - NOT IMPLEMENTED.
+     */
+    ScopedTimer& operator=(const ScopedTimer& rhs);
+
+};  // end class ScopedTimer
+
+}   // end namespace Yosokumo
+
+#endif  // METRICS_H
+
+// end Metrics.h
@@ -0,0 +1,143 @@
+// MpscQueue.h
+
+#ifndef MPSCQUEUE_H
+#define MPSCQUEUE_H
+
+#include <stddef.h>
+
+namespace Yosokumo
+{
+
+/**
+ * An unbounded first-in first-out queue which any number of threads may
+ * push onto at once, without a lock, and one thread pops from.
+ * <p>
+ * A push allocates a node, swaps it into the head with one atomic exchange,
+ * and then links the old head to it.  Between those two steps the node is
+ * not yet reachable, so <code>pop()</code> may report the queue empty while
+ * a push is in progress, even though later pushes have completed; the
+ * consumer just tries again later.  A node placed in the queue at
+ * construction (the stub) keeps the head and tail apart, so the producers
+ * never touch the consumer's end.
+ * <p>
+ * The element type must have a default constructor and an assignment
+ * operator.
+ */
+template <class T>
+class MpscQueue
+{
+    struct Node
+    {
+        Node *next;
+        T    value;
+    };
+
+    Node *head;                     // Last pushed; swapped by producers
+    Node *tail;                     // Next to pop; only used by the consumer
+    Node stub;
+
+public:
+
+    MpscQueue()
+    {
+        stub.next = NULL;
+        head      = &stub;
+        tail      = &stub;
+    }
+
+    /**
+     * Destructor - deletes the values still queued.  No thread may be
+     * pushing.
+     */
+    ~MpscQueue()
+    {
+        T value;
+        while (pop(value))
+            ;
+    }
+
+    /**
+     * Add a value at the end of the queue.  May be called from any thread.
+     *
+     * @param  value  the value.  A copy is queued.
+     */
+    void push(const T &value)
+    {
+        Node *node = new Node;
+        node->value = value;
+        pushNode(node);
+    }
+
+    /**
+     * Take the value at the front of the queue.  Must only be called from
+     * one thread at a time.
+     *
+     * @param  value  set to the value taken.
+     *
+     * @return <code>true</code> means a value was taken.
+     *         <code>false</code> means the queue is empty, or the next
+     *             value is still being pushed.
+     */
+    bool pop(T &value)
+    {
+        Node *t    = tail;
+        Node *next = __atomic_load_n(&t->next, __ATOMIC_ACQUIRE);
+
+        if (t == &stub)
+        {
+            if (next == NULL)
+                return false;
+            tail = next;
+            t    = next;
+            next = __atomic_load_n(&t->next, __ATOMIC_ACQUIRE);
+        }
+
+        if (next == NULL)
+        {
+            // t is the last node reachable.  Unless a push is under way,
+            // put the stub behind it, so it can be taken.
+
+            if (t != __atomic_load_n(&head, __ATOMIC_ACQUIRE))
+                return false;
+
+            pushNode(&stub);
+
+            next = __atomic_load_n(&t->next, __ATOMIC_ACQUIRE);
+            if (next == NULL)
+                return false;
+        }
+
+        tail  = next;
+        value = t->value;
+        delete t;
+        return true;
+    }
+
+private:
+
+    void pushNode(Node *node)
+    {
+        __atomic_store_n(&node->next, (Node *)NULL, __ATOMIC_RELAXED);
+
+        Node *prev = __atomic_exchange_n(&head, node, __ATOMIC_ACQ_REL);
+
+        __atomic_store_n(&prev->next, node, __ATOMIC_RELEASE);
+    }
+
+    /**
+     * Copy constructor - NOT IMPLEMENTED.
+     */
+    MpscQueue(const MpscQueue &rhs);
+
+    /**
+     * Assignment operator - NOT IMPLEMENTED.
+     */
+    MpscQueue& operator=(const MpscQueue& rhs);
+
+};  // end class MpscQueue
+
+}   // end namespace Yosokumo
+
+#endif  // MPSCQUEUE_H
+
+// end MpscQueue.h
@@ -0,0 +1,107 @@
+// Mutex.h
+
+#ifndef MUTEX_H
+#define MUTEX_H
+
+#include <pthread.h>
+
+namespace Yosokumo
+{
+
+/**
+ * A thin wrapper around a POSIX mutex.  The Yosokumo library uses it 
+ * wherever data is shared between threads, e.g., the connection pool of a
+ * <code>Service</code>.
+ */
+class Mutex
+{
+    pthread_mutex_t mutex;
+
+    friend class Condition;
+
+public:
+
+    /**
+     * Initializes a newly created <code>Mutex</code> object.  The mutex is
+     * unlocked.
+     */
+    Mutex();
+
+    /**
+     * Destructor - destroy a <code>Mutex</code> object.  The mutex must be
+     * unlocked.
+     */
+    ~Mutex();
+
+    /**
+     * Lock the mutex, waiting if another thread holds it.
+     */
+    void lock();
+
+    /**
+     * Unlock the mutex.  The calling thread must hold the mutex.
+     */
+    void unlock();
+
+private:
+
+    /**
+     * Copy constructor - NOT IMPLEMENTED.
+     */
+    Mutex(const Mutex &rhs);
+
+    /**
+     * Assignment operator - NOT IMPLEMENTED.
+     */
+    Mutex& operator=(const Mutex& rhs);
+
+};  // end class Mutex
+
+
+/**
+ * Locks a <code>Mutex</code> for the lifetime of the 
+ * <code>ScopedLock</code> object, like this:
+ * <pre>
+ *   {
+ *       ScopedLock lock(mutex);
+ *       access the data guarded by mutex
+ *   }
+ * </pre>
+ */
+class ScopedLock
+{
+    Mutex &mutex;
+
+public:
+
+    /**
+     * Lock a mutex.
+     *
+     * @param  m  the mutex to lock.  It is unlocked by the destructor.
+     */
+    explicit ScopedLock(Mutex &m);
+
+    /**
+     * Destructor - unlock the mutex locked by the constructor.
+     */
+    ~ScopedLock();
+
+private:
+
+    /**
+     * Copy constructor - NOT IMPLEMENTED.
+     */
+    ScopedLock(const ScopedLock &rhs);
+
+    /**
+     * Assignment operator - NOT IMPLEMENTED.
+     */
+    ScopedLock& operator=(const ScopedLock& rhs);
+
+};  // end class ScopedLock
+
+}   // end namespace Yosokumo
+
+#endif  // MUTEX_H
+
+// end Mutex.h
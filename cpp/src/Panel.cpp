@@ -5,6 +5,34 @@
 using namespace Yosokumo;
 
 
+Panel::Panel() : blockCount(0), cellCount(0), prospectCount(0)
+{}
+
+
+// Equality operators
+
+bool Panel::operator==(const Panel &rhs) const
+{
+    return
+    (
+        nameControlLocation       == rhs.nameControlLocation       &&
+        statusControlLocation     == rhs.statusControlLocation     &&
+        visibilityControlLocation == rhs.visibilityControlLocation &&
+        blockCount                == rhs.blockCount                &&
+        cellCount                 == rhs.cellCount                 &&
+        prospectCount             == rhs.prospectCount             &&
+        creationTime              == rhs.creationTime              &&
+        latestBlockTime           == rhs.latestBlockTime           &&
+        latestProspectTime        == rhs.latestProspectTime
+    );
+}
+
+bool Panel::operator!=(const Panel &rhs) const
+{
+    return !(*this == rhs);
+}
+
+
 // Panel setters and getters
 
 void Panel::setNameControlLocation(const std::string &nameControlLocation)
@@ -31,6 +31,38 @@ class Panel
 
 public:
 
+    /**
+     * Initializes a newly created <code>Panel</code> object with empty
+     * locations and times, and zero counts.
+     */
+    Panel();
+
+
+    // Equality operators
+
+    /**
+     * Equality operator - compare two <code>Panel</code> for equality.
+     *
+     * @param  rhs  the righthand side of the equality.
+     *
+     * @return <code>true</code> if and only if <code>this</code> 
+     *              <code>Panel</code> and the righthand side 
+     *              <code>Panel</code> are identically equal.
+     */
+    bool operator==(const Panel &rhs) const;
+
+    /**
+     * Inequality operator - compare two <code>Panel</code> for inequality.
+     *
+     * @param  rhs  the righthand side of the inequality.
+     *
+     * @return <code>true</code> if and only if <code>this</code> 
+     *              <code>Panel</code> and the righthand side 
+     *              <code>Panel</code> are not identically equal.
+     */
+    bool operator!=(const Panel &rhs) const;
+
+
     // Panel setters and getters
 
     /**
@@ -0,0 +1,218 @@
+// PanelWatcher.cpp
+
+#include "PanelWatcher.h"
+
+using namespace Yosokumo;
+
+//*****************************   PanelListener   *************************
+
+PanelListener::~PanelListener()
+{}
+
+void PanelListener::panelFailed(
+    const Study            &,
+    const ServiceException &)
+{}
+
+//*****************************   PanelWatcher   **************************
+
+PanelWatcher::PanelWatcher(
+    const Credentials &credentials,
+    const std::string &hostName,
+    int               port,
+    PanelListener     &listener,
+    unsigned          minInterval,
+    unsigned          maxInterval) :
+        service    (credentials, hostName, port),
+        listener   (listener),
+        minInterval(minInterval > 0 ? minInterval : 1),
+        maxInterval(maxInterval),
+        stopping   (false)
+{
+    if (this->maxInterval < this->minInterval)
+        this->maxInterval = this->minInterval;
+
+    service.setConditionalGet(true);
+}
+
+PanelWatcher::~PanelWatcher()
+{
+    stop();
+}
+
+void PanelWatcher::watch(const Study &study)
+{
+    ScopedLock lock(mutex);
+
+    std::string id = study.getStudyIdentifier();
+
+    WatchedMap::iterator it = watched.find(id);
+    if (it != watched.end())
+        schedule.erase(std::make_pair(it->second.nextPoll, id));
+
+    Watched &w = watched[id];
+    w.study    = study;
+    w.panel    = study.getPanel();
+    w.interval = minInterval;
+    w.nextPoll = Thread::currentTimeMillis();
+
+    schedule.insert(std::make_pair(w.nextPoll, id));
+    changed.signal();
+}
+
+bool PanelWatcher::unwatch(const std::string &studyIdentifier)
+{
+    ScopedLock lock(mutex);
+
+    WatchedMap::iterator it = watched.find(studyIdentifier);
+    if (it == watched.end())
+        return false;
+
+    schedule.erase(std::make_pair(it->second.nextPoll, studyIdentifier));
+    watched.erase(it);
+
+    return true;
+}
+
+size_t PanelWatcher::size()
+{
+    ScopedLock lock(mutex);
+
+    return watched.size();
+}
+
+unsigned PanelWatcher::getInterval(const std::string &studyIdentifier)
+{
+    ScopedLock lock(mutex);
+
+    WatchedMap::const_iterator it = watched.find(studyIdentifier);
+
+    return (it == watched.end()) ? 0 : it->second.interval;
+}
+
+void PanelWatcher::stop()
+{
+    mutex.lock();
+    stopping = true;
+    changed.signal();
+    mutex.unlock();
+
+    join();
+}
+
+unsigned PanelWatcher::getChangedFields(
+    const Panel &oldPanel,
+    const Panel &newPanel)
+{
+    unsigned fields = 0;
+
+    if (oldPanel.getNameControlLocation() != newPanel.getNameControlLocation())
+        fields |= Study::NAME_CONTROL_LOCATION;
+    if (oldPanel.getStatusControlLocation() !=
+                                        newPanel.getStatusControlLocation())
+        fields |= Study::STATUS_CONTROL_LOCATION;
+    if (oldPanel.getVisibilityControlLocation() !=
+                                    newPanel.getVisibilityControlLocation())
+        fields |= Study::VISIBILITY_CONTROL_LOCATION;
+    if (oldPanel.getBlockCount()         != newPanel.getBlockCount())
+        fields |= Study::BLOCK_COUNT;
+    if (oldPanel.getCellCount()          != newPanel.getCellCount())
+        fields |= Study::CELL_COUNT;
+    if (oldPanel.getProspectCount()      != newPanel.getProspectCount())
+        fields |= Study::PROSPECT_COUNT;
+    if (oldPanel.getCreationTime()       != newPanel.getCreationTime())
+        fields |= Study::CREATION_TIME;
+    if (oldPanel.getLatestBlockTime()    != newPanel.getLatestBlockTime())
+        fields |= Study::LATEST_BLOCK_TIME;
+    if (oldPanel.getLatestProspectTime() != newPanel.getLatestProspectTime())
+        fields |= Study::LATEST_PROSPECT_TIME;
+
+    return fields;
+}
+
+void PanelWatcher::run()
+{
+    mutex.lock();
+
+    while (!stopping)
+    {
+        if (schedule.empty())
+        {
+            changed.wait(mutex);
+            continue;
+        }
+
+        uint64_t now = Thread::currentTimeMillis();
+        uint64_t due = schedule.begin()->first;
+
+        if (due > now)
+        {
+            changed.waitFor(mutex, unsigned(due - now));
+            continue;
+        }
+
+        std::string id = schedule.begin()->second;
+        schedule.erase(schedule.begin());
+
+        pollOne(id);
+    }
+
+    mutex.unlock();
+}
+
+// Poll the panel of one study, which has just been taken off the schedule.
+// Called with the mutex held; unlocks it while talking to the server and
+// while calling the listener.
+
+void PanelWatcher::pollOne(const std::string &studyIdentifier)
+{
+    Study study = watched[studyIdentifier].study;
+
+    mutex.unlock();
+
+    Panel newPanel;
+    bool ok = service.getPanel(study, newPanel);
+    ServiceException exception;
+    if (!ok)
+        exception = service.getException();
+
+    mutex.lock();
+
+    // The study may have been unwatched, or watched anew, meanwhile
+
+    WatchedMap::iterator it = watched.find(studyIdentifier);
+    if (it == watched.end() ||
+                    schedule.count(std::make_pair(it->second.nextPoll,
+                                                        studyIdentifier)) > 0)
+        return;
+
+    Watched &w = it->second;
+    Panel oldPanel = w.panel;
+    unsigned fields = ok ? getChangedFields(oldPanel, newPanel) : 0;
+
+    if (fields != 0)
+    {
+        w.panel    = newPanel;
+        w.interval = minInterval;
+    }
+    else
+        w.interval = (w.interval > maxInterval / 2) ? maxInterval :
+                                                            2 * w.interval;
+
+    w.nextPoll = Thread::currentTimeMillis() + w.interval;
+    schedule.insert(std::make_pair(w.nextPoll, studyIdentifier));
+
+    if (ok && fields == 0)
+        return;
+
+    mutex.unlock();
+
+    if (ok)
+        listener.panelChanged(study, oldPanel, newPanel, fields);
+    else
+        listener.panelFailed(study, exception);
+
+    mutex.lock();
+}
+
+// end PanelWatcher.cpp
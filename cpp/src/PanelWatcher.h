@@ -0,0 +1,222 @@
+// PanelWatcher.h
+
+#ifndef PANELWATCHER_H
+#define PANELWATCHER_H
+
+#include "Condition.h"
+#include "Credentials.h"
+#include "Mutex.h"
+#include "Panel.h"
+#include "Service.h"
+#include "ServiceException.h"
+#include "Study.h"
+#include "Thread.h"
+
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+
+namespace Yosokumo
+{
+
+/**
+ * Receives the changes seen by a <code>PanelWatcher</code>.  The methods are
+ * called on the watcher's thread, with no lock held, so they may call the
+ * watcher (e.g., to stop watching a study), but should return promptly:
+ * while one runs no study is polled.
+ */
+class PanelListener
+{
+public:
+
+    virtual ~PanelListener();
+
+    /**
+     * Called when a poll finds that the panel of a study has changed.
+     *
+     * @param  study  the study.
+     * @param  oldPanel  the panel as it was.
+     * @param  newPanel  the panel as it is now.
+     * @param  fields  the <code>Study::Field</code> bits of the panel
+     *             attributes which changed, e.g.,
+     *             <code>Study::BLOCK_COUNT</code>.
+     */
+    virtual void panelChanged(
+        const Study &study,
+        const Panel &oldPanel,
+        const Panel &newPanel,
+        unsigned    fields) = 0;
+
+    /**
+     * Called when a poll fails.  The study goes on being polled, less
+     * often.  By default does nothing.
+     *
+     * @param  study  the study.
+     * @param  exception  why the poll failed.
+     */
+    virtual void panelFailed(
+        const Study            &study,
+        const ServiceException &exception);
+
+};  // end class PanelListener
+
+
+/**
+ * Watches the panels of many studies, e.g., while their models train, from
+ * one thread and over one kept-alive connection with conditional GET, so an
+ * unchanged panel costs a 304 response.  For example:
+ * <pre>
+ *    PanelWatcher watcher(credentials, hostName, port, listener);
+ *    watcher.watch(study1);
+ *    watcher.watch(study2);
+ *    watcher.start();
+ *    ...
+ *    watcher.stop();
+ * </pre>
+ * Each study is polled on an interval of its own.  The interval starts at
+ * <code>minInterval</code>; it doubles, up to <code>maxInterval</code>,
+ * after each poll which finds no change (or fails), and drops back to
+ * <code>minInterval</code> after a poll which finds a change.  So a study
+ * whose counts are moving is polled often, and an idle one rarely.
+ * <p>
+ * The listener hears only of changes.  The first poll of a study is
+ * compared with the panel attributes of the <code>Study</code> passed to
+ * <code>watch()</code>.
+ */
+class PanelWatcher : public Thread
+{
+public:
+
+    /**
+     * Default shortest and longest intervals between polls of a study, in
+     * milliseconds.
+     */
+    enum { DEFAULT_MIN_INTERVAL = 1000 };
+    enum { DEFAULT_MAX_INTERVAL = 60000 };
+
+private:
+
+    struct Watched
+    {
+        Study    study;
+        Panel    panel;             // As last seen
+        unsigned interval;          // Milliseconds
+        uint64_t nextPoll;          // Thread::currentTimeMillis() time
+    };
+
+    typedef std::map<std::string, Watched>             WatchedMap;
+    typedef std::set<std::pair<uint64_t, std::string> > Schedule;
+
+    Service       service;          // Only used by the watcher thread
+    PanelListener &listener;
+    unsigned      minInterval;
+    unsigned      maxInterval;
+
+    Mutex         mutex;            // Guards the following
+    Condition     changed;
+    WatchedMap    watched;          // By study identifier
+    Schedule      schedule;         // Next poll time and study identifier
+    bool          stopping;
+
+public:
+
+    /**
+     * Initializes a newly created <code>PanelWatcher</code>.  Call
+     * <code>start()</code> to start it.
+     *
+     * @param  credentials specifies user id and key for authentication.
+     * @param  hostName is the name of the Yosokumo server.
+     * @param  port is the port to use to access the Yosokumo service.
+     * @param  listener  receives the changes.  Not owned by the watcher.
+     * @param  minInterval  the shortest time (in milliseconds) between polls
+     *             of a study.
+     * @param  maxInterval  the longest time (in milliseconds) between polls
+     *             of a study.
+     */
+    PanelWatcher(
+        const Credentials &credentials,
+        const std::string &hostName,
+        int               port,
+        PanelListener     &listener,
+        unsigned          minInterval = DEFAULT_MIN_INTERVAL,
+        unsigned          maxInterval = DEFAULT_MAX_INTERVAL);
+
+    /**
+     * Destructor - stops the watcher.
+     */
+    virtual ~PanelWatcher();
+
+    /**
+     * Start watching the panel of a study, or restart with a new copy of
+     * the study.  The study is polled at once.  May be called from any
+     * thread.
+     *
+     * @param  study  the study.  Its identifier and panel location must be
+     *             set.
+     */
+    void watch(const Study &study);
+
+    /**
+     * Stop watching the panel of a study.  May be called from any thread.
+     *
+     * @param  studyIdentifier  the identifier of the study.
+     *
+     * @return <code>true</code> means the study was being watched.
+     */
+    bool unwatch(const std::string &studyIdentifier);
+
+    /**
+     * Return the number of studies being watched.
+     */
+    size_t size();
+
+    /**
+     * Return the current interval between polls of a study.
+     *
+     * @param  studyIdentifier  the identifier of the study.
+     *
+     * @return the interval in milliseconds, or 0 if the study is not being
+     *             watched.
+     */
+    unsigned getInterval(const std::string &studyIdentifier);
+
+    /**
+     * Stop the watcher and wait for its thread to end.
+     */
+    void stop();
+
+    /**
+     * Return the panel attributes of a study which differ between two
+     * panels.
+     *
+     * @return the <code>Study::Field</code> bits of the attributes.
+     */
+    static unsigned getChangedFields(const Panel &oldPanel,
+                                                    const Panel &newPanel);
+
+protected:
+
+    void run();
+
+private:
+
+    void pollOne(const std::string &studyIdentifier);
+
+    /**
+     * Copy constructor - NOT IMPLEMENTED.
+     */
+    PanelWatcher(const PanelWatcher &rhs);
+
+    /**
+     * Assignment operator - NOT IMPLEMENTED.
+     */
+    PanelWatcher& operator=(const PanelWatcher& rhs);
+
+};  // end class PanelWatcher
+
+}   // end namespace Yosokumo
+
+#endif  // PANELWATCHER_H
+
+// end PanelWatcher.h
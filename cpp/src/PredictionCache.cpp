@@ -0,0 +1,147 @@
+// PredictionCache.cpp
+
+#include "PredictionCache.h"
+#include "Thread.h"
+
+using namespace Yosokumo;
+
+PredictionCache::PredictionCache(size_t capacity, unsigned ttl) :
+    capacity(capacity < 1 ? 1 : capacity), ttl(ttl), hits(0), misses(0)
+{}
+
+bool PredictionCache::lookup(
+    const std::string &studyIdentifier,
+    const Specimen    &prospect,
+    Value             &predictand)
+{
+    Key key(studyIdentifier, prospect.getContentFingerprint());
+
+    ScopedLock lock(mutex);
+
+    EntryMap::iterator it = index.find(key);
+    if (it == index.end())
+    {
+        ++misses;
+        return false;
+    }
+
+    EntryList::iterator e = it->second;
+    if (e->expiresAt != 0 && Thread::currentTimeMillis() >= e->expiresAt)
+    {
+        entries.erase(e);
+        index.erase(it);
+        ++misses;
+        return false;
+    }
+
+    // Move to the front:  most recently used
+
+    entries.splice(entries.begin(), entries, e);
+
+    predictand = e->predictand;
+    ++hits;
+    return true;
+}
+
+void PredictionCache::insert(
+    const std::string &studyIdentifier,
+    const Specimen    &prospect,
+    const Value       &predictand)
+{
+    Entry entry;
+    entry.key        = Key(studyIdentifier, prospect.getContentFingerprint());
+    entry.predictand = predictand;
+    entry.expiresAt  = (ttl == 0) ? 0 : Thread::currentTimeMillis() + ttl;
+
+    ScopedLock lock(mutex);
+
+    EntryMap::iterator it = index.find(entry.key);
+    if (it != index.end())
+    {
+        entries.erase(it->second);
+        index.erase(it);
+    }
+
+    while (entries.size() >= capacity)
+    {
+        index.erase(entries.back().key);
+        entries.pop_back();
+    }
+
+    entries.push_front(entry);
+    index[entry.key] = entries.begin();
+}
+
+bool PredictionCache::checkPanel(
+    const std::string &studyIdentifier,
+    const Panel       &panel)
+{
+    std::string latest = panel.getLatestBlockTime();
+
+    ScopedLock lock(mutex);
+
+    BlockTimeMap::iterator it = latestBlockTimes.find(studyIdentifier);
+    if (it == latestBlockTimes.end())
+    {
+        latestBlockTimes[studyIdentifier] = latest;
+        return false;
+    }
+
+    if (it->second == latest)
+        return false;
+
+    it->second = latest;
+    invalidateLocked(studyIdentifier);
+    return true;
+}
+
+void PredictionCache::invalidate(const std::string &studyIdentifier)
+{
+    ScopedLock lock(mutex);
+    invalidateLocked(studyIdentifier);
+}
+
+void PredictionCache::invalidateLocked(const std::string &studyIdentifier)
+{
+    // Keys are ordered by study identifier first, so the entries of a study
+    // are adjacent in the index
+
+    EntryMap::iterator it = index.lower_bound(Key(studyIdentifier, 0));
+
+    while (it != index.end() && it->first.first == studyIdentifier)
+    {
+        entries.erase(it->second);
+        index.erase(it++);
+    }
+}
+
+void PredictionCache::clear()
+{
+    ScopedLock lock(mutex);
+
+    entries.clear();
+    index.clear();
+    latestBlockTimes.clear();
+    hits   = 0;
+    misses = 0;
+}
+
+size_t PredictionCache::size()
+{
+    ScopedLock lock(mutex);
+    return entries.size();
+}
+
+uint64_t PredictionCache::getHitCount()
+{
+    ScopedLock lock(mutex);
+    return hits;
+}
+
+uint64_t PredictionCache::getMissCount()
+{
+    ScopedLock lock(mutex);
+    return misses;
+}
+
+// end PredictionCache.cpp
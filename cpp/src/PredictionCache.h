@@ -0,0 +1,171 @@
+// PredictionCache.h
+
+#ifndef PREDICTIONCACHE_H
+#define PREDICTIONCACHE_H
+
+#include "Mutex.h"
+#include "Panel.h"
+#include "Specimen.h"
+#include "Value.h"
+
+#include <list>
+#include <map>
+#include <string>
+#include <utility>
+
+namespace Yosokumo
+{
+
+/**
+ * A least-recently-used cache of predictions, so that a prospect which has
+ * already been predicted need not be sent to the server again.  An entry is
+ * keyed by study identifier plus a 64-bit fingerprint of the prospect's
+ * cells and predictand (see <code>Specimen::getContentFingerprint()</code>),
+ * which costs nothing to get; the prospect's key, status, and weight do not
+ * matter.
+ * <p>
+ * An entry expires after a time to live.  Since the predictions of a study
+ * change when new blocks are added to its table, all entries of a study are
+ * dropped when <code>checkPanel()</code> sees that the latest block time of
+ * the study has changed.
+ * <p>
+ * A <code>PredictionCache</code> may be used by many threads at once.
+ */
+class PredictionCache
+{
+public:
+
+    /**
+     * Default maximum number of entries.
+     */
+    enum { DEFAULT_CAPACITY = 10000 };
+
+    /**
+     * Default time to live (in milliseconds).  Zero means forever.
+     */
+    enum { DEFAULT_TTL = 60000 };
+
+private:
+
+    typedef std::pair<std::string, uint64_t> Key;
+
+    struct Entry
+    {
+        Key      key;
+        Value    predictand;
+        uint64_t expiresAt;         // Milliseconds; 0 means never
+    };
+
+    typedef std::list<Entry>                       EntryList;
+    typedef std::map<Key, EntryList::iterator>     EntryMap;
+    typedef std::map<std::string, std::string>     BlockTimeMap;
+
+    Mutex        mutex;             // Guards all of the following
+    size_t       capacity;
+    unsigned     ttl;
+    EntryList    entries;           // Most recently used first
+    EntryMap     index;
+    BlockTimeMap latestBlockTimes;  // Study identifier -> latest block time
+    uint64_t     hits;
+    uint64_t     misses;
+
+public:
+
+    /**
+     * Initializes a newly created, empty <code>PredictionCache</code>.
+     *
+     * @param  capacity  the maximum number of entries.  When full, the
+     *             least recently used entry is dropped to make room.
+     * @param  ttl  the time (in milliseconds) an entry stays valid.  Zero
+     *             means entries do not expire.
+     */
+    PredictionCache(
+        size_t   capacity = DEFAULT_CAPACITY,
+        unsigned ttl      = DEFAULT_TTL);
+
+    /**
+     * Look up the prediction for a prospect.
+     *
+     * @param  studyIdentifier  the study of the prediction.
+     * @param  prospect  the prospect.
+     * @param  predictand  where to place the prediction, if found.
+     *
+     * @return <code>true</code> means the prediction was found (a hit).
+     *         <code>false</code> means it was not (a miss).
+     */
+    bool lookup(
+        const std::string &studyIdentifier,
+        const Specimen    &prospect,
+        Value             &predictand);
+
+    /**
+     * Add the prediction for a prospect, replacing any previous one.
+     *
+     * @param  studyIdentifier  the study of the prediction.
+     * @param  prospect  the prospect.
+     * @param  predictand  the prediction.
+     */
+    void insert(
+        const std::string &studyIdentifier,
+        const Specimen    &prospect,
+        const Value       &predictand);
+
+    /**
+     * Note the latest block time of a study, from its panel.  If it differs
+     * from the time noted before, all entries of the study are dropped.
+     *
+     * @param  studyIdentifier  the study the panel belongs to.
+     * @param  panel  the panel, e.g., from <code>Service::getPanel()</code>.
+     *
+     * @return <code>true</code> means entries were dropped.
+     */
+    bool checkPanel(const std::string &studyIdentifier, const Panel &panel);
+
+    /**
+     * Drop all entries of a study.
+     *
+     * @param  studyIdentifier  the study.
+     */
+    void invalidate(const std::string &studyIdentifier);
+
+    /**
+     * Drop all entries and reset the counters.
+     */
+    void clear();
+
+    /**
+     * Return the number of entries.
+     */
+    size_t size();
+
+    /**
+     * Return the number of lookups which found a prediction.
+     */
+    uint64_t getHitCount();
+
+    /**
+     * Return the number of lookups which did not find a prediction.
+     */
+    uint64_t getMissCount();
+
+private:
+
+    void invalidateLocked(const std::string &studyIdentifier);
+
+    /**
+     * Copy constructor - NOT IMPLEMENTED.
+     */
+    PredictionCache(const PredictionCache &rhs);
+
+    /**
+     * Assignment operator - NOT IMPLEMENTED.
+     */
+    PredictionCache& operator=(const PredictionCache& rhs);
+
+};  // end class PredictionCache
+
+}   // end namespace Yosokumo
+
+#endif  // PREDICTIONCACHE_H
+
+// end PredictionCache.h
@@ -0,0 +1,308 @@
+// PredictionCoalescer.cpp
+
+#include "PredictionCoalescer.h"
+#include "Service.h"
+#include "SpecimenBlock.h"
+#include "CellBlock.h"
+#include "Thread.h"
+
+#include <vector>
+
+using namespace Yosokumo;
+
+//***************************   PredictionTicket   ************************
+
+PredictionTicket::PredictionTicket() : ready(false)
+{}
+
+bool PredictionTicket::wait()
+{
+    ScopedLock lock(mutex);
+
+    while (!ready)
+        done.wait(mutex);
+
+    return !YosokumoDIF::isException(exception);
+}
+
+bool PredictionTicket::isReady()
+{
+    ScopedLock lock(mutex);
+    return ready;
+}
+
+Value PredictionTicket::getPredictand()
+{
+    ScopedLock lock(mutex);
+    return predictand;
+}
+
+ServiceException PredictionTicket::getException()
+{
+    ScopedLock lock(mutex);
+    return exception;
+}
+
+void PredictionTicket::fulfil(const Value &v)
+{
+    ScopedLock lock(mutex);
+    predictand = v;
+    ready      = true;
+    done.broadcast();
+}
+
+void PredictionTicket::fail(const ServiceException &e)
+{
+    ScopedLock lock(mutex);
+    exception = e;
+    ready     = true;
+    done.broadcast();
+}
+
+//**************************   PredictionCoalescer   **********************
+
+class PredictionCoalescer::Flusher : public Thread
+{
+    PredictionCoalescer &coalescer;
+
+public:
+
+    Flusher(PredictionCoalescer &coalescer) : coalescer(coalescer)
+    {}
+
+protected:
+
+    void run()
+    {
+        coalescer.runFlusher();
+    }
+};
+
+PredictionCoalescer::PredictionCoalescer(
+    const Credentials &credentials,
+    const std::string &hostName,
+    int               port,
+    const std::string &modelLocation,
+    unsigned          maxBatchSize,
+    unsigned          maxDelay) :
+        modelLocation(modelLocation),
+        request(credentials, hostName, port, dif.getContentType())
+{
+    init(maxBatchSize, maxDelay);
+}
+
+PredictionCoalescer::PredictionCoalescer(
+    const Credentials &credentials,
+    const std::string &hostName,
+    int               port,
+    const Study       &study,
+    unsigned          maxBatchSize,
+    unsigned          maxDelay) :
+        modelLocation(study.getModelLocation()),
+        studyIdentifier(study.getStudyIdentifier()),
+        request(credentials, hostName, port, dif.getContentType())
+{
+    init(maxBatchSize, maxDelay);
+}
+
+void PredictionCoalescer::init(unsigned maxBatchSize, unsigned maxDelay)
+{
+    this->maxBatchSize = (maxBatchSize < 1) ? 1 : maxBatchSize;
+    this->maxDelay     = maxDelay;
+
+    cache    = NULL;
+    stopping = false;
+
+    flusher = new Flusher(*this);
+    if (!flusher->start())
+    {
+        delete flusher;
+        flusher = NULL;
+    }
+}
+
+PredictionCoalescer::~PredictionCoalescer()
+{
+    {
+        ScopedLock lock(mutex);
+        stopping = true;
+        changed.broadcast();
+    }
+
+    if (flusher != NULL)
+    {
+        flusher->join();
+        delete flusher;
+    }
+}
+
+void PredictionCoalescer::submit(
+    const Specimen   &prospect,
+    PredictionTicket &ticket)
+{
+    Value predictand;
+    if (cache != NULL && cache->lookup(getCacheKey(), prospect, predictand))
+    {
+        ticket.fulfil(predictand);
+        return;
+    }
+
+    ScopedLock lock(mutex);
+
+    if (stopping || flusher == NULL)
+    {
+        ticket.fail(ServiceException("Prediction thread is not running",
+                                                                "submit"));
+        return;
+    }
+
+    Pending p;
+    p.prospect = prospect;
+    p.ticket   = &ticket;
+    p.queuedAt = Thread::currentTimeMillis();
+    queue.push_back(p);
+
+    // The flusher needs waking for the first prospect of a batch (to start
+    // the clock) and for the last (to post at once)
+
+    if (queue.size() == 1 || queue.size() >= maxBatchSize)
+        changed.signal();
+}
+
+bool PredictionCoalescer::predict(
+    const Specimen   &prospect,
+    Value            &predictand,
+    ServiceException &exception)
+{
+    PredictionTicket ticket;
+    submit(prospect, ticket);
+
+    if (!ticket.wait())
+    {
+        exception = ticket.getException();
+        return false;
+    }
+
+    predictand = ticket.getPredictand();
+    return true;
+}
+
+bool PredictionCoalescer::predict(const Specimen &prospect, Value &predictand)
+{
+    ServiceException exception;
+    return predict(prospect, predictand, exception);
+}
+
+void PredictionCoalescer::setCache(PredictionCache *cache)
+{
+    this->cache = cache;
+}
+
+std::string PredictionCoalescer::getCacheKey() const
+{
+    return studyIdentifier.empty() ? modelLocation : studyIdentifier;
+}
+
+void PredictionCoalescer::runFlusher()
+{
+    mutex.lock();
+
+    for (;;)
+    {
+        while (queue.empty() && !stopping)
+            changed.wait(mutex);
+
+        if (queue.empty())
+            break;
+
+        // Wait for a full batch, or until the oldest prospect is due
+
+        uint64_t due = queue.front().queuedAt + maxDelay;
+
+        while (!stopping && queue.size() < maxBatchSize)
+        {
+            uint64_t now = Thread::currentTimeMillis();
+            if (now >= due)
+                break;
+            changed.waitFor(mutex, unsigned(due - now));
+        }
+
+        std::deque<Pending> batch;
+        while (!queue.empty() && batch.size() < maxBatchSize)
+        {
+            batch.push_back(queue.front());
+            queue.pop_front();
+        }
+
+        mutex.unlock();
+        postBatch(batch);
+        mutex.lock();
+    }
+
+    mutex.unlock();
+}
+
+void PredictionCoalescer::postBatch(std::deque<Pending> &batch)
+{
+    // Key i+1 stands for batch[i], whatever the caller's key was
+
+    std::vector<Specimen> prospects(batch.size());
+    SpecimenBlock block(studyIdentifier);
+
+    for (unsigned i = 0;  i < batch.size();  ++i)
+    {
+        prospects[i] = batch[i].prospect;
+        prospects[i].setSpecimenKey(i + 1);
+        block.addSpecimen(&prospects[i]);
+    }
+
+    ServiceException e;
+    std::vector<uint8_t> entity;
+    Block predictions;
+
+    if (!dif.makeBytesFromBlock(block, entity))
+        dif.getException(e);
+    else
+    {
+        bool ok = request.postToServer(modelLocation, entity);
+        if (Service::checkResponse(request, ok, dif, "predict", e))
+        {
+            request.getEntity(entity);
+            if (!dif.makeBlockFromBytes(entity, predictions))
+                dif.getException(e);
+        }
+    }
+
+    if (YosokumoDIF::isException(e))
+    {
+        for (unsigned i = 0;  i < batch.size();  ++i)
+            batch[i].ticket->fail(e);
+        return;
+    }
+
+    std::vector<bool> answered(batch.size(), false);
+
+    if (predictions.getType() == Block::CELL)
+    {
+        CellBlock &cells = (CellBlock &)predictions;
+        for (uint64_t j = 0;  j < cells.size();  ++j)
+        {
+            Cell cell = cells.getCell(j);
+            uint64_t key = cell.getKey();
+            if (key < 1 || key > batch.size() || answered[key - 1])
+                continue;
+            if (cache != NULL)
+                cache->insert(getCacheKey(), batch[key - 1].prospect, 
+                                                            cell.getValue());
+            batch[key - 1].ticket->fulfil(cell.getValue());
+            answered[key - 1] = true;
+        }
+    }
+
+    for (unsigned i = 0;  i < batch.size();  ++i)
+        if (!answered[i])
+            batch[i].ticket->fail(ServiceException(
+                    "No prediction returned for prospect", 200, "predict"));
+}
+
+// end PredictionCoalescer.cpp
@@ -0,0 +1,271 @@
+// PredictionCoalescer.h
+
+#ifndef PREDICTIONCOALESCER_H
+#define PREDICTIONCOALESCER_H
+
+#include "Condition.h"
+#include "Credentials.h"
+#include "Mutex.h"
+#include "PredictionCache.h"
+#include "ServiceException.h"
+#include "Specimen.h"
+#include "Study.h"
+#include "Value.h"
+#include "YosokumoProtobuf.h"
+#include "YosokumoRequest.h"
+
+#include <deque>
+#include <string>
+
+namespace Yosokumo
+{
+
+/**
+ * The outcome of one prediction requested from a
+ * <code>PredictionCoalescer</code>.  The ticket is filled in by the
+ * coalescer's thread; the caller waits for it with <code>wait()</code>.  A
+ * ticket must stay alive until <code>wait()</code> has returned.
+ */
+class PredictionTicket
+{
+    Mutex            mutex;
+    Condition        done;
+    bool             ready;
+    Value            predictand;
+    ServiceException exception;
+
+    friend class PredictionCoalescer;
+
+public:
+
+    /**
+     * Initializes a newly created <code>PredictionTicket</code> which is
+     * not ready.
+     */
+    PredictionTicket();
+
+    /**
+     * Wait until the prediction is available (or has failed).
+     *
+     * @return <code>true</code> means the prediction succeeded; use
+     *             <code>getPredictand()</code> to get it.
+     *         <code>false</code> means the prediction failed; use
+     *             <code>getException()</code> to find out why.
+     */
+    bool wait();
+
+    /**
+     * Test if the prediction is available (or has failed), without waiting.
+     *
+     * @return <code>true</code> means <code>wait()</code> will not block.
+     */
+    bool isReady();
+
+    /**
+     * Return the predicted predictand.  Only meaningful after
+     * <code>wait()</code> has returned <code>true</code>.
+     *
+     * @return the predictand.
+     */
+    Value getPredictand();
+
+    /**
+     * Return the exception for a failed prediction.
+     *
+     * @return the exception.
+     */
+    ServiceException getException();
+
+private:
+
+    void fulfil(const Value &v);
+    void fail(const ServiceException &e);
+
+    /**
+     * Copy constructor - NOT IMPLEMENTED.
+     */
+    PredictionTicket(const PredictionTicket &rhs);
+
+    /**
+     * Assignment operator - NOT IMPLEMENTED.
+     */
+    PredictionTicket& operator=(const PredictionTicket& rhs);
+
+};  // end class PredictionTicket
+
+
+/**
+ * Combines single predictions requested by many threads into
+ * multi-specimen blocks posted to the model of a study.  A call to
+ * <code>submit()</code> queues one prospect and returns at once; a thread
+ * owned by the coalescer posts the queued prospects as one block when
+ * <code>maxBatchSize</code> prospects are waiting, or when the oldest has
+ * waited <code>maxDelay</code> milliseconds, and then fills in each
+ * caller's <code>PredictionTicket</code>.  For example:
+ * <pre>
+ *    PredictionCoalescer coalescer(credentials, hostName, port, study);
+ *    ...
+ *    Value predictand;
+ *    if (!coalescer.predict(prospect, predictand))
+ *        ...
+ * </pre>
+ * The keys of the prospects need not be unique:  each prospect is given a
+ * key of its own within the block, and the prediction returned for that key
+ * goes back to the caller who submitted the prospect.
+ * <p>
+ * With a <code>PredictionCache</code> (see <code>setCache()</code>), a
+ * prospect found in the cache is answered at once, without being queued,
+ * and every prediction received is added to the cache.
+ */
+class PredictionCoalescer
+{
+public:
+
+    /**
+     * Default number of prospects which triggers a post.
+     */
+    enum { DEFAULT_MAX_BATCH_SIZE = 100 };
+
+    /**
+     * Default time (in milliseconds) a prospect may wait before a post.
+     */
+    enum { DEFAULT_MAX_DELAY = 10 };
+
+private:
+
+    struct Pending
+    {
+        Specimen         prospect;
+        PredictionTicket *ticket;
+        uint64_t         queuedAt;      // Milliseconds
+    };
+
+    std::string         modelLocation;
+    std::string         studyIdentifier;
+    unsigned            maxBatchSize;
+    unsigned            maxDelay;
+    PredictionCache     *cache;         // NULL means no cache
+
+    YosokumoProtobuf    dif;            // Only used by the flusher thread
+    YosokumoRequest     request;        //   ditto
+
+    Mutex               mutex;          // Guards the following
+    Condition           changed;
+    std::deque<Pending> queue;
+    bool                stopping;
+
+    class Flusher;
+    friend class Flusher;
+    Flusher             *flusher;
+
+public:
+
+    /**
+     * Initializes a newly created <code>PredictionCoalescer</code> and
+     * starts its thread.
+     *
+     * @param  credentials specifies user id and key for authentication.
+     * @param  hostName is the name of the Yosokumo server.
+     * @param  port is the port to use to access the Yosokumo service.
+     * @param  modelLocation is the URI of the model to post prospects to.
+     * @param  maxBatchSize is the number of waiting prospects which
+     *             triggers a post.
+     * @param  maxDelay is the time in milliseconds after which a waiting
+     *             prospect is posted even if the batch is not full.
+     */
+    PredictionCoalescer(
+        const Credentials &credentials,
+        const std::string &hostName,
+        int               port,
+        const std::string &modelLocation,
+        unsigned          maxBatchSize = DEFAULT_MAX_BATCH_SIZE,
+        unsigned          maxDelay     = DEFAULT_MAX_DELAY);
+
+    /**
+     * Initializes a newly created <code>PredictionCoalescer</code> which
+     * posts to the model of a study.  Parameters are as above, except the
+     * model location comes from <code>study.getModelLocation()</code>.
+     */
+    PredictionCoalescer(
+        const Credentials &credentials,
+        const std::string &hostName,
+        int               port,
+        const Study       &study,
+        unsigned          maxBatchSize = DEFAULT_MAX_BATCH_SIZE,
+        unsigned          maxDelay     = DEFAULT_MAX_DELAY);
+
+    /**
+     * Destructor - posts any prospects still queued, then stops the thread.
+     */
+    ~PredictionCoalescer();
+
+    /**
+     * Queue a prospect for prediction.  Returns at once; the ticket is
+     * filled in later.  May be called from any thread.
+     *
+     * @param  prospect  the specimen whose predictand is wanted.
+     * @param  ticket  receives the prediction.  Must stay alive until its
+     *             <code>wait()</code> has returned.
+     */
+    void submit(const Specimen &prospect, PredictionTicket &ticket);
+
+    /**
+     * Queue a prospect and wait for its prediction.  May be called from
+     * any thread.
+     *
+     * @param  prospect  the specimen whose predictand is wanted.
+     * @param  predictand  where to place the prediction.
+     * @param  exception  where to place the exception if the prediction
+     *             fails.
+     *
+     * @return <code>true</code> means success.
+     */
+    bool predict(
+        const Specimen   &prospect,
+        Value            &predictand,
+        ServiceException &exception);
+
+    /**
+     * Queue a prospect and wait for its prediction.  As above, but without
+     * the exception.
+     */
+    bool predict(const Specimen &prospect, Value &predictand);
+
+    /**
+     * Use a cache of predictions.  Must be called before any prospect is
+     * submitted.  The cache is not owned by the coalescer, and may be 
+     * shared with other coalescers.  Entries are keyed by the study 
+     * identifier, or by the model location if the coalescer was not 
+     * constructed from a <code>Study</code>.
+     *
+     * @param  cache  the cache to use, or <code>NULL</code> for none.
+     */
+    void setCache(PredictionCache *cache);
+
+private:
+
+    void init(unsigned maxBatchSize, unsigned maxDelay);
+
+    void runFlusher();
+
+    void postBatch(std::deque<Pending> &batch);
+
+    std::string getCacheKey() const;
+
+    /**
+     * Copy constructor - NOT IMPLEMENTED.
+     */
+    PredictionCoalescer(const PredictionCoalescer &rhs);
+
+    /**
+     * Assignment operator - NOT IMPLEMENTED.
+     */
+    PredictionCoalescer& operator=(const PredictionCoalescer& rhs);
+
+};  // end class PredictionCoalescer
+
+}   // end namespace Yosokumo
+
+#endif  // PREDICTIONCOALESCER_H
+
+// end PredictionCoalescer.h
@@ -58,6 +58,7 @@ PredictorBlock::~PredictorBlock()
 void PredictorBlock::addPredictor(const Predictor &predictor)
 {
     predictorSequence.push_back(predictor);
+    addPredictorsFingerprint(predictorSequence.size() - 1);
 }
 
 bool PredictorBlock::addPredictors(
@@ -66,6 +67,7 @@ bool PredictorBlock::addPredictors(
 {
     unsigned old_size = predictorSequence.size();
     predictorSequence.insert(predictorSequence.end(), begin, end);
+    addPredictorsFingerprint(old_size);
     return predictorSequence.size() != old_size;
 }
 
@@ -75,6 +77,7 @@ bool PredictorBlock::addPredictors(
 {
     unsigned old_size = predictorSequence.size();
     predictorSequence.insert(predictorSequence.end(), begin, end);
+    addPredictorsFingerprint(old_size);
     return predictorSequence.size() != old_size;
 }
 
@@ -86,9 +89,13 @@ bool PredictorBlock::removePredictors(uint64_t numPredictorsToRemove)
     if (numPredictorsToRemove >= size())
         clearPredictors();
     else
+    {
+        subtractPredictorsFingerprint(size() - numPredictorsToRemove);
+
         predictorSequence.erase(
             predictorSequence.end()-numPredictorsToRemove, 
             predictorSequence.end());
+    }
 
     return true;
 }
@@ -103,6 +110,7 @@ Predictor PredictorBlock::getPredictor(uint64_t index) const
 void PredictorBlock::clearPredictors()
 {
     predictorSequence.clear();
+    predictorsFingerprint = 0;
 }
 
 uint64_t PredictorBlock::size() const
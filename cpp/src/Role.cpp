@@ -1,21 +1,41 @@
 // Role.cpp
 
 #include "Role.h"
+#include "Hash.h"
 
 #include <sstream>
 
 using namespace Yosokumo;
 
+namespace
+{
+
+// The attributes of a role, numbered for the fingerprint
+
+enum
+{
+    USER_IDENTIFIER = 1,
+    USER_NAME,
+    STUDY_IDENTIFIER,
+    STUDY_NAME,
+    ROLE_LOCATION,
+    PRIVILEGES
+};
+
+}   // end anonymous namespace
+
 // Constructors
 
 Role::Role() :
-    userIdentifier(""), 
+    userIdentifier(), 
     userName(""), 
-    studyIdentifier(""), 
+    studyIdentifier(), 
     studyName(""), 
     roleLocation("")
 {
     privilegeSet.reset();   // Turn off all privileges
+
+    fingerprint = computeFingerprint();
 }
 
 Role::Role(
@@ -28,6 +48,8 @@ Role::Role(
         roleLocation("")
 {
     privilegeSet.reset();   // Turn off all privileges
+
+    fingerprint = computeFingerprint();
 }
 
 Role::Role(const Role &rhs)
@@ -51,6 +73,8 @@ Role &Role::operator=(const Role& rhs)
 
     privilegeSet    = rhs.privilegeSet;
 
+    fingerprint     = rhs.fingerprint;
+
     return *this;
 }
 
@@ -59,6 +83,9 @@ Role &Role::operator=(const Role& rhs)
 
 bool Role::operator==(const Role &rhs) const 
 {
+    if (fingerprint != rhs.fingerprint)
+        return false;
+
     return
     (
         userIdentifier  == rhs.userIdentifier &&
@@ -75,12 +102,35 @@ bool Role::operator!=(const Role &rhs) const
     return !(*this == rhs);
 }
 
+uint64_t Role::getFingerprint() const
+{
+    return fingerprint;
+}
+
+uint64_t Role::computeFingerprint() const
+{
+    return
+        hashAttribute(USER_IDENTIFIER,  userIdentifier         ) ^
+        hashAttribute(USER_NAME,        userName               ) ^
+        hashAttribute(STUDY_IDENTIFIER, studyIdentifier        ) ^
+        hashAttribute(STUDY_NAME,       studyName              ) ^
+        hashAttribute(ROLE_LOCATION,    roleLocation           ) ^
+        hashAttribute(PRIVILEGES,       privilegeSet.to_ulong());
+}
+
+void Role::setPrivileges(const PrivilegeSet &privileges)
+{
+    fingerprint ^= hashAttribute(PRIVILEGES, privilegeSet.to_ulong()) ^
+                   hashAttribute(PRIVILEGES, privileges.to_ulong());
+    privilegeSet = privileges;
+}
+
 
 // Setters and getters
 
 Role &Role::setRoleLocation(const std::string &loc)
 {
-    roleLocation = loc;
+    setAttribute(fingerprint, ROLE_LOCATION, roleLocation, loc);
     return *this;
 }
 
@@ -91,18 +141,31 @@ std::string Role::getRoleLocation() const
 
 Role &Role::setUserIdentifier(const std::string &userIdentifier)
 {
-    this->userIdentifier = userIdentifier;
+    setAttribute(fingerprint, USER_IDENTIFIER,
+                    this->userIdentifier, Identifier(userIdentifier));
     return *this;
 }
 
 std::string Role::getUserIdentifier() const
+{
+    return userIdentifier.str();
+}
+
+Role &Role::setUserIdentifier(const Identifier &userIdentifier)
+{
+    setAttribute(fingerprint, USER_IDENTIFIER,
+                    this->userIdentifier, userIdentifier);
+    return *this;
+}
+
+const Identifier &Role::getUserIdentifierHandle() const
 {
     return userIdentifier;
 }
 
 Role &Role::setUserName(const std::string &name)
 {
-    userName = name;
+    setAttribute(fingerprint, USER_NAME, userName, name);
     return *this;
 }
 
@@ -113,18 +176,31 @@ std::string Role::getUserName() const
 
 Role &Role::setStudyIdentifier(const std::string &studyIdentifier)
 {
-    this->studyIdentifier = studyIdentifier;
+    setAttribute(fingerprint, STUDY_IDENTIFIER,
+                    this->studyIdentifier, Identifier(studyIdentifier));
     return *this;
 }
 
 std::string Role::getStudyIdentifier() const
+{
+    return studyIdentifier.str();
+}
+
+Role &Role::setStudyIdentifier(const Identifier &studyIdentifier)
+{
+    setAttribute(fingerprint, STUDY_IDENTIFIER,
+                    this->studyIdentifier, studyIdentifier);
+    return *this;
+}
+
+const Identifier &Role::getStudyIdentifierHandle() const
 {
     return studyIdentifier;
 }
 
 Role &Role::setStudyName(const std::string &name)
 {
-    studyName = name;
+    setAttribute(fingerprint, STUDY_NAME, studyName, name);
     return *this;
 }
 
@@ -138,28 +214,32 @@ std::string Role::getStudyName() const
 
 Role &Role::addPrivilege(Privilege privilege)
 {
-    privilegeSet.set(privilege.getNumber()-1, true);
+    PrivilegeSet privileges(privilegeSet);
+    privileges.set(privilege.getNumber()-1, true);
+    setPrivileges(privileges);
 
     return *this;
 }
 
 Role &Role::removePrivilege(Privilege privilege)
 {
-    privilegeSet.reset(privilege.getNumber()-1);
+    PrivilegeSet privileges(privilegeSet);
+    privileges.reset(privilege.getNumber()-1);
+    setPrivileges(privileges);
 
     return *this;
 }
 
 Role &Role::addAllPrivileges()
 {
-    privilegeSet.set();
+    setPrivileges(PrivilegeSet().set());
 
     return *this;
 }
 
 Role &Role::removeAllPrivileges()
 {
-    privilegeSet.reset();
+    setPrivileges(PrivilegeSet());
 
     return *this;
 }
@@ -4,7 +4,9 @@
 #define ROLE_H
 
 #include <bitset>
+#include <stdint.h>
 
+#include "Identifier.h"
 #include "Privilege.h"
 
 namespace Yosokumo
@@ -41,15 +43,19 @@ namespace Yosokumo
  */
 class Role
 {
-    std::string userIdentifier;
+    typedef std::bitset<Privilege::NUMBER_OF_PRIVILEGES> PrivilegeSet;
+
+    Identifier  userIdentifier;
     std::string userName;
 
-    std::string studyIdentifier;
+    Identifier  studyIdentifier;
     std::string studyName;
 
     std::string roleLocation;
 
-    std::bitset<Privilege::NUMBER_OF_PRIVILEGES> privilegeSet;
+    PrivilegeSet privilegeSet;
+
+    uint64_t    fingerprint;        // kept up to date by the setters
 
 public:
 
@@ -118,6 +124,15 @@ public:
      */
     bool operator!=(const Role &rhs) const;
 
+    /**
+     * Return a 64-bit fingerprint of the attributes of the role, kept up to
+     * date by the setters.  Roles whose fingerprints differ are not equal
+     * (see <code>Study::getFingerprint()</code>).
+     *
+     * @return the fingerprint.
+     */
+    uint64_t getFingerprint() const;
+
 
     // Setters and getters
 
@@ -153,6 +168,23 @@ public:
      */
     std::string getUserIdentifier() const;
 
+    /**
+     * Set the user identifier.
+     *
+     * @param  userIdentifier  the interned user identifier to assign to this
+     *             role.
+     *
+     * @return this <code>Role</code>.
+     */
+    Role &setUserIdentifier(const Identifier &userIdentifier);
+
+    /**
+     * Return the user identifier, interned.
+     *
+     * @return the interned user identifier of this role.
+     */
+    const Identifier &getUserIdentifierHandle() const;
+
 
     /**
      * Set the user name.
@@ -187,6 +219,23 @@ public:
      */
     std::string getStudyIdentifier() const;
 
+    /**
+     * Set the study identifier.
+     *
+     * @param  studyIdentifier  the interned study identifier to assign to
+     *             this role.
+     *
+     * @return this <code>Role</code>.
+     */
+    Role &setStudyIdentifier(const Identifier &studyIdentifier);
+
+    /**
+     * Return the study identifier, interned.
+     *
+     * @return the interned study identifier of this role.
+     */
+    const Identifier &getStudyIdentifierHandle() const;
+
 
     /**
      * Set the study name.
@@ -267,6 +316,11 @@ public:
      */
     std::string toStringInternal(bool showAll) const;
 
+private:
+
+    uint64_t computeFingerprint() const;
+    void setPrivileges(const PrivilegeSet &privileges);
+
 };  // end class Role
 
 }   // end namespace Yosokumo
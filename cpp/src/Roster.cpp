@@ -1,7 +1,6 @@
 // Roster.cpp
 
 #include <sstream>
-#include <cassert>
 
 #include "Roster.h"
 
@@ -10,7 +9,7 @@ using namespace Yosokumo;
 // Constructors
 
 Roster::Roster() :
-    studyIdentifier(""),
+    studyIdentifier(),
     studyName(""),
     rosterLocation("")
 {
@@ -38,22 +37,7 @@ bool Roster::operator==(const Roster &rhs) const
     ))
         return false;
 
-    RoleConstIterator iter;
- 
-    for (iter = begin();  iter != end();  ++iter)
-    {
-        Role role = iter->second;
-        const std::string userIdentifier = role.getUserIdentifier();
-        Role rhsRole;
-
-        if (!rhs.getRole(userIdentifier, rhsRole))
-            return false;
-        
-        if (role != rhsRole)
-            return false;
-    }
-
-    return true;
+    return roleCollection == rhs.roleCollection;
 }
 
 bool Roster::operator!=(const Roster &rhs) const
@@ -66,10 +50,15 @@ bool Roster::operator!=(const Roster &rhs) const
 
 void Roster::setStudyIdentifier(const std::string &id)
 {
-    studyIdentifier = id;
+    studyIdentifier = Identifier(id);
 }
 
 std::string Roster::getStudyIdentifier() const
+{
+    return studyIdentifier.str();
+}
+
+const Identifier &Roster::getStudyIdentifierHandle() const
 {
     return studyIdentifier;
 }
@@ -98,38 +87,18 @@ std::string Roster::getRosterLocation() const
 
 bool Roster::addRole(const Role &newRole, Role &oldRole)
 {
-    std::pair<std::string, Role> keyRole = 
-        std::make_pair(newRole.getUserIdentifier(), newRole);
-
-    std::pair<RoleIterator, bool> ret;
-
-    ret = roleCollection.insert(keyRole);
-
-    if (ret.second)
-        return true;
-
-    RoleIterator iter = ret.first;
-    oldRole = iter->second;
-
-    roleCollection.erase(ret.first);
-
-    ret = roleCollection.insert(keyRole);
-
-    assert(ret.second);
-
-    return false;
+    return roleCollection.insert(
+                        newRole.getUserIdentifierHandle(), newRole, &oldRole);
 }
 
 bool Roster::addRole(const Role &newRole)
 {
-    Role oldRole;
-
-    return addRole(newRole, oldRole);
+    return roleCollection.insert(newRole.getUserIdentifierHandle(), newRole);
 }
 
 bool Roster::removeRole(const std::string &userIdentifier)
 {
-    return (roleCollection.erase(userIdentifier) == 1);
+    return roleCollection.erase(userIdentifier);
 }
 
 void Roster::clearRoles()
@@ -139,21 +108,19 @@ void Roster::clearRoles()
 
 bool Roster::getRole(const std::string &userIdentifier, Role &foundRole) const
 {
-    RoleConstIterator iter;
+    const Role *role = roleCollection.find(userIdentifier);
 
-    iter = roleCollection.find(userIdentifier);
-
-    if (iter == roleCollection.end())
+    if (role == NULL)
         return false;
 
-    foundRole = iter->second;
+    foundRole = *role;
 
     return true;
 }
 
 bool Roster::containsRole(std::string userIdentifier) const
 {
-    return (roleCollection.find(userIdentifier) != roleCollection.end());
+    return (roleCollection.find(userIdentifier) != NULL);
 }
 
 int Roster::size() const
@@ -161,6 +128,16 @@ int Roster::size() const
     return roleCollection.size();
 }
 
+void Roster::reserveRoles(int n)
+{
+    roleCollection.reserve(n);
+}
+
+void Roster::sortRoles()
+{
+    roleCollection.sort();
+}
+
 bool Roster::isEmpty() const
 {
     return roleCollection.empty();
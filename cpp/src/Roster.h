@@ -4,8 +4,8 @@
 #define ROSTER_H
 
 #include <string>
-#include <map>
 
+#include "IdentifierMap.h"
 #include "Role.h"
 
 namespace Yosokumo
@@ -24,17 +24,16 @@ namespace Yosokumo
  */
 class Roster
 {
-    std::string studyIdentifier;
+    Identifier  studyIdentifier;
     std::string studyName;
 
     std::string rosterLocation;
 
-    // At present the roleCollection map is implemented as an STL map
-    // because this implementation has O(ln n) performance for insert, remove,
-    // and find, and O(1) for "next".  The latter is used to iterate 
-    // over the map, and thus we do not want it to be expensive.  
+    // The roleCollection map is implemented as an IdentifierMap, which has
+    // O(1) average performance for insert, remove, and find, and whose
+    // entries lie in one vector, so "next" is cheap.
 
-    typedef std::map<std::string, Role> RoleMap;
+    typedef IdentifierMap<Role> RoleMap;
 
     RoleMap roleCollection;
 
@@ -108,6 +107,14 @@ public:
      */
     std::string getStudyIdentifier() const;
 
+    /**
+     * Return the study identifier, interned.
+     *
+     * @return the interned identifier of the study to which the roster
+     * belongs.
+     */
+    const Identifier &getStudyIdentifierHandle() const;
+
     /**
      * Set the study name.
      *
@@ -233,6 +240,21 @@ public:
      */
     int size() const;
 
+    /**
+     * Make room for a number of roles, so that adding them allocates no
+     * more space for the role collection.
+     *
+     * @param  n  the number of roles.
+     */
+    void reserveRoles(int n);
+
+    /**
+     * Put the roles in user identifier order, for iteration.  Otherwise
+     * roles are iterated over in the order they were added, except that
+     * removing a role moves the last role into its place.
+     */
+    void sortRoles();
+
     /**
      * Return <code>true</code> if the roster contains no roles.
      *
@@ -257,6 +279,8 @@ public:
      *   }
      * </pre>
      *
+     * Adding or removing a role invalidates all iterators.
+     *
      * @return an iterator referring to the first role in the roster.
      */
     RoleIterator begin();
@@ -0,0 +1,1160 @@
+// Service.cpp
+
+#include "Service.h"
+#include "Message.h"
+#include "Mutex.h"
+#include "Thread.h"
+
+#include <sstream>
+
+using namespace Yosokumo;
+
+const std::string Service::DEFAULT_HOST_NAME = "yosokumo.com";
+
+// The state shared by the workers of one batch operation.  Workers take the
+// next unclaimed block index under the mutex, so blocks are handed out in
+// order and no block is done twice.
+
+struct BatchJob
+{
+    std::string                      location;
+    std::string                      methodName;
+    const std::vector<const Block *> *blocks;
+    const std::vector<Block *>       *results;     // NULL means post only
+    std::vector<ServiceException>    *exceptions;
+
+    Mutex    mutex;
+    unsigned nextIndex;
+};
+
+// A worker thread for a batch operation.  Each worker has its own encoder
+// (YosokumoProtobuf objects keep per-call state) and its own connection.
+
+class BatchWorker : public Thread
+{
+    BatchJob         &job;
+    YosokumoRequest  &request;
+    YosokumoProtobuf dif;
+
+public:
+
+    BatchWorker(BatchJob &job, YosokumoRequest &request) :
+        job(job), request(request)
+    {}
+
+    // Do the work on the calling thread rather than a new one
+
+    void runHere()
+    {
+        run();
+    }
+
+protected:
+
+    void run()
+    {
+        for (;;)
+        {
+            unsigned i;
+            {
+                ScopedLock lock(job.mutex);
+                if (job.nextIndex >= job.blocks->size())
+                    return;
+                i = job.nextIndex++;
+            }
+            process(i);
+        }
+    }
+
+private:
+
+    void process(unsigned i)
+    {
+        ServiceException &e = (*job.exceptions)[i];
+
+        std::vector<uint8_t> entity;
+        if (!dif.makeBytesFromBlock(*(*job.blocks)[i], entity))
+        {
+            dif.getException(e);
+            return;
+        }
+
+        bool ok = request.postToServer(job.location, entity);
+        if (!Service::checkResponse(request, ok, dif, job.methodName, e))
+            return;
+
+        if (job.results != NULL)
+        {
+            request.getEntity(entity);
+            if (!dif.makeBlockFromBytes(entity, *(*job.results)[i]))
+                dif.getException(e);
+        }
+    }
+};
+
+// The state shared by the workers of a catalog hydration.  Each task is the
+// panel or the roster of one study:  with rosters, task 2i is the panel of
+// study i and task 2i+1 its roster; without, task i is the panel.
+
+struct HydrationJob
+{
+    std::vector<const Study *>    studies;
+    bool                          withRosters;
+    std::vector<Panel>            panels;
+    std::vector<Roster>           rosters;
+    std::vector<ServiceException> panelExceptions;
+    std::vector<ServiceException> rosterExceptions;
+
+    Mutex    mutex;
+    unsigned nextIndex;
+    unsigned numTasks;
+};
+
+// A worker thread for a catalog hydration.  It fetches and decodes on its
+// own connection with its own decoder, so the decoding of one response
+// overlaps the fetching of others.
+
+class HydrationWorker : public Thread
+{
+    HydrationJob     &job;
+    YosokumoRequest  &request;
+    YosokumoProtobuf dif;
+
+public:
+
+    HydrationWorker(HydrationJob &job, YosokumoRequest &request) :
+        job(job), request(request)
+    {}
+
+    void runHere()
+    {
+        run();
+    }
+
+protected:
+
+    void run()
+    {
+        for (;;)
+        {
+            unsigned i;
+            {
+                ScopedLock lock(job.mutex);
+                if (job.nextIndex >= job.numTasks)
+                    return;
+                i = job.nextIndex++;
+            }
+
+            if (!job.withRosters)
+                fetchPanel(i);
+            else if (i % 2 == 0)
+                fetchPanel(i / 2);
+            else
+                fetchRoster(i / 2);
+        }
+    }
+
+private:
+
+    void fetchPanel(unsigned i)
+    {
+        ServiceException &e = job.panelExceptions[i];
+
+        bool ok = request.getFromServer(job.studies[i]->getPanelLocation());
+        if (!Service::checkResponse(request, ok, dif, "hydrateCatalog", e))
+            return;
+
+        std::vector<uint8_t> entity;
+        request.getEntity(entity);
+        if (!dif.makePanelFromBytes(entity, job.panels[i]))
+            dif.getException(e);
+    }
+
+    void fetchRoster(unsigned i)
+    {
+        ServiceException &e = job.rosterExceptions[i];
+
+        bool ok = request.getFromServer(job.studies[i]->getRosterLocation());
+        if (!Service::checkResponse(request, ok, dif, "hydrateCatalog", e))
+            return;
+
+        std::vector<uint8_t> entity;
+        request.getEntity(entity);
+        if (!dif.makeRosterFromBytes(entity, job.rosters[i]))
+            dif.getException(e);
+    }
+};
+
+// Run a job on as many workers as there are connections.  With one worker
+// there is nothing to gain from a thread, so the work is done on the calling
+// thread.  Otherwise any worker which cannot be started is simply left out;
+// the others pick up its share.
+
+template <class Job, class Worker>
+static void runWorkers(Job &job, const std::vector<YosokumoRequest *> &requests)
+{
+    unsigned n = requests.size();
+
+    std::vector<Worker *> workers;
+    for (unsigned i = 0;  i < n;  ++i)
+        workers.push_back(new Worker(job, *requests[i]));
+
+    if (n == 1)
+        workers[0]->runHere();
+    else
+    {
+        for (unsigned i = 0;  i < n;  ++i)
+            workers[i]->start();
+        for (unsigned i = 0;  i < n;  ++i)
+            workers[i]->join();
+    }
+
+    for (unsigned i = 0;  i < n;  ++i)
+        delete workers[i];
+
+    // A worker which could not start leaves its tasks unclaimed
+
+    Worker(job, *requests[0]).runHere();
+}
+
+Service::Service(const Credentials &credentials)
+{
+    init(credentials, DEFAULT_HOST_NAME, DEFAULT_PORT);
+}
+
+Service::Service(
+    const Credentials &credentials,
+    const std::string &hostName,
+    int               port)
+{
+    init(credentials, hostName, port);
+}
+
+void Service::init(
+    const Credentials &credentials,
+    const std::string &hostName,
+    int               port)
+{
+    this->credentials    = credentials;
+    this->hostName       = hostName;
+    this->port           = port;
+    this->maxConnections = DEFAULT_MAX_CONNECTIONS;
+    this->trace          = false;
+    this->conditionalGet = false;
+}
+
+Service::~Service()
+{
+    for (unsigned i = 0;  i < connections.size();  ++i)
+        delete connections[i];
+}
+
+void Service::setTrace(bool traceOn)
+{
+    trace = traceOn;
+
+    for (unsigned i = 0;  i < connections.size();  ++i)
+        connections[i]->setTrace(traceOn);
+}
+
+void Service::setMaxConnections(unsigned n)
+{
+    maxConnections = (n < 1) ? 1 : n;
+}
+
+unsigned Service::getMaxConnections() const
+{
+    return maxConnections;
+}
+
+void Service::setConditionalGet(bool on)
+{
+    conditionalGet = on;
+
+    // Only single operations, on connection 0, fetch cacheable objects
+
+    getConnection(0)->setConditionalGet(on);
+
+    if (!on)
+    {
+        catalogCache.clear();
+        studyCache.clear();
+        panelCache.clear();
+        rosterCache.clear();
+    }
+}
+
+bool Service::getConditionalGet() const
+{
+    return conditionalGet;
+}
+
+bool Service::isException()
+{
+    return YosokumoDIF::isException(exception);
+}
+
+ServiceException Service::getException()
+{
+    return exception;
+}
+
+YosokumoRequest *Service::getConnection(unsigned i)
+{
+    while (connections.size() <= i)
+    {
+        YosokumoRequest *r = new YosokumoRequest(
+                        credentials, hostName, port, dif.getContentType());
+        r->setTrace(trace);
+        connections.push_back(r);
+    }
+
+    return connections[i];
+}
+
+void Service::getConnections(
+    unsigned                       numTasks,
+    std::vector<YosokumoRequest *> &requests)
+{
+    unsigned n = maxConnections;
+    if (n > numTasks)
+        n = numTasks;
+    if (n == 0)
+        n = 1;
+
+    requests.clear();
+    for (unsigned i = 0;  i < n;  ++i)
+        requests.push_back(getConnection(i));
+}
+
+bool Service::checkResponse(
+    YosokumoRequest   &request,
+    bool              ok,
+    YosokumoProtobuf  &dif,
+    const std::string &methodName,
+    ServiceException  &exception)
+{
+    if (!ok)
+    {
+        ServiceException e = request.getException();
+        exception = ServiceException(e.what(), request.getStatusCode(),
+                                                                methodName);
+        return false;
+    }
+
+    int statusCode = request.getStatusCode();
+    if ((statusCode >= 200 && statusCode < 300) || request.isNotModified())
+        return true;
+
+    // The server explains an error with a Message entity
+
+    std::stringstream text;
+    text << "HTTP status code " << statusCode;
+
+    std::vector<uint8_t> entity;
+    request.getEntity(entity);
+
+    Message message;
+    if (!entity.empty() && dif.makeMessageFromBytes(entity, message))
+        text << ": " << message.getText();
+
+    exception = ServiceException(text.str(), statusCode, methodName);
+    return false;
+}
+
+bool Service::getEntity(
+    const std::string    &location,
+    const std::string    &methodName,
+    std::vector<uint8_t> &entity)
+{
+    YosokumoRequest *request = getConnection(0);
+
+    bool ok = request->getFromServer(location);
+    if (!checkResponse(*request, ok, dif, methodName, exception))
+        return false;
+
+    request->getEntity(entity);
+    return true;
+}
+
+// Send a GET conditional on eTag and lastModified.  If the resource has
+// changed, set entity to it, and eTag and lastModified to its validators.
+
+bool Service::getEntityIfChanged(
+    const std::string    &location,
+    const std::string    &methodName,
+    std::string          &eTag,
+    std::string          &lastModified,
+    std::vector<uint8_t> &entity,
+    bool                 &changed)
+{
+    YosokumoRequest *request = getConnection(0);
+
+    bool ok = request->getFromServerIfChanged(location, eTag, lastModified);
+    if (ok && request->getStatusCode() == 304)
+    {
+        changed = false;
+        return true;
+    }
+
+    if (!checkResponse(*request, ok, dif, methodName, exception))
+        return false;
+
+    changed = true;
+    request->getEntity(entity);
+
+    eTag.clear();
+    lastModified.clear();
+    request->getResponseHeader("ETag", eTag);
+    request->getResponseHeader("Last-Modified", lastModified);
+
+    return true;
+}
+
+// Send a GET for location, conditional if conditional GET is on.  If the
+// server answers 304 Not Modified and the object decoded from the kept
+// entity is remembered, set changed to false and leave entity alone:
+// nothing need be decoded, as the remembered object is current.
+// Otherwise, set entity.
+
+bool Service::getEntityUnlessCurrent(
+    const std::string    &location,
+    const std::string    &methodName,
+    bool                 remembered,
+    std::vector<uint8_t> &entity,
+    bool                 &changed)
+{
+    YosokumoRequest *request = getConnection(0);
+
+    bool ok = request->getFromServer(location);
+    if (!checkResponse(*request, ok, dif, methodName, exception))
+        return false;
+
+    changed = !(remembered && request->isNotModified());
+    if (changed)
+        request->getEntity(entity);
+
+    return true;
+}
+
+// Whether an object decoded for location is remembered
+
+template <class T>
+static bool isRemembered(
+    const std::map<std::string, T> &cache,
+    const std::string              &location)
+{
+    return cache.find(location) != cache.end();
+}
+
+// After a 304, the remembered object is current, but the caller's object
+// may not be the same.  Leave the caller's object alone if it equals the
+// remembered one; otherwise copy the remembered one to it.  Set changed
+// to whether the caller's object was set.
+
+template <class T>
+static void takeRemembered(const T &remembered, T &object, bool &changed)
+{
+    changed = (object != remembered);
+    if (changed)
+        object = remembered;
+}
+
+bool Service::putControl(
+    const std::string          &location,
+    const std::vector<uint8_t> &entity,
+    const std::string          &methodName)
+{
+    YosokumoRequest *request = getConnection(0);
+
+    bool ok = request->putToServer(location, entity);
+    return checkResponse(*request, ok, dif, methodName, exception);
+}
+
+//*****************************   Catalog   *******************************
+
+bool Service::getCatalog(Catalog &catalog)
+{
+    return getCatalog("/catalog/" + credentials.getUserId(), catalog);
+}
+
+bool Service::getCatalog(const std::string &catalogLocation, Catalog &catalog)
+{
+    bool changed;
+    return getCatalog(catalogLocation, catalog, changed);
+}
+
+bool Service::getCatalog(
+    const std::string &catalogLocation,
+    Catalog           &catalog,
+    bool              &changed)
+{
+    exception = ServiceException();
+
+    getConnection(0)->setAuxHeader("x-yosokumo-full-entries", "on");
+
+    std::vector<uint8_t> entity;
+    if (!getEntityUnlessCurrent(catalogLocation, "getCatalog", 
+                isRemembered(catalogCache, catalogLocation), entity, changed))
+        return false;
+
+    if (!changed)
+    {
+        takeRemembered(catalogCache[catalogLocation], catalog, changed);
+        return true;
+    }
+
+    if (!dif.makeCatalogFromBytes(entity, catalog))
+    {
+        dif.getException(exception);
+        return false;
+    }
+
+    if (conditionalGet)
+        catalogCache[catalogLocation] = catalog;
+
+    return true;
+}
+
+bool Service::getLazyCatalog(LazyCatalog &catalog)
+{
+    return getLazyCatalog("/catalog/" + credentials.getUserId(), catalog);
+}
+
+bool Service::getLazyCatalog(
+    const std::string &catalogLocation,
+    LazyCatalog       &catalog)
+{
+    exception = ServiceException();
+
+    getConnection(0)->setAuxHeader("x-yosokumo-full-entries", "on");
+
+    std::vector<uint8_t> entity;
+    if (!getEntity(catalogLocation, "getLazyCatalog", entity))
+        return false;
+
+    if (!dif.makeLazyCatalogFromBytes(entity, catalog))
+    {
+        dif.getException(exception);
+        return false;
+    }
+
+    return true;
+}
+
+bool Service::revalidateCatalog(
+    const std::string &catalogLocation,
+    std::string       &eTag,
+    std::string       &lastModified,
+    Catalog           &catalog,
+    bool              &changed)
+{
+    exception = ServiceException();
+
+    getConnection(0)->setAuxHeader("x-yosokumo-full-entries", "on");
+
+    std::vector<uint8_t> entity;
+    if (!getEntityIfChanged(catalogLocation, "revalidateCatalog", eTag,
+                                            lastModified, entity, changed))
+        return false;
+
+    if (changed && !dif.makeCatalogFromBytes(entity, catalog))
+    {
+        dif.getException(exception);
+        return false;
+    }
+
+    return true;
+}
+
+//******************************   Study   ********************************
+
+bool Service::createStudy(Study &study)
+{
+    exception = ServiceException();
+
+    std::vector<uint8_t> entity;
+    if (!dif.makeBytesFromStudy(study, entity))
+    {
+        dif.getException(exception);
+        return false;
+    }
+
+    YosokumoRequest *request = getConnection(0);
+
+    bool ok = request->postToServer(
+                        "/catalog/" + credentials.getUserId(), entity);
+    if (!checkResponse(*request, ok, dif, "createStudy", exception))
+        return false;
+
+    request->getEntity(entity);
+
+    if (!dif.makeStudyFromBytes(entity, study))
+    {
+        dif.getException(exception);
+        return false;
+    }
+
+    return true;
+}
+
+bool Service::getStudy(const std::string &studyLocation, Study &study)
+{
+    bool changed;
+    return getStudy(studyLocation, study, changed);
+}
+
+bool Service::getStudy(
+    const std::string &studyLocation,
+    Study             &study,
+    bool              &changed)
+{
+    exception = ServiceException();
+
+    std::vector<uint8_t> entity;
+    if (!getEntityUnlessCurrent(studyLocation, "getStudy", 
+                    isRemembered(studyCache, studyLocation), entity, changed))
+        return false;
+
+    if (!changed)
+    {
+        takeRemembered(studyCache[studyLocation], study, changed);
+        return true;
+    }
+
+    if (!dif.makeStudyFromBytes(entity, study))
+    {
+        dif.getException(exception);
+        return false;
+    }
+
+    if (conditionalGet)
+        studyCache[studyLocation] = study;
+
+    return true;
+}
+
+bool Service::deleteStudy(const Study &study)
+{
+    exception = ServiceException();
+
+    YosokumoRequest *request = getConnection(0);
+
+    bool ok = request->deleteFromServer(study.getStudyLocation());
+    return checkResponse(*request, ok, dif, "deleteStudy", exception);
+}
+
+bool Service::updateStudyName(Study &study, const std::string &name)
+{
+    exception = ServiceException();
+
+    std::vector<uint8_t> entity;
+    if (!dif.makeBytesFromStudyName(name, entity))
+    {
+        dif.getException(exception);
+        return false;
+    }
+
+    if (!putControl(study.getNameControlLocation(), entity,
+                                                        "updateStudyName"))
+        return false;
+
+    study.setStudyName(name);
+    return true;
+}
+
+bool Service::updateStudyStatus(Study &study, Study::Status status)
+{
+    exception = ServiceException();
+
+    std::vector<uint8_t> entity;
+    if (!dif.makeBytesFromStudyStatus(status, entity))
+    {
+        dif.getException(exception);
+        return false;
+    }
+
+    if (!putControl(study.getStatusControlLocation(), entity,
+                                                        "updateStudyStatus"))
+        return false;
+
+    study.setStatus(status);
+    return true;
+}
+
+bool Service::updateStudyVisibility(Study &study, Study::Visibility visibility)
+{
+    exception = ServiceException();
+
+    std::vector<uint8_t> entity;
+    if (!dif.makeBytesFromStudyVisibility(visibility, entity))
+    {
+        dif.getException(exception);
+        return false;
+    }
+
+    if (!putControl(study.getVisibilityControlLocation(), entity,
+                                                    "updateStudyVisibility"))
+        return false;
+
+    study.setVisibility(visibility);
+    return true;
+}
+
+//******************************   Panel   ********************************
+
+bool Service::getPanel(const Study &study, Panel &panel)
+{
+    bool changed;
+    return getPanel(study, panel, changed);
+}
+
+bool Service::getPanel(const Study &study, Panel &panel, bool &changed)
+{
+    exception = ServiceException();
+
+    std::string location = study.getPanelLocation();
+
+    std::vector<uint8_t> entity;
+    if (!getEntityUnlessCurrent(location, "getPanel", 
+                        isRemembered(panelCache, location), entity, changed))
+        return false;
+
+    if (!changed)
+    {
+        takeRemembered(panelCache[location], panel, changed);
+        return true;
+    }
+
+    if (!dif.makePanelFromBytes(entity, panel))
+    {
+        dif.getException(exception);
+        return false;
+    }
+
+    if (conditionalGet)
+        panelCache[location] = panel;
+
+    return true;
+}
+
+bool Service::revalidatePanel(
+    const std::string &panelLocation,
+    std::string       &eTag,
+    std::string       &lastModified,
+    Panel             &panel,
+    bool              &changed)
+{
+    exception = ServiceException();
+
+    std::vector<uint8_t> entity;
+    if (!getEntityIfChanged(panelLocation, "revalidatePanel", eTag,
+                                            lastModified, entity, changed))
+        return false;
+
+    if (changed && !dif.makePanelFromBytes(entity, panel))
+    {
+        dif.getException(exception);
+        return false;
+    }
+
+    return true;
+}
+
+//**************************   Roster and Role   **************************
+
+bool Service::getRoster(const Study &study, Roster &roster)
+{
+    bool changed;
+    return getRoster(study, roster, changed);
+}
+
+bool Service::getRoster(const Study &study, Roster &roster, bool &changed)
+{
+    exception = ServiceException();
+
+    std::string location = study.getRosterLocation();
+
+    std::vector<uint8_t> entity;
+    if (!getEntityUnlessCurrent(location, "getRoster", 
+                        isRemembered(rosterCache, location), entity, changed))
+        return false;
+
+    if (!changed)
+    {
+        takeRemembered(rosterCache[location], roster, changed);
+        return true;
+    }
+
+    if (!dif.makeRosterFromBytes(entity, roster))
+    {
+        dif.getException(exception);
+        return false;
+    }
+
+    if (conditionalGet)
+        rosterCache[location] = roster;
+
+    return true;
+}
+
+bool Service::revalidateRoster(
+    const std::string &rosterLocation,
+    std::string       &eTag,
+    std::string       &lastModified,
+    Roster            &roster,
+    bool              &changed)
+{
+    exception = ServiceException();
+
+    std::vector<uint8_t> entity;
+    if (!getEntityIfChanged(rosterLocation, "revalidateRoster", eTag,
+                                            lastModified, entity, changed))
+        return false;
+
+    if (changed && !dif.makeRosterFromBytes(entity, roster))
+    {
+        dif.getException(exception);
+        return false;
+    }
+
+    return true;
+}
+
+bool Service::getRole(const std::string &roleLocation, Role &role)
+{
+    exception = ServiceException();
+
+    std::vector<uint8_t> entity;
+    if (!getEntity(roleLocation, "getRole", entity))
+        return false;
+
+    if (!dif.makeRoleFromBytes(entity, role))
+    {
+        dif.getException(exception);
+        return false;
+    }
+
+    return true;
+}
+
+bool Service::createRole(const Study &study, Role &role)
+{
+    exception = ServiceException();
+
+    std::vector<uint8_t> entity;
+    if (!dif.makeBytesFromRole(role, entity))
+    {
+        dif.getException(exception);
+        return false;
+    }
+
+    YosokumoRequest *request = getConnection(0);
+
+    bool ok = request->postToServer(study.getRosterLocation(), entity);
+    if (!checkResponse(*request, ok, dif, "createRole", exception))
+        return false;
+
+    request->getEntity(entity);
+
+    if (!entity.empty() && !dif.makeRoleFromBytes(entity, role))
+    {
+        dif.getException(exception);
+        return false;
+    }
+
+    return true;
+}
+
+bool Service::updateRole(Role &role)
+{
+    exception = ServiceException();
+
+    std::vector<uint8_t> entity;
+    if (!dif.makeBytesFromRole(role, entity))
+    {
+        dif.getException(exception);
+        return false;
+    }
+
+    return putControl(role.getRoleLocation(), entity, "updateRole");
+}
+
+bool Service::deleteRole(const Role &role)
+{
+    exception = ServiceException();
+
+    YosokumoRequest *request = getConnection(0);
+
+    bool ok = request->deleteFromServer(role.getRoleLocation());
+    return checkResponse(*request, ok, dif, "deleteRole", exception);
+}
+
+//****************************   Table and Model   *************************
+
+bool Service::postBlock(const std::string &tableLocation, const Block &block)
+{
+    exception = ServiceException();
+
+    std::vector<uint8_t> entity;
+    if (!dif.makeBytesFromBlock(block, entity))
+    {
+        dif.getException(exception);
+        return false;
+    }
+
+    YosokumoRequest *request = getConnection(0);
+
+    bool ok = request->postToServer(tableLocation, entity);
+    return checkResponse(*request, ok, dif, "postBlock", exception);
+}
+
+bool Service::postBlock(const Study &study, const Block &block)
+{
+    return postBlock(study.getTableLocation(), block);
+}
+
+bool Service::postBlock(
+    const std::string &tableLocation, 
+    const Block       &block,
+    WorkStealingPool  &pool)
+{
+    exception = ServiceException();
+
+    std::vector<std::vector<uint8_t> > segments;
+    if (!dif.makeSegmentsFromBlock(block, segments, pool))
+    {
+        dif.getException(exception);
+        return false;
+    }
+
+    YosokumoRequest *request = getConnection(0);
+
+    bool ok = request->postToServer(tableLocation, segments);
+    return checkResponse(*request, ok, dif, "postBlock", exception);
+}
+
+bool Service::postBlockFromFile(
+    const std::string &tableLocation, 
+    int               fd,
+    off_t             offset,
+    size_t            length)
+{
+    exception = ServiceException();
+
+    YosokumoRequest *request = getConnection(0);
+
+    bool ok = request->postFileToServer(tableLocation, fd, offset, length);
+    return checkResponse(*request, ok, dif, "postBlockFromFile", exception);
+}
+
+bool Service::predict(
+    const std::string &modelLocation,
+    const Block       &prospects,
+    Block             &predictions)
+{
+    exception = ServiceException();
+
+    std::vector<uint8_t> entity;
+    if (!dif.makeBytesFromBlock(prospects, entity))
+    {
+        dif.getException(exception);
+        return false;
+    }
+
+    YosokumoRequest *request = getConnection(0);
+
+    bool ok = request->postToServer(modelLocation, entity);
+    if (!checkResponse(*request, ok, dif, "predict", exception))
+        return false;
+
+    request->getEntity(entity);
+
+    if (!dif.makeBlockFromBytes(entity, predictions))
+    {
+        dif.getException(exception);
+        return false;
+    }
+
+    return true;
+}
+
+//****************************   Batch Operations   ************************
+
+bool Service::postBlocks(
+    const std::string                &tableLocation,
+    const std::vector<const Block *> &blocks,
+    std::vector<ServiceException>    &exceptions)
+{
+    return runBatch(tableLocation, blocks, NULL, exceptions, "postBlocks");
+}
+
+bool Service::predictMany(
+    const std::string                &modelLocation,
+    const std::vector<const Block *> &prospects,
+    const std::vector<Block *>       &predictions,
+    std::vector<ServiceException>    &exceptions)
+{
+    if (predictions.size() != prospects.size())
+    {
+        exception = ServiceException(
+            "predictions and prospects differ in size", "predictMany");
+        exceptions.assign(prospects.size(), exception);
+        return false;
+    }
+
+    return runBatch(modelLocation, prospects, &predictions, exceptions,
+                                                            "predictMany");
+}
+
+bool Service::postBlockInChunks(
+    const std::string             &tableLocation,
+    const Block                   &block,
+    size_t                        maxChunkBytes,
+    std::vector<ServiceException> &exceptions)
+{
+    exception = ServiceException();
+
+    std::vector<uint64_t> starts;
+    if (!dif.splitBlock(block, maxChunkBytes, starts))
+    {
+        dif.getException(exception);
+        exceptions.assign(1, exception);
+        return false;
+    }
+
+    std::vector<Block>         chunks(starts.size());
+    std::vector<const Block *> pointers;
+    for (unsigned i = 0;  i < starts.size();  ++i)
+    {
+        uint64_t end = (i + 1 < starts.size()) ? 
+                                    starts[i + 1] : block.getItemCount();
+        Block::copyBlockRange(chunks[i], block, starts[i], end);
+        pointers.push_back(&chunks[i]);
+    }
+
+    if (runBatch(tableLocation, pointers, NULL, exceptions, 
+                                                    "postBlockInChunks"))
+        return true;
+
+    unsigned failed = 0;
+    unsigned first  = 0;
+    for (unsigned i = exceptions.size();  i-- > 0;  )
+    {
+        if (YosokumoDIF::isException(exceptions[i]))
+        {
+            ++failed;
+            first = i;
+        }
+    }
+
+    std::stringstream text;
+    text << failed << " of " << exceptions.size() << " chunks failed; " <<
+            "chunk " << first << ": " << exceptions[first].what();
+
+    exception = ServiceException(text.str(), 
+                        exceptions[first].getStatusCode(), "postBlockInChunks");
+    return false;
+}
+
+bool Service::hydrateCatalog(
+    Catalog                       &catalog,
+    std::map<std::string, Roster> *rosters,
+    std::vector<ServiceException> &exceptions)
+{
+    exception = ServiceException();
+
+    HydrationJob job;
+    job.withRosters = (rosters != NULL);
+    job.nextIndex   = 0;
+
+    Catalog::StudyConstIterator iter;
+    for (iter = catalog.begin();  iter != catalog.end();  ++iter)
+        job.studies.push_back(&iter->second);
+
+    unsigned n = job.studies.size();
+    job.numTasks = job.withRosters ? 2 * n : n;
+    job.panels          .resize(n);
+    job.panelExceptions .resize(n);
+    job.rosters         .resize(job.withRosters ? n : 0);
+    job.rosterExceptions.resize(job.withRosters ? n : 0);
+
+    std::vector<YosokumoRequest *> requests;
+    getConnections(job.numTasks, requests);
+
+    runWorkers<HydrationJob, HydrationWorker>(job, requests);
+
+    // Attach the results.  The studies are changed only now, after all
+    // workers are done with them.
+
+    exceptions.assign(n, ServiceException());
+
+    unsigned i = 0;
+    Catalog::StudyIterator study;
+    for (study = catalog.begin();  study != catalog.end();  ++study, ++i)
+    {
+        if (YosokumoDIF::isException(job.panelExceptions[i]))
+            exceptions[i] = job.panelExceptions[i];
+        else
+            study->second.setPanel(job.panels[i]);
+
+        if (!job.withRosters)
+            continue;
+
+        if (YosokumoDIF::isException(job.rosterExceptions[i]))
+        {
+            if (!YosokumoDIF::isException(exceptions[i]))
+                exceptions[i] = job.rosterExceptions[i];
+        }
+        else
+            (*rosters)[study->second.getStudyIdentifier()] = job.rosters[i];
+    }
+
+    for (i = 0;  i < n;  ++i)
+    {
+        if (YosokumoDIF::isException(exceptions[i]))
+        {
+            exception = exceptions[i];
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool Service::runBatch(
+    const std::string                &location,
+    const std::vector<const Block *> &blocks,
+    const std::vector<Block *>       *results,
+    std::vector<ServiceException>    &exceptions,
+    const std::string                &methodName)
+{
+    exception = ServiceException();
+    exceptions.assign(blocks.size(), ServiceException());
+
+    BatchJob job;
+    job.location   = location;
+    job.methodName = methodName;
+    job.blocks     = &blocks;
+    job.results    = results;
+    job.exceptions = &exceptions;
+    job.nextIndex  = 0;
+
+    std::vector<YosokumoRequest *> requests;
+    getConnections(blocks.size(), requests);
+
+    runWorkers<BatchJob, BatchWorker>(job, requests);
+
+    for (unsigned i = 0;  i < exceptions.size();  ++i)
+    {
+        if (YosokumoDIF::isException(exceptions[i]))
+        {
+            exception = exceptions[i];
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// end Service.cpp
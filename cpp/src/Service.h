@@ -0,0 +1,714 @@
+// Service.h
+
+#ifndef SERVICE_H
+#define SERVICE_H
+
+#include "Block.h"
+#include "Catalog.h"
+#include "Credentials.h"
+#include "LazyCatalog.h"
+#include "Panel.h"
+#include "Role.h"
+#include "Roster.h"
+#include "ServiceException.h"
+#include "Study.h"
+#include "YosokumoProtobuf.h"
+#include "YosokumoRequest.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace Yosokumo
+{
+/**
+ * Provides access to the Yosokumo web service.  A <code>Service</code>
+ * combines a <code>YosokumoRequest</code> (the HTTP transport) with a
+ * <code>YosokumoProtobuf</code> (the entity encoder and decoder), so that
+ * each operation is a single call, e.g.:
+ * <pre>
+ *    Service service(credentials);
+ *    Study study("My Study", Study::NUMBER, Study::RUNNING, 
+ *                                                    Study::PRIVATE);
+ *    if (!service.createStudy(study))
+ *        std::cout << service.getException().what() << '\n';
+ * </pre>
+ * All operations return <code>false</code> in case of a problem; the cause
+ * of the failure is then available from <code>getException()</code>.
+ * <p>
+ * The batch operations <code>postBlocks()</code> and <code>predictMany()</code>
+ * spread a list of blocks over several worker threads.  Each worker encodes
+ * its blocks and sends them over its own connection, and the connections are
+ * kept open for reuse by later operations.  The number of workers (and
+ * connections) is set by <code>setMaxConnections()</code>.
+ * <p>
+ * With <code>setConditionalGet(true)</code>, the catalog, study, panel, and
+ * roster objects fetched are remembered by location.  Fetching one again
+ * sends a conditional GET, and when the server answers 304 Not Modified the
+ * remembered object is returned without decoding anything.  The overloads
+ * with a <code>changed</code> flag do not even copy it when the caller's
+ * object already equals it:  they leave the caller's object alone and
+ * report that it is still current.
+ * <p>
+ * A <code>Service</code> object must not be used by more than one thread at
+ * a time.
+ *
+ * @author  Roger House
+ * @version 0.9
+ */
+
+class Service
+{
+public:
+
+    /**
+     * Default Yosokumo server host name and port.
+     */
+    static const std::string DEFAULT_HOST_NAME;
+    enum { DEFAULT_PORT = 80 };
+
+    /**
+     * Default maximum number of connections used by batch operations.
+     */
+    enum { DEFAULT_MAX_CONNECTIONS = 4 };
+
+private:
+    Credentials      credentials;
+    std::string      hostName;
+    int              port;
+    unsigned         maxConnections;
+    bool             trace;
+    bool             conditionalGet;
+
+    YosokumoProtobuf dif;
+    ServiceException exception;
+
+    // Connections to the server.  connections[0] is used for single
+    // operations; batch operations use as many as maxConnections.  Each is
+    // created when first needed and kept open thereafter.
+
+    std::vector<YosokumoRequest *> connections;
+
+    // Decoded objects by location, kept when conditionalGet is on
+
+    std::map<std::string, Catalog> catalogCache;
+    std::map<std::string, Study>   studyCache;
+    std::map<std::string, Panel>   panelCache;
+    std::map<std::string, Roster>  rosterCache;
+
+public:
+    /**
+     * Initializes a newly created <code>Service</code> object which uses the
+     * default host name and port.
+     *
+     * @param  credentials specifies user id and key for authentication.
+     */
+    Service(const Credentials &credentials);
+
+    /**
+     * Initializes a newly created <code>Service</code> object with
+     * attributes specified by the input parameters.
+     *
+     * @param  credentials specifies user id and key for authentication.
+     * @param  hostName is the name of the Yosokumo server.
+     * @param  port is the port to use to access the Yosokumo service.
+     */
+    Service(
+        const Credentials &credentials,
+        const std::string &hostName,
+        int               port);
+
+    /**
+     * Destructor - closes all connections to the server.
+     */
+    virtual ~Service();
+
+    /**
+     * Set the trace flag for all connections.
+     *
+     * @param  traceOn is the value to assign to the trace flag.
+     */
+    void setTrace(bool traceOn);
+
+    /**
+     * Set the maximum number of connections (and worker threads) used by
+     * batch operations.
+     *
+     * @param  n  the maximum number of connections.  Values less than one
+     *             are treated as one.
+     */
+    void setMaxConnections(unsigned n);
+
+    /**
+     * Return the maximum number of connections used by batch operations.
+     *
+     * @return the maximum number of connections.
+     */
+    unsigned getMaxConnections() const;
+
+    /**
+     * Turn conditional GET on or off for <code>getCatalog()</code>,
+     * <code>getStudy()</code>, <code>getPanel()</code>, and
+     * <code>getRoster()</code>.  Turning it off forgets all remembered
+     * objects.
+     *
+     * @param  on  <code>true</code> to use conditional GET.
+     */
+    void setConditionalGet(bool on);
+
+    /**
+     * Return whether conditional GET is on.
+     *
+     * @return the conditional GET flag.
+     */
+    bool getConditionalGet() const;
+
+    /**
+     * Test if an exception has occurred in the most recent operation.
+     *
+     * @return <code>true</code> means there is an exception.
+     *         <code>false</code> means there is no exception.
+     */
+    bool isException();
+
+    /**
+     * Return the exception from the most recent operation.
+     *
+     * @return the exception from the most recent operation.
+     */
+    ServiceException getException();
+
+//*****************************   Catalog   *******************************
+
+    /**
+     * Get the catalog of the user identified by the credentials.
+     *
+     * @param  catalog  where to place the catalog.
+     *
+     * @return <code>true</code> means success.
+     */
+    bool getCatalog(Catalog &catalog);
+
+    /**
+     * Get the catalog at a specified location.
+     *
+     * @param  catalogLocation  the URI of the catalog.
+     * @param  catalog  where to place the catalog.
+     *
+     * @return <code>true</code> means success.
+     */
+    bool getCatalog(const std::string &catalogLocation, Catalog &catalog);
+
+    /**
+     * Get the catalog at a specified location, unless the catalog passed in
+     * is already current.  This is <code>getCatalog()</code> without the
+     * copy of an unchanged catalog; it needs conditional GET to be on to
+     * find anything unchanged.  The server's answer is about the catalog
+     * this <code>Service</code> remembers for the location, so when the
+     * server says that has not changed, the catalog passed in is compared
+     * with it, and set to it if they differ.
+     *
+     * @param  catalogLocation  the URI of the catalog.
+     * @param  catalog  where to place the catalog, unless it already holds
+     *             the current one.
+     * @param  changed  set to <code>false</code> if catalog already held the
+     *             current catalog and is untouched; <code>true</code> if it
+     *             was set.
+     *
+     * @return <code>true</code> means success.
+     */
+    bool getCatalog(
+        const std::string &catalogLocation,
+        Catalog           &catalog,
+        bool              &changed);
+
+    /**
+     * Get the catalog of the user identified by the credentials, decoding
+     * each study only when it is asked for.  See <code>LazyCatalog</code>.
+     *
+     * @param  catalog  where to place the catalog.
+     *
+     * @return <code>true</code> means success.
+     */
+    bool getLazyCatalog(LazyCatalog &catalog);
+
+    /**
+     * Get the catalog at a specified location, decoding each study only
+     * when it is asked for.  See <code>LazyCatalog</code>.
+     *
+     * @param  catalogLocation  the URI of the catalog.
+     * @param  catalog  where to place the catalog.
+     *
+     * @return <code>true</code> means success.
+     */
+    bool getLazyCatalog(
+        const std::string &catalogLocation,
+        LazyCatalog       &catalog);
+
+    /**
+     * Revalidate a catalog kept elsewhere, e.g., in a
+     * <code>CatalogSnapshot</code>:  get it again only if it has changed
+     * since it was fetched with the given validators.  The conditional GET
+     * cache (see <code>setConditionalGet()</code>) is not involved.
+     *
+     * @param  catalogLocation  the URI of the catalog.
+     * @param  eTag  the ETag the catalog was fetched with, or empty.  If it
+     *             has changed, set to the new ETag (empty if none).
+     * @param  lastModified  the Last-Modified time the catalog was fetched
+     *             with, or empty.  If it has changed, set to the new one.
+     * @param  catalog  if it has changed, where to place the new catalog.
+     * @param  changed  set to <code>false</code> if the server says the
+     *             catalog has not changed; catalog is then untouched.
+     *
+     * @return <code>true</code> means success.
+     */
+    bool revalidateCatalog(
+        const std::string &catalogLocation,
+        std::string       &eTag,
+        std::string       &lastModified,
+        Catalog           &catalog,
+        bool              &changed);
+
+//******************************   Study   ********************************
+
+    /**
+     * Create a new study in the catalog of the user identified by the
+     * credentials.  On success the study is replaced by the study returned
+     * by the server, which includes the study identifier and locations.
+     *
+     * @param  study  the study to create.
+     *
+     * @return <code>true</code> means success.
+     */
+    bool createStudy(Study &study);
+
+    /**
+     * Get a study.
+     *
+     * @param  studyLocation  the URI of the study.
+     * @param  study  where to place the study.
+     *
+     * @return <code>true</code> means success.
+     */
+    bool getStudy(const std::string &studyLocation, Study &study);
+
+    /**
+     * Get a study, unless the one passed in is already current.  As for
+     * <code>getCatalog()</code> with a <code>changed</code> flag.
+     *
+     * @param  studyLocation  the URI of the study.
+     * @param  study  where to place the study, unless it already holds the
+     *             current one.
+     * @param  changed  set to <code>false</code> if study is untouched.
+     *
+     * @return <code>true</code> means success.
+     */
+    bool getStudy(
+        const std::string &studyLocation,
+        Study             &study,
+        bool              &changed);
+
+    /**
+     * Delete a study.
+     *
+     * @param  study  the study to delete.
+     *
+     * @return <code>true</code> means success.
+     */
+    bool deleteStudy(const Study &study);
+
+    /**
+     * Change the name of a study.  On success the study is updated.
+     *
+     * @param  study  the study to change.
+     * @param  name   the new name.
+     *
+     * @return <code>true</code> means success.
+     */
+    bool updateStudyName(Study &study, const std::string &name);
+
+    /**
+     * Change the status of a study.  On success the study is updated.
+     *
+     * @param  study   the study to change.
+     * @param  status  the new status.
+     *
+     * @return <code>true</code> means success.
+     */
+    bool updateStudyStatus(Study &study, Study::Status status);
+
+    /**
+     * Change the visibility of a study.  On success the study is updated.
+     *
+     * @param  study       the study to change.
+     * @param  visibility  the new visibility.
+     *
+     * @return <code>true</code> means success.
+     */
+    bool updateStudyVisibility(Study &study, Study::Visibility visibility);
+
+//******************************   Panel   ********************************
+
+    /**
+     * Get the panel of a study.
+     *
+     * @param  study  the study whose panel is wanted.
+     * @param  panel  where to place the panel.
+     *
+     * @return <code>true</code> means success.
+     */
+    bool getPanel(const Study &study, Panel &panel);
+
+    /**
+     * Get the panel of a study, unless the one passed in is already
+     * current.  As for <code>getCatalog()</code> with a
+     * <code>changed</code> flag.
+     *
+     * @param  study  the study whose panel is wanted.
+     * @param  panel  where to place the panel, unless it already holds the
+     *             current one.
+     * @param  changed  set to <code>false</code> if panel is untouched.
+     *
+     * @return <code>true</code> means success.
+     */
+    bool getPanel(const Study &study, Panel &panel, bool &changed);
+
+    /**
+     * Revalidate a panel kept elsewhere.  As for
+     * <code>revalidateCatalog()</code>.
+     */
+    bool revalidatePanel(
+        const std::string &panelLocation,
+        std::string       &eTag,
+        std::string       &lastModified,
+        Panel             &panel,
+        bool              &changed);
+
+//**************************   Roster and Role   **************************
+
+    /**
+     * Get the roster of a study.
+     *
+     * @param  study   the study whose roster is wanted.
+     * @param  roster  where to place the roster.
+     *
+     * @return <code>true</code> means success.
+     */
+    bool getRoster(const Study &study, Roster &roster);
+
+    /**
+     * Get the roster of a study, unless the one passed in is already
+     * current.  As for <code>getCatalog()</code> with a
+     * <code>changed</code> flag.
+     *
+     * @param  study   the study whose roster is wanted.
+     * @param  roster  where to place the roster, unless it already holds
+     *             the current one.
+     * @param  changed  set to <code>false</code> if roster is untouched.
+     *
+     * @return <code>true</code> means success.
+     */
+    bool getRoster(const Study &study, Roster &roster, bool &changed);
+
+    /**
+     * Revalidate a roster kept elsewhere.  As for
+     * <code>revalidateCatalog()</code>.
+     */
+    bool revalidateRoster(
+        const std::string &rosterLocation,
+        std::string       &eTag,
+        std::string       &lastModified,
+        Roster            &roster,
+        bool              &changed);
+
+    /**
+     * Get a role.
+     *
+     * @param  roleLocation  the URI of the role.
+     * @param  role  where to place the role.
+     *
+     * @return <code>true</code> means success.
+     */
+    bool getRole(const std::string &roleLocation, Role &role);
+
+    /**
+     * Add a role to the roster of a study.  On success the role is replaced
+     * by the role returned by the server, which includes its location.
+     *
+     * @param  study  the study to which to add the role.
+     * @param  role   the role to add.
+     *
+     * @return <code>true</code> means success.
+     */
+    bool createRole(const Study &study, Role &role);
+
+    /**
+     * Replace a role.  The role location identifies the role to replace.
+     *
+     * @param  role  the new role.
+     *
+     * @return <code>true</code> means success.
+     */
+    bool updateRole(Role &role);
+
+    /**
+     * Remove a role from the roster of a study.
+     *
+     * @param  role  the role to remove.
+     *
+     * @return <code>true</code> means success.
+     */
+    bool deleteRole(const Role &role);
+
+//****************************   Table and Model   *************************
+
+    /**
+     * Post a block of predictors or specimens to the table of a study.
+     *
+     * @param  tableLocation  the URI of the table.
+     * @param  block  the block to post.
+     *
+     * @return <code>true</code> means success.
+     */
+    bool postBlock(const std::string &tableLocation, const Block &block);
+
+    /**
+     * Post a block of predictors or specimens to the table of a study.
+     *
+     * @param  study  the study whose table receives the block.
+     * @param  block  the block to post.
+     *
+     * @return <code>true</code> means success.
+     */
+    bool postBlock(const Study &study, const Block &block);
+
+    /**
+     * Post a large block of specimens to the table of a study, encoding it
+     * in parallel.  The specimens are encoded into segments on the workers
+     * of a pool (see <code>YosokumoProtobuf::makeSegmentsFromBlock()</code>)
+     * and the segments are sent in one gathered write, so the encoded 
+     * block is never copied into one buffer.
+     *
+     * @param  tableLocation  the URI of the table.
+     * @param  block  the block to post.
+     * @param  pool  the pool on which to encode.
+     *
+     * @return <code>true</code> means success.
+     */
+    bool postBlock(
+        const std::string &tableLocation, 
+        const Block       &block,
+        WorkStealingPool  &pool);
+
+    /**
+     * Post a block which is already encoded, from a range of an open file
+     * (e.g., a record of a <code>BlockSpool</code>).  The range is sent 
+     * with <code>sendfile()</code> (see 
+     * <code>YosokumoRequest::postFileToServer()</code>), so the block is
+     * neither decoded nor encoded again.
+     *
+     * @param  tableLocation  the URI of the table.
+     * @param  fd  the file descriptor of the file.  Not closed.
+     * @param  offset  the position in the file of the encoded block.
+     * @param  length  the length of the encoded block.
+     *
+     * @return <code>true</code> means success.
+     */
+    bool postBlockFromFile(
+        const std::string &tableLocation, 
+        int               fd,
+        off_t             offset,
+        size_t            length);
+
+    /**
+     * Obtain predictions from the model of a study.
+     *
+     * @param  modelLocation  the URI of the model.
+     * @param  prospects  a block of specimens whose predictands are wanted.
+     * @param  predictions  where to place the predictions returned by the
+     *             server.
+     *
+     * @return <code>true</code> means success.
+     */
+    bool predict(
+        const std::string &modelLocation,
+        const Block       &prospects,
+        Block             &predictions);
+
+//****************************   Batch Operations   ************************
+
+    /**
+     * Post many blocks to the table of a study.  The blocks are encoded and
+     * posted in parallel, over as many as <code>getMaxConnections()</code>
+     * connections.
+     *
+     * @param  tableLocation  the URI of the table.
+     * @param  blocks  the blocks to post.  The pointers are not retained.
+     * @param  exceptions  set to one entry per block:  the exception for the
+     *             block, or a default <code>ServiceException</code> if the
+     *             block was posted successfully.
+     *
+     * @return <code>true</code> means every block was posted successfully.
+     *         <code>false</code> means at least one block failed;
+     *             <code>getException()</code> returns the first failure.
+     */
+    bool postBlocks(
+        const std::string                &tableLocation,
+        const std::vector<const Block *> &blocks,
+        std::vector<ServiceException>    &exceptions);
+
+    /**
+     * Obtain predictions for many blocks of prospects.  The blocks are
+     * encoded, sent, and decoded in parallel, over as many as
+     * <code>getMaxConnections()</code> connections.
+     *
+     * @param  modelLocation  the URI of the model.
+     * @param  prospects  the blocks of prospects.
+     * @param  predictions  one block per entry of prospects, in which to
+     *             place the predictions for that entry.  Must be the same
+     *             size as prospects.
+     * @param  exceptions  set to one entry per block, as for
+     *             <code>postBlocks()</code>.
+     *
+     * @return <code>true</code> means every block succeeded.
+     */
+    bool predictMany(
+        const std::string                &modelLocation,
+        const std::vector<const Block *> &prospects,
+        const std::vector<Block *>       &predictions,
+        std::vector<ServiceException>    &exceptions);
+
+    /**
+     * Post a large block to the table of a study in chunks.  The block is 
+     * divided into chunks whose encoded size does not exceed 
+     * <code>maxChunkBytes</code>, and the chunks are posted concurrently, 
+     * with at most <code>getMaxConnections()</code> in flight at once.
+     *
+     * @param  tableLocation  the URI of the table.
+     * @param  block  the block to post.
+     * @param  maxChunkBytes  the limit on the encoded size of one chunk.  A
+     *             single item bigger than the limit is posted by itself.
+     * @param  exceptions  set to one entry per chunk, in block order, as for
+     *             <code>postBlocks()</code>.
+     *
+     * @return <code>true</code> means every chunk was posted successfully.
+     *         <code>false</code> means at least one chunk failed;
+     *             <code>getException()</code> tells how many failed, and 
+     *             carries the text and status code of the first failure.
+     */
+    bool postBlockInChunks(
+        const std::string             &tableLocation,
+        const Block                   &block,
+        size_t                        maxChunkBytes,
+        std::vector<ServiceException> &exceptions);
+
+    /**
+     * Fill in the panels of all the studies of a catalog, and optionally
+     * get their rosters.  The panels and rosters are fetched and decoded in
+     * parallel, over as many as <code>getMaxConnections()</code>
+     * connections, so the time taken is about that of the slowest fetch
+     * when there are enough connections, rather than the sum of all.
+     *
+     * @param  catalog  the catalog, e.g., just returned by
+     *             <code>getCatalog()</code>.  The panel attributes of each
+     *             study whose panel is fetched are set from the panel.
+     * @param  rosters  where to place the roster of each study, by study
+     *             identifier; <code>NULL</code> means do not fetch rosters.
+     * @param  exceptions  set to one entry per study, in catalog order:  the
+     *             first failure for the study, or a default
+     *             <code>ServiceException</code> if all went well.
+     *
+     * @return <code>true</code> means every fetch succeeded.
+     *         <code>false</code> means at least one failed;
+     *             <code>getException()</code> returns the first failure.
+     *             The studies which succeeded are filled in regardless.
+     */
+    bool hydrateCatalog(
+        Catalog                       &catalog,
+        std::map<std::string, Roster> *rosters,
+        std::vector<ServiceException> &exceptions);
+
+    /**
+     * Interpret the outcome of a request:  if the request failed, or the
+     * server responded with a status code other than 2xx (or 304 for a
+     * conditional GET answered from the cache), set exception and return
+     * false.  An error entity, if any, is decoded from a
+     * <code>Message</code> and used as the exception text.
+     *
+     * @param  request  the request just made.
+     * @param  ok  the value returned by the request method.
+     * @param  dif  used to decode an error message.
+     * @param  methodName  the name of the failed method, for the exception.
+     * @param  exception  where to place the exception.
+     *
+     * @return <code>true</code> means the request succeeded.
+     */
+    static bool checkResponse(
+        YosokumoRequest   &request,
+        bool              ok,
+        YosokumoProtobuf  &dif,
+        const std::string &methodName,
+        ServiceException  &exception);
+
+private:
+
+    void init(
+        const Credentials &credentials,
+        const std::string &hostName,
+        int               port);
+
+    YosokumoRequest *getConnection(unsigned i);
+
+    void getConnections(
+        unsigned                       numTasks,
+        std::vector<YosokumoRequest *> &requests);
+
+    bool getEntity(
+        const std::string    &location,
+        const std::string    &methodName,
+        std::vector<uint8_t> &entity);
+
+    bool getEntityUnlessCurrent(
+        const std::string    &location,
+        const std::string    &methodName,
+        bool                 remembered,
+        std::vector<uint8_t> &entity,
+        bool                 &changed);
+
+    bool getEntityIfChanged(
+        const std::string    &location,
+        const std::string    &methodName,
+        std::string          &eTag,
+        std::string          &lastModified,
+        std::vector<uint8_t> &entity,
+        bool                 &changed);
+
+    bool putControl(
+        const std::string          &location,
+        const std::vector<uint8_t> &entity,
+        const std::string          &methodName);
+
+    bool runBatch(
+        const std::string                &location,
+        const std::vector<const Block *> &blocks,
+        const std::vector<Block *>       *results,
+        std::vector<ServiceException>    &exceptions,
+        const std::string                &methodName);
+
+    /**
+     * Copy constructor - NOT IMPLEMENTED.
+     */
+    Service(const Service &rhs);
+
+    /**
+     * Assignment operator - NOT IMPLEMENTED.
+     */
+    Service& operator=(const Service& rhs);
+
+};  // end class Service
+
+}   // end namespace Yosokumo
+
+#endif  // SERVICE_H
+
+// end Service.h
@@ -0,0 +1,442 @@
+// SharedCatalog.cpp
+
+#include "SharedCatalog.h"
+
+#include <pthread.h>
+
+using namespace Yosokumo;
+
+// The read side.  Each thread which reads has a slot holding the epoch at
+// which its outermost guard began, or 0 when it holds no guard.  A version
+// replaced at epoch E can be freed once no slot holds an epoch <= E:  a
+// guard which began later loaded the version which replaced it, or a newer
+// one.  All epochs, slots, and versions of every SharedCatalog share this.
+
+struct SharedCatalog::ReaderSlot
+{
+    uint64_t   epoch;
+    unsigned   nesting;             // touched only by the owning thread
+    bool       inUse;               // owned by a live thread
+    ReaderSlot *next;
+};
+
+namespace
+{
+
+uint64_t globalEpoch = 1;
+
+// The slots of all threads which have read.  A slot is never freed:  when
+// its thread ends it is given to the next new thread.
+
+pthread_mutex_t slotsMutex = PTHREAD_MUTEX_INITIALIZER;
+void            *slots     = NULL;
+
+pthread_once_t  keyOnce = PTHREAD_ONCE_INIT;
+pthread_key_t   slotKey;            // only to give the slot back
+
+__thread SharedCatalog::ReaderSlot *threadSlot = NULL;
+
+}   // end anonymous namespace
+
+extern "C" void releaseReaderSlot(void *p);
+extern "C" void createReaderSlotKey();
+
+//***************************   CatalogVersion   ***************************
+
+CatalogVersion::CatalogVersion() : studyCount(0), retireEpoch(0)
+{
+    for (unsigned i = 0;  i < SHARD_COUNT;  ++i)
+        shards[i] = NULL;
+}
+
+CatalogVersion::~CatalogVersion()
+{}
+
+const std::string &CatalogVersion::getUserIdentifier() const
+{
+    return userIdentifier;
+}
+
+const std::string &CatalogVersion::getUserName() const
+{
+    return userName;
+}
+
+const std::string &CatalogVersion::getCatalogLocation() const
+{
+    return catalogLocation;
+}
+
+size_t CatalogVersion::size() const
+{
+    return studyCount;
+}
+
+const Study *CatalogVersion::findStudy(const Identifier &studyIdentifier) const
+{
+    const Shard *shard = shards[shardOf(studyIdentifier)];
+    if (shard == NULL)
+        return NULL;
+
+    StudyNode *const *node = shard->studies.find(studyIdentifier);
+
+    return node == NULL ? NULL : &(*node)->study;
+}
+
+const Study *CatalogVersion::findStudy(const std::string &studyIdentifier) const
+{
+    Identifier interned;
+    if (!Identifier::find(studyIdentifier, interned))
+        return NULL;
+
+    return findStudy(interned);
+}
+
+bool CatalogVersion::containsStudy(const std::string &studyIdentifier) const
+{
+    return findStudy(studyIdentifier) != NULL;
+}
+
+void CatalogVersion::getStudies(std::vector<const Study *> &studies) const
+{
+    studies.clear();
+    studies.reserve(studyCount);
+
+    for (unsigned i = 0;  i < SHARD_COUNT;  ++i)
+    {
+        if (shards[i] == NULL)
+            continue;
+
+        StudyMap::const_iterator iter;
+        for (iter = shards[i]->studies.begin();
+                                    iter != shards[i]->studies.end();  ++iter)
+            studies.push_back(&iter->second->study);
+    }
+}
+
+void CatalogVersion::getCatalog(Catalog &catalog) const
+{
+    catalog.setUserIdentifier (userIdentifier );
+    catalog.setUserName       (userName       );
+    catalog.setCatalogLocation(catalogLocation);
+
+    catalog.clearStudies();
+    catalog.reserveStudies(int(studyCount));
+
+    std::vector<const Study *> studies;
+    getStudies(studies);
+
+    for (size_t i = 0;  i < studies.size();  ++i)
+        catalog.addStudy(*studies[i]);
+}
+
+unsigned CatalogVersion::shardOf(const Identifier &studyIdentifier)
+{
+    // The top bits, as IdentifierMap uses the bottom ones
+
+    return unsigned(studyIdentifier.getHash() >> 56) % SHARD_COUNT;
+}
+
+//****************************   ReadGuard   *******************************
+
+extern "C" void releaseReaderSlot(void *p)
+{
+    pthread_mutex_lock(&slotsMutex);
+    static_cast<SharedCatalog::ReaderSlot *>(p)->inUse = false;
+    pthread_mutex_unlock(&slotsMutex);
+}
+
+extern "C" void createReaderSlotKey()
+{
+    pthread_key_create(&slotKey, releaseReaderSlot);
+}
+
+SharedCatalog::ReadGuard::ReadGuard(const SharedCatalog &shared)
+{
+    slot = threadSlot;
+
+    if (slot == NULL)
+    {
+        pthread_once(&keyOnce, createReaderSlotKey);
+
+        pthread_mutex_lock(&slotsMutex);
+
+        for (slot = static_cast<ReaderSlot *>(slots);  slot != NULL;
+                                                        slot = slot->next)
+            if (!slot->inUse)
+                break;
+
+        if (slot == NULL)
+        {
+            slot = new ReaderSlot;
+            slot->epoch   = 0;
+            slot->nesting = 0;
+            slot->next    = static_cast<ReaderSlot *>(slots);
+            slots         = slot;
+        }
+
+        slot->inUse = true;
+
+        pthread_mutex_unlock(&slotsMutex);
+
+        pthread_setspecific(slotKey, slot);
+        threadSlot = slot;
+    }
+
+    // The store of the epoch must come before the load of the version, so
+    // that a publisher which does not see the one sees the other
+
+    if (slot->nesting++ == 0)
+        __atomic_store_n(&slot->epoch,
+                __atomic_load_n(&globalEpoch, __ATOMIC_SEQ_CST),
+                                                            __ATOMIC_SEQ_CST);
+
+    version = __atomic_load_n(&shared.current, __ATOMIC_SEQ_CST);
+}
+
+SharedCatalog::ReadGuard::~ReadGuard()
+{
+    if (--slot->nesting == 0)
+        __atomic_store_n(&slot->epoch, uint64_t(0), __ATOMIC_RELEASE);
+}
+
+//***************************   SharedCatalog   ****************************
+
+SharedCatalog::SharedCatalog() : current(new CatalogVersion)
+{}
+
+SharedCatalog::~SharedCatalog()
+{
+    release(current);
+
+    for (size_t i = 0;  i < retired.size();  ++i)
+        release(retired[i]);
+}
+
+void SharedCatalog::publish(const Catalog &catalog)
+{
+    ScopedLock lock(mutex);
+
+    const CatalogVersion *old = current;
+
+    std::vector<const Study *> puts;
+    std::vector<Identifier>    removals;
+    size_t                     added = 0;
+
+    Catalog::StudyConstIterator iter;
+    for (iter = catalog.begin();  iter != catalog.end();  ++iter)
+    {
+        const Study *study = old->findStudy(iter->first);
+        if (study == NULL)
+            ++added;
+        if (study == NULL || *study != iter->second)
+            puts.push_back(&iter->second);
+    }
+
+    // Only if some old study is missing, look for which
+
+    if (old->studyCount + added > size_t(catalog.size()))
+    {
+        for (unsigned i = 0;  i < CatalogVersion::SHARD_COUNT;  ++i)
+        {
+            if (old->shards[i] == NULL)
+                continue;
+
+            CatalogVersion::StudyMap::const_iterator it;
+            for (it = old->shards[i]->studies.begin();
+                                it != old->shards[i]->studies.end();  ++it)
+                if (catalog.findStudy(it->first) == NULL)
+                    removals.push_back(it->first);
+        }
+    }
+
+    if (puts.empty() && removals.empty()                     &&
+        old->userIdentifier  == catalog.getUserIdentifier()  &&
+        old->userName        == catalog.getUserName()        &&
+        old->catalogLocation == catalog.getCatalogLocation())
+        return;
+
+    commit(catalog.getUserIdentifier(), catalog.getUserName(),
+                            catalog.getCatalogLocation(), puts, removals);
+}
+
+void SharedCatalog::apply(const CatalogDelta &delta)
+{
+    ScopedLock lock(mutex);
+
+    if (delta.isEmpty())
+        return;
+
+    std::vector<const Study *> puts;
+
+    const std::vector<Study> &added = delta.getAddedStudies();
+    for (size_t i = 0;  i < added.size();  ++i)
+        puts.push_back(&added[i]);
+
+    const std::vector<CatalogDelta::StudyChange> &changed =
+                                                    delta.getChangedStudies();
+    for (size_t i = 0;  i < changed.size();  ++i)
+        puts.push_back(&changed[i].study);
+
+    if (delta.getAttributesChanged())
+        commit(delta.getUserIdentifier(), delta.getUserName(),
+                delta.getCatalogLocation(), puts, delta.getRemovedStudies());
+    else
+        commit(current->userIdentifier, current->userName,
+                current->catalogLocation, puts, delta.getRemovedStudies());
+}
+
+void SharedCatalog::commit(
+    const std::string                &userIdentifier,
+    const std::string                &userName,
+    const std::string                &catalogLocation,
+    const std::vector<const Study *> &puts,
+    const std::vector<Identifier>    &removals)
+{
+    CatalogVersion *old  = current;
+    CatalogVersion *next = new CatalogVersion;
+
+    next->userIdentifier  = userIdentifier;
+    next->userName        = userName;
+    next->catalogLocation = catalogLocation;
+    next->studyCount      = old->studyCount;
+
+    // Share every shard, and copy a shard the first time it changes
+
+    bool copied[CatalogVersion::SHARD_COUNT];
+
+    for (unsigned i = 0;  i < CatalogVersion::SHARD_COUNT;  ++i)
+    {
+        next->shards[i] = old->shards[i];
+        if (next->shards[i] != NULL)
+            ++next->shards[i]->refs;
+        copied[i] = false;
+    }
+
+    for (size_t i = 0;  i < removals.size() + puts.size();  ++i)
+    {
+        bool put = (i >= removals.size());
+        const Identifier &id = put ?
+            puts[i - removals.size()]->getStudyIdentifierHandle() :
+            removals[i];
+
+        unsigned s = CatalogVersion::shardOf(id);
+        Shard *shard = next->shards[s];
+
+        if (!put && (shard == NULL || shard->studies.find(id) == NULL))
+            continue;
+
+        if (!copied[s])
+        {
+            Shard *copy = new Shard;
+
+            if (shard != NULL)
+            {
+                copy->studies = shard->studies;
+                --shard->refs;          // still held by old
+
+                CatalogVersion::StudyMap::iterator it;
+                for (it = copy->studies.begin();
+                                        it != copy->studies.end();  ++it)
+                    ++it->second->refs;
+            }
+
+            next->shards[s] = shard = copy;
+            copied[s] = true;
+        }
+
+        StudyNode *replaced = NULL;
+
+        if (put)
+        {
+            if (shard->studies.insert(id,
+                        new StudyNode(*puts[i - removals.size()]), &replaced))
+                ++next->studyCount;
+        }
+        else
+        {
+            replaced = *shard->studies.find(id);
+            shard->studies.erase(id);
+            --next->studyCount;
+        }
+
+        if (replaced != NULL && --replaced->refs == 0)
+            delete replaced;
+    }
+
+    // Publish, then retire the old version at the epoch before the next
+
+    __atomic_store_n(&current, next, __ATOMIC_SEQ_CST);
+    old->retireEpoch = __atomic_fetch_add(&globalEpoch, 1, __ATOMIC_SEQ_CST);
+    retired.push_back(old);
+
+    reclaimLocked();
+}
+
+void SharedCatalog::reclaim()
+{
+    ScopedLock lock(mutex);
+
+    reclaimLocked();
+}
+
+size_t SharedCatalog::getRetiredCount()
+{
+    ScopedLock lock(mutex);
+
+    return retired.size();
+}
+
+void SharedCatalog::reclaimLocked()
+{
+    if (retired.empty())
+        return;
+
+    // The oldest epoch at which a guard still held began
+
+    uint64_t oldest = ~uint64_t(0);
+
+    pthread_mutex_lock(&slotsMutex);
+
+    for (ReaderSlot *slot = static_cast<ReaderSlot *>(slots);  slot != NULL;
+                                                            slot = slot->next)
+    {
+        uint64_t epoch = __atomic_load_n(&slot->epoch, __ATOMIC_SEQ_CST);
+        if (epoch != 0 && epoch < oldest)
+            oldest = epoch;
+    }
+
+    pthread_mutex_unlock(&slotsMutex);
+
+    size_t kept = 0;
+    for (size_t i = 0;  i < retired.size();  ++i)
+    {
+        if (retired[i]->retireEpoch < oldest)
+            release(retired[i]);
+        else
+            retired[kept++] = retired[i];
+    }
+    retired.resize(kept);
+}
+
+void SharedCatalog::release(CatalogVersion *version)
+{
+    for (unsigned i = 0;  i < CatalogVersion::SHARD_COUNT;  ++i)
+    {
+        Shard *shard = version->shards[i];
+
+        if (shard == NULL || --shard->refs > 0)
+            continue;
+
+        CatalogVersion::StudyMap::iterator it;
+        for (it = shard->studies.begin();  it != shard->studies.end();  ++it)
+            if (--it->second->refs == 0)
+                delete it->second;
+
+        delete shard;
+    }
+
+    delete version;
+}
+
+// end SharedCatalog.cpp
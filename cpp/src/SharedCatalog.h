@@ -0,0 +1,284 @@
+// SharedCatalog.h
+
+#ifndef SHAREDCATALOG_H
+#define SHAREDCATALOG_H
+
+#include "Catalog.h"
+#include "CatalogDelta.h"
+#include "Identifier.h"
+#include "IdentifierMap.h"
+#include "Mutex.h"
+#include "Study.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace Yosokumo
+{
+
+/**
+ * One version of a catalog published by a <code>SharedCatalog</code>.  It
+ * never changes; a refresh publishes a new version, which shares with
+ * this one every study that did not change.  A version is read only
+ * through a <code>SharedCatalog::ReadGuard</code>, and the references it
+ * hands out are good until the guard is destroyed.
+ * <p>
+ * The studies are spread over a fixed number of shards by the hash of
+ * their identifiers, and each shard is shared between versions until a
+ * study in it changes.  So the studies of a version are not in the order
+ * of the catalog.
+ */
+class CatalogVersion
+{
+    friend class SharedCatalog;
+
+public:
+
+    enum { SHARD_COUNT = 256 };
+
+private:
+
+    // Study nodes and shards are shared between versions.  Their reference
+    // counts are changed only by the publisher, under its mutex; readers
+    // never touch them.
+
+    struct StudyNode
+    {
+        Study    study;
+        unsigned refs;
+
+        explicit StudyNode(const Study &s) : study(s), refs(1)
+        {}
+    };
+
+    typedef IdentifierMap<StudyNode *> StudyMap;
+
+    struct Shard
+    {
+        StudyMap studies;
+        unsigned refs;
+
+        Shard() : refs(1)
+        {}
+    };
+
+    std::string userIdentifier;
+    std::string userName;
+    std::string catalogLocation;
+    Shard       *shards[SHARD_COUNT];   // NULL means no studies
+    size_t      studyCount;
+    uint64_t    retireEpoch;            // set when replaced
+
+    CatalogVersion();
+    ~CatalogVersion();
+
+public:
+
+    const std::string &getUserIdentifier() const;
+    const std::string &getUserName() const;
+    const std::string &getCatalogLocation() const;
+
+    /**
+     * Return the number of studies.
+     */
+    size_t size() const;
+
+    /**
+     * Return the study with an identifier, or NULL if there is none.
+     */
+    const Study *findStudy(const Identifier &studyIdentifier) const;
+
+    /**
+     * Return the study with an identifier, or NULL if there is none.
+     */
+    const Study *findStudy(const std::string &studyIdentifier) const;
+
+    /**
+     * Test if there is a study with an identifier.
+     */
+    bool containsStudy(const std::string &studyIdentifier) const;
+
+    /**
+     * Get every study.
+     *
+     * @param  studies  set to a pointer to each study.
+     */
+    void getStudies(std::vector<const Study *> &studies) const;
+
+    /**
+     * Copy the whole version into a catalog.
+     *
+     * @param  catalog  where to place the catalog.
+     */
+    void getCatalog(Catalog &catalog) const;
+
+private:
+
+    static unsigned shardOf(const Identifier &studyIdentifier);
+
+    /**
+     * Copy constructor - NOT IMPLEMENTED.
+     */
+    CatalogVersion(const CatalogVersion &rhs);
+
+    /**
+     * Assignment operator - NOT IMPLEMENTED.
+     */
+    CatalogVersion& operator=(const CatalogVersion& rhs);
+
+};  // end class CatalogVersion
+
+
+/**
+ * A catalog read by many threads while another thread refreshes it, in the
+ * manner of read-copy-update.  Readers take the current version with a
+ * <code>ReadGuard</code>:
+ * <pre>
+ *    {
+ *        SharedCatalog::ReadGuard guard(shared);
+ *        const Study *study = guard->findStudy(studyIdentifier);
+ *        ...
+ *    }
+ * </pre>
+ * Taking a guard is wait-free:  it records the epoch in a slot of the
+ * reading thread and loads the current version, with no lock and no
+ * reference count; only the first guard on a thread takes a lock, to get
+ * the thread its slot.  Guards may be nested, also on different
+ * <code>SharedCatalog</code>s.
+ * <p>
+ * The refresher publishes a new version with <code>publish()</code> or
+ * <code>apply()</code>.  The new version shares with the old one every
+ * study which did not change, and every shard in which no study changed,
+ * so a refresh copies only the shards it touches and never copies a
+ * study.  The old version is freed once no guard which could have loaded
+ * it remains; the refresher never waits for readers, and versions still in
+ * use are freed by a later refresh or by <code>reclaim()</code>.
+ * Refreshes from several threads are serialized.
+ */
+class SharedCatalog
+{
+    CatalogVersion                *current;
+    std::vector<CatalogVersion *> retired;
+    Mutex                         mutex;      // serializes publishers
+
+public:
+
+    struct ReaderSlot;              // per reading thread, in the .cpp file
+
+    /**
+     * Holds the current version of a <code>SharedCatalog</code> for
+     * reading, for as long as it exists.  A guard belongs to the thread
+     * which made it.
+     */
+    class ReadGuard
+    {
+        ReaderSlot           *slot;
+        const CatalogVersion *version;
+
+    public:
+
+        explicit ReadGuard(const SharedCatalog &shared);
+        ~ReadGuard();
+
+        const CatalogVersion &operator*() const
+        {
+            return *version;
+        }
+
+        const CatalogVersion *operator->() const
+        {
+            return version;
+        }
+
+    private:
+
+        /**
+         * Copy constructor - NOT IMPLEMENTED.
+         */
+        ReadGuard(const ReadGuard &rhs);
+
+        /**
+         * Assignment operator - NOT IMPLEMENTED.
+         */
+        ReadGuard& operator=(const ReadGuard& rhs);
+
+    };  // end class ReadGuard
+
+    /**
+     * Initializes a newly created <code>SharedCatalog</code> whose version
+     * has no studies.
+     */
+    SharedCatalog();
+
+    /**
+     * Destructor - frees every version.  No guard on it may remain.
+     */
+    ~SharedCatalog();
+
+    /**
+     * Publish a catalog as the new version.  Studies equal to those of the
+     * current version are shared with it.  Takes time in proportion to the
+     * size of the catalog, to compare it, plus the size of the shards in
+     * which studies changed.
+     *
+     * @param  catalog  the catalog.
+     */
+    void publish(const Catalog &catalog);
+
+    /**
+     * Publish the current version changed by a delta.  Takes time in
+     * proportion to the size of the delta and of the shards it touches.
+     *
+     * @param  delta  the changes, e.g., computed by
+     *             <code>CatalogDelta::compute()</code>.
+     */
+    void apply(const CatalogDelta &delta);
+
+    /**
+     * Free the replaced versions which no guard can still hold.
+     */
+    void reclaim();
+
+    /**
+     * Return the number of replaced versions not yet freed.
+     */
+    size_t getRetiredCount();
+
+private:
+
+    typedef CatalogVersion::Shard     Shard;
+    typedef CatalogVersion::StudyNode StudyNode;
+
+    // Make the next version:  share everything of the current one, then
+    // put in studies and take out identifiers, copying the shards touched
+
+    void commit(
+        const std::string                &userIdentifier,
+        const std::string                &userName,
+        const std::string                &catalogLocation,
+        const std::vector<const Study *> &puts,
+        const std::vector<Identifier>    &removals);
+
+    void reclaimLocked();
+
+    static void release(CatalogVersion *version);
+
+    /**
+     * Copy constructor - NOT IMPLEMENTED.
+     */
+    SharedCatalog(const SharedCatalog &rhs);
+
+    /**
+     * Assignment operator - NOT IMPLEMENTED.
+     */
+    SharedCatalog& operator=(const SharedCatalog& rhs);
+
+};  // end class SharedCatalog
+
+}   // end namespace Yosokumo
+
+#endif  // SHAREDCATALOG_H
+
+// end SharedCatalog.h
@@ -5,12 +5,15 @@
 
 #include "Specimen.h"
 #include "EmptyValue.h"
+#include "AllocationTracker.h"
+#include "Hash.h"
 
 using namespace Yosokumo;
 
 // Constructors
 
-Specimen::Specimen()
+Specimen::Specimen() :
+    cellsFingerprint(0)
 {
     setSpecimenKey(0);
     setStatus     (Specimen::ACTIVE);
@@ -18,7 +21,8 @@ Specimen::Specimen()
     setPredictand (EmptyValue());
 }
 
-Specimen::Specimen(uint64_t key)
+Specimen::Specimen(uint64_t key) :
+    cellsFingerprint(0)
 {
     setSpecimenKey(key);
     setStatus     (Specimen::ACTIVE);
@@ -31,7 +35,8 @@ Specimen::Specimen
     uint64_t key, 
     std::vector<Cell>::iterator begin,
     std::vector<Cell>::iterator end
-)
+) :
+    cellsFingerprint(0)
 {
     addCells(begin, end);
     setSpecimenKey(key);
@@ -45,7 +50,8 @@ Specimen::Specimen
     uint64_t key, 
     std::list<Cell>::iterator begin,
     std::list<Cell>::iterator end
-)
+) :
+    cellsFingerprint(0)
 {
     addCells(begin, end);
     setSpecimenKey(key);
@@ -60,7 +66,8 @@ Specimen::Specimen
     Value       predictand,
     std::vector<Cell>::iterator begin,
     std::vector<Cell>::iterator end
-)
+) :
+    cellsFingerprint(0)
 {
     addCells(begin, end);
     setSpecimenKey(key);
@@ -75,7 +82,8 @@ Specimen::Specimen
     Value       predictand,
     std::list<Cell>::iterator begin,
     std::list<Cell>::iterator end
-)
+) :
+    cellsFingerprint(0)
 {
     addCells(begin, end);
     setSpecimenKey(key);
@@ -92,7 +100,8 @@ Specimen::Specimen
     Value       predictand,
     std::vector<Cell>::iterator begin,
     std::vector<Cell>::iterator end
-)
+) :
+    cellsFingerprint(0)
 {
     addCells(begin, end);
     setSpecimenKey(key);
@@ -109,7 +118,8 @@ Specimen::Specimen
     Value       predictand,
     std::list<Cell>::iterator begin,
     std::list<Cell>::iterator end
-)
+) :
+    cellsFingerprint(0)
 {
     addCells(begin, end);
     setSpecimenKey(key);
@@ -118,7 +128,8 @@ Specimen::Specimen
     setPredictand (predictand);
 }
 
-Specimen::Specimen(const Specimen &rhs)
+Specimen::Specimen(const Specimen &rhs) :
+    cellsFingerprint(0)
 {
     operator=(rhs);
 }
@@ -128,6 +139,8 @@ Specimen::~Specimen()
 
 Specimen &Specimen::operator=(const Specimen &rhs)
 {
+    YOSOKUMO_TRACK_ALLOCATIONS("Specimen::operator=");
+
     if (this == &rhs)
         return *this;
 
@@ -194,6 +207,7 @@ Value Specimen::getPredictand() const
 
 void Specimen::addCell(const Cell &cell)
 {
+    cellsFingerprint += hashCellAt(cellSequence.size(), cell);
     cellSequence.push_back(cell);
 }
 
@@ -206,6 +220,7 @@ bool Specimen::addCells
 {
     unsigned old_size = cellSequence.size();
     cellSequence.insert(cellSequence.end(), begin, end);
+    addCellsFingerprint(old_size);
     return cellSequence.size() != old_size;
 }
 
@@ -217,6 +232,7 @@ bool  Specimen::addCells
 {
     unsigned old_size = cellSequence.size();
     cellSequence.insert(cellSequence.end(), begin, end);
+    addCellsFingerprint(old_size);
     return cellSequence.size() != old_size;
 }
 
@@ -228,9 +244,14 @@ bool  Specimen::removeCells(uint64_t numCellsToRemove)
     if (numCellsToRemove >= size())
         clearCells();
     else
+    {
+        for (uint64_t i = size() - numCellsToRemove;  i < size();  ++i)
+            cellsFingerprint -= hashCellAt(i, cellSequence[i]);
+
         cellSequence.erase(
             cellSequence.end()-numCellsToRemove,
             cellSequence.end());
+    }
 
     return true;
 }
@@ -244,6 +265,7 @@ Cell  Specimen::getCell(int index) const
 void  Specimen::clearCells()
 {
     cellSequence.clear();
+    cellsFingerprint = 0;
 }
 
 uint64_t  Specimen::size() const
@@ -256,6 +278,53 @@ bool Specimen::isEmpty() const
     return cellSequence.empty();
 }
 
+void Specimen::addCellsFingerprint(size_t first)
+{
+    for (size_t i = first;  i < cellSequence.size();  ++i)
+        cellsFingerprint += hashCellAt(i, cellSequence[i]);
+}
+
+
+// Equality operators and fingerprints
+
+bool Specimen::operator==(const Specimen &rhs) const
+{
+    return
+    (
+        cellsFingerprint == rhs.cellsFingerprint &&
+        key              == rhs.key              &&
+        status           == rhs.status           &&
+        weight           == rhs.weight           &&
+        predictand       == rhs.predictand       &&
+        cellSequence     == rhs.cellSequence
+    );
+}
+
+bool Specimen::operator!=(const Specimen &rhs) const
+{
+    return !(*this == rhs);
+}
+
+uint64_t Specimen::getCellsFingerprint() const
+{
+    return cellsFingerprint;
+}
+
+uint64_t Specimen::getContentFingerprint() const
+{
+    uint64_t h = hashValue(HASH_SEED, predictand);
+    h = hashUint64(h, cellSequence.size());
+    return mixHash(hashUint64(h, cellsFingerprint));
+}
+
+uint64_t Specimen::getFingerprint() const
+{
+    uint64_t h = hashUint64(HASH_SEED, key);
+    h = hashUint64(h, status);
+    h = hashUint64(h, weight);
+    return mixHash(hashUint64(h, getContentFingerprint()));
+}
+
 
 // Utility
 
@@ -68,6 +68,12 @@ private:
      */
     std::vector<Cell> cellSequence;
 
+    /**
+     * The fingerprint of the cell sequence, kept up to date as cells are
+     * added and removed.
+     */
+    uint64_t cellsFingerprint;
+
 public:
 
     // Constructors
@@ -254,6 +260,63 @@ public:
     Specimen& operator=(const Specimen& rhs);
 
 
+    // Equality operators and fingerprints
+
+    /**
+     * Equality operator - compare two <code>Specimens</code> for equality.
+     * The fingerprints of the cell sequences are compared first, so
+     * specimens with different cells are told apart without walking them.
+     * This is sound because cells which are equal always hash alike (see
+     * <code>hashValue()</code>).
+     *
+     * @param  rhs  the righthand side of the equality.
+     *
+     * @return <code>true</code> if and only if <code>this</code> 
+     *              <code>Specimen</code> and the righthand side 
+     *              <code>Specimen</code> are identically equal.
+     */
+    bool operator==(const Specimen &rhs) const;
+
+    /**
+     * Inequality operator - compare two <code>Specimens</code> for
+     * inequality.
+     *
+     * @param  rhs  the righthand side of the inequality.
+     *
+     * @return <code>true</code> if and only if <code>this</code> 
+     *              <code>Specimen</code> and the righthand side 
+     *              <code>Specimen</code> are not identically equal.
+     */
+    bool operator!=(const Specimen &rhs) const;
+
+    /**
+     * Return a 64-bit fingerprint of the cell sequence.  It is kept up to
+     * date as cells are added and removed, so getting it costs nothing.
+     * Equal sequences have equal fingerprints.
+     *
+     * @return the fingerprint.
+     */
+    uint64_t getCellsFingerprint() const;
+
+    /**
+     * Return a 64-bit fingerprint of the contents of the specimen:  its
+     * predictand and its cells, but not its key, status, or weight.  It
+     * takes constant time, and may serve as a key for a cache of
+     * predictions or for finding duplicate specimens.
+     *
+     * @return the fingerprint.
+     */
+    uint64_t getContentFingerprint() const;
+
+    /**
+     * Return a 64-bit fingerprint of the whole specimen, including its key,
+     * status, and weight.  It takes constant time.
+     *
+     * @return the fingerprint.
+     */
+    uint64_t getFingerprint() const;
+
+
     // Setters and getters
 
     /**
@@ -428,6 +491,12 @@ public:
      */
     std::string toString() const;
 
+private:
+
+    // Add the cells from the one at first on to the cell fingerprint
+
+    void addCellsFingerprint(size_t first);
+
 };  // end class Specimen
 
 }   // end namespace Yosokumo
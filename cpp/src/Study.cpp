@@ -3,6 +3,7 @@
 #include <sstream>
 
 #include "Study.h"
+#include "Hash.h"
 
 using namespace Yosokumo;
 
@@ -23,10 +24,10 @@ Study::Study
 {
     initStudy();
 
-    this->studyName   = studyName;
-    this->type        = type;
-    this->status      = status;
-    this->visibility  = visibility;
+    setStudyName (studyName );
+    setType      (type      );
+    setStatus    (status    );
+    setVisibility(visibility);
 }
 
 Study::Study(const Study &rhs)
@@ -52,6 +53,9 @@ Study &Study::operator=(const Study& rhs)
 
 bool Study::operator==(const Study &rhs) const 
 {
+    if (fingerprint != rhs.fingerprint)
+        return false;
+
     return
     (
         studyIdentifier           == rhs.studyIdentifier           &&
@@ -91,16 +95,97 @@ bool Study::operator!=(const Study &rhs) const
     return !(*this == rhs);
 }
 
+uint64_t Study::getFingerprint() const
+{
+    return fingerprint;
+}
+
+uint64_t Study::computeFingerprint() const
+{
+    return
+        hashAttribute(STUDY_IDENTIFIER,           studyIdentifier          ) ^
+        hashAttribute(STUDY_NAME,                 studyName                ) ^
+        hashAttribute(STUDY_LOCATION,             studyLocation            ) ^
+        hashAttribute(TYPE,                       type                     ) ^
+        hashAttribute(STATUS,                     status                   ) ^
+        hashAttribute(VISIBILITY,                 visibility               ) ^
+        hashAttribute(OWNER_IDENTIFIER,           ownerIdentifier          ) ^
+        hashAttribute(OWNER_NAME,                 ownerName                ) ^
+        hashAttribute(TABLE_LOCATION,             tableLocation            ) ^
+        hashAttribute(MODEL_LOCATION,             modelLocation            ) ^
+        hashAttribute(PANEL_LOCATION,             panelLocation            ) ^
+        hashAttribute(ROSTER_LOCATION,            rosterLocation           ) ^
+        hashAttribute(NAME_CONTROL_LOCATION,      nameControlLocation      ) ^
+        hashAttribute(STATUS_CONTROL_LOCATION,    statusControlLocation    ) ^
+        hashAttribute(VISIBILITY_CONTROL_LOCATION, visibilityControlLocation) ^
+        hashAttribute(BLOCK_COUNT,                blockCount               ) ^
+        hashAttribute(CELL_COUNT,                 cellCount                ) ^
+        hashAttribute(PROSPECT_COUNT,             prospectCount            ) ^
+        hashAttribute(CREATION_TIME,              creationTime             ) ^
+        hashAttribute(LATEST_BLOCK_TIME,          latestBlockTime          ) ^
+        hashAttribute(LATEST_PROSPECT_TIME,       latestProspectTime       );
+}
+
+unsigned Study::getChangedFields(const Study &rhs) const
+{
+    unsigned fields = 0;
+
+    if (studyIdentifier    != rhs.studyIdentifier)
+        fields |= STUDY_IDENTIFIER;
+    if (studyName          != rhs.studyName)
+        fields |= STUDY_NAME;
+    if (studyLocation      != rhs.studyLocation)
+        fields |= STUDY_LOCATION;
+    if (type               != rhs.type)
+        fields |= TYPE;
+    if (status             != rhs.status)
+        fields |= STATUS;
+    if (visibility         != rhs.visibility)
+        fields |= VISIBILITY;
+    if (ownerIdentifier    != rhs.ownerIdentifier)
+        fields |= OWNER_IDENTIFIER;
+    if (ownerName          != rhs.ownerName)
+        fields |= OWNER_NAME;
+    if (tableLocation      != rhs.tableLocation)
+        fields |= TABLE_LOCATION;
+    if (modelLocation      != rhs.modelLocation)
+        fields |= MODEL_LOCATION;
+    if (panelLocation      != rhs.panelLocation)
+        fields |= PANEL_LOCATION;
+    if (rosterLocation     != rhs.rosterLocation)
+        fields |= ROSTER_LOCATION;
+    if (nameControlLocation       != rhs.nameControlLocation)
+        fields |= NAME_CONTROL_LOCATION;
+    if (statusControlLocation     != rhs.statusControlLocation)
+        fields |= STATUS_CONTROL_LOCATION;
+    if (visibilityControlLocation != rhs.visibilityControlLocation)
+        fields |= VISIBILITY_CONTROL_LOCATION;
+    if (blockCount         != rhs.blockCount)
+        fields |= BLOCK_COUNT;
+    if (cellCount          != rhs.cellCount)
+        fields |= CELL_COUNT;
+    if (prospectCount      != rhs.prospectCount)
+        fields |= PROSPECT_COUNT;
+    if (creationTime       != rhs.creationTime)
+        fields |= CREATION_TIME;
+    if (latestBlockTime    != rhs.latestBlockTime)
+        fields |= LATEST_BLOCK_TIME;
+    if (latestProspectTime != rhs.latestProspectTime)
+        fields |= LATEST_PROSPECT_TIME;
+
+    return fields;
+}
+
 
 void Study::initStudy()
 {
-    studyIdentifier           = "";
+    studyIdentifier           = Identifier();
     studyName                 = "";
     studyLocation             = "";
     type                      = NUMBER;
     status                    = RUNNING;
     visibility                = PRIVATE;
-    ownerIdentifier           = "";
+    ownerIdentifier           = Identifier();
     ownerName                 = "";
     tableLocation             = "";
     modelLocation             = "";
@@ -115,36 +200,46 @@ void Study::initStudy()
     creationTime              = "";
     latestBlockTime           = "";
     latestProspectTime        = "";
+
+    // Every default study has the same fingerprint
+
+    static const uint64_t initialFingerprint = computeFingerprint();
+
+    fingerprint = initialFingerprint;
 }
 
 // Copy one study to another
 
 void Study::copyStudy(Study &t, const Study &s)
 {
-    t.setStudyIdentifier(s.getStudyIdentifier());
-    t.setStudyName      (s.getStudyName()      );
-    t.setStudyLocation  (s.getStudyLocation()  );
-    t.setType           (s.getType()           );
-    t.setStatus         (s.getStatus()         );
-    t.setVisibility     (s.getVisibility()     );
-    t.setOwnerIdentifier(s.getOwnerIdentifier());
-    t.setOwnerName      (s.getOwnerName()      );
-    t.setTableLocation  (s.getTableLocation()  );
-    t.setModelLocation  (s.getModelLocation()  );
-    t.setPanelLocation  (s.getPanelLocation()  );
-    t.setRosterLocation (s.getRosterLocation() );
+    // Copied member by member, as the fingerprint need not be made again
+
+    t.studyIdentifier           = s.studyIdentifier          ;
+    t.studyName                 = s.studyName                ;
+    t.studyLocation             = s.studyLocation            ;
+    t.type                      = s.type                     ;
+    t.status                    = s.status                   ;
+    t.visibility                = s.visibility               ;
+    t.ownerIdentifier           = s.ownerIdentifier          ;
+    t.ownerName                 = s.ownerName                ;
+    t.tableLocation             = s.tableLocation            ;
+    t.modelLocation             = s.modelLocation            ;
+    t.panelLocation             = s.panelLocation            ;
+    t.rosterLocation            = s.rosterLocation           ;
 
     // Panel info
 
-    t.setNameControlLocation      (s.getNameControlLocation()      );
-    t.setStatusControlLocation    (s.getStatusControlLocation()    );
-    t.setVisibilityControlLocation(s.getVisibilityControlLocation());
-    t.setBlockCount               (s.getBlockCount()               );
-    t.setCellCount                (s.getCellCount()                );
-    t.setProspectCount            (s.getProspectCount()            );
-    t.setCreationTime             (s.getCreationTime()             );
-    t.setLatestBlockTime          (s.getLatestBlockTime()          );
-    t.setLatestProspectTime       (s.getLatestProspectTime()       );
+    t.nameControlLocation       = s.nameControlLocation      ;
+    t.statusControlLocation     = s.statusControlLocation    ;
+    t.visibilityControlLocation = s.visibilityControlLocation;
+    t.blockCount                = s.blockCount               ;
+    t.cellCount                 = s.cellCount                ;
+    t.prospectCount             = s.prospectCount            ;
+    t.creationTime              = s.creationTime             ;
+    t.latestBlockTime           = s.latestBlockTime          ;
+    t.latestProspectTime        = s.latestProspectTime       ;
+
+    t.fingerprint               = s.fingerprint              ;
 
 }   //  end copyStudy
 
@@ -152,17 +247,28 @@ void Study::copyStudy(Study &t, const Study &s)
 
 void Study::setStudyIdentifier(const std::string &id)
 {
-    studyIdentifier = id;
+    setAttribute(fingerprint, STUDY_IDENTIFIER,
+                    studyIdentifier, Identifier(id));
 }
 
 std::string Study::getStudyIdentifier() const
+{
+    return studyIdentifier.str();
+}
+
+void Study::setStudyIdentifier(const Identifier &id)
+{
+    setAttribute(fingerprint, STUDY_IDENTIFIER, studyIdentifier, id);
+}
+
+const Identifier &Study::getStudyIdentifierHandle() const
 {
     return studyIdentifier;
 }
 
 void Study::setStudyName(const std::string &name)
 {
-    studyName = name;
+    setAttribute(fingerprint, STUDY_NAME, studyName, name);
 }
 
 std::string Study::getStudyName() const
@@ -172,7 +278,7 @@ std::string Study::getStudyName() const
 
 void Study::setStudyLocation(const std::string &loc)
 {
-    studyLocation = loc;
+    setAttribute(fingerprint, STUDY_LOCATION, studyLocation, loc);
 }
 
 std::string Study::getStudyLocation() const
@@ -182,7 +288,7 @@ std::string Study::getStudyLocation() const
 
 void Study::setType(Type t)
 {
-    type = t;
+    setAttribute(fingerprint, TYPE, type, t);
 }
 
 Study::Type Study::getType() const
@@ -192,7 +298,7 @@ Study::Type Study::getType() const
 
 void Study::setStatus(Status s)
 {
-    status = s;
+    setAttribute(fingerprint, STATUS, status, s);
 }
 
 Study::Status Study::getStatus() const
@@ -202,7 +308,7 @@ Study::Status Study::getStatus() const
 
 void Study::setVisibility(Visibility v)
 {
-    visibility = v;
+    setAttribute(fingerprint, VISIBILITY, visibility, v);
 }
 
 Study::Visibility Study::getVisibility() const
@@ -212,17 +318,28 @@ Study::Visibility Study::getVisibility() const
 
 void Study::setOwnerIdentifier(const std::string &id)
 {
-    ownerIdentifier = id;
+    setAttribute(fingerprint, OWNER_IDENTIFIER,
+                    ownerIdentifier, Identifier(id));
 }
 
 std::string Study::getOwnerIdentifier() const
+{
+    return ownerIdentifier.str();
+}
+
+void Study::setOwnerIdentifier(const Identifier &id)
+{
+    setAttribute(fingerprint, OWNER_IDENTIFIER, ownerIdentifier, id);
+}
+
+const Identifier &Study::getOwnerIdentifierHandle() const
 {
     return ownerIdentifier;
 }
 
 void Study::setOwnerName(const std::string &name)
 {
-    ownerName = name;
+    setAttribute(fingerprint, OWNER_NAME, ownerName, name);
 }
 
 std::string Study::getOwnerName() const
@@ -232,7 +349,7 @@ std::string Study::getOwnerName() const
 
 void Study::setTableLocation(const std::string &loc)
 {
-    tableLocation = loc;
+    setAttribute(fingerprint, TABLE_LOCATION, tableLocation, loc);
 }
 
 std::string Study::getTableLocation() const
@@ -242,7 +359,7 @@ std::string Study::getTableLocation() const
 
 void Study::setModelLocation(const std::string &loc)
 {
-    modelLocation = loc;
+    setAttribute(fingerprint, MODEL_LOCATION, modelLocation, loc);
 }
 
 std::string Study::getModelLocation() const
@@ -252,7 +369,7 @@ std::string Study::getModelLocation() const
 
 void Study::setPanelLocation(const std::string &loc)
 {
-    panelLocation = loc;
+    setAttribute(fingerprint, PANEL_LOCATION, panelLocation, loc);
 }
 
 std::string Study::getPanelLocation() const
@@ -262,7 +379,7 @@ std::string Study::getPanelLocation() const
 
 void Study::setRosterLocation(const std::string &loc)
 {
-    rosterLocation = loc;
+    setAttribute(fingerprint, ROSTER_LOCATION, rosterLocation, loc);
 }
 
 std::string Study::getRosterLocation() const
@@ -274,7 +391,8 @@ std::string Study::getRosterLocation() const
 
 void Study::setNameControlLocation(const std::string &nameControlLocation)
 {
-    this->nameControlLocation = nameControlLocation;
+    setAttribute(fingerprint, NAME_CONTROL_LOCATION,
+                    this->nameControlLocation, nameControlLocation);
 }
 
 std::string Study::getNameControlLocation() const
@@ -284,7 +402,8 @@ std::string Study::getNameControlLocation() const
 
 void Study::setStatusControlLocation(const std::string &statusControlLocation)
 {
-    this->statusControlLocation = statusControlLocation;
+    setAttribute(fingerprint, STATUS_CONTROL_LOCATION,
+                    this->statusControlLocation, statusControlLocation);
 }
 
 std::string Study::getStatusControlLocation() const
@@ -294,7 +413,8 @@ std::string Study::getStatusControlLocation() const
 
 void Study::setVisibilityControlLocation(const std::string &visibilityControlLocation)
 {
-    this->visibilityControlLocation = visibilityControlLocation;
+    setAttribute(fingerprint, VISIBILITY_CONTROL_LOCATION,
+                    this->visibilityControlLocation, visibilityControlLocation);
 }
 
 std::string Study::getVisibilityControlLocation() const
@@ -304,7 +424,7 @@ std::string Study::getVisibilityControlLocation() const
 
 void Study::setBlockCount(uint64_t blockCount)
 {
-    this->blockCount = blockCount;
+    setAttribute(fingerprint, BLOCK_COUNT, this->blockCount, blockCount);
 }
 
 uint64_t Study::getBlockCount() const
@@ -314,7 +434,7 @@ uint64_t Study::getBlockCount() const
 
 void Study::setCellCount(uint64_t cellCount)
 {
-    this->cellCount = cellCount;
+    setAttribute(fingerprint, CELL_COUNT, this->cellCount, cellCount);
 }
 
 uint64_t Study::getCellCount() const
@@ -324,7 +444,8 @@ uint64_t Study::getCellCount() const
 
 void Study::setProspectCount(uint64_t prospectCount)
 {
-    this->prospectCount = prospectCount;
+    setAttribute(fingerprint, PROSPECT_COUNT,
+                    this->prospectCount, prospectCount);
 }
 
 uint64_t Study::getProspectCount() const
@@ -334,7 +455,7 @@ uint64_t Study::getProspectCount() const
 
 void Study::setCreationTime(const std::string &creationTime)
 {
-    this->creationTime = creationTime;
+    setAttribute(fingerprint, CREATION_TIME, this->creationTime, creationTime);
 }
 
 std::string Study::getCreationTime() const
@@ -344,7 +465,8 @@ std::string Study::getCreationTime() const
 
 void Study::setLatestBlockTime(const std::string &latestBlockTime)
 {
-    this->latestBlockTime = latestBlockTime;
+    setAttribute(fingerprint, LATEST_BLOCK_TIME,
+                    this->latestBlockTime, latestBlockTime);
 }
 
 std::string Study::getLatestBlockTime() const
@@ -354,7 +476,8 @@ std::string Study::getLatestBlockTime() const
 
 void Study::setLatestProspectTime(const std::string &latestProspectTime)
 {
-    this->latestProspectTime = latestProspectTime;
+    setAttribute(fingerprint, LATEST_PROSPECT_TIME,
+                    this->latestProspectTime, latestProspectTime);
 }
 
 std::string Study::getLatestProspectTime() const
@@ -362,6 +485,36 @@ std::string Study::getLatestProspectTime() const
     return latestProspectTime;
 }
 
+void Study::setPanel(const Panel &panel)
+{
+    setNameControlLocation      (panel.getNameControlLocation()      );
+    setStatusControlLocation    (panel.getStatusControlLocation()    );
+    setVisibilityControlLocation(panel.getVisibilityControlLocation());
+    setBlockCount               (panel.getBlockCount()               );
+    setCellCount                (panel.getCellCount()                );
+    setProspectCount            (panel.getProspectCount()            );
+    setCreationTime             (panel.getCreationTime()             );
+    setLatestBlockTime          (panel.getLatestBlockTime()          );
+    setLatestProspectTime       (panel.getLatestProspectTime()       );
+}
+
+Panel Study::getPanel() const
+{
+    Panel panel;
+
+    panel.setNameControlLocation      (nameControlLocation      );
+    panel.setStatusControlLocation    (statusControlLocation    );
+    panel.setVisibilityControlLocation(visibilityControlLocation);
+    panel.setBlockCount               (blockCount               );
+    panel.setCellCount                (cellCount                );
+    panel.setProspectCount            (prospectCount            );
+    panel.setCreationTime             (creationTime             );
+    panel.setLatestBlockTime          (latestBlockTime          );
+    panel.setLatestProspectTime       (latestProspectTime       );
+
+    return panel;
+}
+
 // Utility
 
 std::string Study::toString()
@@ -6,6 +6,9 @@
 #include <stdint.h>
 #include <string>
 
+#include "Identifier.h"
+#include "Panel.h"
+
 namespace Yosokumo
 {
 
@@ -100,9 +103,38 @@ public:
         PUBLIC
     };
 
+    /**
+     * The attributes of a study, as bits, for reporting which attributes
+     * differ between two studies (see <code>getChangedFields()</code>).
+     */
+    enum Field
+    {
+        STUDY_IDENTIFIER            = 1 <<  0,
+        STUDY_NAME                  = 1 <<  1,
+        STUDY_LOCATION              = 1 <<  2,
+        TYPE                        = 1 <<  3,
+        STATUS                      = 1 <<  4,
+        VISIBILITY                  = 1 <<  5,
+        OWNER_IDENTIFIER            = 1 <<  6,
+        OWNER_NAME                  = 1 <<  7,
+        TABLE_LOCATION              = 1 <<  8,
+        MODEL_LOCATION              = 1 <<  9,
+        PANEL_LOCATION              = 1 << 10,
+        ROSTER_LOCATION             = 1 << 11,
+        NAME_CONTROL_LOCATION       = 1 << 12,
+        STATUS_CONTROL_LOCATION     = 1 << 13,
+        VISIBILITY_CONTROL_LOCATION = 1 << 14,
+        BLOCK_COUNT                 = 1 << 15,
+        CELL_COUNT                  = 1 << 16,
+        PROSPECT_COUNT              = 1 << 17,
+        CREATION_TIME               = 1 << 18,
+        LATEST_BLOCK_TIME           = 1 << 19,
+        LATEST_PROSPECT_TIME        = 1 << 20
+    };
+
 private:
 
-    std::string studyIdentifier;
+    Identifier  studyIdentifier;
     std::string studyName      ;
     std::string studyLocation  ;
 
@@ -110,7 +142,7 @@ private:
     Status     status     ;
     Visibility visibility ;
 
-    std::string ownerIdentifier;
+    Identifier  ownerIdentifier;
     std::string ownerName      ;
 
     std::string tableLocation  ;
@@ -132,6 +164,8 @@ private:
     std::string latestBlockTime   ;
     std::string latestProspectTime;
 
+    uint64_t fingerprint;           // kept up to date by the setters
+
 public:
 
     // Constructors
@@ -217,6 +251,28 @@ public:
      */
     bool operator!=(const Study &rhs) const;
 
+    /**
+     * Return the attributes which differ between this study and another.
+     *
+     * @param  rhs  the study to compare with.
+     *
+     * @return the <code>Field</code> bits of the attributes which differ;
+     *              zero if and only if the studies are equal.
+     */
+    unsigned getChangedFields(const Study &rhs) const;
+
+    /**
+     * Return a 64-bit fingerprint of the attributes of the study.  Equal
+     * studies have equal fingerprints, so the equality operator compares
+     * fingerprints first, and studies with equal fingerprints are almost
+     * always equal, so a fingerprint may serve as a key for a cache or for
+     * finding duplicates.  The setters keep the fingerprint up to date, so
+     * getting it costs nothing.
+     *
+     * @return the fingerprint.
+     */
+    uint64_t getFingerprint() const;
+
 
     /**
      * Initialize the data members of a study.
@@ -250,6 +306,21 @@ public:
      */
     std::string getStudyIdentifier() const;
 
+    /**
+     * Set the study identifier.
+     *
+     * @param  id  the interned identifier to assign to this study.
+     */
+    void setStudyIdentifier(const Identifier &id);
+
+    /**
+     * Return the study identifier, interned.  Comparing these is cheaper than
+     * comparing the strings returned by <code>getStudyIdentifier()</code>.
+     *
+     * @return the interned identifier of this study.
+     */
+    const Identifier &getStudyIdentifierHandle() const;
+
     /**
      * Set the study name.
      *
@@ -334,6 +405,20 @@ public:
      */
     std::string getOwnerIdentifier() const;
 
+    /**
+     * Set the owner identifier.
+     *
+     * @param  id  the interned identifier of the owner of this study.
+     */
+    void setOwnerIdentifier(const Identifier &id);
+
+    /**
+     * Return the owner identifier, interned.
+     *
+     * @return the interned identifier of the owner of this study.
+     */
+    const Identifier &getOwnerIdentifierHandle() const;
+
     /**
      * Set the owner name.
      *
@@ -549,6 +634,21 @@ public:
      */
     std::string getLatestProspectTime() const;
 
+    /**
+     * Set the panel attributes of the study (the control locations, counts,
+     * and times) from a panel.
+     *
+     * @param  panel  the panel of this study.
+     */
+    void setPanel(const Panel &panel);
+
+    /**
+     * Return the panel attributes of the study as a panel.
+     *
+     * @return the panel of this study.
+     */
+    Panel getPanel() const;
+
     // Utility
 
     /**
@@ -558,6 +658,12 @@ public:
      */
     std::string toString();
 
+private:
+
+    // Make the fingerprint from all the attributes
+
+    uint64_t computeFingerprint() const;
+
 };  // end class Study
 
 }   // end namespace Yosokumo
@@ -0,0 +1,686 @@
+// TableImporter.cpp
+
+#include "TableImporter.h"
+#include "Cell.h"
+#include "IntegerValue.h"
+#include "NaturalValue.h"
+#include "RealValue.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <sstream>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace Yosokumo;
+
+namespace
+{
+
+// The number of chunks parsed per worker before their blocks are handed to
+// the sink:  enough that a slow chunk does not leave the other workers
+// idle, few enough to bound the specimens held in memory
+
+const size_t CHUNKS_PER_WORKER = 4;
+
+// Finds the delimiters and line ends of a stretch of text.  The text is
+// scanned 64 bytes at a time into a bit mask of the positions of the
+// separators, and next() takes the positions from the mask one by one, so
+// the common case is a count of trailing zeros, not a loop over bytes.
+
+class Scanner
+{
+    const char *begin;
+    size_t     size;
+    size_t     base;                // Offset of the 64 bytes in mask
+    uint64_t   mask;                // Separators not yet returned
+    char       delimiter;
+
+public:
+
+    Scanner(const char *begin, const char *end, char delimiter) :
+        begin(begin), size(end - begin), base(0), delimiter(delimiter)
+    {
+        mask = scan(0);
+    }
+
+    // Return the next delimiter or line end, or the end of the text
+
+    const char *next()
+    {
+        while (mask == 0)
+        {
+            base += 64;
+            if (base >= size)
+                return begin + size;
+            mask = scan(base);
+        }
+
+        const char *p = begin + base + __builtin_ctzll(mask);
+        mask &= mask - 1;
+        return p;
+    }
+
+private:
+
+    uint64_t scan(size_t offset) const
+    {
+        const char *p = begin + offset;
+        size_t     n  = size - offset;
+        uint64_t   m  = 0;
+
+#ifdef __SSE2__
+        if (n >= 64)
+        {
+            __m128i d  = _mm_set1_epi8(delimiter);
+            __m128i nl = _mm_set1_epi8('\n');
+
+            for (int i = 0;  i < 4;  ++i)
+            {
+                __m128i v   = _mm_loadu_si128((const __m128i *)(p + 16 * i));
+                __m128i hit = _mm_or_si128(_mm_cmpeq_epi8(v, d),
+                                                    _mm_cmpeq_epi8(v, nl));
+                m |= uint64_t(uint32_t(_mm_movemask_epi8(hit))) << (16 * i);
+            }
+            return m;
+        }
+#endif
+
+        if (n > 64)
+            n = 64;
+        for (size_t i = 0;  i < n;  ++i)
+            if (p[i] == delimiter || p[i] == '\n')
+                m |= uint64_t(1) << i;
+
+        return m;
+    }
+};
+
+// Powers of ten which are exact in a double
+
+const double POWERS_OF_TEN[] =
+{
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+const int      MAX_EXACT_POWER  = 22;
+const uint64_t MAX_EXACT_DOUBLE = uint64_t(1) << 53;
+
+bool isDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+// Parse an unsigned decimal number which must fill [p, end)
+
+bool parseDigits(const char *p, const char *end, uint64_t &n)
+{
+    if (p == end)
+        return false;
+
+    n = 0;
+    for (;  p < end;  ++p)
+    {
+        if (!isDigit(*p))
+            return false;
+
+        uint64_t d = uint64_t(*p - '0');
+        if (n > (~uint64_t(0) - d) / 10)
+            return false;
+        n = n * 10 + d;
+    }
+
+    return true;
+}
+
+// Parse a real number.  A plain decimal (an optional sign, at most 19
+// digits, an optional fraction, no exponent) whose digits fit in a double
+// is one exact division, so it rounds as strtod() would; anything else is
+// left to strtod().
+
+bool parseReal(const char *p, const char *end, double &x)
+{
+    const char *q = p;
+    bool negative = false;
+    if (q < end && (*q == '-' || *q == '+'))
+        negative = (*q++ == '-');
+
+    uint64_t mantissa = 0;
+    int      digits   = 0;
+    int      scale    = 0;
+
+    for (;  q < end && isDigit(*q);  ++q, ++digits)
+        mantissa = mantissa * 10 + uint64_t(*q - '0');
+
+    if (q < end && *q == '.')
+        for (++q;  q < end && isDigit(*q);  ++q, ++digits, ++scale)
+            mantissa = mantissa * 10 + uint64_t(*q - '0');
+
+    if (q == end && digits > 0 && digits <= 19 &&
+                    mantissa <= MAX_EXACT_DOUBLE && scale <= MAX_EXACT_POWER)
+    {
+        x = double(mantissa) / POWERS_OF_TEN[scale];
+        if (negative)
+            x = -x;
+        return true;
+    }
+
+    char buffer[64];
+    size_t n = size_t(end - p);
+    if (n == 0 || n >= sizeof(buffer))
+        return false;
+
+    memcpy(buffer, p, n);
+    buffer[n] = '\0';
+
+    char *stop;
+    x = strtod(buffer, &stop);
+
+    return stop == buffer + n;
+}
+
+}   // end anonymous namespace
+
+//*******************************   ImportSink   **************************
+
+ImportSink::~ImportSink()
+{}
+
+//*****************************   TableImporter   *************************
+
+class TableImporter::ParseTask : public IndexedTask
+{
+    const TableImporter &importer;
+    std::vector<Chunk>  &chunks;
+
+public:
+
+    ParseTask(const TableImporter &importer, std::vector<Chunk> &chunks) :
+        importer(importer), chunks(chunks)
+    {}
+
+    void runItem(unsigned, size_t i)
+    {
+        importer.parseChunk(chunks[i]);
+    }
+};
+
+TableImporter::TableImporter(WorkStealingPool &pool, char delimiter) :
+    pool         (pool),
+    delimiter    (delimiter),
+    headerLines  (0),
+    hasKeyColumn (false),
+    maxSpecimens (DEFAULT_MAX_SPECIMENS),
+    maxBytes     (DEFAULT_MAX_BYTES),
+    chunkBytes   (DEFAULT_CHUNK_BYTES),
+    specimenCount(0)
+{}
+
+void TableImporter::setDelimiter(char delimiter)
+{
+    this->delimiter = delimiter;
+}
+
+void TableImporter::setHeaderLines(unsigned n)
+{
+    headerLines = n;
+}
+
+void TableImporter::mapColumn(
+    unsigned    column,
+    Role        role,
+    Value::Type type,
+    uint64_t    predictorKey)
+{
+    if (column >= columns.size())
+    {
+        Column skip = { SKIP, Value::EMPTY, 0 };
+        columns.resize(column + 1, skip);
+    }
+
+    Column &c = columns[column];
+    c.role         = role;
+    c.type         = type;
+    c.predictorKey = predictorKey;
+
+    hasKeyColumn = false;
+    for (size_t i = 0;  i < columns.size();  ++i)
+        if (columns[i].role == SPECIMEN_KEY)
+            hasKeyColumn = true;
+}
+
+void TableImporter::setBlockLimits(unsigned maxSpecimens, size_t maxBytes)
+{
+    this->maxSpecimens = (maxSpecimens < 1) ? 1 : maxSpecimens;
+    this->maxBytes     = maxBytes;
+}
+
+void TableImporter::setChunkBytes(size_t n)
+{
+    chunkBytes = (n < 1) ? 1 : n;
+}
+
+bool TableImporter::importFile(
+    const std::string &path,
+    const std::string &studyIdentifier,
+    ImportSink        &sink)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        specimenCount = 0;
+        exception = ServiceException("Cannot open " + path + ": " +
+                                                strerror(errno), "importFile");
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        int error = errno;
+        ::close(fd);
+        specimenCount = 0;
+        exception = ServiceException("Cannot stat " + path + ": " +
+                                                strerror(error), "importFile");
+        return false;
+    }
+
+    if (st.st_size == 0)
+    {
+        ::close(fd);
+        return importText("", 0, studyIdentifier, sink);
+    }
+
+    size_t size = size_t(st.st_size);
+    void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    int error = errno;
+    ::close(fd);
+
+    if (map == MAP_FAILED)
+    {
+        specimenCount = 0;
+        exception = ServiceException("Cannot map " + path + ": " +
+                                                strerror(error), "importFile");
+        return false;
+    }
+
+    madvise(map, size, MADV_SEQUENTIAL);
+
+    bool ok = importText((const char *)map, size, studyIdentifier, sink);
+
+    munmap(map, size);
+    return ok;
+}
+
+bool TableImporter::importText(
+    const char        *text,
+    size_t            size,
+    const std::string &studyIdentifier,
+    ImportSink        &sink)
+{
+    specimenCount = 0;
+    exception     = ServiceException();
+
+    const char *p   = text;
+    const char *end = text + size;
+    uint64_t   line = 1;                    // The line at p
+
+    for (unsigned i = 0;  i < headerLines && p < end;  ++i, ++line)
+    {
+        const char *nl = (const char *)memchr(p, '\n', end - p);
+        p = (nl == NULL) ? end : nl + 1;
+    }
+
+    // The pending block may hold specimens of several rounds, so a round
+    // is kept until its specimens have all been handed to the sink
+
+    std::deque<Round *> live;
+    SpecimenBlock *block           = NULL;
+    size_t        blockBytes       = 0;
+    uint64_t      blockFirstRound  = 0;
+    uint64_t      roundNumber      = 0;
+    bool          ok               = true;
+
+    size_t chunksPerRound = pool.size() * CHUNKS_PER_WORKER;
+
+    while (ok && p < end)
+    {
+        Round *round = new Round;
+        round->number = roundNumber++;
+        live.push_back(round);
+
+        // Cut the chunks just after a line end
+
+        while (round->chunks.size() < chunksPerRound && p < end)
+        {
+            const char *e = end;
+            if (size_t(end - p) > chunkBytes)
+            {
+                const char *nl = (const char *)memchr(p + chunkBytes - 1,
+                                        '\n', end - (p + chunkBytes - 1));
+                e = (nl == NULL) ? end : nl + 1;
+            }
+
+            round->chunks.push_back(Chunk());
+            round->chunks.back().begin = p;
+            round->chunks.back().end   = e;
+            p = e;
+        }
+
+        ParseTask task(*this, round->chunks);
+        pool.forEach(round->chunks.size(), task);
+
+        ok = emitRound(*round, studyIdentifier, sink, block, blockBytes,
+                                                    blockFirstRound, line);
+
+        while (!live.empty() &&
+                (block == NULL || live.front()->number < blockFirstRound))
+        {
+            delete live.front();
+            live.pop_front();
+        }
+    }
+
+    // After a bad line, the specimens before it still go to the sink
+
+    if (block != NULL && !sink.blockReady(*block) && ok)
+    {
+        exception = ServiceException("Import stopped by sink", "importText");
+        ok = false;
+    }
+
+    delete block;
+
+    while (!live.empty())
+    {
+        delete live.front();
+        live.pop_front();
+    }
+
+    return ok;
+}
+
+uint64_t TableImporter::getSpecimenCount() const
+{
+    return specimenCount;
+}
+
+ServiceException TableImporter::getException() const
+{
+    return exception;
+}
+
+size_t TableImporter::estimateBytes(const Specimen &specimen)
+{
+    // Key, predictand, weight, and framing; then key, value, and framing
+    // for each cell
+
+    return 24 + 16 * size_t(specimen.size());
+}
+
+// Parse the lines of a chunk into specimens.  Runs on a worker of the pool,
+// so touches nothing but the chunk.
+
+void TableImporter::parseChunk(Chunk &chunk) const
+{
+    Scanner scanner(chunk.begin, chunk.end, delimiter);
+
+    const char *p       = chunk.begin;
+    Specimen   *s       = NULL;         // NULL means at the start of a line
+    std::vector<Cell> cells;            // The cells of the line so far
+    unsigned   column   = 0;
+    bool       keySeen  = false;
+    Value      v;
+    uint64_t   n;
+
+    chunk.lines = 0;
+
+    while (p < chunk.end)
+    {
+        const char *sep       = scanner.next();
+        bool       endOfLine  = (sep == chunk.end || *sep == '\n');
+        const char *fieldEnd  = sep;
+
+        if (endOfLine && fieldEnd > p && fieldEnd[-1] == '\r')
+            --fieldEnd;
+
+        const char *nextField = (sep == chunk.end) ? sep : sep + 1;
+
+        if (s == NULL)
+        {
+            if (endOfLine && fieldEnd == p)
+            {
+                ++chunk.lines;              // An empty line
+                p = nextField;
+                continue;
+            }
+
+            chunk.specimens.push_back(Specimen());
+            s       = &chunk.specimens.back();
+            column  = 0;
+            keySeen = false;
+            cells.clear();
+        }
+
+        if (column < columns.size() && columns[column].role != SKIP)
+        {
+            const Column &c     = columns[column];
+            const char   *error = NULL;
+
+            switch (c.role)
+            {
+            case SPECIMEN_KEY:
+                if (!parseDigits(p, fieldEnd, n))
+                    error = "bad specimen key";
+                else
+                {
+                    s->setSpecimenKey(n);
+                    keySeen = true;
+                }
+                break;
+
+            case WEIGHT:
+                if (p == fieldEnd)
+                    break;
+                if (!parseDigits(p, fieldEnd, n))
+                    error = "bad weight";
+                else
+                    s->setWeight(n);
+                break;
+
+            case PREDICTAND:
+                if (!parseValue(p, fieldEnd, c.type, v))
+                    error = "bad predictand";
+                else
+                    s->setPredictand(v);
+                break;
+
+            case PREDICTOR:
+                if (!parseValue(p, fieldEnd, c.type, v))
+                    error = "bad predictor";
+                else if (v.getType() != Value::EMPTY)
+                    cells.push_back(Cell(c.predictorKey, v));
+                break;
+
+            case SKIP:
+                break;
+            }
+
+            if (error != NULL)
+            {
+                std::stringstream text;
+                text << error << " in column " << column + 1;
+                chunk.error = text.str();
+                chunk.specimens.pop_back();
+                return;
+            }
+        }
+
+        if (endOfLine && hasKeyColumn && !keySeen)
+        {
+            chunk.error = "no specimen key";
+            chunk.specimens.pop_back();
+            return;
+        }
+
+        ++column;
+        p = nextField;
+
+        // The cells go in at once, so the specimen allocates them once
+
+        if (endOfLine)
+        {
+            s->addCells(cells.begin(), cells.end());
+            ++chunk.lines;
+            s = NULL;
+        }
+    }
+}
+
+// Parse a field into a value of a type.  An empty field (or one of only
+// blanks) is an empty value.
+
+bool TableImporter::parseValue(
+    const char  *begin,
+    const char  *end,
+    Value::Type type,
+    Value       &value) const
+{
+    while (begin < end && (*begin == ' ' || *begin == '\t'))
+        ++begin;
+    while (end > begin && (end[-1] == ' ' || end[-1] == '\t'))
+        --end;
+
+    if (begin == end)
+    {
+        value = Value();
+        return true;
+    }
+
+    uint64_t n;
+    double   x;
+
+    switch (type)
+    {
+    case Value::NATURAL:
+        if (*begin == '+')
+            ++begin;
+        if (!parseDigits(begin, end, n))
+            return false;
+        value = NaturalValue(n);
+        return true;
+
+    case Value::INTEGER:
+    {
+        bool negative = (*begin == '-');
+        if (*begin == '-' || *begin == '+')
+            ++begin;
+        if (!parseDigits(begin, end, n))
+            return false;
+
+        uint64_t limit = uint64_t(1) << 63;
+        if (negative ? n > limit : n >= limit)
+            return false;
+        value = IntegerValue(negative ? int64_t(0 - n) : int64_t(n));
+        return true;
+    }
+
+    case Value::REAL:
+        if (!parseReal(begin, end, x))
+            return false;
+        value = RealValue(x);
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+// Hand the specimens of a round to the sink, in blocks.  firstLine is the
+// number of the first line of the round; it is advanced past the round.
+
+bool TableImporter::emitRound(
+    Round             &round,
+    const std::string &studyIdentifier,
+    ImportSink        &sink,
+    SpecimenBlock     *&block,
+    size_t            &blockBytes,
+    uint64_t          &blockFirstRound,
+    uint64_t          &firstLine)
+{
+    for (size_t i = 0;  i < round.chunks.size();  ++i)
+    {
+        Chunk &chunk = round.chunks[i];
+
+        for (size_t j = 0;  j < chunk.specimens.size();  ++j)
+        {
+            Specimen &s = chunk.specimens[j];
+            if (!hasKeyColumn)
+                s.setSpecimenKey(specimenCount + 1);
+
+            size_t bytes = estimateBytes(s);
+
+            // Hand over the block first if the specimen would overfill it
+
+            if (block != NULL && blockBytes + bytes > maxBytes)
+            {
+                bool more = sink.blockReady(*block);
+                delete block;
+                block = NULL;
+                if (!more)
+                {
+                    exception = ServiceException("Import stopped by sink",
+                                                                "importText");
+                    return false;
+                }
+            }
+
+            if (block == NULL)
+            {
+                block           = new SpecimenBlock(studyIdentifier);
+                blockBytes      = 0;
+                blockFirstRound = round.number;
+            }
+
+            block->addSpecimen(&s);
+            blockBytes += bytes;
+            ++specimenCount;
+
+            if (block->size() >= maxSpecimens || blockBytes >= maxBytes)
+            {
+                bool more = sink.blockReady(*block);
+                delete block;
+                block = NULL;
+                if (!more)
+                {
+                    exception = ServiceException("Import stopped by sink",
+                                                                "importText");
+                    return false;
+                }
+            }
+        }
+
+        if (!chunk.error.empty())
+        {
+            std::stringstream text;
+            text << "Line " << firstLine + chunk.lines << ": " << chunk.error;
+            exception = ServiceException(text.str(), "importText");
+            return false;
+        }
+
+        firstLine += chunk.lines;
+    }
+
+    return true;
+}
+
+// end TableImporter.cpp
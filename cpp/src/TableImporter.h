@@ -0,0 +1,280 @@
+// TableImporter.h
+
+#ifndef TABLEIMPORTER_H
+#define TABLEIMPORTER_H
+
+#include "ServiceException.h"
+#include "Specimen.h"
+#include "SpecimenBlock.h"
+#include "Value.h"
+#include "WorkStealingPool.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace Yosokumo
+{
+
+/**
+ * Receives the blocks made by a <code>TableImporter</code>, in the order of
+ * the rows of the table.
+ */
+class ImportSink
+{
+public:
+
+    virtual ~ImportSink();
+
+    /**
+     * Called with each block of specimens, e.g., to post it.  The block and
+     * its specimens are only valid during the call.
+     *
+     * @param  block  the block.
+     *
+     * @return <code>true</code> to go on importing.
+     *         <code>false</code> to stop the import.
+     */
+    virtual bool blockReady(SpecimenBlock &block) = 0;
+
+};  // end class ImportSink
+
+
+/**
+ * Reads a table of specimens from a delimited text file (CSV, TSV, and the
+ * like), one specimen per line, and makes it into specimen blocks ready to
+ * post.  For example:
+ * <pre>
+ *    WorkStealingPool pool;
+ *    TableImporter importer(pool, ',');
+ *    importer.setHeaderLines(1);
+ *    importer.mapColumn(0, TableImporter::SPECIMEN_KEY);
+ *    importer.mapColumn(1, TableImporter::PREDICTAND, Value::REAL);
+ *    importer.mapColumn(2, TableImporter::PREDICTOR,  Value::NATURAL, 7);
+ *    if (!importer.importFile("train.csv", study.getStudyIdentifier(), sink))
+ *        ...
+ * </pre>
+ * The file is mapped into memory and cut into chunks at line boundaries,
+ * and the chunks are parsed in parallel on the workers of the pool.  The
+ * delimiters and line ends are found 64 bytes at a time with SSE2
+ * instructions (a byte at a time where SSE2 is missing), and numbers are
+ * converted by hand, without <code>strtod()</code> for the common forms
+ * of real number.  The rows are parsed a few chunks per worker at a time,
+ * so a table of any size takes a bounded amount of memory.
+ * <p>
+ * Fields are not quoted:  a quote is an ordinary character.  A line may
+ * end in CR LF.  Empty lines are skipped.  An empty field gives no cell
+ * (for a predictor) or an empty predictand.  Columns not mapped, and
+ * columns beyond the last mapped one, are ignored.  Without a
+ * <code>SPECIMEN_KEY</code> column, the specimens are numbered from 1 in
+ * row order.
+ * <p>
+ * A block is handed to the sink when it holds <code>maxSpecimens</code>
+ * specimens, or when their estimated encoded size reaches
+ * <code>maxBytes</code>, whichever comes first.
+ */
+class TableImporter
+{
+public:
+
+    /**
+     * What a column of the table holds.
+     */
+    enum Role
+    {
+        SKIP,               // Nothing:  the column is ignored
+        SPECIMEN_KEY,       // The key of the specimen, a natural number
+        PREDICTAND,         // The predictand of the specimen
+        WEIGHT,             // The weight of the specimen, a natural number
+        PREDICTOR           // A cell of the specimen
+    };
+
+    /**
+     * Default limits on a block.
+     */
+    enum { DEFAULT_MAX_SPECIMENS = 10000 };
+    enum { DEFAULT_MAX_BYTES     = 1 << 20 };
+
+    /**
+     * Default size of the chunks of text parsed in parallel.
+     */
+    enum { DEFAULT_CHUNK_BYTES   = 1 << 20 };
+
+private:
+
+    struct Column
+    {
+        Role        role;
+        Value::Type type;
+        uint64_t    predictorKey;
+    };
+
+    // The specimens parsed from one chunk of text
+
+    struct Chunk
+    {
+        const char            *begin;
+        const char            *end;
+        std::deque<Specimen>  specimens;        // Not moved as it grows
+        uint64_t              lines;            // Counted through any error
+        std::string           error;            // Empty means none
+    };
+
+    struct Round
+    {
+        uint64_t           number;
+        std::vector<Chunk> chunks;
+    };
+
+    class ParseTask;
+    friend class ParseTask;
+
+    WorkStealingPool    &pool;
+    char                delimiter;
+    unsigned            headerLines;
+    std::vector<Column> columns;
+    bool                hasKeyColumn;
+    unsigned            maxSpecimens;
+    size_t              maxBytes;
+    size_t              chunkBytes;
+
+    uint64_t            specimenCount;
+    ServiceException    exception;
+
+public:
+
+    /**
+     * Initializes a newly created <code>TableImporter</code> with no
+     * columns mapped.
+     *
+     * @param  pool  the pool on which to parse.  Not owned by the importer.
+     * @param  delimiter  the character between fields, e.g.,
+     *             <code>','</code> or <code>'\t'</code>.
+     */
+    TableImporter(WorkStealingPool &pool, char delimiter = ',');
+
+    /**
+     * Set the character between fields.
+     */
+    void setDelimiter(char delimiter);
+
+    /**
+     * Set the number of lines at the start of the file to skip, e.g., 1 for
+     * a line of column names.  The default is 0.
+     */
+    void setHeaderLines(unsigned n);
+
+    /**
+     * Say what a column of the table holds.
+     *
+     * @param  column  the number of the column, from 0.
+     * @param  role  what the column holds.
+     * @param  type  for a <code>PREDICTAND</code> or <code>PREDICTOR</code>
+     *             column, the type of its values:
+     *             <code>Value::NATURAL</code>, <code>Value::INTEGER</code>,
+     *             or <code>Value::REAL</code>.
+     * @param  predictorKey  for a <code>PREDICTOR</code> column, the key of
+     *             its cells.
+     */
+    void mapColumn(
+        unsigned    column,
+        Role        role,
+        Value::Type type         = Value::REAL,
+        uint64_t    predictorKey = 0);
+
+    /**
+     * Set the limits on a block.
+     *
+     * @param  maxSpecimens  the most specimens in a block.
+     * @param  maxBytes  the most estimated encoded bytes in a block.  A
+     *             single specimen bigger than this goes in a block alone.
+     */
+    void setBlockLimits(unsigned maxSpecimens, size_t maxBytes);
+
+    /**
+     * Set the size of the chunks of text parsed in parallel.
+     */
+    void setChunkBytes(size_t n);
+
+    /**
+     * Import a table from a file.
+     *
+     * @param  path  the path of the file.
+     * @param  studyIdentifier  the study identifier of the blocks.
+     * @param  sink  receives the blocks.
+     *
+     * @return <code>true</code> means the whole table was imported.
+     *         <code>false</code> means the file could not be read, a line
+     *             could not be parsed, or the sink stopped the import;
+     *             <code>getException()</code> tells which.  The specimens
+     *             before the failure have been handed to the sink.
+     */
+    bool importFile(
+        const std::string &path,
+        const std::string &studyIdentifier,
+        ImportSink        &sink);
+
+    /**
+     * Import a table from memory.  As above, except the table is given as
+     * text.
+     */
+    bool importText(
+        const char        *text,
+        size_t            size,
+        const std::string &studyIdentifier,
+        ImportSink        &sink);
+
+    /**
+     * Return the number of specimens imported by the last import.
+     */
+    uint64_t getSpecimenCount() const;
+
+    /**
+     * Return the reason the last import failed.
+     */
+    ServiceException getException() const;
+
+    /**
+     * Return the estimated encoded size of a specimen, in bytes, as charged
+     * against the block limit.
+     */
+    static size_t estimateBytes(const Specimen &specimen);
+
+private:
+
+    void parseChunk(Chunk &chunk) const;
+
+    bool parseValue(
+        const char  *begin,
+        const char  *end,
+        Value::Type type,
+        Value       &value) const;
+
+    bool emitRound(
+        Round                       &round,
+        const std::string           &studyIdentifier,
+        ImportSink                  &sink,
+        SpecimenBlock               *&block,
+        size_t                      &blockBytes,
+        uint64_t                    &blockFirstRound,
+        uint64_t                    &firstLine);
+
+    /**
+     * Copy constructor - NOT IMPLEMENTED.
+     */
+    TableImporter(const TableImporter &rhs);
+
+    /**
+     * Assignment operator - NOT IMPLEMENTED.
+     */
+    TableImporter& operator=(const TableImporter& rhs);
+
+};  // end class TableImporter
+
+}   // end namespace Yosokumo
+
+#endif  // TABLEIMPORTER_H
+
+// end TableImporter.h
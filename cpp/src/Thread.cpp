@@ -0,0 +1,53 @@
+// Thread.cpp
+
+#include "Thread.h"
+
+#include <time.h>
+
+using namespace Yosokumo;
+
+Thread::Thread() : started(false)
+{}
+
+Thread::~Thread()
+{}
+
+bool Thread::start()
+{
+    if (started)
+        return false;
+
+    started = (pthread_create(&thread, NULL, threadMain, this) == 0);
+
+    return started;
+}
+
+void Thread::join()
+{
+    if (!started)
+        return;
+
+    pthread_join(thread, NULL);
+    started = false;
+}
+
+bool Thread::isStarted() const
+{
+    return started;
+}
+
+uint64_t Thread::currentTimeMillis()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return uint64_t(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
+
+void *Thread::threadMain(void *arg)
+{
+    Thread *t = static_cast<Thread *>(arg);
+    t->run();
+    return NULL;
+}
+
+// end Thread.cpp
@@ -0,0 +1,105 @@
+// Thread.h
+
+#ifndef THREAD_H
+#define THREAD_H
+
+#include <pthread.h>
+#include <stdint.h>
+
+namespace Yosokumo
+{
+
+/**
+ * A base class for objects which do their work on a thread of their own.  
+ * A subclass implements <code>run()</code>; the owner calls 
+ * <code>start()</code> to launch a POSIX thread which calls 
+ * <code>run()</code>, and <code>join()</code> to wait for it to finish:
+ * <pre>
+ *   class Worker : public Thread
+ *   {
+ *   protected:
+ *       void run() { do the work }
+ *   };
+ *
+ *   Worker w;
+ *   w.start();
+ *   ...
+ *   w.join();
+ * </pre>
+ * A started thread must be joined before the <code>Thread</code> object is 
+ * destroyed.
+ */
+class Thread
+{
+    pthread_t thread;
+    bool      started;
+
+public:
+
+    /**
+     * Initializes a newly created <code>Thread</code> object.  No thread 
+     * is launched until <code>start()</code> is called.
+     */
+    Thread();
+
+    /**
+     * Destructor.
+     */
+    virtual ~Thread();
+
+    /**
+     * Launch a thread which calls <code>run()</code>.
+     *
+     * @return <code>true</code> means the thread was launched.
+     *         <code>false</code> means the thread could not be created.
+     */
+    bool start();
+
+    /**
+     * Wait for the thread launched by <code>start()</code> to finish.  Does 
+     * nothing if no thread is running.
+     */
+    void join();
+
+    /**
+     * Test if a thread has been started and not yet joined.
+     *
+     * @return <code>true</code> means a thread is running.
+     */
+    bool isStarted() const;
+
+    /**
+     * Return the current time in milliseconds, for measuring intervals.
+     *
+     * @return the number of milliseconds since an arbitrary fixed point.
+     */
+    static uint64_t currentTimeMillis();
+
+protected:
+
+    /**
+     * The work to do on the thread.  Implemented by subclasses.
+     */
+    virtual void run() = 0;
+
+private:
+
+    static void *threadMain(void *arg);
+
+    /**
+     * Copy constructor - NOT IMPLEMENTED.
+     */
+    Thread(const Thread &rhs);
+
+    /**
+     * Assignment operator - NOT IMPLEMENTED.
+     */
+    Thread& operator=(const Thread& rhs);
+
+};  // end class Thread
+
+}   // end namespace Yosokumo
+
+#endif  // THREAD_H
+
+// end Thread.h
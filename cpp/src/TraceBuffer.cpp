@@ -0,0 +1,290 @@
+// TraceBuffer.cpp
+
+#include "TraceBuffer.h"
+#include "Metrics.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+
+using namespace Yosokumo;
+
+// The ring of one thread.  Only the owning thread writes events and head;
+// the drainer reads them.  head counts every event ever written, so event i
+// is in events[i % capacity] until event i + capacity overwrites it.
+
+namespace
+{
+
+struct TraceRing
+{
+    TraceBuffer::Event *events;
+    uint64_t           capacity;
+    uint64_t           head;
+    uint64_t           drained;     // Events before this have been drained
+    uint32_t           number;
+    bool               inUse;       // Owned by a live thread
+    TraceRing          *next;
+};
+
+// All rings, for the drainer.  A ring is never freed:  when its thread ends
+// the ring is kept until drained and given to the next new thread.
+
+pthread_mutex_t ringsMutex = PTHREAD_MUTEX_INITIALIZER;
+TraceRing       *rings     = NULL;
+uint32_t        ringCount  = 0;
+unsigned        capacity   = TraceBuffer::DEFAULT_CAPACITY;
+
+// Only one drain at a time; guards TraceRing::drained and dropped
+
+pthread_mutex_t drainMutex = PTHREAD_MUTEX_INITIALIZER;
+uint64_t        dropped    = 0;
+
+pthread_once_t  keyOnce = PTHREAD_ONCE_INIT;
+pthread_key_t   ringKey;
+
+extern "C" void releaseRing(void *p)
+{
+    pthread_mutex_lock(&ringsMutex);
+    static_cast<TraceRing *>(p)->inUse = false;
+    pthread_mutex_unlock(&ringsMutex);
+}
+
+extern "C" void createRingKey()
+{
+    pthread_key_create(&ringKey, releaseRing);
+}
+
+TraceRing *getRing()
+{
+    pthread_once(&keyOnce, createRingKey);
+
+    TraceRing *ring = static_cast<TraceRing *>(pthread_getspecific(ringKey));
+    if (ring != NULL)
+        return ring;
+
+    pthread_mutex_lock(&ringsMutex);
+
+    for (ring = rings;  ring != NULL;  ring = ring->next)
+        if (!ring->inUse && ring->capacity == capacity)
+            break;
+
+    if (ring == NULL)
+    {
+        ring = new TraceRing;
+        ring->capacity = capacity;
+        ring->events   = new TraceBuffer::Event[capacity];
+        ring->head     = 0;
+        ring->drained  = 0;
+        ring->number   = ++ringCount;
+        ring->next     = rings;
+        rings          = ring;
+    }
+
+    ring->inUse = true;
+
+    pthread_mutex_unlock(&ringsMutex);
+
+    pthread_setspecific(ringKey, ring);
+    return ring;
+}
+
+bool earlier(const TraceBuffer::Event &a, const TraceBuffer::Event &b)
+{
+    return a.time < b.time;
+}
+
+const char * const eventTypeNames[TraceBuffer::NUM_EVENT_TYPES] =
+{
+    "REQUEST_START",
+    "REQUEST_HEADER",
+    "REQUEST_SIGNED",
+    "BYTES_SENT",
+    "RESPONSE_STATUS",
+    "RESPONSE_HEADER",
+    "BYTES_RECEIVED",
+    "REQUEST_END",
+    "REQUEST_FAILED"
+};
+
+}   // end anonymous namespace
+
+//*****************************   TraceBuffer   ***************************
+
+std::string TraceBuffer::Event::getText() const
+{
+    return std::string(text, textLength);
+}
+
+void TraceBuffer::record(
+    EventType  type,
+    uint64_t   value,
+    const char *text,
+    size_t     length)
+{
+    TraceRing *ring = getRing();
+
+    uint64_t h = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+    Event &e = ring->events[h % ring->capacity];
+
+    if (length > TEXT_SIZE)
+        length = TEXT_SIZE;
+
+    e.time       = Metrics::currentTimeMicros();
+    e.value      = value;
+    e.thread     = ring->number;
+    e.type       = uint16_t(type);
+    e.textLength = uint16_t(length);
+    memcpy(e.text, text, length);
+
+    __atomic_store_n(&ring->head, h + 1, __ATOMIC_RELEASE);
+}
+
+void TraceBuffer::record(
+    EventType         type,
+    uint64_t          value,
+    const std::string &text)
+{
+    record(type, value, text.data(), text.size());
+}
+
+void TraceBuffer::setCapacity(unsigned eventsPerThread)
+{
+    pthread_mutex_lock(&ringsMutex);
+    capacity = (eventsPerThread < 16) ? 16 : eventsPerThread;
+    pthread_mutex_unlock(&ringsMutex);
+}
+
+void TraceBuffer::drain(std::vector<Event> &events)
+{
+    pthread_mutex_lock(&drainMutex);
+
+    pthread_mutex_lock(&ringsMutex);
+    TraceRing *first = rings;
+    pthread_mutex_unlock(&ringsMutex);
+
+    size_t start = events.size();
+
+    // Rings are only ever added at the head of the list, so the list from
+    // first on does not change
+
+    for (TraceRing *ring = first;  ring != NULL;  ring = ring->next)
+    {
+        uint64_t cap = ring->capacity;
+        uint64_t h   = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+
+        uint64_t from = ring->drained;
+        if (h > cap && h - cap > from)
+            from = h - cap;
+
+        size_t copied = events.size();
+        for (uint64_t i = from;  i < h;  ++i)
+            events.push_back(ring->events[i % cap]);
+
+        // The owner may have overwritten some of the events while they were
+        // copied:  once it has started event h2, events up to h2 - cap may
+        // be torn, so they are thrown away
+
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        uint64_t h2 = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+
+        uint64_t firstGood = from;
+        if (h2 + 1 > cap && h2 + 1 - cap > firstGood)
+            firstGood = (h2 + 1 - cap < h) ? h2 + 1 - cap : h;
+
+        events.erase(events.begin() + copied,
+                     events.begin() + copied + size_t(firstGood - from));
+
+        dropped += firstGood - ring->drained;
+        ring->drained = h;
+    }
+
+    std::stable_sort(events.begin() + start, events.end(), earlier);
+
+    pthread_mutex_unlock(&drainMutex);
+}
+
+size_t TraceBuffer::dump(std::ostream &out)
+{
+    std::vector<Event> events;
+    drain(events);
+
+    for (size_t i = 0;  i < events.size();  ++i)
+        out << formatEvent(events[i]) << '\n';
+    out.flush();
+
+    return events.size();
+}
+
+uint64_t TraceBuffer::getDroppedCount()
+{
+    pthread_mutex_lock(&drainMutex);
+    uint64_t n = dropped;
+    pthread_mutex_unlock(&drainMutex);
+
+    return n;
+}
+
+std::string TraceBuffer::formatEvent(const Event &e)
+{
+    char head[96];
+    snprintf(head, sizeof(head), "%lu.%06lu t%u %s %lu",
+                (unsigned long)(e.time / 1000000),
+                (unsigned long)(e.time % 1000000),
+                (unsigned)e.thread,
+                getEventTypeName(EventType(e.type)).c_str(),
+                (unsigned long)e.value);
+
+    std::string line(head);
+    if (e.textLength > 0)
+        line += ' ' + e.getText();
+
+    return line;
+}
+
+std::string TraceBuffer::getEventTypeName(EventType type)
+{
+    return (type < NUM_EVENT_TYPES) ? eventTypeNames[type] : "UNKNOWN";
+}
+
+//*****************************   TraceDumper   ***************************
+
+TraceDumper::TraceDumper(std::ostream &out, unsigned interval) :
+    out(out), interval(interval < 1 ? 1 : interval), stopping(false)
+{}
+
+TraceDumper::~TraceDumper()
+{
+    stop();
+}
+
+void TraceDumper::stop()
+{
+    {
+        ScopedLock lock(mutex);
+        stopping = true;
+        changed.broadcast();
+    }
+
+    join();
+}
+
+void TraceDumper::run()
+{
+    mutex.lock();
+
+    while (!stopping)
+    {
+        changed.waitFor(mutex, interval);
+
+        mutex.unlock();
+        TraceBuffer::dump(out);
+        mutex.lock();
+    }
+
+    mutex.unlock();
+}
+
+// end TraceBuffer.cpp
@@ -0,0 +1,184 @@
+// TraceBuffer.h
+
+#ifndef TRACEBUFFER_H
+#define TRACEBUFFER_H
+
+#include "Condition.h"
+#include "Mutex.h"
+#include "Thread.h"
+
+#include <stdint.h>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace Yosokumo
+{
+
+/**
+ * Trace events kept in memory, in a fixed-size ring per thread.  Recording an
+ * event copies a few dozen bytes into the calling thread's ring and takes no
+ * lock, so tracing can be left on under load.  When a ring is full the
+ * oldest events are overwritten.
+ * <p>
+ * Events are taken out with <code>drain()</code> or <code>dump()</code>,
+ * either on demand or periodically by a <code>TraceDumper</code> thread.
+ * Events overwritten before they were drained are counted, not lost
+ * silently (see <code>getDroppedCount()</code>).
+ */
+class TraceBuffer
+{
+public:
+
+    enum EventType
+    {
+        REQUEST_START,      // text:  method and target
+        REQUEST_HEADER,     // text:  "name: value"
+        REQUEST_SIGNED,     // text:  the string signed; value:  its length
+        BYTES_SENT,         // value:  bytes; text:  empty
+        RESPONSE_STATUS,    // value:  status code
+        RESPONSE_HEADER,    // text:  "name: value"
+        BYTES_RECEIVED,     // value:  bytes
+        REQUEST_END,        // value:  microseconds; text:  operation name
+        REQUEST_FAILED,     // value:  status code; text:  the reason
+        NUM_EVENT_TYPES
+    };
+
+    enum { TEXT_SIZE = 40 };
+
+    /**
+     * One event.  Text longer than <code>TEXT_SIZE</code> is cut short.
+     */
+    struct Event
+    {
+        uint64_t time;              // Microseconds, monotonic
+        uint64_t value;
+        uint32_t thread;            // Small number identifying the ring
+        uint16_t type;              // An EventType
+        uint16_t textLength;
+        char     text[TEXT_SIZE];
+
+        std::string getText() const;
+    };
+
+    /**
+     * Default number of events in each thread's ring.
+     */
+    enum { DEFAULT_CAPACITY = 4096 };
+
+    /**
+     * Record an event in the calling thread's ring.
+     *
+     * @param  type  the kind of event.
+     * @param  value  a number whose meaning depends on the type.
+     * @param  text  the text of the event.
+     * @param  length  the length of the text.
+     */
+    static void record(
+        EventType  type,
+        uint64_t   value,
+        const char *text,
+        size_t     length);
+
+    /**
+     * Record an event in the calling thread's ring.
+     */
+    static void record(
+        EventType         type,
+        uint64_t          value,
+        const std::string &text = "");
+
+    /**
+     * Set the number of events in each ring.  This applies to threads which
+     * record their first event afterwards.
+     *
+     * @param  eventsPerThread  the capacity; values less than 16 are treated
+     *             as 16.
+     */
+    static void setCapacity(unsigned eventsPerThread);
+
+    /**
+     * Take out the events of all threads recorded since the last drain, in
+     * time order.
+     *
+     * @param  events  where to append the events.
+     */
+    static void drain(std::vector<Event> &events);
+
+    /**
+     * Drain the events and write them as text, one line per event.
+     *
+     * @param  out  where to write.
+     *
+     * @return the number of events written.
+     */
+    static size_t dump(std::ostream &out);
+
+    /**
+     * Return the number of events overwritten before they were drained.
+     */
+    static uint64_t getDroppedCount();
+
+    /**
+     * Return an event as one line of text (without a newline), e.g.,
+     * <pre>
+     *    12.345678 t1 REQUEST_END 1234 getFromServer
+     * </pre>
+     */
+    static std::string formatEvent(const Event &e);
+
+    /**
+     * Return the name of an event type, e.g., "REQUEST_START".
+     */
+    static std::string getEventTypeName(EventType type);
+
+};  // end class TraceBuffer
+
+
+/**
+ * A thread which dumps trace events every so often, so that the rings do
+ * not overflow.  The events left are dumped when the dumper is stopped or
+ * destroyed.
+ */
+class TraceDumper : public Thread
+{
+private:
+    std::ostream &out;
+    unsigned     interval;          // Milliseconds
+
+    Mutex        mutex;             // Guards stopping
+    Condition    changed;
+    bool         stopping;
+
+public:
+    /**
+     * Initializes a newly created <code>TraceDumper</code>.  Call
+     * <code>start()</code> to start it.
+     *
+     * @param  out  where to write the events.  It is written only by the
+     *             dumper thread while the dumper runs.
+     * @param  interval  the time (in milliseconds) between dumps.
+     */
+    TraceDumper(std::ostream &out, unsigned interval = 1000);
+
+    /**
+     * Destructor - stops the dumper.
+     */
+    virtual ~TraceDumper();
+
+    /**
+     * Stop the dumper after one last dump, and wait for it to end.
+     */
+    void stop();
+
+protected:
+
+    void run();
+
+};  // end class TraceDumper
+
+}   // end namespace Yosokumo
+
+#endif  // TRACEBUFFER_H
+
+// end TraceBuffer.h
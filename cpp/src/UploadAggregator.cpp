@@ -0,0 +1,421 @@
+// UploadAggregator.cpp
+
+#include "UploadAggregator.h"
+#include "SpecimenBlock.h"
+#include "Thread.h"
+
+#include <sched.h>
+
+using namespace Yosokumo;
+
+class UploadAggregator::Flusher : public Thread
+{
+    UploadAggregator &aggregator;
+
+public:
+
+    Flusher(UploadAggregator &aggregator) : aggregator(aggregator)
+    {}
+
+protected:
+
+    void run()
+    {
+        aggregator.runFlusher();
+    }
+};
+
+UploadAggregator::UploadAggregator(
+    const Credentials &credentials,
+    const std::string &hostName,
+    int               port,
+    unsigned          maxBlockSpecimens,
+    size_t            maxBlockBytes,
+    unsigned          maxDelay,
+    uint64_t          memoryBudget,
+    unsigned          maxConnections) :
+        maxBlockSpecimens(maxBlockSpecimens < 1 ? 1 : maxBlockSpecimens),
+        maxBlockBytes    (maxBlockBytes),
+        maxDelay         (maxDelay),
+        memoryBudget     (memoryBudget),
+        pushed           (0),
+        pendingBytes     (0),
+        waiters          (0),
+        sleeping         (false),
+        stopping         (false),
+        postedCount      (0),
+        failedCount      (0),
+        service          (credentials, hostName, port),
+        popped           (0),
+        flushRequested   (0),
+        flushCompleted   (0)
+{
+    service.setMaxConnections(maxConnections);
+
+    flusher = new Flusher(*this);
+    if (!flusher->start())
+    {
+        delete flusher;
+        flusher = NULL;
+    }
+}
+
+UploadAggregator::~UploadAggregator()
+{
+    {
+        ScopedLock lock(mutex);
+        __atomic_store_n(&stopping, true, __ATOMIC_SEQ_CST);
+        changed.signal();
+        room.broadcast();
+    }
+
+    if (flusher != NULL)
+    {
+        flusher->join();
+        delete flusher;
+    }
+
+    // Only if the thread never started is anything left
+
+    Item *item;
+    while (queue.pop(item))
+        delete item;
+}
+
+bool UploadAggregator::add(const Study &study, const Specimen &specimen)
+{
+    return add(study.getStudyIdentifier(), study.getTableLocation(),
+                                                                specimen);
+}
+
+bool UploadAggregator::add(
+    const std::string &studyIdentifier,
+    const std::string &tableLocation,
+    const Specimen    &specimen)
+{
+    if (flusher == NULL || __atomic_load_n(&stopping, __ATOMIC_ACQUIRE))
+        return false;
+
+    size_t bytes = estimateBytes(specimen);
+    if (!reserve(bytes))
+        return false;
+
+    Item *item = new Item;
+    item->studyIdentifier = studyIdentifier;
+    item->tableLocation   = tableLocation;
+    item->specimen        = specimen;
+    item->bytes           = bytes;
+    item->queuedAt        = Thread::currentTimeMillis();
+
+    queue.push(item);
+    __atomic_add_fetch(&pushed, 1, __ATOMIC_SEQ_CST);
+
+    // Only the first producer to find the flusher asleep wakes it
+
+    if (__atomic_load_n(&sleeping, __ATOMIC_SEQ_CST) &&
+                    __atomic_exchange_n(&sleeping, false, __ATOMIC_SEQ_CST))
+    {
+        ScopedLock lock(mutex);
+        changed.signal();
+    }
+
+    return true;
+}
+
+void UploadAggregator::flush()
+{
+    ScopedLock lock(mutex);
+
+    if (flusher == NULL)
+        return;
+
+    unsigned request = ++flushRequested;
+    changed.signal();
+
+    while (flushCompleted < request)
+        flushed.wait(mutex);
+}
+
+uint64_t UploadAggregator::getPendingBytes() const
+{
+    return __atomic_load_n(&pendingBytes, __ATOMIC_ACQUIRE);
+}
+
+uint64_t UploadAggregator::getPostedCount() const
+{
+    return __atomic_load_n(&postedCount, __ATOMIC_ACQUIRE);
+}
+
+uint64_t UploadAggregator::getFailedCount() const
+{
+    return __atomic_load_n(&failedCount, __ATOMIC_ACQUIRE);
+}
+
+ServiceException UploadAggregator::getException()
+{
+    ScopedLock lock(mutex);
+    return exception;
+}
+
+size_t UploadAggregator::estimateBytes(const Specimen &specimen)
+{
+    // Key, predictand, weight, and framing; then key, value, and framing
+    // for each cell
+
+    return 24 + 16 * size_t(specimen.size());
+}
+
+// Charge a specimen against the memory budget, waiting while it does not
+// fit.  A specimen always fits when nothing else is pending, so one bigger
+// than the whole budget does not wait forever.
+
+bool UploadAggregator::reserve(size_t bytes)
+{
+    for (;;)
+    {
+        uint64_t pending = __atomic_load_n(&pendingBytes, __ATOMIC_SEQ_CST);
+
+        if (pending == 0 || pending + bytes <= memoryBudget)
+        {
+            if (__atomic_compare_exchange_n(&pendingBytes, &pending,
+                            pending + bytes, false, __ATOMIC_SEQ_CST,
+                                                        __ATOMIC_SEQ_CST))
+                return true;
+            continue;
+        }
+
+        ScopedLock lock(mutex);
+
+        if (__atomic_load_n(&stopping, __ATOMIC_SEQ_CST))
+            return false;
+
+        // Have the flusher post everything, and wait for it to release
+        // enough.  release() checks waiters after lowering pendingBytes, so
+        // one of us sees the other's change.
+
+        __atomic_add_fetch(&waiters, 1, __ATOMIC_SEQ_CST);
+        changed.signal();
+
+        pending = __atomic_load_n(&pendingBytes, __ATOMIC_SEQ_CST);
+        if (pending != 0 && pending + bytes > memoryBudget)
+            room.wait(mutex);
+
+        __atomic_sub_fetch(&waiters, 1, __ATOMIC_SEQ_CST);
+    }
+}
+
+void UploadAggregator::release(uint64_t bytes)
+{
+    __atomic_sub_fetch(&pendingBytes, bytes, __ATOMIC_SEQ_CST);
+
+    if (__atomic_load_n(&waiters, __ATOMIC_SEQ_CST) > 0)
+    {
+        ScopedLock lock(mutex);
+        room.broadcast();
+    }
+}
+
+void UploadAggregator::runFlusher()
+{
+    std::vector<Group> ready;
+
+    for (;;)
+    {
+        mutex.lock();
+        unsigned request = flushRequested;
+        bool     stop    = __atomic_load_n(&stopping, __ATOMIC_SEQ_CST);
+        mutex.unlock();
+
+        // Post everything when asked to, or when producers are waiting for
+        // memory
+
+        bool all = stop || request != flushCompleted ||
+                            __atomic_load_n(&waiters, __ATOMIC_SEQ_CST) > 0;
+
+        drain(all, ready);
+        uint64_t due = takeDue(all, ready);
+        postReady(ready);
+
+        mutex.lock();
+
+        if (request != flushCompleted)
+        {
+            flushCompleted = request;
+            flushed.broadcast();
+        }
+
+        if (stop)
+        {
+            mutex.unlock();
+            break;
+        }
+
+        // Sleep until the oldest group is due, unless there is more to do.
+        // add() checks sleeping after bumping pushed, so one of us sees the
+        // other's change.
+
+        __atomic_store_n(&sleeping, true, __ATOMIC_SEQ_CST);
+
+        if (request == flushRequested &&
+                    !__atomic_load_n(&stopping, __ATOMIC_SEQ_CST) &&
+                    __atomic_load_n(&waiters, __ATOMIC_SEQ_CST) == 0 &&
+                    __atomic_load_n(&pushed, __ATOMIC_SEQ_CST) == popped)
+        {
+            uint64_t now = Thread::currentTimeMillis();
+
+            if (due == 0)
+                changed.wait(mutex);
+            else if (due > now)
+                changed.waitFor(mutex, unsigned(due - now));
+        }
+
+        __atomic_store_n(&sleeping, false, __ATOMIC_SEQ_CST);
+        mutex.unlock();
+    }
+}
+
+// Move the queued specimens into their groups, and make ready each group
+// which fills up.  With all, wait for pushes still in progress, so that
+// everything added before the call is taken.
+
+void UploadAggregator::drain(bool all, std::vector<Group> &ready)
+{
+    uint64_t target = __atomic_load_n(&pushed, __ATOMIC_SEQ_CST);
+    Item *item;
+
+    for (;;)
+    {
+        if (!queue.pop(item))
+        {
+            if (!all || popped >= target)
+                break;
+            sched_yield();
+            continue;
+        }
+
+        ++popped;
+
+        GroupKey key(item->studyIdentifier, item->tableLocation);
+
+        GroupMap::iterator it = groups.find(key);
+        if (it == groups.end())
+        {
+            it = groups.insert(std::make_pair(key, Group())).first;
+            it->second.studyIdentifier = item->studyIdentifier;
+            it->second.tableLocation   = item->tableLocation;
+            it->second.firstQueuedAt   = item->queuedAt;
+        }
+
+        Group &g = it->second;
+        g.items.push_back(item);
+        g.bytes += item->bytes;
+
+        if (g.items.size() >= maxBlockSpecimens || g.bytes >= maxBlockBytes)
+            take(it, ready);
+    }
+}
+
+// Make ready each group whose oldest specimen is due (or every group, with
+// all).  Return the time the next group is due, or 0 if none is left.
+
+uint64_t UploadAggregator::takeDue(bool all, std::vector<Group> &ready)
+{
+    uint64_t now  = Thread::currentTimeMillis();
+    uint64_t next = 0;
+
+    GroupMap::iterator it = groups.begin();
+    while (it != groups.end())
+    {
+        uint64_t due = it->second.firstQueuedAt + maxDelay;
+
+        if (all || due <= now)
+            take(it++, ready);
+        else
+        {
+            if (next == 0 || due < next)
+                next = due;
+            ++it;
+        }
+    }
+
+    return next;
+}
+
+void UploadAggregator::take(GroupMap::iterator it, std::vector<Group> &ready)
+{
+    ready.push_back(Group());
+
+    Group &g = ready.back();
+    g.studyIdentifier = it->second.studyIdentifier;
+    g.tableLocation   = it->second.tableLocation;
+    g.bytes           = it->second.bytes;
+    g.firstQueuedAt   = it->second.firstQueuedAt;
+    g.items.swap(it->second.items);
+
+    groups.erase(it);
+}
+
+// Post the ready groups, one block each.  The blocks for the same table go
+// in one call to postBlocks(), which spreads them over the connections.
+
+void UploadAggregator::postReady(std::vector<Group> &ready)
+{
+    typedef std::map<std::string, std::vector<size_t> > TableMap;
+
+    TableMap tables;
+    for (size_t i = 0;  i < ready.size();  ++i)
+        tables[ready[i].tableLocation].push_back(i);
+
+    for (TableMap::iterator t = tables.begin();  t != tables.end();  ++t)
+    {
+        const std::vector<size_t> &indexes = t->second;
+
+        std::vector<SpecimenBlock *> blocks;
+        std::vector<const Block *>   blockPointers;
+
+        for (size_t j = 0;  j < indexes.size();  ++j)
+        {
+            Group &g = ready[indexes[j]];
+            SpecimenBlock *block = new SpecimenBlock(g.studyIdentifier);
+            for (size_t k = 0;  k < g.items.size();  ++k)
+                block->addSpecimen(&g.items[k]->specimen);
+            blocks.push_back(block);
+            blockPointers.push_back(block);
+        }
+
+        std::vector<ServiceException> exceptions;
+        if (!service.postBlocks(t->first, blockPointers, exceptions))
+        {
+            ScopedLock lock(mutex);
+            exception = service.getException();
+        }
+
+        for (size_t j = 0;  j < indexes.size();  ++j)
+        {
+            uint64_t n = ready[indexes[j]].items.size();
+
+            if (YosokumoDIF::isException(exceptions[j]))
+                __atomic_add_fetch(&failedCount, n, __ATOMIC_SEQ_CST);
+            else
+                __atomic_add_fetch(&postedCount, n, __ATOMIC_SEQ_CST);
+
+            delete blocks[j];
+        }
+    }
+
+    uint64_t bytes = 0;
+
+    for (size_t i = 0;  i < ready.size();  ++i)
+    {
+        bytes += ready[i].bytes;
+        for (size_t k = 0;  k < ready[i].items.size();  ++k)
+            delete ready[i].items[k];
+    }
+
+    ready.clear();
+
+    if (bytes > 0)
+        release(bytes);
+}
+
+// end UploadAggregator.cpp
@@ -0,0 +1,271 @@
+// UploadAggregator.h
+
+#ifndef UPLOADAGGREGATOR_H
+#define UPLOADAGGREGATOR_H
+
+#include "Condition.h"
+#include "Credentials.h"
+#include "MpscQueue.h"
+#include "Mutex.h"
+#include "Service.h"
+#include "ServiceException.h"
+#include "Specimen.h"
+#include "Study.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Yosokumo
+{
+
+/**
+ * Gathers specimens added one at a time, by any number of threads, into
+ * specimen blocks, one per study and table, and posts the blocks to the
+ * tables.  A call to <code>add()</code> queues one specimen and returns at
+ * once; a thread owned by the aggregator packs the queued specimens into a
+ * block for each study and table, and posts a block when it holds
+ * <code>maxBlockSpecimens</code> specimens, when its estimated encoded size
+ * reaches <code>maxBlockBytes</code>, or when its oldest specimen has
+ * waited <code>maxDelay</code> milliseconds.  For example:
+ * <pre>
+ *    UploadAggregator aggregator(credentials, hostName, port);
+ *    ...
+ *    aggregator.add(study, specimen);      // On any thread
+ *    ...
+ *    aggregator.flush();
+ * </pre>
+ * The specimens travel to the aggregator's thread on an
+ * <code>MpscQueue</code>, so producers do not contend for a lock.  Blocks
+ * which fall due together are posted together with
+ * <code>Service::postBlocks()</code>, over as many as
+ * <code>maxConnections</code> kept-alive connections.
+ * <p>
+ * The specimens queued and not yet posted may take up to
+ * <code>memoryBudget</code> bytes (as estimated by
+ * <code>estimateBytes()</code>).  A producer which would exceed the budget
+ * has the aggregator post everything it holds, and waits until enough has
+ * been posted.
+ * <p>
+ * A specimen whose block fails to post is dropped; the failures are counted
+ * (see <code>getFailedCount()</code>), and the last is kept (see
+ * <code>getException()</code>).
+ */
+class UploadAggregator
+{
+public:
+
+    /**
+     * Default number of specimens which triggers the post of a block.
+     */
+    enum { DEFAULT_MAX_BLOCK_SPECIMENS = 1000 };
+
+    /**
+     * Default estimated size (in bytes) which triggers the post of a block.
+     */
+    enum { DEFAULT_MAX_BLOCK_BYTES = 1 << 20 };
+
+    /**
+     * Default time (in milliseconds) a specimen may wait before a post.
+     */
+    enum { DEFAULT_MAX_DELAY = 100 };
+
+    /**
+     * Default limit on the estimated size (in bytes) of the specimens
+     * queued and not yet posted.
+     */
+    enum { DEFAULT_MEMORY_BUDGET = 64 << 20 };
+
+private:
+
+    struct Item
+    {
+        std::string studyIdentifier;
+        std::string tableLocation;
+        Specimen    specimen;
+        size_t      bytes;              // estimateBytes(specimen)
+        uint64_t    queuedAt;           // Milliseconds
+    };
+
+    // The specimens of one study not yet posted to one of its tables
+
+    struct Group
+    {
+        std::string         studyIdentifier;
+        std::string         tableLocation;
+        std::vector<Item *> items;
+        size_t              bytes;
+        uint64_t            firstQueuedAt;
+
+        Group() : bytes(0), firstQueuedAt(0) {}
+    };
+
+    // Keyed on the study identifier and the table location, so that
+    // specimens for different tables of one study are posted apart
+
+    typedef std::pair<std::string, std::string> GroupKey;
+    typedef std::map<GroupKey, Group>            GroupMap;
+
+    unsigned            maxBlockSpecimens;
+    size_t              maxBlockBytes;
+    unsigned            maxDelay;
+    uint64_t            memoryBudget;
+
+    MpscQueue<Item *>   queue;
+    uint64_t            pushed;         // Atomic:  items pushed so far
+    uint64_t            pendingBytes;   // Atomic:  queued, not yet posted
+    unsigned            waiters;        // Atomic:  producers over budget
+    bool                sleeping;       // Atomic:  flusher may be waiting
+    bool                stopping;       // Atomic
+    uint64_t            postedCount;    // Atomic
+    uint64_t            failedCount;    // Atomic
+
+    Service             service;        // Only used by the flusher thread
+    GroupMap            groups;         //   ditto
+    uint64_t            popped;         //   ditto
+
+    Mutex               mutex;          // Guards the following
+    Condition           changed;        // Wakes the flusher
+    Condition           room;           // Wakes producers over budget
+    Condition           flushed;
+    unsigned            flushRequested;
+    unsigned            flushCompleted;
+    ServiceException    exception;
+
+    class Flusher;
+    friend class Flusher;
+    Flusher             *flusher;
+
+public:
+
+    /**
+     * Initializes a newly created <code>UploadAggregator</code> and starts
+     * its thread.
+     *
+     * @param  credentials specifies user id and key for authentication.
+     * @param  hostName is the name of the Yosokumo server.
+     * @param  port is the port to use to access the Yosokumo service.
+     * @param  maxBlockSpecimens is the number of specimens of one study
+     *             which triggers the post of a block.
+     * @param  maxBlockBytes is the estimated size of the specimens of one
+     *             study which triggers the post of a block.
+     * @param  maxDelay is the time in milliseconds after which a waiting
+     *             specimen is posted even if its block is not full.
+     * @param  memoryBudget is the limit on the estimated size of the
+     *             specimens queued and not yet posted.
+     * @param  maxConnections is the number of connections over which blocks
+     *             are posted in parallel.
+     */
+    UploadAggregator(
+        const Credentials &credentials,
+        const std::string &hostName,
+        int               port,
+        unsigned          maxBlockSpecimens = DEFAULT_MAX_BLOCK_SPECIMENS,
+        size_t            maxBlockBytes     = DEFAULT_MAX_BLOCK_BYTES,
+        unsigned          maxDelay          = DEFAULT_MAX_DELAY,
+        uint64_t          memoryBudget      = DEFAULT_MEMORY_BUDGET,
+        unsigned          maxConnections
+                                    = Service::DEFAULT_MAX_CONNECTIONS);
+
+    /**
+     * Destructor - posts any specimens still queued, then stops the thread.
+     * No thread may be in <code>add()</code>.
+     */
+    ~UploadAggregator();
+
+    /**
+     * Queue a specimen for the table of a study.  May be called from any
+     * thread.  Returns at once unless the memory budget is used up.
+     *
+     * @param  study  the study.  Its identifier and table location must be
+     *             set.
+     * @param  specimen  the specimen.  A copy is queued.
+     *
+     * @return <code>true</code> means the specimen was queued.
+     *         <code>false</code> means the aggregator is stopping, or its
+     *             thread could not be started.
+     */
+    bool add(const Study &study, const Specimen &specimen);
+
+    /**
+     * Queue a specimen for a table.  As above, except the study is given
+     * by its identifier and the URI of its table.
+     */
+    bool add(
+        const std::string &studyIdentifier,
+        const std::string &tableLocation,
+        const Specimen    &specimen);
+
+    /**
+     * Post every specimen queued before the call, and wait until the posts
+     * are done.  May be called from any thread.
+     */
+    void flush();
+
+    /**
+     * Return the estimated size (in bytes) of the specimens queued and not
+     * yet posted.
+     */
+    uint64_t getPendingBytes() const;
+
+    /**
+     * Return the number of specimens posted successfully.
+     */
+    uint64_t getPostedCount() const;
+
+    /**
+     * Return the number of specimens dropped because their block failed
+     * to post.
+     */
+    uint64_t getFailedCount() const;
+
+    /**
+     * Return the exception for the last block which failed to post.
+     *
+     * @return the exception, or a default <code>ServiceException</code> if
+     *             no block has failed.
+     */
+    ServiceException getException();
+
+    /**
+     * Return the estimated encoded size of a specimen, in bytes, as charged
+     * against the block size and the memory budget.
+     */
+    static size_t estimateBytes(const Specimen &specimen);
+
+private:
+
+    bool reserve(size_t bytes);
+
+    void release(uint64_t bytes);
+
+    void runFlusher();
+
+    void drain(bool all, std::vector<Group> &ready);
+
+    uint64_t takeDue(bool all, std::vector<Group> &ready);
+
+    void take(GroupMap::iterator it, std::vector<Group> &ready);
+
+    void postReady(std::vector<Group> &ready);
+
+    /**
+     * Copy constructor - NOT IMPLEMENTED.
+     */
+    UploadAggregator(const UploadAggregator &rhs);
+
+    /**
+     * Assignment operator - NOT IMPLEMENTED.
+     */
+    UploadAggregator& operator=(const UploadAggregator& rhs);
+
+};  // end class UploadAggregator
+
+}   // end namespace Yosokumo
+
+#endif  // UPLOADAGGREGATOR_H
+
+// end UploadAggregator.h
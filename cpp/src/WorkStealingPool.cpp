@@ -0,0 +1,196 @@
+// WorkStealingPool.cpp
+
+#include "WorkStealingPool.h"
+
+#include <unistd.h>
+
+using namespace Yosokumo;
+
+//******************************   IndexedTask   **************************
+
+IndexedTask::~IndexedTask()
+{}
+
+//****************************   WorkStealingPool   ************************
+
+WorkStealingPool::Worker::Worker(WorkStealingPool &pool, unsigned number) :
+    pool(pool), number(number)
+{}
+
+void WorkStealingPool::Worker::run()
+{
+    pool.workerMain(number);
+}
+
+WorkStealingPool::WorkStealingPool(unsigned numWorkers) :
+    task      (NULL),
+    generation(0),
+    running   (0),
+    stopping  (false)
+{
+    if (numWorkers == 0)
+        numWorkers = getProcessorCount();
+
+    // Worker 0 is the thread calling forEach()
+
+    ranges.push_back(new Range);
+
+    for (unsigned i = 1;  i < numWorkers;  ++i)
+    {
+        Worker *w = new Worker(*this, threads.size() + 1);
+        if (!w->start())
+        {
+            delete w;
+            break;
+        }
+        threads.push_back(w);
+        ranges.push_back(new Range);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    mutex.lock();
+    stopping = true;
+    started.broadcast();
+    mutex.unlock();
+
+    for (size_t i = 0;  i < threads.size();  ++i)
+    {
+        threads[i]->join();
+        delete threads[i];
+    }
+
+    for (size_t i = 0;  i < ranges.size();  ++i)
+        delete ranges[i];
+}
+
+unsigned WorkStealingPool::size() const
+{
+    return ranges.size();
+}
+
+void WorkStealingPool::forEach(size_t count, IndexedTask &task)
+{
+    ScopedLock forEachLock(forEachMutex);
+
+    if (count == 0)
+        return;
+
+    size_t n = ranges.size();
+
+    for (size_t i = 0;  i < n;  ++i)
+    {
+        ScopedLock lock(ranges[i]->mutex);
+        ranges[i]->begin = count * i / n;
+        ranges[i]->end   = count * (i + 1) / n;
+    }
+
+    mutex.lock();
+    this->task = &task;
+    ++generation;
+    running = n - 1;
+    started.broadcast();
+    mutex.unlock();
+
+    work(0, task);
+
+    // The other workers may still be running items they have claimed
+
+    mutex.lock();
+    while (running > 0)
+        finished.wait(mutex);
+    this->task = NULL;
+    mutex.unlock();
+}
+
+unsigned WorkStealingPool::getProcessorCount()
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return (n > 0) ? unsigned(n) : 1;
+}
+
+// Run items until there are none left to claim anywhere
+
+void WorkStealingPool::work(unsigned number, IndexedTask &task)
+{
+    size_t index;
+
+    while (takeOwn(number, index) || steal(number, index))
+        task.runItem(number, index);
+}
+
+bool WorkStealingPool::takeOwn(unsigned number, size_t &index)
+{
+    Range &r = *ranges[number];
+    ScopedLock lock(r.mutex);
+
+    if (r.begin >= r.end)
+        return false;
+
+    index = r.begin++;
+    return true;
+}
+
+// Take the back half of the first range found with items left, keep its
+// first item to run, and make the rest the worker's own range
+
+bool WorkStealingPool::steal(unsigned number, size_t &index)
+{
+    size_t n = ranges.size();
+
+    for (size_t k = 1;  k < n;  ++k)
+    {
+        Range &victim = *ranges[(number + k) % n];
+        size_t begin, end;
+        {
+            ScopedLock lock(victim.mutex);
+            if (victim.begin >= victim.end)
+                continue;
+
+            begin = victim.begin + (victim.end - victim.begin) / 2;
+            end   = victim.end;
+            victim.end = begin;
+        }
+
+        Range &own = *ranges[number];
+        ScopedLock lock(own.mutex);
+        own.begin = begin + 1;
+        own.end   = end;
+        index     = begin;
+        return true;
+    }
+
+    return false;
+}
+
+void WorkStealingPool::workerMain(unsigned number)
+{
+    unsigned seen = 0;
+
+    mutex.lock();
+
+    for (;;)
+    {
+        while (!stopping && generation == seen)
+            started.wait(mutex);
+
+        if (stopping)
+            break;
+
+        seen = generation;
+        IndexedTask *t = task;
+        mutex.unlock();
+
+        work(number, *t);
+
+        mutex.lock();
+        if (--running == 0)
+            finished.signal();
+    }
+
+    mutex.unlock();
+}
+
+// end WorkStealingPool.cpp
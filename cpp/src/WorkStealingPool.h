@@ -0,0 +1,156 @@
+// WorkStealingPool.h
+
+#ifndef WORKSTEALINGPOOL_H
+#define WORKSTEALINGPOOL_H
+
+#include "Condition.h"
+#include "Mutex.h"
+#include "Thread.h"
+
+#include <stddef.h>
+#include <vector>
+
+namespace Yosokumo
+{
+
+/**
+ * A piece of work made of many independent items, numbered from 0, to be
+ * run by a <code>WorkStealingPool</code>.
+ */
+class IndexedTask
+{
+public:
+
+    virtual ~IndexedTask();
+
+    /**
+     * Run one item.  Items are run concurrently, in no particular order.
+     *
+     * @param  worker  the number of the worker running the item, less than
+     *             the <code>size()</code> of the pool.  No two items run at
+     *             the same time on the same worker, so the worker number
+     *             may select per-worker state, e.g., an encoder.
+     * @param  index   the number of the item.
+     */
+    virtual void runItem(unsigned worker, size_t index) = 0;
+
+};  // end class IndexedTask
+
+
+/**
+ * A fixed set of threads which run the items of an
+ * <code>IndexedTask</code> in parallel.  For example:
+ * <pre>
+ *    WorkStealingPool pool;
+ *    pool.forEach(blocks.size(), task);
+ * </pre>
+ * The items are first divided evenly among the workers, as contiguous
+ * ranges.  A worker which runs out of items steals the back half of the
+ * range of another, so workers which meet slow items, or start late, do not
+ * hold up the rest.  The thread calling <code>forEach()</code> is itself one
+ * of the workers.
+ * <p>
+ * <code>forEach()</code> may be called from any thread; calls on the same
+ * pool run one at a time.
+ */
+class WorkStealingPool
+{
+    // The items not yet claimed by a worker:  the owner takes from the
+    // front, thieves from the back
+
+    struct Range
+    {
+        Mutex  mutex;
+        size_t begin;
+        size_t end;
+    };
+
+    class Worker : public Thread
+    {
+        WorkStealingPool &pool;
+        unsigned         number;
+
+    public:
+
+        Worker(WorkStealingPool &pool, unsigned number);
+
+    protected:
+
+        void run();
+    };
+
+    std::vector<Worker *> threads;
+    std::vector<Range *>  ranges;       // One per worker, including caller
+
+    Mutex                 forEachMutex; // Serializes forEach()
+
+    Mutex                 mutex;        // Guards the following
+    Condition             started;
+    Condition             finished;
+    IndexedTask           *task;
+    unsigned              generation;   // Count of forEach() calls
+    unsigned              running;      // Workers not done with this call
+    bool                  stopping;
+
+public:
+
+    /**
+     * Initializes a newly created <code>WorkStealingPool</code>.
+     *
+     * @param  numWorkers  the number of workers, including the thread
+     *             calling <code>forEach()</code>; 0 means one per processor.
+     */
+    explicit WorkStealingPool(unsigned numWorkers = 0);
+
+    /**
+     * Destructor - stops the threads.
+     */
+    ~WorkStealingPool();
+
+    /**
+     * Return the number of workers, including the thread calling
+     * <code>forEach()</code>.  May be fewer than asked for if threads could
+     * not be started.
+     */
+    unsigned size() const;
+
+    /**
+     * Run all the items of a task, and wait for them to finish.
+     *
+     * @param  count  the number of items.
+     * @param  task   the task.
+     */
+    void forEach(size_t count, IndexedTask &task);
+
+    /**
+     * Return the number of processors online.
+     */
+    static unsigned getProcessorCount();
+
+private:
+
+    void work(unsigned number, IndexedTask &task);
+
+    bool takeOwn(unsigned number, size_t &index);
+
+    bool steal(unsigned number, size_t &index);
+
+    void workerMain(unsigned number);
+
+    /**
+     * Copy constructor - NOT IMPLEMENTED.
+     */
+    WorkStealingPool(const WorkStealingPool &rhs);
+
+    /**
+     * Assignment operator - NOT IMPLEMENTED.
+     */
+    WorkStealingPool& operator=(const WorkStealingPool& rhs);
+
+};  // end class WorkStealingPool
+
+}   // end namespace Yosokumo
+
+#endif  // WORKSTEALINGPOOL_H
+
+// end WorkStealingPool.h
@@ -2,20 +2,108 @@
 
 #include "StringUtil.h"
 #include "YosokumoProtobuf.h"
+#include "Metrics.h"
+#include "AllocationTracker.h"
 #include "EmptyValue.h"
 #include "IntegerValue.h"
 #include "NaturalValue.h"
 #include "RealValue.h"
 #include "SpecialValue.h"
 
+#include "LazyCatalog.h"
+
 #include "EmptyBlock.h"
 #include "CellBlock.h"
 #include "PredictorBlock.h"
 #include "SpecimenBlock.h"
+#include "WorkStealingPool.h"
+
+#include <google/protobuf/io/coded_stream.h>
+
+#include <algorithm>
 
 
 using namespace Yosokumo;
 
+enum { VARINT = 0, FIXED64 = 1, LENGTH_DELIMITED = 2, FIXED32 = 5 };
+
+// Read a base 128 varint, advancing p past it
+
+static bool readVarint(const uint8_t *&p, const uint8_t *end, uint64_t &value)
+{
+    value = 0;
+
+    for (unsigned shift = 0;  shift < 64 && p < end;  shift += 7)
+    {
+        uint8_t b = *p++;
+        value |= uint64_t(b & 0x7F) << shift;
+        if ((b & 0x80) == 0)
+            return true;
+    }
+
+    return false;
+}
+
+// A field read by readField():  its number and wire type, the value of a
+// varint, and the bytes of a length delimited value (data is NULL for any
+// other wire type)
+
+struct WireField
+{
+    uint64_t      number;
+    unsigned      wireType;
+    uint64_t      value;
+    const uint8_t *data;
+    size_t        length;
+};
+
+// Read the tag of a field and step over its value, advancing p
+
+static bool readField(const uint8_t *&p, const uint8_t *end, WireField &f)
+{
+    uint64_t tag, value;
+    if (!readVarint(p, end, tag))
+        return false;
+
+    f.number   = tag >> 3;
+    f.wireType = unsigned(tag & 7);
+    f.value    = 0;
+    f.data     = NULL;
+    f.length   = 0;
+
+    if (f.number == 0)
+        return false;
+
+    switch (f.wireType)
+    {
+    case VARINT:
+        return readVarint(p, end, f.value);
+
+    case FIXED64:
+        if (end - p < 8)
+            return false;
+        p += 8;
+        return true;
+
+    case LENGTH_DELIMITED:
+        if (!readVarint(p, end, value) || value > uint64_t(end - p))
+            return false;
+        f.data   = p;
+        f.length = size_t(value);
+        p += value;
+        return true;
+
+    case FIXED32:
+        if (end - p < 4)
+            return false;
+        p += 4;
+        return true;
+
+    default:                            // Groups, or not protobuf at all
+        return false;
+    }
+}
+
 
 std::string YosokumoProtobuf::getContentType()
 {
@@ -28,6 +116,9 @@ bool YosokumoProtobuf::makeCatalogFromBytes(
     const std::vector<uint8_t> &catalogAsBytes,
     Catalog &catalog)
 {
+    ScopedTimer timer(Metrics::PARSE_TIME);
+    YOSOKUMO_TRACK_ALLOCATIONS("YosokumoProtobuf::makeCatalogFromBytes");
+
     ProtoBuf::Catalog protoCatalog;
 
     if (!makeProtobufCatalogFromBytes(catalogAsBytes, protoCatalog))
@@ -74,6 +165,7 @@ bool YosokumoProtobuf::makeCatalogFromProtobufCatalog(
     catalog.setCatalogLocation(protoCatalog.location()       );
 
     catalog.clearStudies();
+    catalog.reserveStudies(protoCatalog.study_size());
 
     for (int i = 0;  i < protoCatalog.study_size();  ++i)
     {
@@ -98,12 +190,152 @@ bool YosokumoProtobuf::makeCatalogFromProtobufCatalog(
 
 }   //  end makeCatalogFromProtobufCatalog
 
+
+bool YosokumoProtobuf::makeLazyCatalogFromBytes(
+    std::vector<uint8_t> &catalogAsBytes,
+    LazyCatalog &catalog)
+{
+    ScopedTimer timer(Metrics::PARSE_TIME);
+    YOSOKUMO_TRACK_ALLOCATIONS("YosokumoProtobuf::makeLazyCatalogFromBytes");
+
+    enum { USER_IDENTIFIER = 1, STUDY = 4, USER_NAME = 102, LOCATION = 103 };
+    enum { STUDY_IDENTIFIER = 1, OWNER = 107 };
+    enum { OWNER_IDENTIFIER = 1 };
+
+    catalog.clear();
+
+    if (catalogAsBytes.empty())
+    {
+        exception = ServiceException(
+            "input vector of bytes is empty",
+            "makeLazyCatalogFromBytes");
+        return false;
+    }
+
+    if (catalogAsBytes.size() > 0xFFFFFFFFu)
+    {
+        exception = ServiceException(
+            "catalog is larger than 4 GB",
+            "makeLazyCatalogFromBytes");
+        return false;
+    }
+
+    const uint8_t *begin = &catalogAsBytes[0];
+    const uint8_t *end   = begin + catalogAsBytes.size();
+    const uint8_t *p     = begin;
+
+    // As ParseFromArray() does, reject bytes which are not well formed, or
+    // which lack a required field:  the user identifier of the catalog, or
+    // the study identifier of a study, or the user identifier of an owner
+
+    bool ok = true;
+    bool userIdentifierSeen = false;
+
+    while (ok && p < end)
+    {
+        WireField f;
+
+        if (!readField(p, end, f))
+            ok = false;
+        else if (f.data == NULL)
+            ;
+        else if (f.number == USER_IDENTIFIER)
+        {
+            catalog.userIdentifier.assign((const char *)f.data, f.length);
+            userIdentifierSeen = true;
+        }
+        else if (f.number == USER_NAME)
+            catalog.userName.assign((const char *)f.data, f.length);
+        else if (f.number == LOCATION)
+            catalog.catalogLocation.assign((const char *)f.data, f.length);
+        else if (f.number == STUDY)
+        {
+            LazyCatalog::StudyEntry entry;
+            entry.studyOffset      = uint32_t(f.data - begin);
+            entry.studyLength      = uint32_t(f.length);
+            entry.identifierOffset = entry.studyOffset;
+            entry.identifierLength = 0;
+
+            // The top level of the study, for its identifier (the last,
+            // if there are several, as protobuf has it)
+
+            bool studyIdentifierSeen = false;
+
+            const uint8_t *q = f.data, *studyEnd = f.data + f.length;
+            while (ok && q < studyEnd)
+            {
+                WireField g;
+
+                if (!readField(q, studyEnd, g))
+                    ok = false;
+                else if (g.data != NULL && g.number == STUDY_IDENTIFIER)
+                {
+                    entry.identifierOffset = uint32_t(g.data - begin);
+                    entry.identifierLength = uint32_t(g.length);
+                    studyIdentifierSeen = true;
+                }
+                else if (g.data != NULL && g.number == OWNER)
+                {
+                    bool ownerIdentifierSeen = false;
+
+                    const uint8_t *r = g.data, *ownerEnd = g.data + g.length;
+                    while (ok && r < ownerEnd)
+                    {
+                        WireField h;
+
+                        if (!readField(r, ownerEnd, h))
+                            ok = false;
+                        else if (h.data != NULL && 
+                                            h.number == OWNER_IDENTIFIER)
+                            ownerIdentifierSeen = true;
+                    }
+
+                    ok = ok && ownerIdentifierSeen;
+                }
+            }
+
+            ok = ok && studyIdentifierSeen;
+
+            catalog.studies.push_back(entry);
+        }
+    }
+
+    if (!ok || !userIdentifierSeen)
+    {
+        catalog.clear();
+        exception = ServiceException(
+            "ProtoBuf::Catalog::ParseFromArray failed",
+            "makeLazyCatalogFromBytes");
+        return false;
+    }
+
+    std::vector<LazyCatalog::StudyEntry>(catalog.studies).swap(
+                                                            catalog.studies);
+    catalog.bytes.swap(catalogAsBytes);
+
+    if (!catalog.sortIdentifiers())
+    {
+        catalog.bytes.swap(catalogAsBytes);
+        catalog.clear();
+        exception = ServiceException(
+            "catalog contains two studies with the same identifier",
+            "makeLazyCatalogFromBytes");
+        return false;
+    }
+
+    return true;
+
+}   //  end makeLazyCatalogFromBytes
+
 //***********************   Catalog -> protobuf   *************************
 
 bool YosokumoProtobuf::makeBytesFromCatalog(
     const Catalog &catalog,
     std::vector<uint8_t> &catalogAsBytes)
 {
+    ScopedTimer timer(Metrics::SERIALIZE_TIME);
+    YOSOKUMO_TRACK_ALLOCATIONS("YosokumoProtobuf::makeBytesFromCatalog");
+
     ProtoBuf::Catalog protoCatalog;
 
     if (!makeProtobufCatalogFromCatalog(catalog, protoCatalog))
@@ -117,7 +349,7 @@ bool YosokumoProtobuf::makeProtobufCatalogFromCatalog(
     const Catalog &catalog,
     ProtoBuf::Catalog &protoCatalog)
 {
-    protoCatalog.set_user_identifier (catalog.getUserIdentifier());
+    protoCatalog.set_user_identifier (catalog.getUserIdentifierHandle().str());
     protoCatalog.set_user_name       (catalog.getUserName());
     protoCatalog.set_location        (catalog.getCatalogLocation());
 
@@ -154,6 +386,9 @@ bool YosokumoProtobuf::makeStudyFromBytes(
     const std::vector<uint8_t> &studyAsBytes,
     Study &study)
 {
+    ScopedTimer timer(Metrics::PARSE_TIME);
+    YOSOKUMO_TRACK_ALLOCATIONS("YosokumoProtobuf::makeStudyFromBytes");
+
     ProtoBuf::Study protoStudy;
 
     if (!makeProtobufStudyFromBytes(studyAsBytes, protoStudy))
@@ -163,6 +398,27 @@ bool YosokumoProtobuf::makeStudyFromBytes(
 
 }   //  end makeStudyFromBytes
 
+bool YosokumoProtobuf::makeStudyFromBytes(
+    const uint8_t *studyAsBytes,
+    size_t numBytes,
+    Study &study)
+{
+    ScopedTimer timer(Metrics::PARSE_TIME);
+
+    ProtoBuf::Study protoStudy;
+
+    if (!protoStudy.ParseFromArray(studyAsBytes, int(numBytes)))
+    {
+        exception = ServiceException(
+            "ProtoBuf::Study::ParseFromArray failed",
+            "makeStudyFromBytes");
+        return false;
+    }
+
+    return makeStudyFromProtobufStudy(protoStudy, study);
+
+}   //  end makeStudyFromBytes
+
 bool YosokumoProtobuf::makeProtobufStudyFromBytes(
     const std::vector<uint8_t> &studyAsBytes,
     ProtoBuf::Study &protoStudy)
@@ -231,6 +487,9 @@ bool YosokumoProtobuf::makeBytesFromStudy(
     const Study &study,
     std::vector<uint8_t> &studyAsBytes)
 {
+    ScopedTimer timer(Metrics::SERIALIZE_TIME);
+    YOSOKUMO_TRACK_ALLOCATIONS("YosokumoProtobuf::makeBytesFromStudy");
+
     ProtoBuf::Study protoStudy;
 
     if (!makeProtobufStudyFromStudy(study, protoStudy))
@@ -244,7 +503,7 @@ bool YosokumoProtobuf::makeProtobufStudyFromStudy(
     const Study &study,
     ProtoBuf::Study &protoStudy)
 {
-    protoStudy.set_study_identifier (study.getStudyIdentifier());
+    protoStudy.set_study_identifier (study.getStudyIdentifierHandle().str());
     protoStudy.set_study_name       (study.getStudyName());
 
     ProtoBuf::Study_Type type;
@@ -282,6 +541,9 @@ bool YosokumoProtobuf::makeStudyNameFromBytes(
     const std::vector<uint8_t> &studyNameAsBytes,
     std::string &name)
 {
+    ScopedTimer timer(Metrics::PARSE_TIME);
+    YOSOKUMO_TRACK_ALLOCATIONS("YosokumoProtobuf::makeStudyNameFromBytes");
+
     ProtoBuf::Panel_StudyNameControl protoNameControl;
 
     if (!makeProtobufStudyNameControlFromBytes(
@@ -330,6 +592,9 @@ bool YosokumoProtobuf::makeBytesFromStudyName(
     const std::string &name,
     std::vector<uint8_t> &studyNameAsBytes)
 {
+    ScopedTimer timer(Metrics::SERIALIZE_TIME);
+    YOSOKUMO_TRACK_ALLOCATIONS("YosokumoProtobuf::makeBytesFromStudyName");
+
     ProtoBuf::Panel_StudyNameControl protoNameControl;
 
     if (!makeProtobufStudyNameControlFromName(name, protoNameControl))
@@ -361,6 +626,9 @@ bool YosokumoProtobuf::makeStudyStatusFromBytes(
     const std::vector<uint8_t> &studyStatusAsBytes,
     Study::Status &status)
 {
+    ScopedTimer timer(Metrics::PARSE_TIME);
+    YOSOKUMO_TRACK_ALLOCATIONS("YosokumoProtobuf::makeStudyStatusFromBytes");
+
     ProtoBuf::Panel_StatusControl protoStatusControl;
 
     if (!makeProtobufStudyStatusControlFromBytes(
@@ -410,6 +678,9 @@ bool YosokumoProtobuf::makeBytesFromStudyStatus(
     const Study::Status status,
     std::vector<uint8_t> &studyStatusAsBytes)
 {
+    ScopedTimer timer(Metrics::SERIALIZE_TIME);
+    YOSOKUMO_TRACK_ALLOCATIONS("YosokumoProtobuf::makeBytesFromStudyStatus");
+
     ProtoBuf::Panel_StatusControl protoStatusControl;
 
     if (!makeProtobufStudyStatusControlFromStatus(status, protoStatusControl))
@@ -448,6 +719,10 @@ bool YosokumoProtobuf::makeStudyVisibilityFromBytes(
     const std::vector<uint8_t> &studyVisibilityAsBytes,
     Study::Visibility &visibility)
 {
+    ScopedTimer timer(Metrics::PARSE_TIME);
+    YOSOKUMO_TRACK_ALLOCATIONS(
+                        "YosokumoProtobuf::makeStudyVisibilityFromBytes");
+
     ProtoBuf::Panel_VisibilityControl protoVisibilityControl;
 
     if (!makeProtobufStudyVisibilityControlFromBytes(
@@ -499,6 +774,10 @@ bool YosokumoProtobuf::makeBytesFromStudyVisibility(
     const Study::Visibility visibility,
     std::vector<uint8_t> &studyVisibilityAsBytes)
 {
+    ScopedTimer timer(Metrics::SERIALIZE_TIME);
+    YOSOKUMO_TRACK_ALLOCATIONS(
+                        "YosokumoProtobuf::makeBytesFromStudyVisibility");
+
     ProtoBuf::Panel_VisibilityControl protoVisibilityControl;
 
     if (!makeProtobufStudyVisibilityControlFromVisibility(visibility, 
@@ -539,6 +818,9 @@ bool YosokumoProtobuf::makePanelFromBytes(
     const std::vector<uint8_t> &panelAsBytes,
     Panel &panel)
 {
+    ScopedTimer timer(Metrics::PARSE_TIME);
+    YOSOKUMO_TRACK_ALLOCATIONS("YosokumoProtobuf::makePanelFromBytes");
+
     ProtoBuf::Panel protoPanel;
 
     if (!makeProtobufPanelFromBytes(panelAsBytes, protoPanel))
@@ -611,6 +893,9 @@ bool YosokumoProtobuf::makeBytesFromPanel(
     const Panel &panel,
     std::vector<uint8_t> &panelAsBytes)
 {
+    ScopedTimer timer(Metrics::SERIALIZE_TIME);
+    YOSOKUMO_TRACK_ALLOCATIONS("YosokumoProtobuf::makeBytesFromPanel");
+
     ProtoBuf::Panel protoPanel;
 
     if (!makeProtobufPanelFromPanel(panel, protoPanel))
@@ -679,6 +964,9 @@ bool YosokumoProtobuf::makeRoleFromBytes(
     const std::vector<uint8_t> &roleAsBytes,
     Role &role)
 {
+    ScopedTimer timer(Metrics::PARSE_TIME);
+    YOSOKUMO_TRACK_ALLOCATIONS("YosokumoProtobuf::makeRoleFromBytes");
+
     ProtoBuf::Role protoRole;
 
     if (!makeProtobufRoleFromBytes(roleAsBytes, protoRole))
@@ -753,6 +1041,9 @@ bool YosokumoProtobuf::makeBytesFromRole(
     const Role &role,
     std::vector<uint8_t> &roleAsBytes)
 {
+    ScopedTimer timer(Metrics::SERIALIZE_TIME);
+    YOSOKUMO_TRACK_ALLOCATIONS("YosokumoProtobuf::makeBytesFromRole");
+
     ProtoBuf::Role protoRole;
 
     if (!makeProtobufRoleFromRole(role, protoRole))
@@ -767,11 +1058,11 @@ bool YosokumoProtobuf::makeProtobufRoleFromRole(
     ProtoBuf::Role &protoRole)
 {
     ProtoBuf::Role_Roleholder roleholder;
-    roleholder.set_user_identifier(role.getUserIdentifier());
+    roleholder.set_user_identifier(role.getUserIdentifierHandle().str());
     roleholder.set_user_name      (role.getUserName()      );
 
     ProtoBuf::Role_Study study;
-    study.set_study_identifier(role.getStudyIdentifier());
+    study.set_study_identifier(role.getStudyIdentifierHandle().str());
     study.set_study_name      (role.getStudyName()      );
 
     ProtoBuf::Role_Privileges p;
@@ -814,6 +1105,9 @@ bool YosokumoProtobuf::makeRosterFromBytes(
     const std::vector<uint8_t> &rosterAsBytes,
     Roster &roster)
 {
+    ScopedTimer timer(Metrics::PARSE_TIME);
+    YOSOKUMO_TRACK_ALLOCATIONS("YosokumoProtobuf::makeRosterFromBytes");
+
     ProtoBuf::Roster protoRoster;
 
     if (!makeProtobufRosterFromBytes(rosterAsBytes, protoRoster))
@@ -858,6 +1152,8 @@ bool YosokumoProtobuf::makeRosterFromProtobufRoster(
     roster.setStudyName      (protoRoster.study_name()      );
     roster.setRosterLocation (protoRoster.location()        );
 
+    roster.reserveRoles(roster.size() + protoRoster.role_size());
+
     for (int i = 0;  i < protoRoster.role_size();  ++i)
     {
         const ProtoBuf::Role &protoRole = protoRoster.role(i);
@@ -888,6 +1184,9 @@ bool YosokumoProtobuf::makeBytesFromRoster(
     const Roster &roster,
     std::vector<uint8_t> &rosterAsBytes)
 {
+    ScopedTimer timer(Metrics::SERIALIZE_TIME);
+    YOSOKUMO_TRACK_ALLOCATIONS("YosokumoProtobuf::makeBytesFromRoster");
+
     ProtoBuf::Roster protoRoster;
 
     if (!makeProtobufRosterFromRoster(roster, protoRoster))
@@ -901,7 +1200,7 @@ bool YosokumoProtobuf::makeProtobufRosterFromRoster(
     const Roster &roster,
     ProtoBuf::Roster &protoRoster)
 {
-    protoRoster.set_study_identifier(roster.getStudyIdentifier());
+    protoRoster.set_study_identifier(roster.getStudyIdentifierHandle().str());
     protoRoster.set_study_name      (roster.getStudyName()      );
     protoRoster.set_location        (roster.getRosterLocation() );
 
@@ -937,6 +1236,9 @@ bool YosokumoProtobuf::makePredictorFromBytes(
     const std::vector<uint8_t> &predictorAsBytes,
     Predictor &predictor)
 {
+    ScopedTimer timer(Metrics::PARSE_TIME);
+    YOSOKUMO_TRACK_ALLOCATIONS("YosokumoProtobuf::makePredictorFromBytes");
+
     ProtoBuf::Predictor protoPredictor;
 
     if (!makeProtobufPredictorFromBytes(predictorAsBytes, protoPredictor))
@@ -1005,6 +1307,9 @@ bool YosokumoProtobuf::makeBytesFromPredictor(
     const Predictor &predictor,
     std::vector<uint8_t> &predictorAsBytes)
 {
+    ScopedTimer timer(Metrics::SERIALIZE_TIME);
+    YOSOKUMO_TRACK_ALLOCATIONS("YosokumoProtobuf::makeBytesFromPredictor");
+
     ProtoBuf::Predictor protoPredictor;
 
     if (!makeProtobufPredictorFromPredictor(predictor, protoPredictor))
@@ -1055,6 +1360,9 @@ bool YosokumoProtobuf::makeCellFromBytes(
     const std::vector<uint8_t> &cellAsBytes,
     Cell &cell)
 {
+    ScopedTimer timer(Metrics::PARSE_TIME);
+    YOSOKUMO_TRACK_ALLOCATIONS("YosokumoProtobuf::makeCellFromBytes");
+
     ProtoBuf::Cell protoCell;
 
     if (!makeProtobufCellFromBytes(cellAsBytes, protoCell))
@@ -1140,6 +1448,9 @@ bool YosokumoProtobuf::makeBytesFromCell(
     const Cell &cell,
     std::vector<uint8_t> &cellAsBytes)
 {
+    ScopedTimer timer(Metrics::SERIALIZE_TIME);
+    YOSOKUMO_TRACK_ALLOCATIONS("YosokumoProtobuf::makeBytesFromCell");
+
     ProtoBuf::Cell protoCell;
 
     if (!makeProtobufCellFromCell(cell, protoCell))
@@ -1192,6 +1503,9 @@ bool YosokumoProtobuf::makeSpecimenFromBytes(
     const std::vector<uint8_t> &specimenAsBytes,
     Specimen &specimen)
 {
+    ScopedTimer timer(Metrics::PARSE_TIME);
+    YOSOKUMO_TRACK_ALLOCATIONS("YosokumoProtobuf::makeSpecimenFromBytes");
+
     ProtoBuf::Specimen protoSpecimen;
 
     if (!makeProtobufSpecimenFromBytes(specimenAsBytes, protoSpecimen))
@@ -1283,6 +1597,9 @@ bool YosokumoProtobuf::makeBytesFromSpecimen(
     const Specimen &specimen,
     std::vector<uint8_t> &specimenAsBytes)
 {
+    ScopedTimer timer(Metrics::SERIALIZE_TIME);
+    YOSOKUMO_TRACK_ALLOCATIONS("YosokumoProtobuf::makeBytesFromSpecimen");
+
     ProtoBuf::Specimen protoSpecimen;
 
     if (!makeProtobufSpecimenFromSpecimen(specimen, protoSpecimen))
@@ -1351,6 +1668,9 @@ bool YosokumoProtobuf::makeBlockFromBytes(
     const std::vector<uint8_t> &blockAsBytes,
     Block &block)
 {
+    ScopedTimer timer(Metrics::PARSE_TIME);
+    YOSOKUMO_TRACK_ALLOCATIONS("YosokumoProtobuf::makeBlockFromBytes");
+
     ProtoBuf::Block protoBlock;
 
     if (!makeProtobufBlockFromBytes(blockAsBytes, protoBlock))
@@ -1459,12 +1779,190 @@ bool YosokumoProtobuf::makeBlockFromProtobufBlock(
 }   //  end makeBlockFromProtobufBlock
 
 
+// A block of specimens with fewer specimens than this is decoded serially;
+// each worker task decodes this many specimens
+
+static const size_t PARALLEL_DECODE_MIN_SPECIMENS = 4096;
+static const size_t SPECIMENS_PER_TASK            = 512;
+
+// Decodes ranges of the specimens of a block into cells.  Each worker has
+// its own ProtoBuf::Specimen, reused from specimen to specimen, and its own
+// YosokumoProtobuf to convert with, since conversion failures are recorded
+// in the converter.
+
+class YosokumoProtobuf::SpecimenRangeTask : public IndexedTask
+{
+    const uint8_t                     *bytes;
+    const ItemSpans                   &spans;
+    std::vector<Cell>                 &cells;
+    std::vector<ServiceException>     &exceptions;   // One per range
+    std::vector<YosokumoProtobuf *>   difs;
+    std::vector<ProtoBuf::Specimen *> protoSpecimens;
+
+public:
+
+    SpecimenRangeTask(
+        const std::vector<uint8_t>    &blockAsBytes,
+        const ItemSpans               &spans,
+        std::vector<Cell>             &cells,
+        std::vector<ServiceException> &exceptions,
+        unsigned                      numWorkers) :
+            bytes(&blockAsBytes[0]), spans(spans), cells(cells),
+            exceptions(exceptions)
+    {
+        for (unsigned i = 0;  i < numWorkers;  ++i)
+        {
+            difs.push_back(new YosokumoProtobuf);
+            protoSpecimens.push_back(new ProtoBuf::Specimen);
+        }
+    }
+
+    ~SpecimenRangeTask()
+    {
+        for (size_t i = 0;  i < difs.size();  ++i)
+        {
+            delete difs[i];
+            delete protoSpecimens[i];
+        }
+    }
+
+    void runItem(unsigned worker, size_t range)
+    {
+        YosokumoProtobuf   &dif           = *difs[worker];
+        ProtoBuf::Specimen &protoSpecimen = *protoSpecimens[worker];
+
+        size_t begin = range * SPECIMENS_PER_TASK;
+        size_t end   = std::min(begin + SPECIMENS_PER_TASK, spans.size());
+
+        for (size_t i = begin;  i < end;  ++i)
+        {
+            if (!protoSpecimen.ParseFromArray(bytes + spans[i].first,
+                                                        int(spans[i].second)))
+            {
+                exceptions[range] = ServiceException(
+                    "ProtoBuf::Specimen::ParseFromArray failed",
+                    "makeBlockFromBytes");
+                return;
+            }
+
+            Specimen specimen;
+
+            if (!dif.makeSpecimenFromProtobufSpecimen(protoSpecimen, specimen))
+            {
+                dif.getException(exceptions[range]);
+                return;
+            }
+
+            cells[i] = Cell(specimen.getSpecimenKey(),
+                                                specimen.getPredictand());
+        }
+    }
+};
+
+bool YosokumoProtobuf::makeBlockFromBytes(
+    const std::vector<uint8_t> &blockAsBytes,
+    Block &block,
+    WorkStealingPool &pool)
+{
+    std::string id;
+    ItemSpans   spans;
+
+    if (pool.size() < 2 ||
+            !scanProtobufSpecimenBlock(blockAsBytes, id, spans) ||
+            spans.size() < PARALLEL_DECODE_MIN_SPECIMENS)
+        return makeBlockFromBytes(blockAsBytes, block);
+
+    ScopedTimer timer(Metrics::PARSE_TIME);
+    YOSOKUMO_TRACK_ALLOCATIONS("YosokumoProtobuf::makeBlockFromBytes");
+
+    size_t numRanges = (spans.size() + SPECIMENS_PER_TASK - 1) /
+                                                        SPECIMENS_PER_TASK;
+
+    std::vector<Cell>             cells(spans.size());
+    std::vector<ServiceException> exceptions(numRanges);
+    {
+        SpecimenRangeTask task(blockAsBytes, spans, cells, exceptions,
+                                                                pool.size());
+        pool.forEach(numRanges, task);
+    }
+
+    for (size_t i = 0;  i < numRanges;  ++i)
+    {
+        if (isException(exceptions[i]))
+        {
+            exception = exceptions[i];
+            return false;
+        }
+    }
+
+    // As in makeBlockFromProtobufBlock, a block of specimens becomes a
+    // block of cells
+
+    block = CellBlock(id);
+    CellBlock &cblock = (CellBlock&)block;
+    cblock.swapCells(cells);
+
+    return true;
+
+}   //  end makeBlockFromBytes
+
+// Find the study identifier and the span of each specimen of an encoded
+// block, without decoding the specimens.  Returns false if the encoding
+// is not of a non-empty block of specimens, or is not well formed; the
+// caller then leaves it all to the full parser.
+
+bool YosokumoProtobuf::scanProtobufSpecimenBlock(
+    const std::vector<uint8_t> &blockAsBytes,
+    std::string &studyIdentifier,
+    ItemSpans &specimenSpans)
+{
+    enum { STUDY_IDENTIFIER = 1, EMPTY = 2, PREDICTOR = 3, SPECIMEN = 4 };
+
+    if (blockAsBytes.empty())
+        return false;
+
+    const uint8_t *begin = &blockAsBytes[0];
+    const uint8_t *end   = begin + blockAsBytes.size();
+    const uint8_t *p     = begin;
+
+    studyIdentifier.clear();
+    specimenSpans.clear();
+
+    bool empty = false;
+
+    while (p < end)
+    {
+        WireField f;
+        if (!readField(p, end, f))
+            return false;
+
+        if (f.wireType == VARINT && f.number == EMPTY)
+            empty = (f.value != 0);
+        else if (f.data == NULL)
+            ;
+        else if (f.number == STUDY_IDENTIFIER)
+            studyIdentifier.assign((const char *)f.data, f.length);
+        else if (f.number == PREDICTOR)
+            return false;
+        else if (f.number == SPECIMEN)
+            specimenSpans.push_back(std::make_pair(size_t(f.data - begin),
+                                                                f.length));
+    }
+
+    return !empty;
+
+}   //  end scanProtobufSpecimenBlock
+
+
 //************************   Block -> protobuf   **************************
 
 bool YosokumoProtobuf::makeBytesFromBlock(
     const Block &block,
     std::vector<uint8_t> &blockAsBytes)
 {
+    ScopedTimer timer(Metrics::SERIALIZE_TIME);
+    YOSOKUMO_TRACK_ALLOCATIONS("YosokumoProtobuf::makeBytesFromBlock");
+
     ProtoBuf::Block protoBlock;
 
     if (!makeProtobufBlockFromBlock(block, protoBlock))
@@ -1513,6 +2011,23 @@ bool YosokumoProtobuf::makeProtobufBlockFromBlock(
         break;
     }
 
+    case Block::CELL:
+    {
+        // The reverse of makeBlockFromProtobufBlock:  each cell becomes a
+        // specimen with the cell key and a predictand of the cell value.
+
+        protoBlock.clear_empty();
+        CellBlock &cblock = (CellBlock&)block;
+        for (unsigned i = 0;  i < cblock.size();  ++i)
+        {
+            ProtoBuf::Specimen *pProtoSpecimen = protoBlock.add_specimen();
+            if (!makeProtobufSpecimenFromCell(cblock.getCell(i), 
+                                                            *pProtoSpecimen))
+                return false;
+        }
+        break;
+    }
+
     default:
         protoBlock.set_empty(true);
         exception = ServiceException(
@@ -1524,6 +2039,102 @@ bool YosokumoProtobuf::makeProtobufBlockFromBlock(
     return true;
 }
 
+bool YosokumoProtobuf::makeProtobufSpecimenFromCell(
+    const Cell &cell,
+    ProtoBuf::Specimen &protoSpecimen)
+{
+    Specimen specimen(cell.getKey());
+    specimen.setPredictand(cell.getValue());
+
+    return makeProtobufSpecimenFromSpecimen(specimen, protoSpecimen);
+}
+
+bool YosokumoProtobuf::splitBlock(
+    const Block &block,
+    size_t maxChunkBytes,
+    std::vector<uint64_t> &chunkStarts)
+{
+    using google::protobuf::io::CodedOutputStream;
+
+    chunkStarts.clear();
+    chunkStarts.push_back(0);
+
+    // Every chunk repeats the study identifier
+
+    size_t idSize = block.getStudyIdentifier().size();
+    size_t headerSize = 1 + CodedOutputStream::VarintSize32(idSize) + idSize;
+
+    size_t chunkSize = headerSize;
+
+    for (uint64_t i = 0;  i < block.getItemCount();  ++i)
+    {
+        size_t itemSize;
+        if (!getBlockItemSize(block, i, itemSize))
+            return false;
+
+        if (chunkSize > headerSize && chunkSize + itemSize > maxChunkBytes)
+        {
+            chunkStarts.push_back(i);
+            chunkSize = headerSize;
+        }
+        chunkSize += itemSize;
+    }
+
+    return true;
+}
+
+// The size of an item as encoded in a block:  the item itself, plus its 
+// field tag (one byte for both predictor and specimen) and length prefix.
+
+bool YosokumoProtobuf::getBlockItemSize(
+    const Block &block,
+    uint64_t index,
+    size_t &itemSize)
+{
+    using google::protobuf::io::CodedOutputStream;
+
+    int size = 0;
+
+    switch (block.getType())
+    {
+    case Block::PREDICTOR:
+    {
+        ProtoBuf::Predictor protoPredictor;
+        if (!makeProtobufPredictorFromPredictor(
+                ((PredictorBlock&)block).getPredictor(index), protoPredictor))
+            return false;
+        size = protoPredictor.ByteSize();
+        break;
+    }
+
+    case Block::SPECIMEN:
+    {
+        ProtoBuf::Specimen protoSpecimen;
+        if (!makeProtobufSpecimenFromSpecimen(
+                *((SpecimenBlock&)block).getSpecimen(index), protoSpecimen))
+            return false;
+        size = protoSpecimen.ByteSize();
+        break;
+    }
+
+    case Block::CELL:
+    {
+        ProtoBuf::Specimen protoSpecimen;
+        if (!makeProtobufSpecimenFromCell(
+                ((CellBlock&)block).getCell(index), protoSpecimen))
+            return false;
+        size = protoSpecimen.ByteSize();
+        break;
+    }
+
+    default:
+        break;
+    }
+
+    itemSize = 1 + CodedOutputStream::VarintSize32(size) + size;
+    return true;
+}
+
 bool YosokumoProtobuf::makeBytesFromProtobufBlock(
     const ProtoBuf::Block &protoBlock,
     std::vector<uint8_t> &blockAsBytes)
@@ -1535,6 +2146,158 @@ bool YosokumoProtobuf::makeBytesFromProtobufBlock(
     return protoBlock.SerializeToArray(&blockAsBytes[0], numBytes);
 }
 
+// A block with fewer items than this is encoded serially, into one segment;
+// otherwise the items are divided into up to this many segments per worker,
+// so that a worker which falls behind can have some of its share stolen
+
+static const size_t PARALLEL_ENCODE_MIN_ITEMS = 4096;
+static const size_t SEGMENTS_PER_WORKER       = 4;
+
+// Encodes ranges of the specimens (or cells) of a block, each range into a
+// segment, as the specimen fields of a ProtoBuf::Block.  As in
+// SpecimenRangeTask, each worker has its own ProtoBuf::Specimen and
+// YosokumoProtobuf.
+
+class YosokumoProtobuf::SpecimenSegmentTask : public IndexedTask
+{
+    const Block                        &block;
+    size_t                             itemsPerSegment;
+    std::vector<std::vector<uint8_t> > &segments;     // Segment 0 is the id
+    std::vector<ServiceException>      &exceptions;   // One per segment
+    std::vector<YosokumoProtobuf *>    difs;
+    std::vector<ProtoBuf::Specimen *>  protoSpecimens;
+
+public:
+
+    SpecimenSegmentTask(
+        const Block                        &block,
+        size_t                             itemsPerSegment,
+        std::vector<std::vector<uint8_t> > &segments,
+        std::vector<ServiceException>      &exceptions,
+        unsigned                           numWorkers) :
+            block(block), itemsPerSegment(itemsPerSegment),
+            segments(segments), exceptions(exceptions)
+    {
+        for (unsigned i = 0;  i < numWorkers;  ++i)
+        {
+            difs.push_back(new YosokumoProtobuf);
+            protoSpecimens.push_back(new ProtoBuf::Specimen);
+        }
+    }
+
+    ~SpecimenSegmentTask()
+    {
+        for (size_t i = 0;  i < difs.size();  ++i)
+        {
+            delete difs[i];
+            delete protoSpecimens[i];
+        }
+    }
+
+    void runItem(unsigned worker, size_t range)
+    {
+        using google::protobuf::io::CodedOutputStream;
+
+        YosokumoProtobuf     &dif           = *difs[worker];
+        ProtoBuf::Specimen   &protoSpecimen = *protoSpecimens[worker];
+        std::vector<uint8_t> &segment       = segments[range + 1];
+
+        uint64_t begin = range * itemsPerSegment;
+        uint64_t end   = std::min(uint64_t(begin + itemsPerSegment),
+                                                    block.getItemCount());
+
+        for (uint64_t i = begin;  i < end;  ++i)
+        {
+            protoSpecimen.Clear();
+
+            bool ok = (block.getType() == Block::SPECIMEN) ?
+                dif.makeProtobufSpecimenFromSpecimen(
+                    *((const SpecimenBlock&)block).getSpecimen(i),
+                                                            protoSpecimen) :
+                dif.makeProtobufSpecimenFromCell(
+                    ((const CellBlock&)block).getCell(i), protoSpecimen);
+            if (!ok)
+            {
+                dif.getException(exceptions[range]);
+                return;
+            }
+
+            // The field tag and length, then the specimen
+
+            uint32_t size = uint32_t(protoSpecimen.ByteSize());
+            size_t   at   = segment.size();
+            segment.resize(at + 1 + CodedOutputStream::VarintSize32(size) +
+                                                                        size);
+
+            uint8_t *p = &segment[at];
+            *p++ = SPECIMEN_TAG;
+            p = CodedOutputStream::WriteVarint32ToArray(size, p);
+            protoSpecimen.SerializeWithCachedSizesToArray(p);
+        }
+    }
+
+private:
+
+    enum { SPECIMEN_TAG = (4 << 3) | 2 };   // Field 4, length delimited
+};
+
+bool YosokumoProtobuf::makeSegmentsFromBlock(
+    const Block &block,
+    std::vector<std::vector<uint8_t> > &segments,
+    WorkStealingPool &pool)
+{
+    using google::protobuf::io::CodedOutputStream;
+
+    uint64_t n = block.getItemCount();
+    bool specimens = (block.getType() == Block::SPECIMEN ||
+                                            block.getType() == Block::CELL);
+
+    if (pool.size() < 2 || !specimens || n < PARALLEL_ENCODE_MIN_ITEMS)
+    {
+        segments.resize(1);
+        return makeBytesFromBlock(block, segments[0]);
+    }
+
+    ScopedTimer timer(Metrics::SERIALIZE_TIME);
+    YOSOKUMO_TRACK_ALLOCATIONS("YosokumoProtobuf::makeSegmentsFromBlock");
+
+    size_t numRanges = pool.size() * SEGMENTS_PER_WORKER;
+    size_t itemsPerSegment = size_t((n + numRanges - 1) / numRanges);
+    numRanges = size_t((n + itemsPerSegment - 1) / itemsPerSegment);
+
+    segments.assign(numRanges + 1, std::vector<uint8_t>());
+
+    // The study identifier comes first, as field 1 of the block
+
+    const std::string id = block.getStudyIdentifier();
+    std::vector<uint8_t> &header = segments[0];
+    header.resize(1 + CodedOutputStream::VarintSize32(id.size()) + id.size());
+    uint8_t *p = &header[0];
+    *p++ = (1 << 3) | 2;
+    p = CodedOutputStream::WriteVarint32ToArray(uint32_t(id.size()), p);
+    std::copy(id.begin(), id.end(), p);
+
+    std::vector<ServiceException> exceptions(numRanges);
+    {
+        SpecimenSegmentTask task(block, itemsPerSegment, segments, exceptions,
+                                                                pool.size());
+        pool.forEach(numRanges, task);
+    }
+
+    for (size_t i = 0;  i < numRanges;  ++i)
+    {
+        if (isException(exceptions[i]))
+        {
+            exception = exceptions[i];
+            segments.clear();
+            return false;
+        }
+    }
+
+    return true;
+
+}   //  end makeSegmentsFromBlock
+
 
 //***********************   protobuf -> Message   *************************
 
@@ -1543,6 +2306,9 @@ bool YosokumoProtobuf::makeMessageFromBytes(
     const std::vector<uint8_t> &messageAsBytes,
     Message &message)
 {
+    ScopedTimer timer(Metrics::PARSE_TIME);
+    YOSOKUMO_TRACK_ALLOCATIONS("YosokumoProtobuf::makeMessageFromBytes");
+
     ProtoBuf::Message protoMessage;
 
     if (!makeProtobufMessageFromBytes(messageAsBytes, protoMessage))
@@ -1613,6 +2379,9 @@ bool YosokumoProtobuf::makeBytesFromMessage(
     const Message &message,
     std::vector<uint8_t> &messageAsBytes)
 {
+    ScopedTimer timer(Metrics::SERIALIZE_TIME);
+    YOSOKUMO_TRACK_ALLOCATIONS("YosokumoProtobuf::makeBytesFromMessage");
+
     ProtoBuf::Message protoMessage;
 
     if (!makeProtobufMessageFromMessage(message, protoMessage))
@@ -6,8 +6,14 @@
 #include "YosokumoDIF.h"
 #include "yosokumo.pb.h"
 
+#include <utility>
+
 namespace Yosokumo
 {
+
+class LazyCatalog;
+class WorkStealingPool;
+
 /**
  * Implements all functionality for transforming HTTP entity bytes in Google 
  * Protocol Buffer form into Yosokumo C++ objects (e.g., <code>Catalog</code> 
@@ -66,6 +72,22 @@ public:
         const std::vector<uint8_t> &catalogAsBytes,
         Catalog &catalog);
 
+    /**
+     * Make a catalog which decodes its studies only when they are asked
+     * for.  The top level of the encoding, and the top level of each
+     * study, is scanned once, to find where each study lies and what its
+     * identifier is; nothing is decoded.
+     *
+     * @param  catalogAsBytes  the encoded catalog.  On success the bytes
+     *             are moved into the catalog, and this is left empty.
+     * @param  catalog  set to the catalog.
+     *
+     * @return <code>true</code> means success.
+     */
+    bool makeLazyCatalogFromBytes(
+        std::vector<uint8_t> &catalogAsBytes,
+        LazyCatalog &catalog);
+
 private:
 
     bool makeProtobufCatalogFromBytes(
@@ -102,6 +124,11 @@ public:
         const std::vector<uint8_t> &studyAsBytes,
         Study &study);
 
+    bool makeStudyFromBytes(
+        const uint8_t *studyAsBytes,
+        size_t numBytes,
+        Study &study);
+
 private:
 
     bool makeProtobufStudyFromBytes(
@@ -457,8 +484,39 @@ public:
         const std::vector<uint8_t> &blockAsBytes,
         Block &block);
 
+    /**
+     * Decode a block as <code>makeBlockFromBytes</code> does, but decode
+     * the specimens of a large block of specimens in parallel, on the
+     * workers of a pool.  The top level of the encoding is scanned first
+     * to find where each specimen starts; then ranges of specimens are
+     * decoded, each by a worker, straight into their places in the cell
+     * sequence of the result.  Other blocks, and blocks with too few
+     * specimens to be worth dividing, are decoded on the calling thread.
+     *
+     * @param  blockAsBytes  the encoded block.
+     * @param  block  set to the decoded block.
+     * @param  pool  the pool on which to decode.  Not used by other calls
+     *             meanwhile, as <code>forEach()</code> calls on a pool run
+     *             one at a time.
+     *
+     * @return <code>true</code> means success.
+     */
+    bool makeBlockFromBytes(
+        const std::vector<uint8_t> &blockAsBytes,
+        Block &block,
+        WorkStealingPool &pool);
+
 private:
 
+    class SpecimenRangeTask;
+
+    typedef std::vector<std::pair<size_t, size_t> > ItemSpans;
+
+    bool scanProtobufSpecimenBlock(
+        const std::vector<uint8_t> &blockAsBytes,
+        std::string &studyIdentifier,
+        ItemSpans &specimenSpans);
+
     bool makeProtobufBlockFromBytes(
         const std::vector<uint8_t> &blockAsBytes,
         ProtoBuf::Block &protoBlock);
@@ -475,12 +533,64 @@ public:
         const Block &block,
         std::vector<uint8_t> &blockAsBytes);
 
+    /**
+     * Divide a block into chunks whose encoded sizes do not exceed a limit.
+     * Sizes are computed from the encoded size of each item, without 
+     * encoding the whole block.  An item too big for the limit by itself 
+     * gets a chunk of its own.
+     *
+     * @param  block  the block to divide.
+     * @param  maxChunkBytes  the limit on the encoded size of a chunk.
+     * @param  chunkStarts  set to the index of the first item of each chunk.
+     *             A block with no items has one (empty) chunk.
+     *
+     * @return <code>true</code> means success.
+     */
+    bool splitBlock(
+        const Block &block,
+        size_t maxChunkBytes,
+        std::vector<uint64_t> &chunkStarts);
+
+    /**
+     * Encode a block as <code>makeBytesFromBlock</code> does, but as a list
+     * of segments whose concatenation is the encoding, so the whole need
+     * never be in one buffer; e.g., the segments may be posted with
+     * <code>YosokumoRequest::postToServer()</code>, which sends them in a
+     * gathered write.  The specimens of a large block of specimens or
+     * cells are encoded in parallel, on the workers of a pool, each range
+     * of specimens into a segment of its own after a first segment holding
+     * the study identifier.  Other blocks, and blocks with too few items
+     * to be worth dividing, are encoded into one segment on the calling
+     * thread.
+     *
+     * @param  block  the block to encode.
+     * @param  segments  set to the segments of the encoding.
+     * @param  pool  the pool on which to encode.
+     *
+     * @return <code>true</code> means success.
+     */
+    bool makeSegmentsFromBlock(
+        const Block &block,
+        std::vector<std::vector<uint8_t> > &segments,
+        WorkStealingPool &pool);
+
 private:
 
+    class SpecimenSegmentTask;
+
     bool makeProtobufBlockFromBlock(
         const Block &block,
         ProtoBuf::Block &protoBlock);
 
+    bool makeProtobufSpecimenFromCell(
+        const Cell &cell,
+        ProtoBuf::Specimen &protoSpecimen);
+
+    bool getBlockItemSize(
+        const Block &block,
+        uint64_t index,
+        size_t &itemSize);
+
     bool makeBytesFromProtobufBlock(
         const ProtoBuf::Block &protoBlock,
         std::vector<uint8_t> &blockAsBytes);
@@ -1,18 +1,66 @@
 // YosokumoRequest.cpp
 
 #include "YosokumoRequest.h"
+#include "DigestRequest.h"
+#include "Metrics.h"
+#include "TraceBuffer.h"
 #include "StringUtil.h"
 
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <sstream>
+
 using namespace Yosokumo;
 
 // Only used as default value
 std::vector<uint8_t> YosokumoRequest::emptyEntity;
 
+// The most parts one sendmsg() call accepts
+
+#ifdef IOV_MAX
+static const size_t MAX_SEND_PARTS = IOV_MAX;
+#else
+static const size_t MAX_SEND_PARTS = 16;    // The POSIX minimum
+#endif
+
+// The most of a file read at once to be compressed
+
+static const size_t FILE_PIECE_SIZE = 65536;
+
+// Add a buffer to the parts of an entity; empty buffers are left out
+
+static void addPart(
+    std::vector<struct iovec>  &parts, 
+    const std::vector<uint8_t> &bytes)
+{
+    if (bytes.empty())
+        return;
+
+    struct iovec part;
+    part.iov_base = const_cast<uint8_t *>(&bytes[0]);
+    part.iov_len  = bytes.size();
+    parts.push_back(part);
+}
+
 YosokumoRequest::YosokumoRequest(
     const Credentials &credentials,
     const std::string &hostName,
     int               port,
-    const std::string &contentType)
+    const std::string &contentType) :
+        compressor(Compression::IDENTITY)
 {
     this->trace       = false;
 
@@ -21,11 +69,23 @@ YosokumoRequest::YosokumoRequest(
     this->port        = port;
     this->contentType = contentType;
 
+    socketFd      = -1;
+    connectedPort = 0;
+    timeout       = DEFAULT_TIMEOUT;
+
+    conditionalGet   = false;
+    notModifiedEntry = NULL;
+
     initForOperation();
 
     emptyEntity.clear();
 }
 
+YosokumoRequest::~YosokumoRequest()
+{
+    closeConnection();
+}
+
 void YosokumoRequest::initForOperation()
 {
     auxHeaderName  = "";
@@ -33,6 +93,8 @@ void YosokumoRequest::initForOperation()
     statusCode     = 0;
     entity.clear();
     exception      = ServiceException();
+    responseHeaders.clear();
+    notModifiedEntry = NULL;
 }
 
 void YosokumoRequest::setCredentials(Credentials credentials)
@@ -65,7 +127,45 @@ int YosokumoRequest::getStatusCode()
 
 void YosokumoRequest::getEntity(std::vector<uint8_t> &putEntityHere)
 {
-    putEntityHere = entity;
+    if (notModifiedEntry != NULL)
+        putEntityHere = notModifiedEntry->entity;
+    else
+        putEntityHere = entity;
+}
+
+void YosokumoRequest::setConditionalGet(bool on)
+{
+    conditionalGet = on;
+
+    if (!on)
+    {
+        entityCache.clear();
+        notModifiedEntry = NULL;
+    }
+}
+
+bool YosokumoRequest::getConditionalGet()
+{
+    return conditionalGet;
+}
+
+bool YosokumoRequest::isNotModified()
+{
+    return notModifiedEntry != NULL;
+}
+
+bool YosokumoRequest::setCompression(Compression::Coding coding, int level)
+{
+    if (!Compression::isAvailable(coding))
+        return false;
+
+    compressor = Compressor(coding, level);
+    return true;
+}
+
+Compression::Coding YosokumoRequest::getCompression()
+{
+    return compressor.getCoding();
 }
 
 bool YosokumoRequest::isException()
@@ -78,219 +178,902 @@ ServiceException YosokumoRequest::getException()
     return exception;
 }
 
-//??? From this point on the code for the function bodies needs work
+// Case-insensitive comparison of header names
+
+static bool sameHeaderName(const std::string &a, const std::string &b)
+{
+    if (a.size() != b.size())
+        return false;
+
+    for (std::string::size_type i = 0;  i < a.size();  ++i)
+        if (tolower((unsigned char)a[i]) != tolower((unsigned char)b[i]))
+            return false;
+
+    return true;
+}
+
+bool YosokumoRequest::getResponseHeader(
+    const std::string &name, 
+    std::string       &value)
+{
+    for (unsigned i = 0;  i < responseHeaders.size();  ++i)
+    {
+        if (sameHeaderName(responseHeaders[i].first, name))
+        {
+            value = responseHeaders[i].second;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void YosokumoRequest::setTimeout(unsigned milliseconds)
+{
+    timeout = milliseconds;
+}
+
+bool YosokumoRequest::isConnected()
+{
+    return socketFd >= 0;
+}
+
+void YosokumoRequest::closeConnection()
+{
+    if (socketFd >= 0)
+        close(socketFd);
+
+    socketFd = -1;
+    connectedHost.clear();
+    connectedPort = 0;
+    readBuffer.clear();
+}
 
 bool YosokumoRequest::getFromServer(const std::string &resourceUri)
 {
-    std::string uri = normalizeResourceUri(resourceUri, hostName, port);
-    
-    return makeRequest(1, "getFromServer");
-//??    return makeRequest(new HttpGet(uri), "getFromServer");
+    HttpRequest request;
+    request.method = "GET";
+    request.uri    = normalizeResourceUri(resourceUri, hostName, port);
+
+    if (!conditionalGet)
+        return makeRequest(request, "getFromServer");
+
+    std::map<std::string, CachedEntity>::iterator it = 
+                                                entityCache.find(request.uri);
+
+    if (it != entityCache.end())
+    {
+        const CachedEntity &c = it->second;
+        if (!c.eTag.empty())
+            request.headers.push_back(Header("If-None-Match", c.eTag));
+        if (!c.lastModified.empty())
+            request.headers.push_back(
+                            Header("If-Modified-Since", c.lastModified));
+    }
+
+    if (!makeRequest(request, "getFromServer"))
+        return false;
+
+    if (statusCode == 304 && it != entityCache.end())
+    {
+        notModifiedEntry = &it->second;
+        return true;
+    }
+
+    // Keep the entity of a successful response if the server gave a 
+    // validator for it
+
+    std::string eTag, lastModified;
+    bool hasETag         = getResponseHeader("ETag", eTag);
+    bool hasLastModified = getResponseHeader("Last-Modified", lastModified);
+
+    if (statusCode == 200 && (hasETag || hasLastModified))
+    {
+        CachedEntity &c = entityCache[request.uri];
+        c.eTag         = eTag;
+        c.lastModified = lastModified;
+        c.entity       = entity;
+    }
+    else if (it != entityCache.end())
+        entityCache.erase(it);
+
+    return true;
+}
+
+bool YosokumoRequest::getFromServerIfChanged(
+    const std::string &resourceUri,
+    const std::string &eTag,
+    const std::string &lastModified)
+{
+    HttpRequest request;
+    request.method = "GET";
+    request.uri    = normalizeResourceUri(resourceUri, hostName, port);
+
+    if (!eTag.empty())
+        request.headers.push_back(Header("If-None-Match", eTag));
+    if (!lastModified.empty())
+        request.headers.push_back(Header("If-Modified-Since", lastModified));
+
+    return makeRequest(request, "getFromServerIfChanged");
 }
 
 bool YosokumoRequest::postToServer(
     const std::string          &resourceUri, 
     const std::vector<uint8_t> &entityToPost)
 {
-    std::string uri = normalizeResourceUri(resourceUri, hostName, port);
-    return makeRequest(2, "postToServer", entityToPost);
-//??    return makeRequest(new HttpPost(uri), "postToServer", entityToPost);
+    HttpRequest request;
+    request.method = "POST";
+    request.uri    = normalizeResourceUri(resourceUri, hostName, port);
+
+    return makeRequest(request, "postToServer", entityToPost);
+}
+
+bool YosokumoRequest::postToServer(
+    const std::string                        &resourceUri, 
+    const std::vector<std::vector<uint8_t> > &segments)
+{
+    HttpRequest request;
+    request.method = "POST";
+    request.uri    = normalizeResourceUri(resourceUri, hostName, port);
+
+    EntityParts parts;
+    for (size_t i = 0;  i < segments.size();  ++i)
+        addPart(parts, segments[i]);
+
+    return makeRequestFromParts(request, "postToServer", parts);
+}
+
+bool YosokumoRequest::postFileToServer(
+    const std::string &resourceUri, 
+    int               fd,
+    off_t             offset,
+    size_t            length)
+{
+    HttpRequest request;
+    request.method = "POST";
+    request.uri    = normalizeResourceUri(resourceUri, hostName, port);
+
+    FilePart file;
+    file.fd     = fd;
+    file.offset = offset;
+    file.length = length;
+
+    return makeRequestFromParts(request, "postFileToServer", EntityParts(), 
+                                                                    &file);
 }
 
 bool YosokumoRequest::deleteFromServer(const std::string &resourceUri)
 {
-    std::string uri = normalizeResourceUri(resourceUri, hostName, port);
+    HttpRequest request;
+    request.method = "DELETE";
+    request.uri    = normalizeResourceUri(resourceUri, hostName, port);
     
-    return makeRequest(3, "deleteFromServer");
-//??    return makeRequest(new HttpDelete(uri), "deleteFromServer");
+    return makeRequest(request, "deleteFromServer");
 }
 
 bool YosokumoRequest::putToServer(
     const std::string          &resourceUri,
     const std::vector<uint8_t> &entityToPost)
 {
-    std::string uri = normalizeResourceUri(resourceUri, hostName, port);
+    HttpRequest request;
+    request.method = "PUT";
+    request.uri    = normalizeResourceUri(resourceUri, hostName, port);
     
-    return makeRequest(4, "putToServer", entityToPost);
-//??    return makeRequest(new HttpPut(uri), "putToServer", entityToPost);
+    return makeRequest(request, "putToServer", entityToPost);
 }
 
 
-
 bool YosokumoRequest::makeRequest(
-    HttpRequestBase httpRequest, 
-    const std::string &traceName,
+    HttpRequest                &httpRequest, 
+    const std::string          &traceName,
     const std::vector<uint8_t> &entityToSend)
 {
-#if 0   //??? patch out
+    EntityParts parts;
+    addPart(parts, entityToSend);
+
+    return makeRequestFromParts(httpRequest, traceName, parts);
+}
+
+bool YosokumoRequest::makeRequestFromParts(
+    HttpRequest       &httpRequest, 
+    const std::string &traceName,
+    const EntityParts &entityParts,
+    const FilePart    *filePart)
+{
     if (trace)
-    {
-        System.out.println(traceName+":");
-        System.out.println(credentials.toString());
-    }
+        TraceBuffer::record(TraceBuffer::REQUEST_START, 0, 
+                    httpRequest.method + " " + getUriTarget(httpRequest.uri));
+
+    uint64_t started = Metrics::currentTimeMicros();
 
     statusCode = 0;
-    entity     = null;
-    exception  = null;
+    entity.clear();
+    exception  = ServiceException();
+    responseHeaders.clear();
+    notModifiedEntry = NULL;
+
+    bool hasEntity = 
+                (httpRequest.method == "POST" || httpRequest.method == "PUT");
+
+    size_t entitySize = 0;
+    for (size_t i = 0;  i < entityParts.size();  ++i)
+        entitySize += entityParts[i].iov_len;
+    if (filePart != NULL)
+        entitySize += filePart->length;
+
+    // Compress the entity, if compression is on.  The parts, and the file
+    // range a piece at a time, pass through the compressor without first
+    // being joined.  The compressed entity is kept whole:  its length goes
+    // in the Content-Length header, which is part of the signed request
+    // string (see makeRequestString()), so it must be known before the
+    // request is signed, and the request cannot be sent chunked.
+
+    Compression::Coding coding = compressor.getCoding();
+    std::vector<uint8_t> compressed;
+    bool compress = hasEntity && coding != Compression::IDENTITY && 
+                                                            entitySize > 0;
+
+    EntityParts body = hasEntity ? entityParts : EntityParts();
+    const FilePart *bodyFile = hasEntity ? filePart : NULL;
+
+    if (compress)
+    {
+        bool ok = compressor.start();
+
+        for (size_t i = 0;  ok && i < entityParts.size();  ++i)
+            ok = compressor.update((const uint8_t *)entityParts[i].iov_base,
+                                        entityParts[i].iov_len, compressed);
+
+        if (ok && filePart != NULL && filePart->length > 0 && 
+                        !compressFilePart(*filePart, traceName, compressed))
+            return false;
+
+        if (!ok || !compressor.finish(compressed))
+        {
+            exception = compressor.getException();
+            return false;
+        }
+
+        body.clear();
+        addPart(body, compressed);
+        bodyFile   = NULL;
+        entitySize = compressed.size();
+    }
 
     // Add headers to the request
 
-    httpRequest.addHeader("Host",   hostName);
-    httpRequest.addHeader("Date",   DateUtils.formatDate(new Date()));
-    httpRequest.addHeader("Accept", contentType);
+    char date[64];
+    time_t now = time(NULL);
+    struct tm gmt;
+    gmtime_r(&now, &gmt);
+    strftime(date, sizeof(date), "%a, %d %b %Y %H:%M:%S GMT", &gmt);
+
+    HeaderList &h = httpRequest.headers;
+
+    h.push_back(Header("Host",   hostName));
+    h.push_back(Header("Date",   date    ));
+    h.push_back(Header("Accept", contentType));
 
-    if (auxHeaderName != null && !auxHeaderName.isEmpty())
+    if (coding != Compression::IDENTITY)
+        h.push_back(Header("Accept-Encoding", 
+                                        Compression::getCodingName(coding)));
+
+    if (!auxHeaderName.empty())
     {
-        httpRequest.addHeader(auxHeaderName, auxHeaderValue);
-        auxHeaderName  = null;
-        auxHeaderValue = null;
+        h.push_back(Header(auxHeaderName, auxHeaderValue));
+        auxHeaderName  = "";
+        auxHeaderValue = "";
     }
 
-    if (entityToSend != null)
+    if (hasEntity)
     {
-        httpRequest.addHeader("Content-Type", contentType);
-        httpRequest.addHeader("Content-Length", 
-                                Integer.toString(entityToSend.length));
+        std::stringstream len;
+        len << entitySize;
+
+        h.push_back(Header("Content-Type",   contentType));
+        h.push_back(Header("Content-Length", len.str()));
+        if (compress)
+            h.push_back(Header("Content-Encoding", 
+                                        Compression::getCodingName(coding)));
     }
 
     std::string requestDigest = makeDigest(httpRequest);
-    if (requestDigest == null)
+    if (requestDigest.empty())
         return false;
 
-    httpRequest.addHeader("Authorization", "yosokumo " + 
-                        credentials.getUserId() + ":" + requestDigest);
+    h.push_back(Header("Authorization", "yosokumo " + 
+                        credentials.getUserId() + ":" + requestDigest));
+
+    if (trace)
+        for (unsigned i = 0;  i < h.size();  ++i)
+            TraceBuffer::record(TraceBuffer::REQUEST_HEADER, 0, 
+                                            h[i].first + ": " + h[i].second);
+
+    // Execute the request and get the response
+
+    bool ok = getResponseFromParts(httpRequest, traceName, body, bodyFile);
+
+    recordRequestMetrics(httpRequest.method, ok, started);
+
+    if (trace && !ok)
+        TraceBuffer::record(TraceBuffer::REQUEST_FAILED, statusCode, 
+                                                            exception.what());
+    if (trace)
+        TraceBuffer::record(TraceBuffer::REQUEST_END, 
+                        Metrics::currentTimeMicros() - started, traceName);
+
+    return ok;
 
-    if (entityToSend != null)
+}   //  end makeRequestFromParts
+
+void YosokumoRequest::recordRequestMetrics(
+    const std::string &method, 
+    bool              ok,
+    uint64_t          started)
+{
+    if (method == "GET")
+        Metrics::increment(Metrics::REQUESTS_GET);
+    else if (method == "POST")
+        Metrics::increment(Metrics::REQUESTS_POST);
+    else if (method == "PUT")
+        Metrics::increment(Metrics::REQUESTS_PUT);
+    else if (method == "DELETE")
+        Metrics::increment(Metrics::REQUESTS_DELETE);
+
+    if (!ok || statusCode < 100 || statusCode > 599)
+        Metrics::increment(Metrics::TRANSPORT_ERRORS);
+    else
+        Metrics::increment(
+            Metrics::Counter(Metrics::RESPONSES_1XX + statusCode / 100 - 1));
+
+    Metrics::record(Metrics::REQUEST_TIME, 
+                                    Metrics::currentTimeMicros() - started);
+}
+
+bool YosokumoRequest::getResponse(
+    const HttpRequest          &httpRequest, 
+    const std::string          &traceName,
+    const std::vector<uint8_t> &entityToSend) 
+{
+    EntityParts parts;
+    addPart(parts, entityToSend);
+
+    return getResponseFromParts(httpRequest, traceName, parts);
+}
+
+bool YosokumoRequest::getResponseFromParts(
+    const HttpRequest &httpRequest, 
+    const std::string &traceName,
+    const EntityParts &entityParts,
+    const FilePart    *filePart)
+{
+    std::string host;
+    int         hostPort;
+    getUriHostAndPort(httpRequest.uri, host, hostPort);
+
+    if (socketFd >= 0 && (host != connectedHost || hostPort != connectedPort))
+        closeConnection();
+
+    // The request head is assembled in one string and sent together with
+    // the parts of the entity in a single gathered write.
+
+    std::string head = httpRequest.method + " " + 
+                        getUriTarget(httpRequest.uri) + " HTTP/1.1\r\n";
+    for (unsigned i = 0;  i < httpRequest.headers.size();  ++i)
+        head += httpRequest.headers[i].first + ": " + 
+                httpRequest.headers[i].second + "\r\n";
+    head += "\r\n";
+
+    std::vector<struct iovec> iov(1);
+    iov[0].iov_base = const_cast<char *>(head.data());
+    iov[0].iov_len  = head.size();
+    iov.insert(iov.end(), entityParts.begin(), entityParts.end());
+
+    size_t entitySize = 0;
+    for (size_t i = 0;  i < entityParts.size();  ++i)
+        entitySize += entityParts[i].iov_len;
+    if (filePart != NULL)
+        entitySize += filePart->length;
+
+    // A reused connection may have been closed by the server while idle.  
+    // In that case nothing at all comes back, and the request is tried once 
+    // more on a fresh connection.  Only an idempotent request is tried 
+    // again:  the server may have acted on a POST before the connection 
+    // dropped.
+
+    bool idempotent = (httpRequest.method != "POST");
+
+    for (int attempt = 0;  attempt < 2;  ++attempt)
     {
-        // We need the Content-Length header to compute the digest, but 
-        // we can't keep it as a header because the call of setEntity 
-        // below causes a Content-Length header to be automatically 
-        // generated, and if there are two of them, an exception is 
-        // thrown.
+        bool reused = (socketFd >= 0);
+
+        if (!reused && !connectToServer(host, hostPort))
+            return false;
 
-        httpRequest.removeHeaders("Content-Length");
-        ByteArrayEntity baEntity = new ByteArrayEntity(entityToSend);
-        ((HttpEntityEnclosingRequestBase)httpRequest).setEntity(baEntity);
+        bool nothingReceived = false;
+
+        uint64_t sendStarted = Metrics::currentTimeMicros();
+        bool sent = sendAll(&iov[0], int(iov.size()), filePart != NULL);
+        if (sent && filePart != NULL)
+            sent = sendFile(*filePart);
+        if (sent)
+        {
+            Metrics::record(Metrics::SEND_TIME, 
+                                Metrics::currentTimeMicros() - sendStarted);
+            Metrics::increment(Metrics::BYTES_SENT, head.size() + entitySize);
+            if (trace)
+                TraceBuffer::record(TraceBuffer::BYTES_SENT, 
+                                                head.size() + entitySize);
+        }
+
+        if (sent && readResponse(httpRequest, nothingReceived))
+            break;
+
+        closeConnection();
+
+        if (!reused || !nothingReceived || !idempotent)
+        {
+            if (!YosokumoDIF::isException(exception))
+                exception = ServiceException("Fatal transport error in " + 
+                                                traceName, statusCode, 
+                                                traceName);
+            return false;
+        }
+
+        exception = ServiceException();
+        statusCode = 0;
+        entity.clear();
+        responseHeaders.clear();
     }
 
     if (trace)
     {
-        System.out.println("  Request:");
-        System.out.println("    Request line: " + 
-                                            httpRequest.getRequestLine());
-        HeaderIterator it = httpRequest.headerIterator(null);
-        while (it.hasNext())
-            System.out.println("    " + it.next());
+        TraceBuffer::record(TraceBuffer::RESPONSE_STATUS, statusCode);
+        for (unsigned i = 0;  i < responseHeaders.size();  ++i)
+            TraceBuffer::record(TraceBuffer::RESPONSE_HEADER, 0, 
+                                            responseHeaders[i].first + ": " + 
+                                            responseHeaders[i].second);
+        TraceBuffer::record(TraceBuffer::BYTES_RECEIVED, entity.size());
     }
 
-    // Execute the request and get the response
+    return true;
 
-    return getResponse(httpRequest, traceName);
-#endif
-return false;    
+}   //  end getResponseFromParts
 
-}   //  end makeRequest
+// Pass a range of a file through the compressor a piece at a time
 
-bool YosokumoRequest::getResponse(HttpRequestBase httpRequest, const std::string &traceName) 
+bool YosokumoRequest::compressFilePart(
+    const FilePart       &filePart, 
+    const std::string    &traceName,
+    std::vector<uint8_t> &compressed)
 {
-#if 0 //???
-    HttpClient httpclient = new DefaultHttpClient();
+    std::vector<uint8_t> buffer(std::min(filePart.length, FILE_PIECE_SIZE));
 
-    try
+    off_t  offset = filePart.offset;
+    size_t left   = filePart.length;
+
+    while (left > 0)
+    {
+        ssize_t n = pread(filePart.fd, &buffer[0], 
+                                    std::min(left, buffer.size()), offset);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+        {
+            exception = ServiceException(
+                "Cannot read entity from file", traceName);
+            return false;
+        }
+
+        if (!compressor.update(&buffer[0], size_t(n), compressed))
+        {
+            exception = compressor.getException();
+            return false;
+        }
+
+        offset += n;
+        left   -= size_t(n);
+    }
+
+    return true;
+}
+
+bool YosokumoRequest::connectToServer(const std::string &host, int hostPort)
+{
+    std::stringstream s;
+    s << hostPort;
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    uint64_t started = Metrics::currentTimeMicros();
+
+    struct addrinfo *addresses = NULL;
+    int rc = getaddrinfo(host.c_str(), s.str().c_str(), &hints, &addresses);
+
+    uint64_t resolved = Metrics::currentTimeMicros();
+    Metrics::record(Metrics::DNS_TIME, resolved - started);
+
+    if (rc != 0)
+    {
+        exception = ServiceException(std::string("Cannot resolve host ") + 
+                host + ": " + gai_strerror(rc), "connectToServer");
+        return false;
+    }
+
+    int fd = -1;
+
+    for (struct addrinfo *a = addresses;  a != NULL;  a = a->ai_next)
+    {
+        fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+        if (fd < 0)
+            continue;
+
+        if (connect(fd, a->ai_addr, a->ai_addrlen) == 0)
+            break;
+
+        close(fd);
+        fd = -1;
+    }
+
+    freeaddrinfo(addresses);
+
+    if (fd < 0)
+    {
+        exception = ServiceException(std::string("Cannot connect to ") + 
+                host + ":" + s.str() + ": " + strerror(errno), 
+                "connectToServer");
+        return false;
+    }
+
+    Metrics::record(Metrics::CONNECT_TIME, 
+                                    Metrics::currentTimeMicros() - resolved);
+    Metrics::increment(Metrics::CONNECTIONS_OPENED);
+
+    struct timeval tv;
+    tv.tv_sec  = timeout / 1000;
+    tv.tv_usec = (timeout % 1000) * 1000;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    socketFd      = fd;
+    connectedHost = host;
+    connectedPort = hostPort;
+    readBuffer.clear();
+
+    return true;
+
+}   //  end connectToServer
+
+// With more, tell the kernel that more is to be sent at once (by 
+// sendFile()), so the end of the head does not go out in a packet by itself
+
+bool YosokumoRequest::sendAll(const struct iovec *iov, int iovcnt, bool more)
+{
+    int flags = MSG_NOSIGNAL | (more ? MSG_MORE : 0);
+
+    std::vector<struct iovec> v(iov, iov + iovcnt);
+    unsigned first = 0;
+
+    while (first < v.size())
     {
-        HttpResponse response = httpclient.execute(httpRequest);
-
-        statusCode = response.getStatusLine().getStatusCode();
-
-        HttpEntity theEntity = response.getEntity();
-
-        if (theEntity != null)
-        { 
-            int contentLen = (int)theEntity.getContentLength();
-
-            if (contentLen < 0)
-            {
-                //  Content length unknown so reading content is awkward
-                final int BUFF_SIZE = 16384;
-                byte [] buffer = new byte[BUFF_SIZE];
-                int totalBytesRead = 0;
-                InputStream is = theEntity.getContent();
-                while (true)
-                {
-                    if (totalBytesRead == buffer.length)
-                    {
-                        byte [] tempArray = new byte[4*buffer.length];
-                        System.arraycopy(buffer, 0, tempArray, 0,  
-                                                        totalBytesRead);
-                        buffer = tempArray;
-                    }
-
-                    int numRead = is.read(buffer, totalBytesRead, 
-                                            buffer.length-totalBytesRead);
-                    if (numRead == -1)
-                        break;
-                    totalBytesRead += numRead;
-                }
-                if (totalBytesRead > 0)
-                {
-                    entity = new byte[totalBytesRead];
-                    System.arraycopy(buffer, 0, entity, 0, totalBytesRead);
-                }
-            }
-
-            if (contentLen >= 0)
-            {
-                // Content length is known so reading content is easy
-                entity = new byte[contentLen];
-                InputStream is = theEntity.getContent();
-                int offset = 0;
-                while (contentLen > 0)
-                {
-                    int numRead = is.read(entity, offset, contentLen);
-                    if (numRead == -1)
-                        break;
-                    offset += numRead;
-                    contentLen -= numRead;
-                }
-                if (contentLen > 0)
-                {
-                    exception = new ServiceException("Attempt to read " + 
-                        "last " + contentLen + " bytes of entity failed"); 
-                    return false;
-                }
-            }
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov    = &v[first];
+        msg.msg_iovlen = std::min(v.size() - first, MAX_SEND_PARTS);
+
+        ssize_t n = sendmsg(socketFd, &msg, flags);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+
+        // Skip over what was sent
+
+        size_t sent = size_t(n);
+        while (first < v.size() && sent >= v[first].iov_len)
+            sent -= v[first++].iov_len;
+        if (first < v.size())
+        {
+            v[first].iov_base = (char *)v[first].iov_base + sent;
+            v[first].iov_len -= sent;
         }
-        if (trace)
+    }
+
+    return true;
+}
+
+bool YosokumoRequest::sendFile(const FilePart &filePart)
+{
+    off_t  offset = filePart.offset;
+    size_t left   = filePart.length;
+
+    while (left > 0)
+    {
+        ssize_t n = sendfile(socketFd, filePart.fd, &offset, left);
+        if (n < 0)
         {
-            System.out.println("  Response:");
-            System.out.println("    Status line: " + 
-                                            response.getStatusLine());
-            HeaderIterator it = response.headerIterator(null);
-            while (it.hasNext())
-                System.out.println("    " + it.next());
+            if (errno == EINTR)
+                continue;
+            return false;
         }
+        if (n == 0)
+            return false;           // The file is shorter than the range
 
+        left -= size_t(n);
     }
-    catch (IOException e)
+
+    return true;
+}
+
+bool YosokumoRequest::fillReadBuffer()
+{
+    char buffer[16384];
+
+    for (;;)
     {
-        exception = new ServiceException("Fatal transport error in " + 
-                                                        traceName, e);
+        ssize_t n = recv(socketFd, buffer, sizeof(buffer), 0);
+        if (n > 0)
+        {
+            readBuffer.append(buffer, n);
+            Metrics::increment(Metrics::BYTES_RECEIVED, n);
+            return true;
+        }
+        if (n < 0 && errno == EINTR)
+            continue;
         return false;
     }
-    finally
+}
+
+bool YosokumoRequest::readLine(std::string &line)
+{
+    std::string::size_type eol;
+
+    while ((eol = readBuffer.find("\r\n")) == std::string::npos)
+        if (!fillReadBuffer())
+            return false;
+
+    line = readBuffer.substr(0, eol);
+    readBuffer.erase(0, eol + 2);
+
+    return true;
+}
+
+bool YosokumoRequest::appendEntity(const char *bytes, size_t n)
+{
+    if (!decompressor.update(reinterpret_cast<const uint8_t *>(bytes), n, 
+                                                                    entity))
     {
-        // When the HttpClient instance is no longer needed, shut down the 
-        // connection manager to ensure immediate deallocation of all 
-        // system resources
+        exception = ServiceException(decompressor.getException().what(), 
+                                                statusCode, "appendEntity");
+        return false;
+    }
+
+    return true;
+}
+
+bool YosokumoRequest::readEntityBytes(size_t n)
+{
+    // Each piece is passed on as it arrives, so that no more than one read 
+    // buffer of the entity is held before it is decompressed
 
-        httpclient.getConnectionManager().shutdown();
+    while (n > 0)
+    {
+        if (readBuffer.empty() && !fillReadBuffer())
+        {
+            std::stringstream s;
+            s << "Attempt to read last " << n << " bytes of entity failed";
+            exception = ServiceException(s.str(), statusCode, 
+                                                        "readEntityBytes");
+            return false;
+        }
+
+        size_t piece = std::min(n, readBuffer.size());
+        bool ok = appendEntity(readBuffer.data(), piece);
+        readBuffer.erase(0, piece);
+        n -= piece;
+
+        if (!ok)
+            return false;
     }
 
     return true;
-#endif
-return false;    
+}
+
+bool YosokumoRequest::readChunkedEntity()
+{
+    for (;;)
+    {
+        std::string line;
+        if (!readLine(line))
+            return false;
+
+        // The size in hex, then perhaps chunk extensions after a ';'
 
-}   //  end getResponse
+        const char *begin = line.c_str();
+        char *end;
+        errno = 0;
+        unsigned long chunkSize = strtoul(begin, &end, 16);
+
+        while (*end == ' ' || *end == '\t')
+            ++end;
+
+        if (!isxdigit((unsigned char)*begin) || errno == ERANGE || 
+                                                (*end != '\0' && *end != ';'))
+        {
+            exception = ServiceException("Malformed chunk size line: " + line,
+                                                statusCode, "readChunkedEntity");
+            return false;
+        }
+
+        if (chunkSize == 0)
+            break;
+
+        if (!readEntityBytes(chunkSize) || !readLine(line))
+            return false;
+    }
+
+    // Skip any trailer headers
+
+    std::string line;
+    do
+    {
+        if (!readLine(line))
+            return false;
+    } while (!line.empty());
+
+    return true;
+}
+
+bool YosokumoRequest::readEntityToEnd()
+{
+    bool ok = true;
+
+    do
+    {
+        ok = appendEntity(readBuffer.data(), readBuffer.size());
+        readBuffer.clear();
+    } while (ok && fillReadBuffer());
+
+    closeConnection();
+
+    return ok;
+}
+
+bool YosokumoRequest::readResponse(
+    const HttpRequest &httpRequest, 
+    bool              &nothingReceived)
+{
+    std::string line;
+
+    uint64_t waitStarted = Metrics::currentTimeMicros();
+    uint64_t firstByteAt = 0;
+
+    nothingReceived = readBuffer.empty();
+
+    // Status line, e.g., "HTTP/1.1 200 OK".  Interim 1xx responses are 
+    // skipped.
+
+    do
+    {
+        if (!readLine(line))
+        {
+            nothingReceived = nothingReceived && readBuffer.empty();
+            return false;
+        }
+        nothingReceived = false;
+
+        if (firstByteAt == 0)
+        {
+            firstByteAt = Metrics::currentTimeMicros();
+            Metrics::record(Metrics::FIRST_BYTE_TIME, 
+                                                firstByteAt - waitStarted);
+        }
+
+        std::string::size_type sp = line.find(' ');
+        if (!startsWith(line, "HTTP/") || sp == std::string::npos)
+        {
+            exception = ServiceException("Malformed status line: " + line, 
+                                                        "readResponse");
+            return false;
+        }
+        statusCode = atoi(line.c_str() + sp + 1);
+
+        responseHeaders.clear();
+        for (;;)
+        {
+            if (!readLine(line))
+                return false;
+            if (line.empty())
+                break;
+
+            std::string::size_type colon = line.find(':');
+            if (colon == std::string::npos)
+                continue;
+
+            std::string name  = line.substr(0, colon);
+            std::string value = line.substr(colon + 1);
+            responseHeaders.push_back(Header(trim(name), trim(value)));
+        }
+    } while (statusCode >= 100 && statusCode < 200);
+
+    // The entity
+
+    std::string value;
+    bool closeAfter = 
+        getResponseHeader("Connection", value) && sameHeaderName(value, "close");
+
+    bool hasBody = !(httpRequest.method == "HEAD" || statusCode == 204 || 
+                                                        statusCode == 304);
+
+    // The entity is decompressed as it is read
+
+    Compression::Coding coding = Compression::IDENTITY;
+    if (hasBody && getResponseHeader("Content-Encoding", value) && 
+                                !Compression::getCodingFromName(value, coding))
+    {
+        exception = ServiceException("Unknown Content-Encoding: " + value, 
+                                                statusCode, "readResponse");
+        return false;
+    }
+
+    if (hasBody && !decompressor.start(coding))
+    {
+        exception = ServiceException(decompressor.getException().what(), 
+                                                statusCode, "readResponse");
+        return false;
+    }
+
+    bool ok = true;
+
+    if (!hasBody)
+        ;
+    else if (getResponseHeader("Transfer-Encoding", value) && 
+                                            !sameHeaderName(value, "identity"))
+        ok = readChunkedEntity();
+    else if (getResponseHeader("Content-Length", value))
+    {
+        const char *begin = value.c_str();
+        char *end;
+        errno = 0;
+        unsigned long contentLength = strtoul(begin, &end, 10);
+
+        if (!isdigit((unsigned char)*begin) || errno == ERANGE || *end != '\0')
+        {
+            exception = ServiceException("Malformed Content-Length: " + value,
+                                                statusCode, "readResponse");
+            return false;
+        }
+
+        ok = readEntityBytes(contentLength);
+    }
+    else
+        ok = readEntityToEnd();
+
+    if (hasBody && !decompressor.finish() && ok)
+    {
+        exception = ServiceException(decompressor.getException().what(), 
+                                                statusCode, "readResponse");
+        ok = false;
+    }
+
+    if (closeAfter)
+        closeConnection();
+
+    if (ok)
+        Metrics::record(Metrics::RECEIVE_TIME, 
+                                    Metrics::currentTimeMicros() - firstByteAt);
+
+    return ok;
+
+}   //  end readResponse
 
 std::string YosokumoRequest::normalizeResourceUri(
     const std::string &resourceUri, 
@@ -323,67 +1106,114 @@ std::string YosokumoRequest::normalizeResourceUri(
     return newUri;
 }
 
-std::string YosokumoRequest::makeDigest(HttpRequestBase request)
+std::string YosokumoRequest::makeDigest(const HttpRequest &request)
 {
-#if 0 //???
     std::string requestString = makeRequestString(request);
 
     if (trace)
-        System.out.println("    requestString: " + requestString);
+        TraceBuffer::record(TraceBuffer::REQUEST_SIGNED, requestString.size(),
+                                                                requestString);
 
     std::string requestDigest;
 
     try
     {
-        requestDigest = DigestRequest.makeDigest(requestString, 
-                                                 credentials.getKey());
+        std::vector<uint8_t> key;
+        credentials.getKey(key);
+        requestDigest = DigestRequest::makeDigest(requestString, key);
     }
-    catch (ServiceException e)
+    catch (ServiceException &e)
     {
         exception = e;
-        requestDigest = null;
+        requestDigest = "";
     }
 
     return requestDigest; 
-#endif
-return "";
 
 }   //  end makeDigest
 
-std::string YosokumoRequest::makeRequestString(HttpRequestBase r)
+std::string YosokumoRequest::makeRequestString(const HttpRequest &r)
 {
-#if 0
-    StringBuilder s = new StringBuilder();
-    Header h;
+    std::string s;
 
-    s.append(r.getRequestLine().getMethod());       // method
+    s.append(r.method);                             // method
     appendHeaderValue(r, "Host", s);                // host
-    s.append("+" + r.getURI().getPath());           // uri 
+    s.append("+" + getUriPath(r.uri));              // uri 
     appendHeaderValue(r, "Date",             s);    // date
     appendHeaderValue(r, "Content-Type",     s);    // content type
     appendHeaderValue(r, "Content-Length",   s);    // content length
     appendHeaderValue(r, "Content-Encoding", s);    // content encoding
     appendHeaderValue(r, "Content-MD5",      s);    // content MD5
-    return s.toString();
-#endif
-return "";
+    return s;
 
 }   //  end makeRequestString
 
 void YosokumoRequest::appendHeaderValue(
-    HttpRequest   r,
-    const std::string        &headerName,
-    std::string &s)
+    const HttpRequest &r,
+    const std::string &headerName,
+          std::string &s)
 {
-#if 0 //??
-    Header h;
-
     s.append("+");
-    h = r.getFirstHeader(headerName);
-    if (h != null)
-        s.append(h.getValue());
-#endif
+
+    for (unsigned i = 0;  i < r.headers.size();  ++i)
+    {
+        if (sameHeaderName(r.headers[i].first, headerName))
+        {
+            s.append(r.headers[i].second);
+            break;
+        }
+    }
 }
 
-// end YosokumoRequest.cpp
+// Position just past "http://host:port" in a URI, or 0 if there is no 
+// scheme.
 
+static std::string::size_type endOfAuthority(const std::string &uri)
+{
+    std::string::size_type p = uri.find("://");
+    if (p == std::string::npos)
+        return 0;
+
+    std::string::size_type q = uri.find_first_of("/?", p + 3);
+    return (q == std::string::npos) ? uri.size() : q;
+}
+
+std::string YosokumoRequest::getUriTarget(const std::string &uri)
+{
+    std::string target = uri.substr(endOfAuthority(uri));
+
+    if (target.empty() || target[0] != '/')
+        target = "/" + target;
+
+    return target;
+}
+
+std::string YosokumoRequest::getUriPath(const std::string &uri)
+{
+    std::string target = getUriTarget(uri);
+    return target.substr(0, target.find('?'));
+}
+
+void YosokumoRequest::getUriHostAndPort(
+    const std::string &uri, 
+    std::string       &host, 
+    int               &port)
+{
+    std::string::size_type p = uri.find("://");
+    std::string::size_type begin = (p == std::string::npos) ? 0 : p + 3;
+    std::string authority = uri.substr(begin, endOfAuthority(uri) - begin);
+
+    std::string::size_type colon = authority.rfind(':');
+    if (colon == std::string::npos)
+    {
+        host = authority;
+        port = 80;
+    }
+    else
+    {
+        host = authority.substr(0, colon);
+        port = atoi(authority.c_str() + colon + 1);
+    }
+}
+
+// end YosokumoRequest.cpp
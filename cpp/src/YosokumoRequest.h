@@ -4,9 +4,15 @@
 #define YOSOKUMOREQUEST_H
 
 #include "YosokumoDIF.h"
+#include "Compression.h"
 #include "Credentials.h"
 
+#include <map>
 #include <vector>
+#include <utility>
+
+#include <sys/types.h>
+#include <sys/uio.h>
 
 namespace Yosokumo
 {
@@ -27,12 +33,61 @@ namespace Yosokumo
  * <li>isException()
  * <li>getException()
  * </ul>
+ * A <code>YosokumoRequest</code> keeps its connection to the server open 
+ * between requests, so a sequence of requests made with one object reuses a 
+ * single TCP connection.  A <code>YosokumoRequest</code> must not be used by 
+ * more than one thread at a time.
+ * <p>
+ * When conditional GET is on (see <code>setConditionalGet()</code>), the 
+ * entity of each GET response which carries an ETag or Last-Modified header
+ * is kept, and the next GET of the same URI asks the server to send the 
+ * entity only if it has changed.  If it has not, the server responds with 
+ * status code 304 (Not Modified), <code>isNotModified()</code> returns 
+ * <code>true</code>, and <code>getEntity()</code> returns the kept entity.
+ * <p>
+ * When compression is on (see <code>setCompression()</code>), entities sent
+ * to the server are compressed and the server is told it may compress its
+ * responses the same way.  Compressed responses are decompressed as they are
+ * read, whether or not compression is on.
+ * <p>
+ * Every request is timed and counted in <code>Metrics</code>.
+ *
  * @author  Roger House
  * @version 0.9
  */
 
 class YosokumoRequest
 {
+public:
+
+    /**
+     * An HTTP header:  a name and a value.
+     */
+    typedef std::pair<std::string, std::string> Header;
+
+    /**
+     * A list of HTTP headers, in the order in which they are sent or 
+     * received.
+     */
+    typedef std::vector<Header> HeaderList;
+
+    /**
+     * An HTTP request ready to be sent:  the method (GET, POST, PUT, or 
+     * DELETE), the normalized URI, and the request headers.
+     */
+    struct HttpRequest
+    {
+        std::string method;
+        std::string uri;
+        HeaderList  headers;
+    };
+
+    /**
+     * Default time (in milliseconds) to wait for the server to accept, 
+     * send, or receive data before giving up.
+     */
+    enum { DEFAULT_TIMEOUT = 60000 };
+
 private:
     bool trace;                     // Set true to get debug trace 
 
@@ -47,6 +102,39 @@ private:
     int                  statusCode;
     std::vector<uint8_t> entity;
     ServiceException     exception;
+    HeaderList           responseHeaders;
+
+    // The connection to the server is kept open between requests (HTTP/1.1
+    // keep-alive), so a sequence of operations pays for the TCP handshake 
+    // only once.  connectedHost and connectedPort tell which server the 
+    // socket is connected to.
+
+    int         socketFd;           // -1 means not connected
+    std::string connectedHost;
+    int         connectedPort;
+    unsigned    timeout;            // Milliseconds
+    std::string readBuffer;         // Bytes received but not yet consumed
+
+    // The conditional GET cache:  for each URI, the validators and entity
+    // of the most recent full response.  notModifiedEntry points into the 
+    // cache when the most recent response was 304 (Not Modified).
+
+    struct CachedEntity
+    {
+        std::string          eTag;
+        std::string          lastModified;
+        std::vector<uint8_t> entity;
+    };
+
+    bool                                conditionalGet;
+    std::map<std::string, CachedEntity> entityCache;
+    const CachedEntity                  *notModifiedEntry;
+
+    // Outgoing entities are compressed by compressor (IDENTITY means not at
+    // all); incoming ones pass through decompressor as they are read.
+
+    Compressor   compressor;
+    Decompressor decompressor;
 
     static std::vector<uint8_t> emptyEntity;    // Only used as default value
 
@@ -67,6 +155,11 @@ public:
         int               port,
         const std::string &contentType);
 
+    /**
+     * Destructor - close the connection to the server, if any.
+     */
+    virtual ~YosokumoRequest();
+
     /**
      * Initialize for an HTTP operation.  Init various data fields to prepare 
      * for execution of a service request.
@@ -92,8 +185,9 @@ public:
     void setAuxHeader(const std::string &name, const std::string &value);
 
     /**
-     * Set the trace flag.  When trace is on, text is written to cout
-     * showing the progress of HTTP requests and reponses.
+     * Set the trace flag.  When trace is on, the progress of HTTP requests
+     * and responses is recorded in the <code>TraceBuffer</code> of the 
+     * calling thread.
      *
      * @param  traceOn is the value to assign to the trace flag.
      */
@@ -129,6 +223,53 @@ public:
      */
     bool isException();
 
+    /**
+     * Turn conditional GET on or off.  Turning it off also empties the 
+     * cache of entities.
+     *
+     * @param  on  <code>true</code> means GET requests are conditional.
+     */
+    void setConditionalGet(bool on);
+
+    /**
+     * Test if conditional GET is on.
+     *
+     * @return <code>true</code> means GET requests are conditional.
+     */
+    bool getConditionalGet();
+
+    /**
+     * Test if the most recent response was 304 (Not Modified) to a 
+     * conditional GET.  In that case <code>getEntity()</code> returns the 
+     * entity of the earlier response, which is still current.
+     *
+     * @return <code>true</code> means the resource has not changed.
+     */
+    bool isNotModified();
+
+    /**
+     * Set the compression of entities sent to the server, and ask the
+     * server to compress its responses the same way.
+     *
+     * @param  coding  the coding; <code>Compression::IDENTITY</code> turns
+     *             compression off.
+     * @param  level  the compression level (see <code>Compressor</code>).
+     *
+     * @return <code>true</code> means success.  <code>false</code> means the
+     *         coding is not available in this build, and compression is 
+     *         left unchanged.
+     */
+    bool setCompression(
+        Compression::Coding coding, 
+        int                 level = Compression::DEFAULT_LEVEL);
+
+    /**
+     * Return the coding used to compress entities sent to the server.
+     *
+     * @return the coding; <code>Compression::IDENTITY</code> means none.
+     */
+    Compression::Coding getCompression();
+
     /**
      * Return the exception from an HTTP process.
      *
@@ -136,6 +277,41 @@ public:
      */
     ServiceException getException();
 
+    /**
+     * Return a header from the most recent HTTP response.
+     *
+     * @param  name   the name of the header (case is not significant).
+     * @param  value  where to place the value of the header.
+     *
+     * @return <code>true</code> means the header was present in the 
+     *             response and its value has been placed in value.
+     *         <code>false</code> means there was no such header; value is
+     *             unchanged.
+     */
+    bool getResponseHeader(const std::string &name, std::string &value);
+
+    /**
+     * Set the time to wait for the server before a request fails.
+     *
+     * @param  milliseconds  the timeout for connecting, sending, and 
+     *             receiving.  Zero means wait forever.
+     */
+    void setTimeout(unsigned milliseconds);
+
+    /**
+     * Test if there is an open connection to the server.  A connection is 
+     * opened by the first request and reused by later ones.
+     *
+     * @return <code>true</code> means a connection is open.
+     */
+    bool isConnected();
+
+    /**
+     * Close the connection to the server, if any.  The next request opens
+     * a new connection.
+     */
+    void closeConnection();
+
     /**
      * Issue an HTTP GET request.
      *
@@ -150,6 +326,23 @@ public:
      */
     bool getFromServer(const std::string &resourceUri);
 
+    /**
+     * Issue an HTTP GET request conditional on validators kept elsewhere,
+     * e.g., in a snapshot file.  The cache of conditional GET is neither
+     * used nor changed.  If the resource has not changed, the status code
+     * is 304 (Not Modified) and there is no entity.
+     *
+     * @param  resourceUri is the URI of the resource to get.
+     * @param  eTag  sent as If-None-Match, unless empty.
+     * @param  lastModified  sent as If-Modified-Since, unless empty.
+     *
+     * @return as for <code>getFromServer()</code> above.
+     */
+    bool getFromServerIfChanged(
+        const std::string &resourceUri,
+        const std::string &eTag,
+        const std::string &lastModified);
+
     /**
      * Issue an HTTP POST request.
      *
@@ -167,6 +360,43 @@ public:
         const std::string          &resourceUri, 
         const std::vector<uint8_t> &entityToPost);
 
+    /**
+     * Issue an HTTP POST request whose entity is given in segments, e.g., 
+     * by <code>YosokumoProtobuf::makeSegmentsFromBlock()</code>.  The 
+     * segments are sent as they are, in one gathered write, so a large 
+     * entity need not be copied into one buffer.  (When compression is on
+     * the segments are joined to be compressed.)
+     *
+     * @param  resourceUri is the URI of the resource to post to.
+     * @param  segments are the segments of the entity, in order.
+     *
+     * @return as for <code>postToServer()</code> above.
+     */
+    bool postToServer(
+        const std::string                        &resourceUri, 
+        const std::vector<std::vector<uint8_t> > &segments);
+
+    /**
+     * Issue an HTTP POST request whose entity is a range of an open file, 
+     * e.g., a record of a <code>BlockSpool</code>.  The range is sent with 
+     * <code>sendfile()</code>, straight from the page cache to the socket.
+     * (When compression is on the range is read in pieces to be
+     * compressed.)
+     *
+     * @param  resourceUri is the URI of the resource to post to.
+     * @param  fd is the file descriptor of the file.  Not closed.
+     * @param  offset is the position in the file of the first byte of the
+     *             entity.
+     * @param  length is the length of the entity.
+     *
+     * @return as for <code>postToServer()</code> above.
+     */
+    bool postFileToServer(
+        const std::string &resourceUri, 
+        int               fd,
+        off_t             offset,
+        size_t            length);
+
     /**
      * Issue an HTTP DELETE request.
      *
@@ -198,17 +428,15 @@ public:
         const std::string          &resourceUri, 
         const std::vector<uint8_t> &entityToPut);
 
-//??? Very temporary defs
-typedef int HttpRequestBase;
-typedef int HttpRequest;
-
     /**
      * Make an HTTP request.  This is the workhorse method which does all the 
      * work of making an HTTP request and processing the response.
      *
-     * @param  httpRequest is HttpGet, HttpPut, HttpPost, or HttpDelete.
-     * @param  entityToSend is an entity to put to the server.
+     * @param  httpRequest is a GET, PUT, POST, or DELETE request.  The 
+     *             standard headers are added to it.
      * @param  traceName is the name of the request to be used in trace output.
+     * @param  entityToSend is an entity to put to the server.  Only sent
+     *             for POST and PUT.
      *
      * @return <code>false</code> means there was a problem (call 
      *             <code>getStatusCode()</code>, <code>getEntity()</code>, and
@@ -218,8 +446,8 @@ typedef int HttpRequest;
      *             for more information.
      */
     bool makeRequest(
-        HttpRequestBase httpRequest, 
-        const std::string &traceName,
+        HttpRequest                &httpRequest, 
+        const std::string          &traceName,
         const std::vector<uint8_t> &entityToSend = emptyEntity);
 
     /**
@@ -227,6 +455,7 @@ typedef int HttpRequest;
      *
      * @param  httpRequest is an HTTP request, ready to be executed
      * @param  traceName is the name of the request to be used in trace output.
+     * @param  entityToSend is the entity to send after the request headers.
      * @return <code>false</code> means there was a problem (call 
      *             <code>getStatusCode()</code>, <code>getEntity()</code>, and
      *             <code>getException()</code> for more information).
@@ -234,7 +463,10 @@ typedef int HttpRequest;
      *             <code>getStatusCode()</code> and <code>getEntity()</code>
      *             for more information.
      */
-    bool getResponse(HttpRequestBase httpRequest, const std::string &traceName);
+    bool getResponse(
+        const HttpRequest          &httpRequest, 
+        const std::string          &traceName,
+        const std::vector<uint8_t> &entityToSend);
 
     /**
      * Normalize a resource URI.  There are several cases:
@@ -271,11 +503,11 @@ typedef int HttpRequest;
      * Make a digest of an HTTP request.
      *
      * @param   request is the HTTP request to digest.
-     * @return  <code>null</code> means there was a problem; <code>exception</code> 
+     * @return  an empty string means there was a problem; <code>exception</code> 
      *              is set.  Otherwise the return value is a digest of the 
      *              input request.
      */
-    std::string makeDigest(HttpRequestBase request);
+    std::string makeDigest(const HttpRequest &request);
 
     /**
      * Make a string from an HTTP request.  This string is used for Yosokumo
@@ -284,7 +516,7 @@ typedef int HttpRequest;
      * @param   r is the input HTTP request.
      * @return  is a string containing a number of fields from r. 
      */
-    std::string makeRequestString(HttpRequestBase r);
+    std::string makeRequestString(const HttpRequest &r);
 
     /**
      * Append an HTTP header value.  This is a helper method for 
@@ -295,10 +527,97 @@ typedef int HttpRequest;
      * @param   s is the string to append the header value to.
      */
     void appendHeaderValue(
-        HttpRequest       r,
+        const HttpRequest &r,
         const std::string &headerName,
               std::string &s);
 
+    /**
+     * Return the path part of a URI, i.e., the URI without the scheme, 
+     * the host, the port, and the query.
+     *
+     * @param   uri is a normalized URI, e.g., "http://host:80/a/b?c".
+     * @return  the path of the URI, e.g., "/a/b".  Never empty.
+     */
+    static std::string getUriPath(const std::string &uri);
+
+    /**
+     * Return the request target of a URI, i.e., the path and the query.
+     *
+     * @param   uri is a normalized URI, e.g., "http://host:80/a/b?c".
+     * @return  the request target of the URI, e.g., "/a/b?c".
+     */
+    static std::string getUriTarget(const std::string &uri);
+
+    /**
+     * Return the host and port of a URI.
+     *
+     * @param   uri is a normalized URI, e.g., "http://host:80/a/b?c".
+     * @param   host where to place the host, e.g., "host".
+     * @param   port where to place the port, e.g., 80.  If the URI has no 
+     *              port, 80 is used.
+     */
+    static void getUriHostAndPort(
+        const std::string &uri, 
+        std::string       &host, 
+        int               &port);
+
+private:
+
+    // The entity of a request, as the parts of a gathered write
+
+    typedef std::vector<struct iovec> EntityParts;
+
+    // A range of a file sent after the entity parts
+
+    struct FilePart
+    {
+        int    fd;
+        off_t  offset;
+        size_t length;
+    };
+
+    bool makeRequestFromParts(
+        HttpRequest       &httpRequest, 
+        const std::string &traceName,
+        const EntityParts &entityParts,
+        const FilePart    *filePart = NULL);
+    bool getResponseFromParts(
+        const HttpRequest &httpRequest, 
+        const std::string &traceName,
+        const EntityParts &entityParts,
+        const FilePart    *filePart = NULL);
+
+    // Helpers for the connection to the server
+
+    bool connectToServer(const std::string &host, int port);
+    bool sendAll(const struct iovec *iov, int iovcnt, bool more = false);
+    bool sendFile(const FilePart &filePart);
+    bool compressFilePart(
+        const FilePart       &filePart, 
+        const std::string    &traceName,
+        std::vector<uint8_t> &compressed);
+    bool fillReadBuffer();
+    bool readLine(std::string &line);
+    bool appendEntity(const char *bytes, size_t n);
+    bool readEntityBytes(size_t n);
+    bool readChunkedEntity();
+    bool readEntityToEnd();
+    bool readResponse(const HttpRequest &httpRequest, bool &nothingReceived);
+    void recordRequestMetrics(
+        const std::string &method, 
+        bool              ok,
+        uint64_t          started);
+
+    /**
+     * Copy constructor - NOT IMPLEMENTED.
+     */
+    YosokumoRequest(const YosokumoRequest &rhs);
+
+    /**
+     * Assignment operator - NOT IMPLEMENTED.
+     */
+    YosokumoRequest& operator=(const YosokumoRequest& rhs);
+
 };  //  end YosokumoRequest
 
 }   //  end namespace Yosokumo
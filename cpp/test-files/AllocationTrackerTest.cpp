@@ -0,0 +1,155 @@
+// AllocationTrackerTest.cpp  -  Test the AllocationTracker class, and hold
+//                               library entry points to allocation budgets
+
+#include "UnitTest++.h"
+
+#include "AllocationTracker.h"
+#include "Catalog.h"
+#include "NaturalValue.h"
+#include "RealValue.h"
+#include "Specimen.h"
+#include "SpecimenBlock.h"
+#include "YosokumoProtobuf.h"
+
+#include <iostream>
+#include <sstream>
+
+using namespace Yosokumo;
+
+// The budgets below are the allocations each operation makes today (with
+// protobuf 3 and the GNU C++ library).  An operation which starts to
+// allocate more fails its check; if the increase is intended, raise the
+// budget.  The budgets are only checked in a tracking build.
+
+static Specimen makeSpecimen(uint64_t key, unsigned nCells)
+{
+    Specimen s(key);
+    s.setPredictand(RealValue(1.5));
+    for (unsigned i = 0;  i < nCells;  ++i)
+        s.addCell(Cell(i + 1, NaturalValue(i % 4)));
+    return s;
+}
+
+TEST(scopeForAllocationTracker)
+{
+    std::cout << "AllocationTracker scopeForAllocationTracker" << '\n';
+
+#ifdef YOSOKUMO_ALLOC_TRACKING
+    CHECK(AllocationTracker::isEnabled());
+#else
+    CHECK(!AllocationTracker::isEnabled());
+#endif
+
+    AllocationScope scope;
+    int *p = new int(7);
+    std::vector<char> *v = new std::vector<char>(100);
+    delete v;
+    delete p;
+
+    if (AllocationTracker::isEnabled())
+    {
+        CHECK_EQUAL(scope.getAllocations(), 3UL);
+        CHECK_EQUAL(scope.getBytes(), sizeof(int) +
+                                        sizeof(std::vector<char>) + 100);
+    }
+    else
+    {
+        CHECK_EQUAL(scope.getAllocations(), 0UL);
+        CHECK_EQUAL(scope.getBytes(), 0UL);
+    }
+
+}   //  end scopeForAllocationTracker
+
+TEST(entryPointsForAllocationTracker)
+{
+    std::cout << "AllocationTracker entryPointsForAllocationTracker" << '\n';
+
+    AllocationTracker::reset();
+
+    Specimen a = makeSpecimen(1, 10);
+    Specimen b;
+    b = a;
+    b = a;
+
+    AllocationTracker::Stats stats;
+    if (!AllocationTracker::isEnabled())
+    {
+        CHECK(!AllocationTracker::getStats("Specimen::operator=", stats));
+        return;
+    }
+
+    CHECK(AllocationTracker::getStats("Specimen::operator=", stats));
+    CHECK(stats.calls >= 2);
+    CHECK(stats.maxAllocations >= 1);
+
+    std::stringstream out;
+    AllocationTracker::report(out);
+    CHECK(out.str().find("Specimen::operator=") != std::string::npos);
+
+}   //  end entryPointsForAllocationTracker
+
+TEST(budgetsForAllocationTracker)
+{
+    std::cout << "AllocationTracker budgetsForAllocationTracker" << '\n';
+
+    if (!AllocationTracker::isEnabled())
+        return;
+
+    // Copy a specimen of 20 cells
+
+    Specimen s = makeSpecimen(1, 20), t;
+    {
+        AllocationScope scope;
+        t = s;
+        std::cout << "  Specimen::operator= " << scope.getAllocations() << '\n';
+        CHECK(scope.getAllocations() <= 1);
+    }
+
+    // Copy a catalog of 10 studies
+
+    Catalog catalog("USER-ID", "User");
+    for (int i = 0;  i < 10;  ++i)
+    {
+        std::stringstream id;
+        id << "STUDY-" << i;
+        Study study;
+        study.setStudyIdentifier(id.str());
+        study.setStudyName("Study " + id.str());
+        catalog.addStudy(study);
+    }
+    {
+        AllocationScope scope;
+        Catalog copy;
+        copy = catalog;
+        std::cout << "  Catalog::operator= " << scope.getAllocations() << '\n';
+        CHECK(scope.getAllocations() <= 11);
+    }
+
+    // Encode and decode a block of 100 specimens of 10 cells
+
+    std::vector<Specimen> specimens;
+    for (unsigned i = 0;  i < 100;  ++i)
+        specimens.push_back(makeSpecimen(i + 1, 10));
+    SpecimenBlock block("STUDY-0");
+    for (unsigned i = 0;  i < specimens.size();  ++i)
+        block.addSpecimen(&specimens[i]);
+
+    YosokumoProtobuf dif;
+    std::vector<uint8_t> bytes;
+    {
+        AllocationScope scope;
+        CHECK(dif.makeBytesFromBlock(block, bytes));
+        std::cout << "  makeBytesFromBlock " << scope.getAllocations() << '\n';
+        CHECK(scope.getAllocations() <= 1510);
+    }
+    {
+        AllocationScope scope;
+        Block decoded;
+        CHECK(dif.makeBlockFromBytes(bytes, decoded));
+        std::cout << "  makeBlockFromBytes " << scope.getAllocations() << '\n';
+        CHECK(scope.getAllocations() <= 2016);
+    }
+
+}   //  end budgetsForAllocationTracker
+
+// end AllocationTrackerTest.cpp
@@ -0,0 +1,87 @@
+// BatchCodecTest.cpp  -  Test the BatchCodec class
+
+#include "UnitTest++.h"
+
+#include "BatchCodec.h"
+#include "CellBlock.h"
+#include "RealValue.h"
+#include "SpecimenBlock.h"
+
+#include <iostream>
+
+using namespace Yosokumo;
+
+TEST(encodeAndDecodeForBatchCodec)
+{
+    std::cout << "BatchCodec encodeAndDecodeForBatchCodec" << '\n';
+
+    const unsigned N = 500;
+
+    std::vector<Specimen>        specimens;
+    for (unsigned i = 0;  i < N;  ++i)
+    {
+        specimens.push_back(Specimen(i + 1));
+        specimens.back().setPredictand(RealValue(i + 0.5));
+    }
+
+    std::vector<SpecimenBlock *> owned;
+    std::vector<const Block *>   blocks;
+    for (unsigned i = 0;  i < N;  ++i)
+    {
+        owned.push_back(new SpecimenBlock("study-id"));
+        owned.back()->addSpecimen(&specimens[i]);
+        blocks.push_back(owned.back());
+    }
+
+    WorkStealingPool pool(4);
+    BatchCodec codec(pool);
+
+    std::vector<std::vector<uint8_t> > bytes;
+    std::vector<ServiceException>      exceptions;
+    CHECK(codec.encodeBlocks(blocks, bytes, exceptions));
+    CHECK_EQUAL(bytes.size(), N);
+    CHECK_EQUAL(exceptions.size(), N);
+
+    // The same bytes as encoding one at a time
+
+    YosokumoProtobuf dif;
+    std::vector<uint8_t> one;
+    dif.makeBytesFromBlock(*blocks[N - 1], one);
+    CHECK(bytes[N - 1] == one);
+
+    // A specimen block decodes as a cell block
+
+    std::vector<CellBlock *> decoded;
+    std::vector<Block *>     out;
+    for (unsigned i = 0;  i < N;  ++i)
+    {
+        decoded.push_back(new CellBlock);
+        out.push_back(decoded.back());
+    }
+
+    CHECK(codec.decodeBlocks(bytes, out, exceptions));
+    for (unsigned i = 0;  i < N;  ++i)
+    {
+        CHECK_EQUAL(decoded[i]->getType(), Block::CELL);
+        CHECK_EQUAL(decoded[i]->size(), 1UL);
+        CHECK_EQUAL(decoded[i]->getCell(0).getKey(), uint64_t(i + 1));
+    }
+
+    // A bad encoding fails alone
+
+    bytes[7].assign(3, 0xFF);
+    CHECK(!codec.decodeBlocks(bytes, out, exceptions));
+    CHECK(YosokumoDIF::isException(exceptions[7]));
+    CHECK(!YosokumoDIF::isException(exceptions[6]));
+    CHECK(!YosokumoDIF::isException(exceptions[8]));
+    CHECK(YosokumoDIF::isException(codec.getException()));
+
+    for (unsigned i = 0;  i < N;  ++i)
+    {
+        delete owned[i];
+        delete decoded[i];
+    }
+
+}   //  end encodeAndDecodeForBatchCodec
+
+// end BatchCodecTest.cpp
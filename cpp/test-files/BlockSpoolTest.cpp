@@ -0,0 +1,253 @@
+// BlockSpoolTest.cpp  -  Test the BlockSpool class
+
+#include "UnitTest++.h"
+
+#include "BlockSpool.h"
+#include "RealValue.h"
+#include "Service.h"
+#include "SpecimenBlock.h"
+#include "YosokumoProtobuf.h"
+#include "FakeServer.h"
+
+#include <algorithm>
+#include <iostream>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace Yosokumo;
+
+// Create an empty file to hold a spool
+
+static std::string makeSpoolPath()
+{
+    char path[] = "/tmp/BlockSpoolTest.XXXXXX";
+    int fd = mkstemp(path);
+    if (fd >= 0)
+        close(fd);
+    return path;
+}
+
+// Encode a block of n specimens, keys first to first + n - 1
+
+static void makeBlockBytes(
+    uint64_t             first,
+    unsigned             n,
+    std::vector<uint8_t> &bytes)
+{
+    std::vector<Specimen> specimens;
+    for (unsigned i = 0;  i < n;  ++i)
+    {
+        Specimen s(first + i);
+        s.setPredictand(RealValue(i + 0.5));
+        s.addCell(Cell(7, RealValue(i)));
+        specimens.push_back(s);
+    }
+
+    SpecimenBlock block("study-id");
+    for (unsigned i = 0;  i < n;  ++i)
+        block.addSpecimen(&specimens[i]);
+
+    YosokumoProtobuf dif;
+    dif.makeBytesFromBlock(block, bytes);
+}
+
+static std::string getEntity(const std::string &request)
+{
+    size_t p = request.find("\r\n\r\n");
+    return (p == std::string::npos) ? "" : request.substr(p + 4);
+}
+
+TEST(reopenForBlockSpool)
+{
+    std::cout << "BlockSpool reopenForBlockSpool" << '\n';
+
+    std::string path = makeSpoolPath();
+    std::vector<uint8_t> b1, b2, b3;
+    makeBlockBytes(1, 10, b1);
+    makeBlockBytes(100, 20, b2);
+    makeBlockBytes(200, 30, b3);
+
+    {
+        BlockSpool spool;
+        CHECK(spool.open(path, 1 << 16));
+        CHECK(spool.isOpen());
+        CHECK_EQUAL(spool.size(), 0U);
+
+        uint64_t t1, t2, t3;
+        CHECK(spool.append("/table/1", b1, t1));
+        CHECK(spool.append("/table/2", b2, t2));
+        CHECK(spool.append("/table/1", b3, t3));
+        CHECK(t1 < t2 && t2 < t3);
+        CHECK_EQUAL(spool.size(), 3U);
+
+        // One sync covers every record appended so far
+
+        CHECK(spool.commit(t1));
+        CHECK(spool.commit(t3));
+        CHECK_EQUAL(spool.getSyncCount(), 1U);
+    }
+
+    // The records are still there after a restart
+
+    {
+        BlockSpool spool;
+        CHECK(spool.open(path));
+        CHECK_EQUAL(spool.size(), 3U);
+    }
+
+    // Tear the last record:  it is dropped on reopening, and the others
+    // are kept
+
+    {
+        int fd = open(path.c_str(), O_RDWR);
+        std::vector<uint8_t> file(1 << 16);
+        CHECK_EQUAL(pread(fd, &file[0], file.size(), 0), ssize_t(file.size()));
+
+        std::vector<uint8_t>::iterator it = std::search(file.begin(),
+                                            file.end(), b3.begin(), b3.end());
+        CHECK(it != file.end());
+        uint8_t flipped = uint8_t(it[b3.size() / 2] ^ 0xff);
+        pwrite(fd, &flipped, 1, (it - file.begin()) + b3.size() / 2);
+        close(fd);
+    }
+
+    {
+        BlockSpool spool;
+        CHECK(spool.open(path));
+        CHECK_EQUAL(spool.size(), 2U);
+    }
+
+    // Not a spool
+
+    {
+        int fd = open(path.c_str(), O_RDWR);
+        pwrite(fd, "XXXX", 4, 0);
+        close(fd);
+
+        BlockSpool spool;
+        CHECK(!spool.open(path));
+        CHECK(!spool.isOpen());
+        CHECK(spool.getException().what() != std::string(""));
+    }
+
+    unlink(path.c_str());
+
+}   //  end reopenForBlockSpool
+
+TEST(replayForBlockSpool)
+{
+    std::cout << "BlockSpool replayForBlockSpool" << '\n';
+
+    std::string path = makeSpoolPath();
+    std::vector<uint8_t> b1, b2;
+    makeBlockBytes(1, 10, b1);
+    makeBlockBytes(100, 20, b2);
+
+    {
+        BlockSpool spool;
+        CHECK(spool.open(path, 1 << 16));
+
+        uint64_t t;
+        CHECK(spool.append("/table/1", b1, t));
+        CHECK(spool.append("/table/2", b2, t));
+        CHECK(spool.commit());
+    }
+
+    // After a restart the first record is posted, the second fails and
+    // stays
+
+    FakeServer server(3);
+    server.addResponse(201, std::vector<uint8_t>(), "Connection: close\r\n");
+    server.addResponse(500, std::vector<uint8_t>(), "Connection: close\r\n");
+    server.addResponse(201, std::vector<uint8_t>(), "Connection: close\r\n");
+    server.start();
+
+    Service service(makeCreds(), "127.0.0.1", server.getPort());
+
+    {
+        BlockSpool spool;
+        CHECK(spool.open(path));
+        CHECK_EQUAL(spool.size(), 2U);
+
+        CHECK(!spool.replay(service));
+        CHECK_EQUAL(spool.getException().getStatusCode(), 500);
+        CHECK_EQUAL(spool.size(), 1U);
+    }
+
+    // The next restart posts only the second
+
+    {
+        BlockSpool spool;
+        CHECK(spool.open(path));
+        CHECK_EQUAL(spool.size(), 1U);
+
+        CHECK(spool.replay(service));
+        CHECK_EQUAL(spool.size(), 0U);
+    }
+    server.join();
+
+    CHECK_EQUAL(server.requests.size(), 3U);
+    CHECK(server.requests[0].find("POST /table/1 HTTP/1.1\r\n") == 0);
+    CHECK(server.requests[1].find("POST /table/2 HTTP/1.1\r\n") == 0);
+    CHECK(server.requests[2].find("POST /table/2 HTTP/1.1\r\n") == 0);
+    CHECK(getEntity(server.requests[0]) == std::string(b1.begin(), b1.end()));
+    CHECK(getEntity(server.requests[2]) == std::string(b2.begin(), b2.end()));
+
+    {
+        BlockSpool spool;
+        CHECK(spool.open(path));
+        CHECK_EQUAL(spool.size(), 0U);
+    }
+
+    unlink(path.c_str());
+
+}   //  end replayForBlockSpool
+
+TEST(fullForBlockSpool)
+{
+    std::cout << "BlockSpool fullForBlockSpool" << '\n';
+
+    std::string path = makeSpoolPath();
+    std::vector<uint8_t> bytes(990, 0x5a);     // Records of 1024 bytes
+
+    FakeServer server(4);
+    server.addResponse(201, std::vector<uint8_t>(), "Connection: close\r\n");
+    server.start();
+
+    Service service(makeCreds(), "127.0.0.1", server.getPort());
+
+    {
+        // Room for 4 records after the header page
+
+        BlockSpool spool;
+        CHECK(spool.open(path, 8192));
+
+        uint64_t t;
+        for (int i = 0;  i < 4;  ++i)
+            CHECK(spool.append("/table/1", bytes, t));
+        CHECK(!spool.append("/table/1", bytes, t));
+        CHECK_EQUAL(spool.size(), 4U);
+
+        // Once everything is posted, the records start again at the front
+
+        CHECK(spool.replay(service));
+        CHECK_EQUAL(spool.size(), 0U);
+        CHECK(spool.append("/table/1", bytes, t));
+        CHECK(spool.commit(t));
+    }
+    server.join();
+
+    // Records of the earlier lap beyond the new one are not revived
+
+    {
+        BlockSpool spool;
+        CHECK(spool.open(path));
+        CHECK_EQUAL(spool.size(), 1U);
+    }
+
+    unlink(path.c_str());
+
+}   //  end fullForBlockSpool
+
+// end BlockSpoolTest.cpp
@@ -622,6 +622,126 @@ TEST(basicAccessToSequencesForBlock)
 }   //  end basicAccessToSequences()
 
 
+TEST(copyBlockRangeForBlock)
+{
+    std::cout << "BlockTest copyBlockRangeForBlock" << '\n';
+
+    std::list<Specimen> specimenList;
+    makeSpecimenList(specimenList);
+
+    SpecimenBlock sblock("Specimens");
+    for (std::list<Specimen>::iterator it = specimenList.begin();  
+                                            it != specimenList.end();  ++it)
+        sblock.addSpecimen(&*it);
+    CHECK_EQUAL(sblock.getItemCount(), sblock.size());
+
+    Block range;
+    Block::copyBlockRange(range, sblock, 1, 3);
+    CHECK_EQUAL(range.getType(), Block::SPECIMEN);
+    CHECK_EQUAL(range.getStudyIdentifier(), "Specimens");
+    CHECK_EQUAL(range.getItemCount(), 2UL);
+    CHECK(((SpecimenBlock &)range).getSpecimen(0) == sblock.getSpecimen(1));
+    CHECK(((SpecimenBlock &)range).getSpecimen(1) == sblock.getSpecimen(2));
+
+    // An end past the last item is cut back
+
+    Block::copyBlockRange(range, sblock, 2, 1000);
+    CHECK_EQUAL(range.getItemCount(), sblock.size() - 2);
+
+    CellBlock cblock("Cells");
+    std::list<Cell> cellList;
+    makeCellList(cellList);
+    cblock.addCells(cellList.begin(), cellList.end());
+
+    Block::copyBlockRange(range, cblock, 0, 1);
+    CHECK_EQUAL(range.getType(), Block::CELL);
+    CHECK_EQUAL(range.getItemCount(), 1UL);
+    CHECK(((CellBlock &)range).getCell(0) == cblock.getCell(0));
+
+    EmptyBlock eblock("Empty");
+    CHECK_EQUAL(eblock.getItemCount(), 0UL);
+
+}   //  end copyBlockRangeForBlock
+
+TEST(fingerprintForBlock)
+{
+    std::cout << "BlockTest fingerprintForBlock" << '\n';
+
+    std::list<Specimen> specimenList;
+    makeSpecimenList(specimenList);
+    std::list<Specimen> specimenList2(specimenList);
+
+    SpecimenBlock sblock("Specimens"), sblock2("Specimens");
+    sblock.addSpecimens(specimenList.begin(), specimenList.end());
+    sblock2.addSpecimens(specimenList2.begin(), specimenList2.end());
+    CHECK_EQUAL(sblock.getFingerprint(), sblock2.getFingerprint());
+
+    // A change to a specimen, or to the study, changes the fingerprint
+
+    uint64_t fingerprint = sblock.getFingerprint();
+
+    specimenList2.back().addCell(Cell(99, NaturalValue(99)));
+    CHECK(fingerprint != sblock2.getFingerprint());
+    specimenList2.back().removeCells(1);
+    CHECK_EQUAL(fingerprint, sblock2.getFingerprint());
+
+    sblock2.setStudyIdentifier("Other");
+    CHECK(fingerprint != sblock2.getFingerprint());
+
+    // Cell blocks, and a copy of a range
+
+    CellBlock cblock("Cells"), cblock2("Cells");
+    std::list<Cell> cellList;
+    makeCellList(cellList);
+    cblock.addCells(cellList.begin(), cellList.end());
+    cblock2.addCells(cellList.begin(), cellList.end());
+    CHECK_EQUAL(cblock.getFingerprint(), cblock2.getFingerprint());
+    CHECK(cblock.getFingerprint() != EmptyBlock("Cells").getFingerprint());
+
+    Block range;
+    Block::copyBlockRange(range, cblock, 0, cblock.size());
+    CHECK_EQUAL(cblock.getFingerprint(), range.getFingerprint());
+    Block::copyBlockRange(range, cblock, 1, cblock.size());
+    CHECK(cblock.getFingerprint() != range.getFingerprint());
+
+    // The kept fingerprint of a cell block follows each change to it
+
+    fingerprint = cblock.getFingerprint();
+    cblock.addCell(Cell(99, NaturalValue(99)));
+    CHECK(fingerprint != cblock.getFingerprint());
+    cblock.removeCells(1);
+    CHECK_EQUAL(fingerprint, cblock.getFingerprint());
+
+    std::vector<Cell> cells;
+    cblock.swapCells(cells);
+    CHECK(fingerprint != cblock.getFingerprint());
+    cblock.swapCells(cells);
+    CHECK_EQUAL(fingerprint, cblock.getFingerprint());
+
+    cblock.clearCells();
+    CHECK(fingerprint != cblock.getFingerprint());
+    cblock.addCells(cellList.begin(), cellList.end());
+    CHECK_EQUAL(fingerprint, cblock.getFingerprint());
+
+    // And that of a predictor block
+
+    PredictorBlock pblock("Predictors");
+    std::list<Predictor> predictorList;
+    makePredictorList(predictorList);
+    pblock.addPredictors(predictorList.begin(), predictorList.end());
+
+    fingerprint = pblock.getFingerprint();
+    pblock.removePredictors(1);
+    CHECK(fingerprint != pblock.getFingerprint());
+    pblock.addPredictor(predictorList.back());
+    CHECK_EQUAL(fingerprint, pblock.getFingerprint());
+    pblock.setStudyIdentifier("Other");
+    CHECK(fingerprint != pblock.getFingerprint());
+    pblock.setStudyIdentifier("Predictors");
+    pblock.clearPredictors();
+    CHECK(fingerprint != pblock.getFingerprint());
+}
+
 TEST(addPredictorsForPredictorBlock)
 {
     std::cout << "BlockTest addPredictorsForPredictorBlock" << '\n';
@@ -0,0 +1,122 @@
+// CatalogDeltaTest.cpp  -  Test the CatalogDelta class
+
+#include "UnitTest++.h"
+
+#include "CatalogDelta.h"
+
+#include <iostream>
+#include <sstream>
+
+using namespace Yosokumo;
+
+static Study makeStudy(int n)
+{
+    std::stringstream id;
+    id << "STUDY-" << n;
+
+    Study study("study " + id.str(), Study::NUMBER, Study::RUNNING,
+                                                            Study::PRIVATE);
+    study.setStudyIdentifier(id.str());
+    study.setBlockCount(n);
+    return study;
+}
+
+TEST(emptyForCatalogDelta)
+{
+    std::cout << "CatalogDelta emptyForCatalogDelta" << '\n';
+
+    Catalog a("USER-ID", "user name"), b("USER-ID", "user name");
+
+    for (int i = 0;  i < 100;  ++i)
+    {
+        a.addStudy(makeStudy(i));
+        b.addStudy(makeStudy(99 - i));
+    }
+
+    CatalogDelta delta(a, b);
+    CHECK(delta.isEmpty());
+
+    Catalog c = a;
+    delta.apply(c);
+    CHECK(c == a);
+
+    CHECK(!CatalogDelta(a, Catalog("USER-ID", "new name")).isEmpty());
+
+}   //  end emptyForCatalogDelta
+
+TEST(computeAndApplyForCatalogDelta)
+{
+    std::cout << "CatalogDelta computeAndApplyForCatalogDelta" << '\n';
+
+    Catalog oldCatalog("USER-ID", "user name");
+    for (int i = 0;  i < 1000;  ++i)
+        oldCatalog.addStudy(makeStudy(i));
+
+    // Remove 5 studies, change 3, and add 2
+
+    Catalog newCatalog = oldCatalog;
+    newCatalog.setCatalogLocation("/catalog/USER-ID");
+
+    for (int i = 10;  i < 15;  ++i)
+        CHECK(newCatalog.removeStudy(makeStudy(i).getStudyIdentifier()));
+
+    Study changed = makeStudy(20);
+    changed.setStatus(Study::STOPPED);
+    newCatalog.addStudy(changed);
+
+    changed = makeStudy(21);
+    changed.setStudyName("renamed");
+    changed.setCellCount(77);
+    newCatalog.addStudy(changed);
+
+    changed = makeStudy(22);
+    changed.setOwnerIdentifier("OWNER-ID");
+    newCatalog.addStudy(changed);
+
+    newCatalog.addStudy(makeStudy(1000));
+    newCatalog.addStudy(makeStudy(1001));
+
+    CatalogDelta delta(oldCatalog, newCatalog);
+
+    CHECK(!delta.isEmpty());
+    CHECK(delta.getAttributesChanged());
+    CHECK_EQUAL(delta.getAddedStudies().size(),   2U);
+    CHECK_EQUAL(delta.getRemovedStudies().size(), 5U);
+    CHECK_EQUAL(delta.getChangedStudies().size(), 3U);
+
+    for (size_t i = 0;  i < delta.getChangedStudies().size();  ++i)
+    {
+        const CatalogDelta::StudyChange &change = delta.getChangedStudies()[i];
+        std::string id = change.study.getStudyIdentifier();
+
+        if (id == "STUDY-20")
+            CHECK_EQUAL(change.fields, unsigned(Study::STATUS));
+        else if (id == "STUDY-21")
+            CHECK_EQUAL(change.fields,
+                            unsigned(Study::STUDY_NAME | Study::CELL_COUNT));
+        else if (id == "STUDY-22")
+            CHECK_EQUAL(change.fields, unsigned(Study::OWNER_IDENTIFIER));
+        else
+            CHECK(false);
+    }
+
+    // Applying the delta to a copy of the old catalog gives the new one
+
+    Catalog local = oldCatalog;
+    delta.apply(local);
+    CHECK(local == newCatalog);
+    CHECK(CatalogDelta(local, newCatalog).isEmpty());
+
+    // The reverse delta undoes it
+
+    CatalogDelta reverse(newCatalog, oldCatalog);
+    CHECK_EQUAL(reverse.getAddedStudies().size(),   5U);
+    CHECK_EQUAL(reverse.getRemovedStudies().size(), 2U);
+    reverse.apply(local);
+    CHECK(local == oldCatalog);
+
+    CHECK(delta.toString().find("  removed  STUDY-12\n") != std::string::npos);
+
+}   //  end computeAndApplyForCatalogDelta
+
+// end CatalogDeltaTest.cpp
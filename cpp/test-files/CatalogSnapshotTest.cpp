@@ -0,0 +1,215 @@
+// CatalogSnapshotTest.cpp  -  Test the CatalogSnapshot class
+
+#include "UnitTest++.h"
+
+#include "CatalogSnapshot.h"
+#include "TestStudies.h"
+
+#include <iostream>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace Yosokumo;
+
+static std::string makeSnapshotPath()
+{
+    char path[] = "/tmp/CatalogSnapshotTest.XXXXXX";
+    int fd = mkstemp(path);
+    if (fd >= 0)
+        close(fd);
+    return path;
+}
+
+static void writeFile(const std::string &path, const std::string &text)
+{
+    int fd = open(path.c_str(), O_WRONLY | O_TRUNC);
+    CHECK(fd >= 0);
+    CHECK_EQUAL(ssize_t(text.size()), write(fd, text.data(), text.size()));
+    close(fd);
+}
+
+TEST(writeAndReadForCatalogSnapshot)
+{
+    std::cout << "CatalogSnapshotTest writeAndReadForCatalogSnapshot" << '\n';
+
+    const unsigned N = 50;
+
+    Catalog catalog = makeTestCatalog(N, true);
+
+    Roster roster("study-0", "Study study-0");
+    roster.setRosterLocation("/roster/study-0");
+    Role owner("user-1", "study-0");
+    owner.setUserName("User One").setStudyName("Study study-0");
+    owner.setRoleLocation("/role/study-0/user-1").addAllPrivileges();
+    Role reader("user-2", "study-0");
+    reader.setRoleLocation("/role/study-0/user-2");
+    reader.addPrivilege(Privilege(Privilege::GET_STUDY));
+    reader.addPrivilege(Privilege(Privilege::GET_MODEL));
+    roster.addRole(owner);
+    roster.addRole(reader);
+
+    Panel panel;
+    panel.setNameControlLocation("/control/name/study-0");
+    panel.setBlockCount(3);
+    panel.setCellCount(4);
+    panel.setProspectCount(5);
+    panel.setLatestBlockTime("2026-10-19T11:00:00Z");
+
+    std::string path = makeSnapshotPath();
+
+    CatalogSnapshotWriter writer;
+    writer.setCatalog(catalog, "\"c1\"", "Mon, 19 Oct 2026 10:00:00 GMT");
+    writer.addRoster(roster, "\"r1\"");
+    writer.addPanel("/panel/study-0", panel, "", "Mon, 19 Oct 2026");
+    CHECK(writer.write(path));
+
+    CatalogSnapshot snapshot;
+    CHECK(!snapshot.isOpen());
+    CHECK(snapshot.open(path));
+    CHECK(snapshot.isOpen());
+    CHECK(snapshot.verify());
+    CHECK(snapshot.hasCatalog());
+    CHECK(snapshot.getCreationTime() > 0);
+
+    // Studies, by position and by identifier
+
+    CHECK_EQUAL(N, snapshot.getStudyCount());
+
+    Study study;
+    for (unsigned i = 0;  i < N;  ++i)
+    {
+        Study expected = makeTestStudyWithPanel(i);
+        CHECK(snapshot.findStudy(expected.getStudyIdentifier(), study));
+        CHECK(study == expected);
+        CHECK_EQUAL(expected.getProspectCount(), study.getProspectCount());
+        CHECK_EQUAL(expected.getCreationTime(), study.getCreationTime());
+    }
+
+    CHECK(snapshot.getStudy(N - 1, study));
+    CHECK(!snapshot.getStudy(N, study));
+    CHECK(!snapshot.findStudy("study-none", study));
+    CHECK(!snapshot.findStudy("", study));
+
+    Catalog loaded;
+    CHECK(snapshot.getCatalog(loaded));
+    CHECK(loaded == catalog);
+
+    std::string location, eTag, lastModified;
+    CHECK(snapshot.getCatalogValidators(location, eTag, lastModified));
+    CHECK_EQUAL("/catalog/user-1", location);
+    CHECK_EQUAL("\"c1\"", eTag);
+    CHECK_EQUAL("Mon, 19 Oct 2026 10:00:00 GMT", lastModified);
+
+    // Rosters and panels, by location
+
+    CHECK_EQUAL(1u, snapshot.getRosterCount());
+    Roster loadedRoster;
+    CHECK(snapshot.findRoster("/roster/study-0", loadedRoster));
+    CHECK(loadedRoster == roster);
+    CHECK(!snapshot.findRoster("/roster/study-1", loadedRoster));
+    CHECK(snapshot.getRosterValidators("/roster/study-0", eTag,
+                                                                lastModified));
+    CHECK_EQUAL("\"r1\"", eTag);
+    CHECK_EQUAL("", lastModified);
+
+    Role role;
+    CHECK(loadedRoster.getRole("user-2", role));
+    CHECK(role.getPrivilege(Privilege(Privilege::GET_MODEL)));
+    CHECK(!role.getPrivilege(Privilege(Privilege::POST_TABLE)));
+
+    CHECK_EQUAL(1u, snapshot.getPanelCount());
+    Panel loadedPanel;
+    CHECK(snapshot.findPanel("/panel/study-0", loadedPanel));
+    CHECK_EQUAL("/control/name/study-0",
+                                    loadedPanel.getNameControlLocation());
+    CHECK_EQUAL(4u, loadedPanel.getCellCount());
+    CHECK_EQUAL(5u, loadedPanel.getProspectCount());
+    CHECK_EQUAL("2026-10-19T11:00:00Z", loadedPanel.getLatestBlockTime());
+    CHECK(snapshot.getPanelValidators("/panel/study-0", eTag, lastModified));
+    CHECK_EQUAL("", eTag);
+    CHECK_EQUAL("Mon, 19 Oct 2026", lastModified);
+
+    snapshot.close();
+    CHECK(!snapshot.isOpen());
+    CHECK(!snapshot.findStudy("study-0", study));
+
+    // An empty snapshot
+
+    CatalogSnapshotWriter empty;
+    CHECK(empty.write(path));
+    CHECK(snapshot.open(path));
+    CHECK(!snapshot.hasCatalog());
+    CHECK_EQUAL(0u, snapshot.getStudyCount());
+    CHECK(!snapshot.findStudy("study-0", study));
+    CHECK(!snapshot.getCatalog(loaded));
+
+    unlink(path.c_str());
+}
+
+TEST(damagedForCatalogSnapshot)
+{
+    std::cout << "CatalogSnapshotTest damagedForCatalogSnapshot" << '\n';
+
+    std::string path = makeSnapshotPath();
+
+    Catalog catalog = makeTestCatalog(10, true);
+
+    CatalogSnapshotWriter writer;
+    writer.setCatalog(catalog);
+    CHECK(writer.write(path));
+
+    std::string good;
+    {
+        CatalogSnapshot snapshot;
+        CHECK(snapshot.open(path));
+        int fd = open(path.c_str(), O_RDONLY);
+        char buffer[65536];
+        ssize_t n = read(fd, buffer, sizeof(buffer));
+        close(fd);
+        CHECK(n > 0);
+        good.assign(buffer, n > 0 ? n : 0);
+    }
+
+    CatalogSnapshot snapshot;
+
+    // A change to a string is only found by verify()
+
+    std::string bad = good;
+    bad[bad.size() - 1] ^= 1;
+    writeFile(path, bad);
+    CHECK(snapshot.open(path));
+    CHECK(!snapshot.verify());
+
+    // A change to the header, a short file, and not a snapshot at all
+
+    bad = good;
+    bad[20] ^= 1;
+    writeFile(path, bad);
+    CHECK(!snapshot.open(path));
+    CHECK(!snapshot.isOpen());
+
+    writeFile(path, good.substr(0, good.size() - 8));
+    CHECK(!snapshot.open(path));
+
+    writeFile(path, "study-id,name\n");
+    CHECK(!snapshot.open(path));
+    CHECK(std::string(snapshot.getException().what()).find("not a snapshot")
+                                                        != std::string::npos);
+
+    CHECK(!snapshot.open("/nonexistent/catalog.snap"));
+
+    writeFile(path, good);
+    CHECK(snapshot.open(path));
+    CHECK(snapshot.verify());
+
+    // A failed write leaves the old file
+
+    CHECK(!writer.write("/nonexistent/catalog.snap"));
+    CHECK(std::string(writer.getException().what()).find("Cannot create")
+                                                        != std::string::npos);
+
+    unlink(path.c_str());
+}
+
+// end CatalogSnapshotTest.cpp
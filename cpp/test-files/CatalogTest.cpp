@@ -259,4 +259,35 @@ TEST(stressTestAccessToStudyCollectionForCatalog)
 }   //  end stressTestAccessToStudyCollection
 
 
+TEST(sortStudiesForCatalog)
+{
+    std::cout << "Catalog sortStudiesForCatalog" << '\n';
+
+    Catalog catalog, reversed;
+
+    for (int i = 1;  i <= 100;  i++)
+    {
+        Study study;
+        study.setStudyIdentifier(makeStudyId(i));
+        catalog.addStudy(study);
+
+        study.setStudyIdentifier(makeStudyId(101 - i));
+        reversed.addStudy(study);
+    }
+
+    // The order studies were added in does not matter for equality
+
+    CHECK(catalog == reversed);
+
+    catalog.sortStudies();
+    CHECK(catalog == reversed);
+
+    Catalog::StudyConstIterator iter = catalog.begin(), next = iter;
+
+    for (++next;  next != catalog.end();  ++iter, ++next)
+        CHECK(iter->first < next->first);
+
+}   //  end sortStudiesForCatalog
+
+
 // end CatalogTest.cpp
@@ -0,0 +1,215 @@
+// CompactStudyTest.cpp  -  Test the CompactStudy and CompactCatalog classes
+
+#include "UnitTest++.h"
+
+#include "CompactStudy.h"
+#include "LazyCatalog.h"
+#include "YosokumoProtobuf.h"
+
+#include "TestStudies.h"
+
+#include <iostream>
+
+using namespace Yosokumo;
+
+TEST(standardLayoutForCompactStudy)
+{
+    std::cout << "CompactStudyTest standardLayoutForCompactStudy" << '\n';
+
+    Study study = makeTestStudyWithPanel(17);
+    study.setType(Study::RANK);
+    study.setStatus(Study::STANDBY);
+    study.setVisibility(Study::PUBLIC);
+    CompactStudy compact(study);
+
+    CHECK(compact.isDerived(CompactStudy::STUDY_LOCATION));
+    CHECK(compact.isDerived(CompactStudy::TABLE_LOCATION));
+    CHECK(compact.isDerived(CompactStudy::VISIBILITY_CONTROL_LOCATION));
+    CHECK(!compact.isDerived(CompactStudy::STUDY_NAME));
+
+    CHECK_EQUAL(study.getStudyIdentifier(), compact.getStudyIdentifier());
+    CHECK_EQUAL(study.getStudyName(), compact.getStudyName());
+    CHECK_EQUAL(study.getStudyLocation(), compact.getStudyLocation());
+    CHECK_EQUAL(study.getOwnerIdentifier(), compact.getOwnerIdentifier());
+    CHECK_EQUAL(study.getOwnerName(), compact.getOwnerName());
+    CHECK_EQUAL(study.getTableLocation(), compact.getTableLocation());
+    CHECK_EQUAL(study.getModelLocation(), compact.getModelLocation());
+    CHECK_EQUAL(study.getPanelLocation(), compact.getPanelLocation());
+    CHECK_EQUAL(study.getRosterLocation(), compact.getRosterLocation());
+    CHECK_EQUAL(study.getNameControlLocation(),
+                                        compact.getNameControlLocation());
+    CHECK_EQUAL(study.getStatusControlLocation(),
+                                        compact.getStatusControlLocation());
+    CHECK_EQUAL(study.getVisibilityControlLocation(),
+                                    compact.getVisibilityControlLocation());
+    CHECK_EQUAL(Study::RANK, compact.getType());
+    CHECK_EQUAL(Study::STANDBY, compact.getStatus());
+    CHECK_EQUAL(Study::PUBLIC, compact.getVisibility());
+    CHECK_EQUAL(17u, compact.getBlockCount());
+    CHECK_EQUAL(1700u, compact.getCellCount());
+    CHECK_EQUAL(170u, compact.getProspectCount());
+    CHECK_EQUAL("2012-01-31T23:59:59Z", compact.getCreationTime());
+    CHECK_EQUAL("2012-02-29T00:00:00.125Z", compact.getLatestBlockTime());
+    CHECK_EQUAL("", compact.getLatestProspectTime());
+
+    Study back;
+    compact.getStudy(back);
+    CHECK(back == study);
+
+    // The arena holds the name, the base, and the owner name
+
+    CHECK(compact.getMemoryUsage() < sizeof(CompactStudy) + 80);
+    CHECK(compact.getMemoryUsage() < sizeof(Study) / 2);
+
+    // Copies
+
+    CompactStudy copy(compact);
+    CHECK(copy == compact);
+    CompactStudy other(makeTestStudyWithPanel(18));
+    CHECK(other != compact);
+    other = compact;
+    CHECK(other == compact);
+    other = other;
+    CHECK(other == compact);
+    other.setStudy(Study());
+    CHECK(other == CompactStudy());
+    other.getStudy(back);
+    CHECK(back == Study());
+}
+
+TEST(otherLayoutsForCompactStudy)
+{
+    std::cout << "CompactStudyTest otherLayoutsForCompactStudy" << '\n';
+
+    // Locations which are not derived are kept as they are
+
+    Study study = makeTestStudyWithPanel(5);
+    study.setTableLocation("/table/elsewhere");
+    study.setRosterLocation("");
+    study.setLatestProspectTime("not a time");
+
+    CompactStudy compact(study);
+    CHECK(compact.isDerived(CompactStudy::MODEL_LOCATION));
+    CHECK(!compact.isDerived(CompactStudy::TABLE_LOCATION));
+    CHECK(!compact.isDerived(CompactStudy::ROSTER_LOCATION));
+    CHECK_EQUAL("/table/elsewhere", compact.getTableLocation());
+    CHECK_EQUAL("", compact.getRosterLocation());
+    CHECK_EQUAL("not a time", compact.getLatestProspectTime());
+
+    Study back;
+    compact.getStudy(back);
+    CHECK(back == study);
+
+    // A study location not ending in the identifier derives nothing
+
+    study = makeTestStudyWithPanel(6);
+    study.setStudyLocation("/studies/6");
+    compact.setStudy(study);
+    CHECK(!compact.isDerived(CompactStudy::STUDY_LOCATION));
+    CHECK(!compact.isDerived(CompactStudy::PANEL_LOCATION));
+    compact.getStudy(back);
+    CHECK(back == study);
+
+    // Times which are kept as integers, and times which look like them but
+    // are kept as text
+
+    const char *times[] =
+    {
+        "1970-01-01T00:00:00Z", "1969-12-31T23:59:59.999Z",
+        "2000-02-29T12:34:56.000Z", "9999-12-31T23:59:59Z",
+        "0000-01-01T00:00:00Z",
+        "2001-02-29T00:00:00Z", "2012-13-01T00:00:00Z",
+        "2012-01-01T24:00:00Z", "2012-01-01 00:00:00Z",
+        "2012-01-01T00:00:60Z", "2012-1-01T00:00:00Z"
+    };
+
+    for (size_t i = 0;  i < sizeof(times) / sizeof(times[0]);  ++i)
+    {
+        study.setCreationTime(times[i]);
+        compact.setStudy(study);
+        CHECK_EQUAL(times[i], compact.getCreationTime());
+        compact.getStudy(back);
+        CHECK(back == study);
+    }
+}
+
+TEST(catalogForCompactStudy)
+{
+    std::cout << "CompactStudyTest catalogForCompactStudy" << '\n';
+
+    const unsigned N = 500;
+
+    Catalog catalog = makeTestCatalog(N, true);
+
+    CompactCatalog compact(catalog);
+    CHECK_EQUAL(N, compact.size());
+    CHECK_EQUAL("user-1", compact.getUserIdentifier());
+    CHECK_EQUAL("User One", compact.getUserName());
+    CHECK_EQUAL("/catalog/user-1", compact.getCatalogLocation());
+
+    Study study;
+    CHECK(compact.getStudy("study-42", study));
+    CHECK(study == makeTestStudyWithPanel(42));
+    CHECK(compact.containsStudy("study-499"));
+    CHECK(!compact.containsStudy("study-500"));
+    CHECK(!compact.getStudy("study-500", study));
+
+    const CompactStudy *found = compact.findStudy(Identifier("study-7"));
+    CHECK(found != NULL);
+    if (found != NULL)
+        CHECK_EQUAL("Study study-7", found->getStudyName());
+
+    Catalog back;
+    compact.getCatalog(back);
+    CHECK(back == catalog);
+
+    CHECK(compact.getMemoryUsage() < N * sizeof(Study) / 2);
+
+    // Changes
+
+    CHECK(!compact.addStudy(makeTestStudyWithPanel(3)));
+    CHECK(compact.addStudy(makeTestStudyWithPanel(N)));
+    CHECK_EQUAL(N + 1, compact.size());
+    CHECK(compact.removeStudy("study-0"));
+    CHECK(!compact.removeStudy("study-0"));
+    CHECK_EQUAL(N, compact.size());
+
+    size_t n = 0;
+    CompactCatalog::StudyConstIterator iter;
+    for (iter = compact.begin();  iter != compact.end();  ++iter, ++n)
+        CHECK(iter->first == iter->second.getStudyIdentifierHandle());
+    CHECK_EQUAL(N, n);
+
+    // From a lazy catalog
+
+    ProtoBuf::Catalog protoCatalog;
+    protoCatalog.set_user_identifier("user-2");
+    for (unsigned i = 0;  i < 3;  ++i)
+    {
+        ProtoBuf::Study *p = protoCatalog.add_study();
+        p->set_study_identifier(makeTestStudy(i).getStudyIdentifier());
+        p->set_type(ProtoBuf::Study_Type_Chance);
+        p->set_status(ProtoBuf::Study_Status_Running);
+        p->set_visibility(ProtoBuf::Study_Visibility_Private);
+        p->mutable_table()->set_location(makeTestStudy(i).getTableLocation());
+    }
+
+    std::vector<uint8_t> bytes(protoCatalog.ByteSize());
+    protoCatalog.SerializeToArray(&bytes[0], int(bytes.size()));
+
+    YosokumoProtobuf dif;
+    LazyCatalog lazy;
+    CHECK(dif.makeLazyCatalogFromBytes(bytes, lazy));
+    CHECK(compact.setCatalog(lazy));
+    CHECK_EQUAL(3u, compact.size());
+    CHECK_EQUAL("user-2", compact.getUserIdentifier());
+    CHECK(compact.getStudy("study-2", study));
+    CHECK_EQUAL(Study::CHANCE, study.getType());
+    CHECK_EQUAL(makeTestStudy(2).getTableLocation(),
+                                                    study.getTableLocation());
+
+    compact.clearStudies();
+    CHECK_EQUAL(0u, compact.size());
+}
+
+// end CompactStudyTest.cpp
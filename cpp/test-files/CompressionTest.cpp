@@ -0,0 +1,228 @@
+// CompressionTest.cpp  -  Test the Compression classes
+
+#include "UnitTest++.h"
+
+#include "Compression.h"
+
+#include <iostream>
+
+using namespace Yosokumo;
+
+// Repetitive bytes, which compress well
+
+static std::vector<uint8_t> makeBytes(size_t n)
+{
+    std::vector<uint8_t> bytes(n);
+    for (size_t i = 0;  i < n;  ++i)
+        bytes[i] = uint8_t((i % 7) * (i % 13));
+    return bytes;
+}
+
+TEST(namesForCompression)
+{
+    std::cout << "Compression namesForCompression" << '\n';
+
+    CHECK(Compression::isAvailable(Compression::IDENTITY));
+    CHECK(Compression::isAvailable(Compression::GZIP));
+    CHECK_EQUAL(Compression::getCodingName(Compression::GZIP), "gzip");
+    CHECK_EQUAL(Compression::getCodingName(Compression::ZSTD), "zstd");
+
+    Compression::Coding coding;
+    CHECK(Compression::getCodingFromName("GZip", coding));
+    CHECK_EQUAL(coding, Compression::GZIP);
+    CHECK(Compression::getCodingFromName("x-gzip", coding));
+    CHECK_EQUAL(coding, Compression::GZIP);
+    CHECK(Compression::getCodingFromName("zstd", coding));
+    CHECK_EQUAL(coding, Compression::ZSTD);
+    CHECK(Compression::getCodingFromName("identity", coding));
+    CHECK_EQUAL(coding, Compression::IDENTITY);
+    CHECK(!Compression::getCodingFromName("br", coding));
+
+    CHECK_EQUAL(Compressor(Compression::GZIP).getLevel(), 6);
+    CHECK_EQUAL(Compressor(Compression::GZIP, 42).getLevel(), 9);
+    CHECK_EQUAL(Compressor(Compression::GZIP, -5).getLevel(), 1);
+
+}   //  end namesForCompression
+
+TEST(gzipRoundTripForCompression)
+{
+    std::cout << "Compression gzipRoundTripForCompression" << '\n';
+
+    std::vector<uint8_t> in = makeBytes(100000);
+
+    for (int level = 1;  level <= 9;  level += 4)
+    {
+        Compressor compressor(Compression::GZIP, level);
+        std::vector<uint8_t> packed;
+        CHECK(compressor.compress(in, packed));
+        CHECK(packed.size() < in.size() / 4);
+
+        // gzip magic number
+
+        CHECK_EQUAL(packed[0], 0x1f);
+        CHECK_EQUAL(packed[1], 0x8b);
+
+        // Feed the stream in awkward pieces
+
+        Decompressor decompressor;
+        CHECK(decompressor.start(Compression::GZIP));
+        std::vector<uint8_t> out;
+        for (size_t i = 0;  i < packed.size();  i += 37)
+        {
+            size_t n = packed.size() - i < 37 ? packed.size() - i : 37;
+            CHECK(decompressor.update(&packed[i], n, out));
+        }
+        CHECK(decompressor.finish());
+        CHECK(out == in);
+    }
+
+}   //  end gzipRoundTripForCompression
+
+TEST(gzipPiecesForCompression)
+{
+    std::cout << "Compression gzipPiecesForCompression" << '\n';
+
+    std::vector<uint8_t> in = makeBytes(100000), packed, out;
+
+    // Compress in awkward pieces, some of them empty
+
+    Compressor compressor(Compression::GZIP);
+    CHECK(compressor.start());
+    for (size_t i = 0;  i < in.size();  i += 1000)
+    {
+        CHECK(compressor.update(&in[i], (i / 1000) % 3 * 500, packed));
+        CHECK(compressor.update(&in[i] + (i / 1000) % 3 * 500, 
+                                    1000 - (i / 1000) % 3 * 500, packed));
+    }
+    CHECK(compressor.finish(packed));
+    CHECK(packed.size() < in.size() / 4);
+
+    Decompressor decompressor;
+    CHECK(decompressor.start(Compression::GZIP));
+    CHECK(decompressor.update(&packed[0], packed.size(), out));
+    CHECK(decompressor.finish());
+    CHECK(out == in);
+
+    // A copy does not share the stream
+
+    CHECK(compressor.start());
+    Compressor copy(compressor);
+    CHECK(!copy.update(&in[0], 10, packed));
+    copy = compressor;
+    CHECK(!copy.finish(packed));
+    CHECK(compressor.finish(packed));
+
+}   //  end gzipPiecesForCompression
+
+TEST(emptyAndIdentityForCompression)
+{
+    std::cout << "Compression emptyAndIdentityForCompression" << '\n';
+
+    std::vector<uint8_t> empty, packed, out;
+    Compressor gzip(Compression::GZIP);
+    CHECK(gzip.compress(empty, packed));
+    CHECK(!packed.empty());
+
+    Decompressor decompressor;
+    CHECK(decompressor.start(Compression::GZIP));
+    CHECK(decompressor.update(&packed[0], packed.size(), out));
+    CHECK(decompressor.finish());
+    CHECK(out.empty());
+
+    std::vector<uint8_t> in = makeBytes(10);
+    Compressor identity(Compression::IDENTITY);
+    CHECK(identity.compress(in, packed));
+    CHECK(packed == in);
+
+    CHECK(decompressor.start(Compression::IDENTITY));
+    CHECK(decompressor.update(&in[0], in.size(), out));
+    CHECK(decompressor.finish());
+    CHECK(out == in);
+
+}   //  end emptyAndIdentityForCompression
+
+TEST(corruptForCompression)
+{
+    std::cout << "Compression corruptForCompression" << '\n';
+
+    std::vector<uint8_t> in = makeBytes(5000), packed, out;
+    Compressor compressor(Compression::GZIP);
+    CHECK(compressor.compress(in, packed));
+
+    // A truncated stream
+
+    Decompressor decompressor;
+    CHECK(decompressor.start(Compression::GZIP));
+    CHECK(decompressor.update(&packed[0], packed.size() / 2, out));
+    CHECK(!decompressor.finish());
+
+    // Garbage
+
+    std::vector<uint8_t> garbage(100, 0x55);
+    CHECK(decompressor.start(Compression::GZIP));
+    CHECK(!decompressor.update(&garbage[0], garbage.size(), out));
+
+    // Bytes after the end of the stream
+
+    packed.push_back(0);
+    out.clear();
+    CHECK(decompressor.start(Compression::GZIP));
+    CHECK(!decompressor.update(&packed[0], packed.size(), out));
+
+}   //  end corruptForCompression
+
+#ifdef YOSOKUMO_HAVE_ZSTD
+TEST(zstdRoundTripForCompression)
+{
+    std::cout << "Compression zstdRoundTripForCompression" << '\n';
+
+    std::vector<uint8_t> in = makeBytes(100000), packed, out;
+
+    Compressor compressor(Compression::ZSTD);
+    CHECK_EQUAL(compressor.getLevel(), 3);
+    CHECK(compressor.compress(in, packed));
+    CHECK(packed.size() < in.size() / 4);
+
+    Decompressor decompressor;
+    CHECK(decompressor.start(Compression::ZSTD));
+    for (size_t i = 0;  i < packed.size();  i += 100)
+    {
+        size_t n = packed.size() - i < 100 ? packed.size() - i : 100;
+        CHECK(decompressor.update(&packed[i], n, out));
+    }
+    CHECK(decompressor.finish());
+    CHECK(out == in);
+
+    // The same, compressed in pieces
+
+    packed.clear();
+    CHECK(compressor.start());
+    for (size_t i = 0;  i < in.size();  i += 1000)
+        CHECK(compressor.update(&in[i], 1000, packed));
+    CHECK(compressor.finish(packed));
+
+    out.clear();
+    CHECK(decompressor.start(Compression::ZSTD));
+    CHECK(decompressor.update(&packed[0], packed.size(), out));
+    CHECK(decompressor.finish());
+    CHECK(out == in);
+
+}   //  end zstdRoundTripForCompression
+#else
+TEST(zstdUnavailableForCompression)
+{
+    std::cout << "Compression zstdUnavailableForCompression" << '\n';
+
+    std::vector<uint8_t> in = makeBytes(10), packed;
+
+    CHECK(!Compression::isAvailable(Compression::ZSTD));
+    Compressor compressor(Compression::ZSTD);
+    CHECK(!compressor.compress(in, packed));
+
+    Decompressor decompressor;
+    CHECK(!decompressor.start(Compression::ZSTD));
+
+}   //  end zstdUnavailableForCompression
+#endif
+
+// end CompressionTest.cpp
@@ -0,0 +1,152 @@
+// FakeServer.cpp  -  A canned-response HTTP server for testing
+
+#include "FakeServer.h"
+
+#include <netinet/in.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <sstream>
+
+FakeServer::FakeServer(unsigned requestsToServe) :
+    listenFd(-1), port(0), requestsToServe(requestsToServe),
+    connectionCount(0)
+{
+    listenFd = socket(AF_INET, SOCK_STREAM, 0);
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port        = 0;
+
+    bind(listenFd, (struct sockaddr *)&addr, sizeof(addr));
+    listen(listenFd, 16);
+
+    socklen_t len = sizeof(addr);
+    getsockname(listenFd, (struct sockaddr *)&addr, &len);
+    port = ntohs(addr.sin_port);
+
+    // Do not wait forever if a test fails to connect
+
+    struct timeval tv;
+    tv.tv_sec  = 5;
+    tv.tv_usec = 0;
+    setsockopt(listenFd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+}
+
+FakeServer::~FakeServer()
+{
+    join();
+    close(listenFd);
+}
+
+int FakeServer::getPort() const
+{
+    return port;
+}
+
+void FakeServer::addResponse(
+    int                        statusCode,
+    const std::vector<uint8_t> &entity,
+    const std::string          &extraHeaders)
+{
+    std::stringstream s;
+    s << "HTTP/1.1 " << statusCode << " Canned\r\n";
+    s << "Content-Length: " << entity.size() << "\r\n";
+    s << extraHeaders << "\r\n";
+    s << std::string(entity.begin(), entity.end());
+
+    responses.push_back(s.str());
+}
+
+void FakeServer::addRawResponse(const std::string &response)
+{
+    responses.push_back(response);
+}
+
+void FakeServer::run()
+{
+    unsigned served = 0;
+
+    while (served < requestsToServe)
+    {
+        int fd = accept(listenFd, NULL, NULL);
+        if (fd < 0)
+            return;
+        ++connectionCount;
+
+        struct timeval tv;
+        tv.tv_sec  = 5;
+        tv.tv_usec = 0;
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+        std::string pending;
+        bool keepOpen = true;
+
+        while (keepOpen && served < requestsToServe &&
+                                            serveOne(fd, pending, keepOpen))
+            ++served;
+
+        close(fd);
+    }
+}
+
+bool FakeServer::serveOne(int fd, std::string &pending, bool &keepOpen)
+{
+    char buffer[4096];
+    std::string::size_type end;
+
+    while ((end = pending.find("\r\n\r\n")) == std::string::npos)
+    {
+        ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+        if (n <= 0)
+            return false;
+        pending.append(buffer, n);
+    }
+
+    std::string head = pending.substr(0, end + 4);
+    size_t length = 0;
+    std::string::size_type p = head.find("Content-Length: ");
+    if (p != std::string::npos)
+        length = strtoul(head.c_str() + p + 16, NULL, 10);
+
+    while (pending.size() < end + 4 + length)
+    {
+        ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+        if (n <= 0)
+            return false;
+        pending.append(buffer, n);
+    }
+
+    requests.push_back(pending.substr(0, end + 4 + length));
+    pending.erase(0, end + 4 + length);
+
+    std::string response;
+    if (!responses.empty())
+    {
+        unsigned i = requests.size() - 1;
+        response = responses[i < responses.size() ? i : responses.size() - 1];
+    }
+
+    keepOpen = !response.empty() &&
+                (response.find("Connection: close") == std::string::npos);
+
+    send(fd, response.data(), response.size(), MSG_NOSIGNAL);
+
+    return true;
+}
+
+Yosokumo::Credentials makeCreds()
+{
+    std::vector<uint8_t> key;
+    for (uint8_t i = 1;  i <= Yosokumo::Credentials::KEY_LEN;  ++i)
+        key.push_back(i);
+
+    return Yosokumo::Credentials("THIS-IS-USER-ID1", key);
+}
+
+// end FakeServer.cpp
@@ -0,0 +1,92 @@
+// FakeServer.h  -  A canned-response HTTP server for testing
+
+#ifndef FAKESERVER_H
+#define FAKESERVER_H
+
+#include "Credentials.h"
+#include "Thread.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/**
+ * A minimal HTTP server on the loopback interface, for testing the
+ * transport without a Yosokumo server.  It serves a fixed number of
+ * requests on its own thread, answering each with the next of a list of
+ * canned responses (the last response is repeated if the list runs out),
+ * and records the requests it receives.  Connections are handled one at a
+ * time, in the order accepted.
+ */
+class FakeServer : public Yosokumo::Thread
+{
+    int                      listenFd;
+    int                      port;
+    unsigned                 requestsToServe;
+    std::vector<std::string> responses;
+
+public:
+
+    /**
+     * Requests received, each as the request head (request line and
+     * headers) followed by the entity.
+     */
+    std::vector<std::string> requests;
+
+    /**
+     * Number of connections accepted.
+     */
+    int connectionCount;
+
+    /**
+     * Open a listening socket on an unused loopback port.
+     *
+     * @param  requestsToServe  the number of requests to serve before the
+     *             thread exits.
+     */
+    FakeServer(unsigned requestsToServe);
+
+    ~FakeServer();
+
+    /**
+     * Return the port on which the server listens.
+     */
+    int getPort() const;
+
+    /**
+     * Add a canned response.
+     *
+     * @param  statusCode  the status code, e.g., 200.
+     * @param  entity  the entity to send.
+     * @param  extraHeaders  additional header lines, each ending in "\r\n".
+     */
+    void addResponse(
+        int                        statusCode,
+        const std::vector<uint8_t> &entity,
+        const std::string          &extraHeaders = "");
+
+    /**
+     * Add a canned response given as the complete response text.  An
+     * empty response closes the connection without answering, as a server
+     * does with an idle connection.
+     */
+    void addRawResponse(const std::string &response);
+
+protected:
+
+    void run();
+
+private:
+
+    bool serveOne(int fd, std::string &pending, bool &keepOpen);
+};
+
+/**
+ * Return the credentials of a test user, for the clients of a
+ * <code>FakeServer</code>.
+ */
+Yosokumo::Credentials makeCreds();
+
+#endif  // FAKESERVER_H
+
+// end FakeServer.h
@@ -0,0 +1,149 @@
+// IdentifierMapTest.cpp  -  Test the IdentifierMap class
+
+#include "UnitTest++.h"
+
+#include "IdentifierMap.h"
+
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdlib.h>
+
+using namespace Yosokumo;
+
+static Identifier makeId(int n)
+{
+    std::stringstream s;
+    s << "ID-" << n;
+    return Identifier(s.str());
+}
+
+TEST(insertFindEraseForIdentifierMap)
+{
+    std::cout << "IdentifierMap insertFindEraseForIdentifierMap" << '\n';
+
+    IdentifierMap<int> m;
+
+    CHECK(m.empty());
+    CHECK(m.find("none") == NULL);
+    CHECK(!m.erase("none"));
+
+    CHECK(m.insert(Identifier("b"), 2));
+    CHECK(m.insert(Identifier("a"), 1));
+    CHECK(m.insert(Identifier("c"), 3));
+    CHECK_EQUAL(m.size(), 3U);
+
+    // Replacing keeps the size and returns the old value
+
+    int old = 0;
+    CHECK(!m.insert(Identifier("a"), 10, &old));
+    CHECK_EQUAL(old, 1);
+    CHECK_EQUAL(*m.find("a"), 10);
+    CHECK_EQUAL(m.size(), 3U);
+
+    // Entries are iterated over in the order added, or sorted on request
+
+    IdentifierMap<int>::const_iterator iter = m.begin();
+    CHECK_EQUAL(iter->first.str(), "b");
+    CHECK_EQUAL((++iter)->first.str(), "a");
+
+    m.sort();
+    iter = m.begin();
+    CHECK_EQUAL(iter->first.str(), "a");
+    CHECK_EQUAL((++iter)->first.str(), "b");
+    CHECK_EQUAL((++iter)->first.str(), "c");
+    CHECK(++iter == m.end());
+    CHECK_EQUAL(*m.find("c"), 3);
+
+    // Erasing moves the last entry into the hole
+
+    CHECK(m.erase("a"));
+    CHECK(m.find("a") == NULL);
+    CHECK_EQUAL(m.begin()->first.str(), "c");
+    CHECK_EQUAL(*m.find("b"), 2);
+    CHECK_EQUAL(*m.find("c"), 3);
+
+    m.clear();
+    CHECK(m.empty());
+    CHECK(m.find("b") == NULL);
+    CHECK(m.insert(Identifier("b"), 4));
+
+}   //  end insertFindEraseForIdentifierMap
+
+TEST(againstStdMapForIdentifierMap)
+{
+    std::cout << "IdentifierMap againstStdMapForIdentifierMap" << '\n';
+
+    // Random adds and removes, checked against std::map.  The small key
+    // range makes for long probe runs and many removals from their middle.
+
+    IdentifierMap<int> m;
+    std::map<Identifier, int> expected;
+
+    srand(4321);
+
+    for (int i = 0;  i < 20000;  ++i)
+    {
+        Identifier id = makeId(rand() % 500);
+
+        if (rand() % 3 == 0)
+            CHECK_EQUAL(m.erase(id), expected.erase(id) == 1);
+        else
+        {
+            bool isNew = (expected.find(id) == expected.end());
+            expected[id] = i;
+            CHECK_EQUAL(m.insert(id, i), isNew);
+        }
+    }
+
+    CHECK_EQUAL(m.size(), expected.size());
+
+    std::map<Identifier, int>::const_iterator e;
+    for (e = expected.begin();  e != expected.end();  ++e)
+    {
+        const int *value = m.find(e->first);
+        CHECK(value != NULL && *value == e->second);
+    }
+
+    m.sort();
+    IdentifierMap<int>::const_iterator iter = m.begin();
+    for (e = expected.begin();  e != expected.end();  ++e, ++iter)
+        CHECK_EQUAL(iter->first, e->first);
+
+}   //  end againstStdMapForIdentifierMap
+
+TEST(equalityForIdentifierMap)
+{
+    std::cout << "IdentifierMap equalityForIdentifierMap" << '\n';
+
+    IdentifierMap<int> a, b;
+
+    for (int i = 0;  i < 1000;  ++i)
+    {
+        a.insert(makeId(i), i);
+        b.insert(makeId(999 - i), 999 - i);
+    }
+
+    // Order does not matter
+
+    CHECK(a == b);
+
+    b.insert(makeId(5), 6);
+    CHECK(a != b);
+
+    b.insert(makeId(5), 5);
+    b.erase(makeId(7));
+    CHECK(a != b);
+
+    b.insert(makeId(1000), 7);
+    CHECK(a != b);
+
+    // Reserving keeps the contents
+
+    IdentifierMap<int> c = a;
+    c.reserve(100000);
+    CHECK(a == c);
+
+}   //  end equalityForIdentifierMap
+
+// end IdentifierMapTest.cpp
@@ -0,0 +1,155 @@
+// IdentifierTest.cpp  -  Test the Identifier class
+
+#include "UnitTest++.h"
+
+#include "Identifier.h"
+#include "Catalog.h"
+#include "Roster.h"
+#include "YosokumoProtobuf.h"
+
+#include <iostream>
+#include <sstream>
+
+using namespace Yosokumo;
+
+static std::string makeHexId(int n)
+{
+    std::stringstream s;
+    s << std::hex << std::uppercase << (0xABC0000 + n) << "00000000";
+    return s.str();
+}
+
+TEST(internForIdentifier)
+{
+    std::cout << "Identifier internForIdentifier" << '\n';
+
+    Identifier empty;
+    CHECK(empty.empty());
+    CHECK_EQUAL(empty.str(), "");
+    CHECK(empty == Identifier(std::string()));
+
+    std::string s = "0123456789ABCDEF";
+    Identifier a(s), b(std::string("0123456789ABCDEF"));
+
+    // Equal strings are interned once
+
+    CHECK(a == b);
+    CHECK(&a.str() == &b.str());
+    CHECK_EQUAL(a.str(), s);
+    CHECK(a.getHash() == b.getHash());
+    CHECK(a != empty);
+
+    size_t count = Identifier::getInternedCount();
+    Identifier c(s);
+    CHECK_EQUAL(Identifier::getInternedCount(), count);
+
+    // find() does not intern
+
+    Identifier found;
+    CHECK(Identifier::find(s, found));
+    CHECK(found == a);
+    CHECK(!Identifier::find("never interned anywhere", found));
+    CHECK(found == a);
+    CHECK_EQUAL(Identifier::getInternedCount(), count);
+
+    // Ordering is by string
+
+    CHECK(Identifier(std::string("A")) < Identifier(std::string("B")));
+    CHECK(!(a < a));
+    CHECK(empty < a);
+
+    std::stringstream out;
+    out << a;
+    CHECK_EQUAL(out.str(), s);
+
+}   //  end internForIdentifier
+
+TEST(catalogConversionForIdentifier)
+{
+    std::cout << "Identifier catalogConversionForIdentifier" << '\n';
+
+    Catalog catalog(makeHexId(0), "user name");
+
+    for (int i = 1;  i <= 200;  ++i)
+    {
+        Study study("study name", Study::NUMBER, Study::RUNNING,
+                                                            Study::PRIVATE);
+        study.setStudyIdentifier(makeHexId(i));
+        catalog.addStudy(study);
+    }
+
+    YosokumoProtobuf dif;
+    std::vector<uint8_t> bytes;
+    CHECK(dif.makeBytesFromCatalog(catalog, bytes));
+
+    size_t count = Identifier::getInternedCount();
+
+    Catalog decoded;
+    CHECK(dif.makeCatalogFromBytes(bytes, decoded));
+
+    // Decoding interns nothing new:  the decoded identifiers refer to the
+    // strings interned when the catalog was built
+
+    CHECK_EQUAL(Identifier::getInternedCount(), count);
+    CHECK(decoded == catalog);
+    CHECK(decoded.getUserIdentifierHandle() ==
+                                        catalog.getUserIdentifierHandle());
+
+    Catalog::StudyConstIterator iter;
+    for (iter = decoded.begin();  iter != decoded.end();  ++iter)
+    {
+        Study original;
+        CHECK(catalog.getStudy(iter->second.getStudyIdentifier(), original));
+        CHECK(&iter->second.getStudyIdentifierHandle().str() ==
+                            &original.getStudyIdentifierHandle().str());
+    }
+
+    // The bytes are the same after a round trip
+
+    std::vector<uint8_t> again;
+    CHECK(dif.makeBytesFromCatalog(decoded, again));
+    CHECK(again == bytes);
+
+}   //  end catalogConversionForIdentifier
+
+TEST(rosterConversionForIdentifier)
+{
+    std::cout << "Identifier rosterConversionForIdentifier" << '\n';
+
+    std::string studyId = makeHexId(1000);
+    Roster roster(studyId, "study name");
+
+    for (int i = 1;  i <= 50;  ++i)
+    {
+        Role role(makeHexId(2000 + i), studyId);
+        role.setUserName("user name");
+        role.setStudyName("study name");
+        roster.addRole(role);
+    }
+
+    YosokumoProtobuf dif;
+    std::vector<uint8_t> bytes;
+    CHECK(dif.makeBytesFromRoster(roster, bytes));
+
+    Roster decoded;
+    CHECK(dif.makeRosterFromBytes(bytes, decoded));
+    CHECK(decoded == roster);
+
+    // Every role shares the roster's study identifier
+
+    Roster::RoleConstIterator iter;
+    for (iter = decoded.begin();  iter != decoded.end();  ++iter)
+    {
+        CHECK(iter->second.getStudyIdentifierHandle() ==
+                                        decoded.getStudyIdentifierHandle());
+        CHECK(iter->first == iter->second.getUserIdentifierHandle());
+    }
+
+    Role role;
+    CHECK(decoded.getRole(makeHexId(2007), role));
+    CHECK_EQUAL(role.getStudyIdentifier(), studyId);
+    CHECK(!decoded.getRole(makeHexId(3000), role));
+
+}   //  end rosterConversionForIdentifier
+
+// end IdentifierTest.cpp
@@ -0,0 +1,202 @@
+// LazyCatalogTest.cpp  -  Test the LazyCatalog class
+
+#include "UnitTest++.h"
+
+#include "LazyCatalog.h"
+#include "YosokumoProtobuf.h"
+
+#include "TestStudies.h"
+
+#include <iostream>
+
+using namespace Yosokumo;
+
+// The server sends more of a study than makeBytesFromCatalog() encodes, so
+// build the encoding here
+
+static void makeLazyCatalogBytes(
+    const Catalog        &catalog,
+    std::vector<uint8_t> &bytes)
+{
+    ProtoBuf::Catalog protoCatalog;
+    protoCatalog.set_user_identifier(catalog.getUserIdentifier());
+    protoCatalog.set_user_name(catalog.getUserName());
+    protoCatalog.set_location(catalog.getCatalogLocation());
+
+    Catalog::StudyConstIterator iter;
+    for (iter = catalog.begin();  iter != catalog.end();  ++iter)
+    {
+        const Study &study = iter->second;
+
+        ProtoBuf::Study *p = protoCatalog.add_study();
+        p->set_study_identifier(study.getStudyIdentifier());
+        p->set_study_name(study.getStudyName());
+        p->set_type(ProtoBuf::Study_Type_Number);
+        p->set_status(ProtoBuf::Study_Status_Running);
+        p->set_visibility(ProtoBuf::Study_Visibility_Private);
+        p->set_location(study.getStudyLocation());
+        p->mutable_owner()->set_user_identifier(study.getOwnerIdentifier());
+        p->mutable_owner()->set_user_name(study.getOwnerName());
+        p->mutable_table()->set_location(study.getTableLocation());
+        p->mutable_model()->set_location(study.getModelLocation());
+        p->mutable_panel()->set_location(study.getPanelLocation());
+        p->mutable_roster()->set_location(study.getRosterLocation());
+    }
+
+    bytes.resize(protoCatalog.ByteSize());
+    protoCatalog.SerializeToArray(&bytes[0], int(bytes.size()));
+}
+
+TEST(lookupForLazyCatalog)
+{
+    std::cout << "LazyCatalogTest lookupForLazyCatalog" << '\n';
+
+    const unsigned N = 200;
+
+    Catalog catalog = makeTestCatalog(N);
+
+    YosokumoProtobuf dif;
+    std::vector<uint8_t> bytes;
+    makeLazyCatalogBytes(catalog, bytes);
+
+    LazyCatalog lazy;
+    CHECK_EQUAL(0u, lazy.size());
+    CHECK(dif.makeLazyCatalogFromBytes(bytes, lazy));
+    CHECK(bytes.empty());
+
+    CHECK_EQUAL("user-1", lazy.getUserIdentifier());
+    CHECK_EQUAL("User One", lazy.getUserName());
+    CHECK_EQUAL("/catalog/user-1", lazy.getCatalogLocation());
+    CHECK_EQUAL(N, lazy.size());
+
+    // By position, in the order of the catalog
+
+    Study study;
+    Catalog::StudyConstIterator iter = catalog.begin();
+    for (size_t i = 0;  i < lazy.size();  ++i, ++iter)
+    {
+        CHECK_EQUAL(iter->second.getStudyIdentifier(),
+                                                lazy.getStudyIdentifier(i));
+        CHECK(lazy.getStudy(i, study));
+        CHECK(study == iter->second);
+        CHECK_EQUAL(iter->second.getTableLocation(), study.getTableLocation());
+    }
+    CHECK(!lazy.getStudy(N, study));
+    CHECK_EQUAL("", lazy.getStudyIdentifier(N));
+
+    // By identifier
+
+    for (unsigned i = 0;  i < N;  ++i)
+    {
+        Study expected = makeTestStudy(i);
+        CHECK(lazy.containsStudy(expected.getStudyIdentifier()));
+        CHECK(lazy.findStudy(expected.getStudyIdentifier(), study));
+        CHECK(study == expected);
+        CHECK_EQUAL(expected.getRosterLocation(), study.getRosterLocation());
+    }
+    CHECK(!lazy.containsStudy("study-"));
+    CHECK(!lazy.containsStudy("study-9999"));
+    CHECK(!lazy.containsStudy(""));
+    CHECK(!lazy.findStudy("zzz", study));
+
+    // The whole catalog, as decoding it all at once makes it
+
+    Catalog decoded, eager;
+    CHECK(lazy.getCatalog(decoded));
+    makeLazyCatalogBytes(catalog, bytes);
+    CHECK(dif.makeCatalogFromBytes(bytes, eager));
+    CHECK(decoded == eager);
+    CHECK_EQUAL(catalog.size(), decoded.size());
+    CHECK(decoded.getStudy("study-0", study));
+    CHECK_EQUAL("/model/study-0", study.getModelLocation());
+
+    lazy.clear();
+    CHECK_EQUAL(0u, lazy.size());
+    CHECK_EQUAL("", lazy.getUserIdentifier());
+    CHECK(!lazy.findStudy("study-0", study));
+}
+
+TEST(errorsForLazyCatalog)
+{
+    std::cout << "LazyCatalogTest errorsForLazyCatalog" << '\n';
+
+    Catalog catalog("user-1", "User One");
+    catalog.addStudy(makeTestStudy(1));
+    catalog.addStudy(makeTestStudy(2));
+
+    YosokumoProtobuf dif;
+    std::vector<uint8_t> good;
+    makeLazyCatalogBytes(catalog, good);
+
+    LazyCatalog lazy;
+    Catalog decoded;
+    ServiceException e;
+
+    // Two copies of a catalog are one catalog with every study twice
+
+    std::vector<uint8_t> bytes = good;
+    bytes.insert(bytes.end(), good.begin(), good.end());
+    CHECK(!dif.makeLazyCatalogFromBytes(bytes, lazy));
+    CHECK_EQUAL(2 * good.size(), bytes.size());
+    CHECK_EQUAL(0u, lazy.size());
+    dif.getException(e);
+    CHECK(std::string(e.what()).find("same identifier") != std::string::npos);
+
+    // Cut short, and empty
+
+    bytes.assign(good.begin(), good.end() - 4);
+    CHECK(!dif.makeLazyCatalogFromBytes(bytes, lazy));
+    CHECK_EQUAL(0u, lazy.size());
+    dif.getException(e);
+    CHECK(std::string(e.what()).find("ParseFromArray failed") 
+                                                        != std::string::npos);
+
+    bytes.clear();
+    CHECK(!dif.makeLazyCatalogFromBytes(bytes, lazy));
+
+    // Without a required field, as the eager decoder rejects them too
+
+    ProtoBuf::Catalog partial;
+    partial.set_user_name("User One");
+    std::string text;
+    partial.SerializePartialToString(&text);
+    bytes.assign(text.begin(), text.end());
+    CHECK(!dif.makeLazyCatalogFromBytes(bytes, lazy));
+    CHECK(!dif.makeCatalogFromBytes(bytes, decoded));
+    dif.getException(e);
+    CHECK(std::string(e.what()).find("ParseFromArray failed") 
+                                                        != std::string::npos);
+
+    partial.set_user_identifier("user-1");
+    partial.add_study()->set_study_name("No Identifier");
+    partial.SerializePartialToString(&text);
+    bytes.assign(text.begin(), text.end());
+    CHECK(!dif.makeLazyCatalogFromBytes(bytes, lazy));
+    CHECK(!dif.makeCatalogFromBytes(bytes, decoded));
+
+    partial.mutable_study(0)->set_study_identifier("study-1");
+    partial.mutable_study(0)->mutable_owner()->set_user_name("No Identifier");
+    partial.SerializePartialToString(&text);
+    bytes.assign(text.begin(), text.end());
+    CHECK(!dif.makeLazyCatalogFromBytes(bytes, lazy));
+    CHECK(!dif.makeCatalogFromBytes(bytes, decoded));
+
+    partial.mutable_study(0)->mutable_owner()->set_user_identifier("owner-1");
+    partial.SerializePartialToString(&text);
+    bytes.assign(text.begin(), text.end());
+    CHECK(dif.makeLazyCatalogFromBytes(bytes, lazy));
+    CHECK_EQUAL(1u, lazy.size());
+
+    // A catalog of no studies
+
+    Catalog none("user-2", "User Two");
+    CHECK(dif.makeBytesFromCatalog(none, bytes));
+    CHECK(dif.makeLazyCatalogFromBytes(bytes, lazy));
+    CHECK_EQUAL("user-2", lazy.getUserIdentifier());
+    CHECK_EQUAL(0u, lazy.size());
+
+    CHECK(lazy.getCatalog(decoded));
+    CHECK(decoded == none);
+}
+
+// end LazyCatalogTest.cpp
@@ -0,0 +1,165 @@
+// MetricsTest.cpp  -  Test the Metrics classes
+
+#include "UnitTest++.h"
+
+#include "Metrics.h"
+#include "Thread.h"
+#include "YosokumoRequest.h"
+#include "FakeServer.h"
+
+#include <iostream>
+
+using namespace Yosokumo;
+
+TEST(bucketsForLatencyHistogram)
+{
+    std::cout << "Metrics bucketsForLatencyHistogram" << '\n';
+
+    // Small values have a bucket each
+
+    for (uint64_t v = 0;  v < 16;  ++v)
+    {
+        CHECK_EQUAL(LatencyHistogram::getBucketIndex(v), unsigned(v));
+        CHECK_EQUAL(LatencyHistogram::getBucketUpperBound(unsigned(v)), v);
+    }
+
+    // Every value lies in its bucket, and buckets are narrow
+
+    for (uint64_t v = 16;  v < (uint64_t(1) << 39);  v = v * 3 / 2 + 1)
+    {
+        unsigned b = LatencyHistogram::getBucketIndex(v);
+        uint64_t upper = LatencyHistogram::getBucketUpperBound(b);
+        uint64_t lower = LatencyHistogram::getBucketUpperBound(b - 1) + 1;
+        CHECK(lower <= v && v <= upper);
+        CHECK(upper - lower < v / 15 + 1);
+    }
+
+    CHECK_EQUAL(LatencyHistogram::getBucketIndex(uint64_t(1) << 50),
+                unsigned(LatencyHistogram::NUM_BUCKETS - 1));
+
+}   //  end bucketsForLatencyHistogram
+
+TEST(percentilesForLatencyHistogram)
+{
+    std::cout << "Metrics percentilesForLatencyHistogram" << '\n';
+
+    LatencyHistogram h;
+    CHECK_EQUAL(h.getPercentile(50), 0UL);
+
+    for (uint64_t v = 1;  v <= 1000;  ++v)
+        h.record(v);
+
+    CHECK_EQUAL(h.getCount(), 1000UL);
+    CHECK_EQUAL(h.getSum(),   500500UL);
+    CHECK_EQUAL(h.getMax(),   1000UL);
+
+    uint64_t p50 = h.getPercentile(50);
+    uint64_t p99 = h.getPercentile(99);
+    CHECK(p50 >= 500 && p50 <= 532);
+    CHECK(p99 >= 990 && p99 <= 1000);
+    CHECK_EQUAL(h.getPercentile(100), 1000UL);
+
+    CHECK_EQUAL(h.getCountAtOrBelow(15), 15UL);
+
+}   //  end percentilesForLatencyHistogram
+
+class Recorder : public Thread
+{
+protected:
+
+    void run()
+    {
+        for (int i = 0;  i < 1000;  ++i)
+        {
+            Metrics::increment(Metrics::BYTES_SENT, 2);
+            Metrics::record(Metrics::PARSE_TIME, 40);
+        }
+    }
+};
+
+TEST(threadsForMetrics)
+{
+    std::cout << "Metrics threadsForMetrics" << '\n';
+
+    MetricsSnapshot before, after;
+    Metrics::snapshot(before);
+
+    // Counts from threads which have ended are kept
+
+    Recorder r[4];
+    for (int i = 0;  i < 4;  ++i)
+        r[i].start();
+    for (int i = 0;  i < 4;  ++i)
+        r[i].join();
+
+    Metrics::snapshot(after);
+    after.subtract(before);
+
+    CHECK_EQUAL(after.getCounter(Metrics::BYTES_SENT), 8000UL);
+    CHECK_EQUAL(after.getHistogram(Metrics::PARSE_TIME).getCount(), 4000UL);
+    CHECK_EQUAL(after.getHistogram(Metrics::PARSE_TIME).getSum(), 160000UL);
+
+    // Nothing is recorded while disabled
+
+    Metrics::setEnabled(false);
+    Metrics::increment(Metrics::BYTES_SENT, 5);
+    Metrics::setEnabled(true);
+    CHECK(Metrics::isEnabled());
+
+    MetricsSnapshot later;
+    Metrics::snapshot(later);
+    later.subtract(before);
+    CHECK_EQUAL(later.getCounter(Metrics::BYTES_SENT), 8000UL);
+
+}   //  end threadsForMetrics
+
+TEST(requestForMetrics)
+{
+    std::cout << "Metrics requestForMetrics" << '\n';
+
+    std::vector<uint8_t> key(Credentials::KEY_LEN, 7);
+    Credentials creds("THIS-IS-USER-ID1", key);
+
+    FakeServer server(2);
+    server.addResponse(200, std::vector<uint8_t>(10, 'a'));
+    server.addResponse(404, std::vector<uint8_t>());
+    server.start();
+
+    MetricsSnapshot before, after;
+    Metrics::snapshot(before);
+
+    YosokumoRequest yr(creds, "127.0.0.1", server.getPort(), "text/plain");
+    CHECK(yr.getFromServer("/thing"));
+    CHECK(yr.deleteFromServer("/thing"));
+    server.join();
+
+    Metrics::snapshot(after);
+    after.subtract(before);
+
+    CHECK_EQUAL(after.getCounter(Metrics::REQUESTS_GET),       1UL);
+    CHECK_EQUAL(after.getCounter(Metrics::REQUESTS_DELETE),    1UL);
+    CHECK_EQUAL(after.getCounter(Metrics::RESPONSES_2XX),      1UL);
+    CHECK_EQUAL(after.getCounter(Metrics::RESPONSES_4XX),      1UL);
+    CHECK_EQUAL(after.getCounter(Metrics::CONNECTIONS_OPENED), 1UL);
+    CHECK(after.getCounter(Metrics::BYTES_SENT)     > 0);
+    CHECK(after.getCounter(Metrics::BYTES_RECEIVED) > 10);
+
+    CHECK_EQUAL(after.getHistogram(Metrics::REQUEST_TIME).getCount(),    2UL);
+    CHECK_EQUAL(after.getHistogram(Metrics::CONNECT_TIME).getCount(),    1UL);
+    CHECK_EQUAL(after.getHistogram(Metrics::FIRST_BYTE_TIME).getCount(), 2UL);
+
+    std::string text = after.toPrometheusText();
+    CHECK(text.find("# TYPE yosokumo_requests_total counter\n") !=
+                                                        std::string::npos);
+    CHECK(text.find("yosokumo_requests_total{method=\"GET\"} 1\n") !=
+                                                        std::string::npos);
+    CHECK(text.find("# TYPE yosokumo_request_seconds histogram\n") !=
+                                                        std::string::npos);
+    CHECK(text.find("yosokumo_request_seconds_bucket{le=\"+Inf\"} 2\n") !=
+                                                        std::string::npos);
+    CHECK(text.find("yosokumo_request_seconds_count 2\n") !=
+                                                        std::string::npos);
+
+}   //  end requestForMetrics
+
+// end MetricsTest.cpp
@@ -0,0 +1,114 @@
+// MpscQueueTest.cpp  -  Test the MpscQueue class
+
+#include "UnitTest++.h"
+
+#include "MpscQueue.h"
+#include "Thread.h"
+
+#include <iostream>
+#include <vector>
+
+using namespace Yosokumo;
+
+// Pushes the values number * COUNT to number * COUNT + COUNT - 1, in order
+
+class QueueProducer : public Thread
+{
+    MpscQueue<unsigned> &queue;
+    unsigned            number;
+
+public:
+
+    enum { COUNT = 20000 };
+
+    QueueProducer(MpscQueue<unsigned> &queue, unsigned number) :
+        queue(queue), number(number)
+    {}
+
+protected:
+
+    void run()
+    {
+        for (unsigned i = 0;  i < COUNT;  ++i)
+            queue.push(number * COUNT + i);
+    }
+};
+
+TEST(fifoForMpscQueue)
+{
+    std::cout << "MpscQueue fifoForMpscQueue" << '\n';
+
+    MpscQueue<unsigned> queue;
+    unsigned v;
+
+    CHECK(!queue.pop(v));
+
+    queue.push(1);
+    queue.push(2);
+    CHECK(queue.pop(v));
+    CHECK_EQUAL(v, 1U);
+
+    queue.push(3);
+    CHECK(queue.pop(v));
+    CHECK_EQUAL(v, 2U);
+    CHECK(queue.pop(v));
+    CHECK_EQUAL(v, 3U);
+    CHECK(!queue.pop(v));
+
+    // The queue is reusable once empty, and deletes what is left
+
+    queue.push(4);
+    CHECK(queue.pop(v));
+    CHECK_EQUAL(v, 4U);
+    queue.push(5);
+    queue.push(6);
+
+}   //  end fifoForMpscQueue
+
+TEST(manyProducersForMpscQueue)
+{
+    std::cout << "MpscQueue manyProducersForMpscQueue" << '\n';
+
+    const unsigned P = 4;
+
+    MpscQueue<unsigned> queue;
+    std::vector<QueueProducer *> producers;
+    for (unsigned p = 0;  p < P;  ++p)
+    {
+        producers.push_back(new QueueProducer(queue, p));
+        CHECK(producers.back()->start());
+    }
+
+    // Every value arrives once, and each producer's values in order
+
+    std::vector<unsigned> next(P, 0);
+    unsigned total = 0;
+
+    while (total < P * QueueProducer::COUNT)
+    {
+        unsigned v;
+        if (!queue.pop(v))
+            continue;
+
+        unsigned p = v / QueueProducer::COUNT;
+        CHECK(p < P);
+        if (p >= P)
+            break;
+        CHECK_EQUAL(v % QueueProducer::COUNT, next[p]);
+        next[p] = v % QueueProducer::COUNT + 1;
+        ++total;
+    }
+
+    for (unsigned p = 0;  p < P;  ++p)
+    {
+        producers[p]->join();
+        delete producers[p];
+        CHECK_EQUAL(next[p], unsigned(QueueProducer::COUNT));
+    }
+
+    unsigned v;
+    CHECK(!queue.pop(v));
+
+}   //  end manyProducersForMpscQueue
+
+// end MpscQueueTest.cpp
@@ -45,6 +45,16 @@ TEST(allMethodsForPanel)
     CHECK_EQUAL(panel.getCreationTime             (), creationTime             );
     CHECK_EQUAL(panel.getLatestBlockTime          (), latestBlockTime          );
     CHECK_EQUAL(panel.getLatestProspectTime       (), latestProspectTime       );
+
+    Panel copy(panel);
+    CHECK(copy == panel);
+    copy.setCellCount(cellCount + 1);
+    CHECK(copy != panel);
+
+    Panel empty;
+    CHECK_EQUAL(empty.getBlockCount(), 0U);
+    CHECK(empty != panel);
+    CHECK(empty == Panel());
 }
 
 // end PanelTest.cpp
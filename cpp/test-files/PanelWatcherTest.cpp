@@ -0,0 +1,156 @@
+// PanelWatcherTest.cpp  -  Test the PanelWatcher class
+
+#include "UnitTest++.h"
+
+#include "PanelWatcher.h"
+#include "FakeServer.h"
+
+#include <iostream>
+#include <unistd.h>
+
+using namespace Yosokumo;
+
+static void makePanelBytes(
+    uint64_t             blockCount,
+    const std::string    &latestBlockTime,
+    std::vector<uint8_t> &bytes)
+{
+    Panel panel;
+    panel.setBlockCount(blockCount);
+    panel.setCellCount(0);
+    panel.setProspectCount(0);
+    panel.setLatestBlockTime(latestBlockTime);
+
+    YosokumoProtobuf dif;
+    dif.makeBytesFromPanel(panel, bytes);
+}
+
+class RecordingListener : public PanelListener
+{
+public:
+    Mutex    mutex;
+    unsigned changes;
+    unsigned failures;
+    unsigned fields;
+    uint64_t oldBlockCount;
+    uint64_t newBlockCount;
+
+    RecordingListener() :
+        changes(0), failures(0), fields(0), oldBlockCount(0), newBlockCount(0)
+    {}
+
+    void panelChanged(
+        const Study &,
+        const Panel &oldPanel,
+        const Panel &newPanel,
+        unsigned    changedFields)
+    {
+        ScopedLock lock(mutex);
+        ++changes;
+        fields        = changedFields;
+        oldBlockCount = oldPanel.getBlockCount();
+        newBlockCount = newPanel.getBlockCount();
+    }
+
+    void panelFailed(const Study &, const ServiceException &)
+    {
+        ScopedLock lock(mutex);
+        ++failures;
+    }
+
+    unsigned getChanges()
+    {
+        ScopedLock lock(mutex);
+        return changes;
+    }
+
+    unsigned getFailures()
+    {
+        ScopedLock lock(mutex);
+        return failures;
+    }
+};
+
+static Study makeWatchedStudy()
+{
+    Study study("watched", Study::NUMBER, Study::RUNNING, Study::PRIVATE);
+    study.setStudyIdentifier("STUDY-1");
+    study.setPanelLocation("/panel/1");
+    study.setBlockCount(5);
+    study.setLatestBlockTime("t0");
+    return study;
+}
+
+TEST(changesForPanelWatcher)
+{
+    std::cout << "PanelWatcher changesForPanelWatcher" << '\n';
+
+    // Two polls find the panel as in the study; the third finds a new block
+
+    std::vector<uint8_t> same, moved;
+    makePanelBytes(5, "t0", same);
+    makePanelBytes(6, "t1", moved);
+
+    FakeServer server(3);
+    server.addResponse(200, same);
+    server.addResponse(200, same);
+    server.addResponse(200, moved);
+    server.start();
+
+    RecordingListener listener;
+    PanelWatcher watcher(makeCreds(), "127.0.0.1", server.getPort(),
+                                                            listener, 5, 40);
+    watcher.watch(makeWatchedStudy());
+    CHECK_EQUAL(watcher.size(), 1U);
+    watcher.start();
+
+    server.join();
+    for (int i = 0;  i < 200 && listener.getChanges() == 0;  ++i)
+        usleep(10000);
+    watcher.stop();
+
+    CHECK_EQUAL(listener.changes, 1U);
+    CHECK_EQUAL(listener.fields,
+                    unsigned(Study::BLOCK_COUNT | Study::LATEST_BLOCK_TIME));
+    CHECK_EQUAL(listener.oldBlockCount, 5UL);
+    CHECK_EQUAL(listener.newBlockCount, 6UL);
+
+    for (unsigned i = 0;  i < server.requests.size();  ++i)
+        CHECK(server.requests[i].find("GET /panel/1 HTTP/1.1\r\n") == 0);
+    CHECK_EQUAL(server.connectionCount, 1);
+
+}   //  end changesForPanelWatcher
+
+TEST(backoffForPanelWatcher)
+{
+    std::cout << "PanelWatcher backoffForPanelWatcher" << '\n';
+
+    // Nothing listens on port 1, so every poll fails and the interval grows
+    // to the maximum
+
+    RecordingListener listener;
+    PanelWatcher watcher(makeCreds(), "127.0.0.1", 1, listener, 1, 8);
+    watcher.watch(makeWatchedStudy());
+    watcher.start();
+
+    for (int i = 0;  i < 200 && watcher.getInterval("STUDY-1") < 8;  ++i)
+        usleep(10000);
+
+    CHECK_EQUAL(watcher.getInterval("STUDY-1"), 8U);
+    CHECK(listener.getFailures() >= 3);
+    CHECK_EQUAL(listener.getChanges(), 0U);
+
+    // An unwatched study is forgotten
+
+    CHECK(watcher.unwatch("STUDY-1"));
+    CHECK(!watcher.unwatch("STUDY-1"));
+    CHECK_EQUAL(watcher.getInterval("STUDY-1"), 0U);
+    CHECK_EQUAL(watcher.size(), 0U);
+
+    watcher.stop();
+
+    CHECK_EQUAL(PanelWatcher::getChangedFields(Panel(), Panel()), 0U);
+
+}   //  end backoffForPanelWatcher
+
+// end PanelWatcherTest.cpp
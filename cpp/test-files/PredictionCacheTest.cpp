@@ -0,0 +1,120 @@
+// PredictionCacheTest.cpp  -  Test the PredictionCache class
+
+#include "UnitTest++.h"
+
+#include "PredictionCache.h"
+#include "Hash.h"
+#include "IntegerValue.h"
+#include "RealValue.h"
+
+#include <iostream>
+#include <unistd.h>
+
+using namespace Yosokumo;
+
+static Specimen makeProspect(uint64_t key, double x)
+{
+    Specimen s(key);
+    s.addCell(Cell(1, RealValue(x)));
+    s.addCell(Cell(2, IntegerValue(-3)));
+    return s;
+}
+
+TEST(hashForPredictionCache)
+{
+    std::cout << "PredictionCache hashForPredictionCache" << '\n';
+
+    // Key and status do not matter; cells and predictand do
+
+    Specimen a = makeProspect(1, 0.5);
+    Specimen b = makeProspect(2, 0.5);
+    b.setStatus(Specimen::INACTIVE);
+    CHECK_EQUAL(hashSpecimenContent(HASH_SEED, a), 
+                hashSpecimenContent(HASH_SEED, b));
+
+    Specimen c = makeProspect(1, 0.25);
+    CHECK(hashSpecimenContent(HASH_SEED, a) != 
+          hashSpecimenContent(HASH_SEED, c));
+
+    Specimen d = makeProspect(1, 0.5);
+    d.setPredictand(RealValue(1.0));
+    CHECK(hashSpecimenContent(HASH_SEED, a) != 
+          hashSpecimenContent(HASH_SEED, d));
+
+    CHECK(hashString(HASH_SEED, "ab") != hashString(HASH_SEED, "ba"));
+
+}   //  end hashForPredictionCache
+
+TEST(lookupAndInsertForPredictionCache)
+{
+    std::cout << "PredictionCache lookupAndInsertForPredictionCache" << '\n';
+
+    PredictionCache cache(2, 0);
+    Value v;
+
+    CHECK(!cache.lookup("s1", makeProspect(1, 1.0), v));
+    cache.insert("s1", makeProspect(1, 1.0), RealValue(10.0));
+    CHECK(cache.lookup("s1", makeProspect(9, 1.0), v));
+    CHECK_CLOSE(v.getRealValue(), 10.0, 1e-9);
+
+    // Same prospect, different study
+
+    CHECK(!cache.lookup("s2", makeProspect(1, 1.0), v));
+
+    CHECK_EQUAL(cache.getHitCount(),  1UL);
+    CHECK_EQUAL(cache.getMissCount(), 2UL);
+
+    // Least recently used goes first:  2.0 is dropped, not 1.0
+
+    cache.insert("s1", makeProspect(1, 2.0), RealValue(20.0));
+    CHECK(cache.lookup("s1", makeProspect(1, 1.0), v));
+    cache.insert("s1", makeProspect(1, 3.0), RealValue(30.0));
+    CHECK_EQUAL(cache.size(), 2U);
+    CHECK(cache.lookup("s1", makeProspect(1, 1.0), v));
+    CHECK(!cache.lookup("s1", makeProspect(1, 2.0), v));
+    CHECK(cache.lookup("s1", makeProspect(1, 3.0), v));
+
+    cache.clear();
+    CHECK_EQUAL(cache.size(), 0U);
+    CHECK_EQUAL(cache.getHitCount(), 0UL);
+
+}   //  end lookupAndInsertForPredictionCache
+
+TEST(expiryAndInvalidationForPredictionCache)
+{
+    std::cout << "PredictionCache expiryAndInvalidationForPredictionCache" << '\n';
+
+    Value v;
+
+    PredictionCache shortLived(10, 1);
+    shortLived.insert("s1", makeProspect(1, 1.0), RealValue(10.0));
+    usleep(5000);
+    CHECK(!shortLived.lookup("s1", makeProspect(1, 1.0), v));
+    CHECK_EQUAL(shortLived.size(), 0U);
+
+    PredictionCache cache(10, 0);
+    cache.insert("s1", makeProspect(1, 1.0), RealValue(10.0));
+    cache.insert("s1", makeProspect(1, 2.0), RealValue(20.0));
+    cache.insert("s2", makeProspect(1, 1.0), RealValue(30.0));
+
+    // The first panel seen only sets the latest block time
+
+    Panel panel;
+    panel.setLatestBlockTime("2012-01-01T00:00:00Z");
+    CHECK(!cache.checkPanel("s1", panel));
+    CHECK(!cache.checkPanel("s1", panel));
+    CHECK_EQUAL(cache.size(), 3U);
+
+    // A new block drops the entries of that study only
+
+    panel.setLatestBlockTime("2012-01-02T00:00:00Z");
+    CHECK(cache.checkPanel("s1", panel));
+    CHECK_EQUAL(cache.size(), 1U);
+    CHECK(cache.lookup("s2", makeProspect(1, 1.0), v));
+
+    cache.invalidate("s2");
+    CHECK_EQUAL(cache.size(), 0U);
+
+}   //  end expiryAndInvalidationForPredictionCache
+
+// end PredictionCacheTest.cpp
@@ -0,0 +1,164 @@
+// PredictionCoalescerTest.cpp  -  Test the PredictionCoalescer class
+
+#include "UnitTest++.h"
+
+#include "PredictionCoalescer.h"
+#include "CellBlock.h"
+#include "RealValue.h"
+#include "SpecimenBlock.h"
+#include "FakeServer.h"
+
+#include <iostream>
+
+using namespace Yosokumo;
+
+// Make the entity of a predictions response:  specimen keys 1 to n, with
+// predictand 10 times the key
+
+static void makePredictionBytes(unsigned n, std::vector<uint8_t> &entity)
+{
+    std::vector<Specimen> specimens;
+    for (unsigned i = 1;  i <= n;  ++i)
+    {
+        Specimen s(i);
+        s.setPredictand(RealValue(10.0 * i));
+        specimens.push_back(s);
+    }
+
+    SpecimenBlock block("study-id");
+    for (unsigned i = 0;  i < n;  ++i)
+        block.addSpecimen(&specimens[i]);
+
+    YosokumoProtobuf dif;
+    dif.makeBytesFromBlock(block, entity);
+}
+
+TEST(fullBatchForPredictionCoalescer)
+{
+    std::cout << "PredictionCoalescer fullBatchForPredictionCoalescer" << '\n';
+
+    std::vector<uint8_t> entity;
+    makePredictionBytes(3, entity);
+
+    FakeServer server(1);
+    server.addResponse(200, entity);
+    server.start();
+
+    {
+        // A long delay, so only a full batch causes a post
+
+        PredictionCoalescer coalescer(makeCreds(), "127.0.0.1",
+                                    server.getPort(), "/model/1", 3, 60000);
+
+        // All prospects have the same key; each caller still gets its own
+        // prediction
+
+        Specimen prospect(7);
+        PredictionTicket t1, t2, t3;
+        coalescer.submit(prospect, t1);
+        coalescer.submit(prospect, t2);
+        coalescer.submit(prospect, t3);
+
+        CHECK(t1.wait());
+        CHECK(t2.wait());
+        CHECK(t3.wait());
+        CHECK_CLOSE(t1.getPredictand().getRealValue(), 10.0, 1e-9);
+        CHECK_CLOSE(t2.getPredictand().getRealValue(), 20.0, 1e-9);
+        CHECK_CLOSE(t3.getPredictand().getRealValue(), 30.0, 1e-9);
+    }
+    server.join();
+
+    CHECK_EQUAL(server.requests.size(), 1U);
+
+    // The one request carried all three prospects
+
+    std::string &r = server.requests[0];
+    std::string body = r.substr(r.find("\r\n\r\n") + 4);
+    std::vector<uint8_t> bytes(body.begin(), body.end());
+
+    YosokumoProtobuf dif;
+    Block posted;
+    CHECK(dif.makeBlockFromBytes(bytes, posted));
+    CHECK_EQUAL(posted.getItemCount(), 3UL);
+
+}   //  end fullBatchForPredictionCoalescer
+
+TEST(delayForPredictionCoalescer)
+{
+    std::cout << "PredictionCoalescer delayForPredictionCoalescer" << '\n';
+
+    std::vector<uint8_t> entity;
+    makePredictionBytes(1, entity);
+
+    FakeServer server(1);
+    server.addResponse(200, entity);
+    server.start();
+
+    {
+        PredictionCoalescer coalescer(makeCreds(), "127.0.0.1",
+                                    server.getPort(), "/model/1", 100, 20);
+
+        Value predictand;
+        CHECK(coalescer.predict(Specimen(99), predictand));
+        CHECK_CLOSE(predictand.getRealValue(), 10.0, 1e-9);
+    }
+    server.join();
+
+    CHECK_EQUAL(server.requests.size(), 1U);
+
+}   //  end delayForPredictionCoalescer
+
+TEST(failureForPredictionCoalescer)
+{
+    std::cout << "PredictionCoalescer failureForPredictionCoalescer" << '\n';
+
+    FakeServer server(1);
+    server.addResponse(500, std::vector<uint8_t>());
+    server.start();
+
+    {
+        PredictionCoalescer coalescer(makeCreds(), "127.0.0.1",
+                                    server.getPort(), "/model/1", 100, 1);
+
+        Value predictand;
+        ServiceException e;
+        CHECK(!coalescer.predict(Specimen(1), predictand, e));
+        CHECK_EQUAL(e.getStatusCode(), 500);
+    }
+    server.join();
+
+}   //  end failureForPredictionCoalescer
+
+TEST(cacheForPredictionCoalescer)
+{
+    std::cout << "PredictionCoalescer cacheForPredictionCoalescer" << '\n';
+
+    std::vector<uint8_t> entity;
+    makePredictionBytes(1, entity);
+
+    FakeServer server(1);
+    server.addResponse(200, entity);
+    server.start();
+
+    PredictionCache cache;
+    {
+        PredictionCoalescer coalescer(makeCreds(), "127.0.0.1",
+                                    server.getPort(), "/model/1", 100, 1);
+        coalescer.setCache(&cache);
+
+        // The second prediction comes from the cache
+
+        Value predictand;
+        CHECK(coalescer.predict(Specimen(5), predictand));
+        CHECK(coalescer.predict(Specimen(6), predictand));
+        CHECK_CLOSE(predictand.getRealValue(), 10.0, 1e-9);
+    }
+    server.join();
+
+    CHECK_EQUAL(server.requests.size(), 1U);
+    CHECK_EQUAL(cache.getHitCount(),  1UL);
+    CHECK_EQUAL(cache.getMissCount(), 1UL);
+
+}   //  end cacheForPredictionCoalescer
+
+// end PredictionCoalescerTest.cpp
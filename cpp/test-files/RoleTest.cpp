@@ -121,6 +121,35 @@ TEST(settersAndGettersForRole)
     CHECK(role.getStudyName()       == studyName);
 }
 
+TEST(fingerprintForRole)
+{
+    std::cout << "Role fingerprintForRole" << '\n';
+
+    Role role("user", "study"), role2("user", "study");
+    CHECK_EQUAL(role.getFingerprint(), role2.getFingerprint());
+    CHECK(role.getFingerprint() != Role().getFingerprint());
+
+    uint64_t fingerprint = role.getFingerprint();
+
+    role2.setUserName("user name");
+    CHECK(role.getFingerprint() != role2.getFingerprint());
+    CHECK(role != role2);
+    role2.setUserName("");
+    CHECK_EQUAL(fingerprint, role2.getFingerprint());
+
+    role2.addPrivilege(Privilege::GET_MODEL);
+    CHECK(role.getFingerprint() != role2.getFingerprint());
+    role2.removePrivilege(Privilege::GET_MODEL);
+    CHECK_EQUAL(fingerprint, role2.getFingerprint());
+    CHECK(role == role2);
+
+    role.addAllPrivileges();
+    role2 = role;
+    CHECK_EQUAL(role.getFingerprint(), role2.getFingerprint());
+    role2.removeAllPrivileges();
+    CHECK_EQUAL(fingerprint, role2.getFingerprint());
+}
+
 TEST(addAndRemovePrivilegesForRole)
 {
     std::cout << "Role addAndRemovePrivilegesForRole" << '\n';
@@ -0,0 +1,477 @@
+// ServiceTest.cpp  -  Test the Service class
+
+#include "UnitTest++.h"
+
+#include "Service.h"
+#include "CellBlock.h"
+#include "Message.h"
+#include "RealValue.h"
+#include "SpecimenBlock.h"
+#include "FakeServer.h"
+
+#include <iostream>
+
+using namespace Yosokumo;
+
+static void makeStudyBytes(const std::string &name, std::vector<uint8_t> &b)
+{
+    Study study(name, Study::NUMBER, Study::RUNNING, Study::PRIVATE);
+    YosokumoProtobuf dif;
+    dif.makeBytesFromStudy(study, b);
+}
+
+TEST(basicMethodsForService)
+{
+    std::cout << "Service basicMethodsForService" << '\n';
+
+    Service service(makeCreds(), "127.0.0.1", 1);
+
+    CHECK(!service.isException());
+    CHECK_EQUAL(service.getMaxConnections(),
+                                    unsigned(Service::DEFAULT_MAX_CONNECTIONS));
+
+    service.setMaxConnections(0);
+    CHECK_EQUAL(service.getMaxConnections(), 1U);
+    service.setMaxConnections(3);
+    CHECK_EQUAL(service.getMaxConnections(), 3U);
+
+}   //  end basicMethodsForService
+
+TEST(getStudyReusesConnectionForService)
+{
+    std::cout << "Service getStudyReusesConnectionForService" << '\n';
+
+    std::vector<uint8_t> entity;
+    makeStudyBytes("Study One", entity);
+
+    FakeServer server(2);
+    server.addResponse(200, entity);
+    server.start();
+
+    Service service(makeCreds(), "127.0.0.1", server.getPort());
+
+    Study study;
+    CHECK(service.getStudy("/study/1", study));
+    CHECK_EQUAL(study.getStudyName(), "Study One");
+    CHECK(service.getStudy("/study/1", study));
+    server.join();
+
+    CHECK_EQUAL(server.connectionCount, 1);
+    CHECK_EQUAL(server.requests.size(), 2U);
+    CHECK(server.requests[0].find("GET /study/1 HTTP/1.1\r\n") == 0);
+    CHECK(server.requests[0].find("Authorization: yosokumo THIS-IS-USER-ID1:")
+                                                        != std::string::npos);
+
+}   //  end getStudyReusesConnectionForService
+
+TEST(errorStatusForService)
+{
+    std::cout << "Service errorStatusForService" << '\n';
+
+    Message message(Message::ERROR, "no such study");
+    std::vector<uint8_t> entity;
+    YosokumoProtobuf dif;
+    dif.makeBytesFromMessage(message, entity);
+
+    FakeServer server(1);
+    server.addResponse(404, entity);
+    server.start();
+
+    Service service(makeCreds(), "127.0.0.1", server.getPort());
+
+    Study study;
+    CHECK(!service.getStudy("/study/2", study));
+    server.join();
+
+    CHECK(service.isException());
+    ServiceException e = service.getException();
+    CHECK_EQUAL(e.getStatusCode(), 404);
+    CHECK_EQUAL(e.getFailedMethodName(), "getStudy");
+    CHECK(std::string(e.what()).find("no such study") != std::string::npos);
+
+}   //  end errorStatusForService
+
+TEST(conditionalGetForService)
+{
+    std::cout << "Service conditionalGetForService" << '\n';
+
+    std::vector<uint8_t> entity;
+    makeStudyBytes("Study One", entity);
+
+    FakeServer server(4);
+    server.addResponse(200, entity, "ETag: \"v1\"\r\n");
+    server.addResponse(304, std::vector<uint8_t>(), "ETag: \"v1\"\r\n");
+    server.start();
+
+    Service service(makeCreds(), "127.0.0.1", server.getPort());
+    service.setConditionalGet(true);
+    CHECK(service.getConditionalGet());
+
+    Study study;
+    CHECK(service.getStudy("/study/1", study));
+
+    // The unchanged study comes from the cache
+
+    Study again;
+    CHECK(service.getStudy("/study/1", again));
+    CHECK(!service.isException());
+    CHECK_EQUAL(again.getStudyName(), "Study One");
+
+    // With the changed flag, a study not yet current is set from the cache
+
+    Study kept;
+    bool changed = false;
+    CHECK(service.getStudy("/study/1", kept, changed));
+    CHECK(changed);
+    CHECK_EQUAL(kept.getStudyName(), "Study One");
+
+    // And a current one is not even copied
+
+    CHECK(service.getStudy("/study/1", kept, changed));
+    CHECK(!changed);
+    CHECK_EQUAL(kept.getStudyName(), "Study One");
+    server.join();
+
+    CHECK_EQUAL(server.requests.size(), 4U);
+    CHECK(server.requests[0].find("If-None-Match:") == std::string::npos);
+    CHECK(server.requests[1].find("If-None-Match: \"v1\"\r\n")
+                                                        != std::string::npos);
+
+}   //  end conditionalGetForService
+
+TEST(revalidateForService)
+{
+    std::cout << "Service revalidateForService" << '\n';
+
+    Catalog catalog("THIS-IS-USER-ID1", "User One");
+    Study study("Study One", Study::NUMBER, Study::RUNNING, Study::PRIVATE);
+    study.setStudyIdentifier("study-1");
+    catalog.addStudy(study);
+    std::vector<uint8_t> entity;
+    YosokumoProtobuf dif;
+    dif.makeBytesFromCatalog(catalog, entity);
+
+    FakeServer server(2);
+    server.addResponse(304, std::vector<uint8_t>(), "ETag: \"v1\"\r\n");
+    server.addResponse(200, entity, "ETag: \"v2\"\r\n");
+    server.start();
+
+    Service service(makeCreds(), "127.0.0.1", server.getPort());
+
+    // Unchanged:  the catalog is left alone
+
+    std::string eTag = "\"v1\"";
+    std::string lastModified;
+    Catalog kept;
+    bool changed = true;
+    CHECK(service.revalidateCatalog("/catalog/1", eTag, lastModified, kept,
+                                                                    changed));
+    CHECK(!changed);
+    CHECK_EQUAL("\"v1\"", eTag);
+    CHECK_EQUAL(0, kept.size());
+
+    // Changed:  the new catalog and validators
+
+    CHECK(service.revalidateCatalog("/catalog/1", eTag, lastModified, kept,
+                                                                    changed));
+    CHECK(changed);
+    CHECK_EQUAL("\"v2\"", eTag);
+    CHECK_EQUAL(1, kept.size());
+    server.join();
+
+    CHECK_EQUAL(server.requests.size(), 2U);
+    CHECK(server.requests[0].find("If-None-Match: \"v1\"\r\n")
+                                                        != std::string::npos);
+    CHECK(server.requests[0].find("If-Modified-Since:") == std::string::npos);
+    CHECK(server.requests[0].find("x-yosokumo-full-entries: on")
+                                                        != std::string::npos);
+
+}   //  end revalidateForService
+
+TEST(getLazyCatalogForService)
+{
+    std::cout << "Service getLazyCatalogForService" << '\n';
+
+    Catalog catalog("THIS-IS-USER-ID1", "User One");
+    catalog.setCatalogLocation("/catalog/THIS-IS-USER-ID1");
+    Study study("Study One", Study::NUMBER, Study::RUNNING, Study::PRIVATE);
+    study.setStudyIdentifier("study-1");
+    catalog.addStudy(study);
+    std::vector<uint8_t> entity;
+    YosokumoProtobuf dif;
+    dif.makeBytesFromCatalog(catalog, entity);
+
+    FakeServer server(2);
+    server.addResponse(200, entity);
+    server.addResponse(200, std::vector<uint8_t>(3, 0xFF));
+    server.start();
+
+    Service service(makeCreds(), "127.0.0.1", server.getPort());
+
+    LazyCatalog lazy;
+    CHECK(service.getLazyCatalog(lazy));
+    CHECK_EQUAL("User One", lazy.getUserName());
+    CHECK_EQUAL(1u, lazy.size());
+    Study found;
+    CHECK(lazy.findStudy("study-1", found));
+    CHECK(found == study);
+
+    // Not a catalog
+
+    CHECK(!service.getLazyCatalog(lazy));
+    CHECK_EQUAL(0u, lazy.size());
+    server.join();
+
+    CHECK_EQUAL(server.requests.size(), 2U);
+    CHECK(server.requests[0].find("GET /catalog/THIS-IS-USER-ID1 ")
+                                                        != std::string::npos);
+    CHECK(server.requests[0].find("x-yosokumo-full-entries: on")
+                                                        != std::string::npos);
+
+}   //  end getLazyCatalogForService
+
+TEST(postBlocksForService)
+{
+    std::cout << "Service postBlocksForService" << '\n';
+
+    const unsigned N = 6;
+
+    std::vector<Specimen> specimens;
+    for (unsigned i = 0;  i < N;  ++i)
+    {
+        Specimen s(i + 1);
+        s.setPredictand(RealValue(i + 0.5));
+        s.addCell(Cell(7, RealValue(i)));
+        specimens.push_back(s);
+    }
+
+    std::vector<SpecimenBlock *> owned;
+    std::vector<const Block *>   blocks;
+    for (unsigned i = 0;  i < N;  ++i)
+    {
+        owned.push_back(new SpecimenBlock("study-id"));
+        owned.back()->addSpecimen(&specimens[i]);
+        blocks.push_back(owned.back());
+    }
+
+    // Each response closes the connection, so the workers take turns with
+    // the one-connection-at-a-time server.
+
+    FakeServer server(N);
+    server.addResponse(201, std::vector<uint8_t>(), "Connection: close\r\n");
+    server.start();
+
+    Service service(makeCreds(), "127.0.0.1", server.getPort());
+    service.setMaxConnections(3);
+
+    std::vector<ServiceException> exceptions;
+    CHECK(service.postBlocks("/table/1", blocks, exceptions));
+    server.join();
+
+    CHECK_EQUAL(exceptions.size(), N);
+    CHECK_EQUAL(server.requests.size(), N);
+    for (unsigned i = 0;  i < server.requests.size();  ++i)
+        CHECK(server.requests[i].find("POST /table/1 HTTP/1.1\r\n") == 0);
+
+    for (unsigned i = 0;  i < N;  ++i)
+        delete owned[i];
+
+}   //  end postBlocksForService
+
+TEST(predictManyForService)
+{
+    std::cout << "Service predictManyForService" << '\n';
+
+    Specimen s(42);
+    s.setPredictand(RealValue(3.25));
+    SpecimenBlock prospects("study-id");
+    prospects.addSpecimen(&s);
+
+    std::vector<uint8_t> entity;
+    YosokumoProtobuf dif;
+    dif.makeBytesFromBlock(prospects, entity);
+
+    FakeServer server(2);
+    server.addResponse(200, entity, "Connection: close\r\n");
+    server.start();
+
+    Service service(makeCreds(), "127.0.0.1", server.getPort());
+    service.setMaxConnections(2);
+
+    Block p0, p1;
+    std::vector<const Block *> in;
+    std::vector<Block *>       out;
+    in.push_back(&prospects);  out.push_back(&p0);
+    in.push_back(&prospects);  out.push_back(&p1);
+
+    std::vector<ServiceException> exceptions;
+    CHECK(service.predictMany("/model/1", in, out, exceptions));
+    server.join();
+
+    CHECK_EQUAL(p0.getType(), Block::CELL);
+    CHECK_EQUAL(p1.getType(), Block::CELL);
+    CHECK_EQUAL(((CellBlock &)p0).size(), 1UL);
+    CHECK_EQUAL(((CellBlock &)p0).getCell(0).getKey(), 42UL);
+
+}   //  end predictManyForService
+
+TEST(postBlockInChunksForService)
+{
+    std::cout << "Service postBlockInChunksForService" << '\n';
+
+    CellBlock cblock("study-id");
+    for (unsigned i = 1;  i <= 40;  ++i)
+        cblock.addCell(Cell(i, RealValue(i)));
+
+    YosokumoProtobuf dif;
+    std::vector<uint8_t> entity;
+    dif.makeBytesFromBlock(cblock, entity);
+
+    std::vector<uint64_t> starts;
+    dif.splitBlock(cblock, entity.size() / 4, starts);
+    unsigned n = starts.size();
+
+    // The second chunk fails
+
+    Message message(Message::ERROR, "table is full");
+    std::vector<uint8_t> errorEntity;
+    dif.makeBytesFromMessage(message, errorEntity);
+
+    FakeServer server(n);
+    server.addResponse(201, std::vector<uint8_t>(), "Connection: close\r\n");
+    server.addResponse(413, errorEntity, "Connection: close\r\n");
+    server.addResponse(201, std::vector<uint8_t>(), "Connection: close\r\n");
+    server.start();
+
+    Service service(makeCreds(), "127.0.0.1", server.getPort());
+    service.setMaxConnections(1);
+
+    std::vector<ServiceException> exceptions;
+    CHECK(!service.postBlockInChunks("/table/1", cblock, entity.size() / 4, 
+                                                                exceptions));
+    server.join();
+
+    CHECK_EQUAL(exceptions.size(), n);
+    CHECK_EQUAL(server.requests.size(), n);
+    CHECK(!YosokumoDIF::isException(exceptions[0]));
+    CHECK_EQUAL(exceptions[1].getStatusCode(), 413);
+
+    ServiceException e = service.getException();
+    CHECK_EQUAL(e.getStatusCode(), 413);
+    CHECK(std::string(e.what()).find("1 of ") == 0);
+    CHECK(std::string(e.what()).find("table is full") != std::string::npos);
+
+}   //  end postBlockInChunksForService
+
+static Catalog makeHydrationCatalog(unsigned n)
+{
+    Catalog catalog("THIS-IS-USER-ID1", "user name");
+    for (unsigned i = 0;  i < n;  ++i)
+    {
+        std::string id(1, char('A' + i));
+        Study study("study " + id, Study::NUMBER, Study::RUNNING,
+                                                            Study::PRIVATE);
+        study.setStudyIdentifier("STUDY-" + id);
+        study.setPanelLocation("/panel/" + id);
+        study.setRosterLocation("/roster/" + id);
+        catalog.addStudy(study);
+    }
+    return catalog;
+}
+
+TEST(hydrateCatalogForService)
+{
+    std::cout << "Service hydrateCatalogForService" << '\n';
+
+    // One connection, so the panel and roster of each study are fetched in
+    // catalog order and the canned responses line up
+
+    Catalog catalog = makeHydrationCatalog(2);
+
+    YosokumoProtobuf dif;
+    FakeServer server(4);
+    for (unsigned i = 0;  i < 2;  ++i)
+    {
+        Panel panel;
+        panel.setBlockCount(10 + i);
+        panel.setCellCount(100 + i);
+        panel.setProspectCount(0);
+        std::vector<uint8_t> panelBytes;
+        dif.makeBytesFromPanel(panel, panelBytes);
+        server.addResponse(200, panelBytes);
+
+        Roster roster("STUDY-" + std::string(1, char('A' + i)), "name");
+        roster.addRole(Role("THIS-IS-USER-ID1", roster.getStudyIdentifier()));
+        std::vector<uint8_t> rosterBytes;
+        dif.makeBytesFromRoster(roster, rosterBytes);
+        server.addResponse(200, rosterBytes);
+    }
+    server.start();
+
+    Service service(makeCreds(), "127.0.0.1", server.getPort());
+    service.setMaxConnections(1);
+
+    std::map<std::string, Roster> rosters;
+    std::vector<ServiceException> exceptions;
+    CHECK(service.hydrateCatalog(catalog, &rosters, exceptions));
+    server.join();
+
+    CHECK_EQUAL(exceptions.size(), 2U);
+    Study study;
+    CHECK(catalog.getStudy("STUDY-A", study));
+    CHECK_EQUAL(study.getBlockCount(), 10UL);
+    CHECK(catalog.getStudy("STUDY-B", study));
+    CHECK_EQUAL(study.getCellCount(), 101UL);
+    CHECK_EQUAL(rosters.size(), 2U);
+    CHECK_EQUAL(rosters["STUDY-B"].getStudyIdentifier(), "STUDY-B");
+    CHECK_EQUAL(rosters["STUDY-B"].size(), 1);
+
+    CHECK(server.requests[0].find("GET /panel/A HTTP/1.1\r\n")  == 0);
+    CHECK(server.requests[1].find("GET /roster/A HTTP/1.1\r\n") == 0);
+    CHECK(server.requests[2].find("GET /panel/B HTTP/1.1\r\n")  == 0);
+    CHECK(server.requests[3].find("GET /roster/B HTTP/1.1\r\n") == 0);
+
+}   //  end hydrateCatalogForService
+
+TEST(hydrateCatalogInParallelForService)
+{
+    std::cout << "Service hydrateCatalogInParallelForService" << '\n';
+
+    const unsigned N = 6;
+    Catalog catalog = makeHydrationCatalog(N);
+
+    Panel panel;
+    panel.setBlockCount(7);
+    panel.setCellCount(0);
+    panel.setProspectCount(0);
+    std::vector<uint8_t> entity;
+    YosokumoProtobuf dif;
+    dif.makeBytesFromPanel(panel, entity);
+
+    FakeServer server(N);
+    server.addResponse(200, entity, "Connection: close\r\n");
+    server.start();
+
+    Service service(makeCreds(), "127.0.0.1", server.getPort());
+    service.setMaxConnections(3);
+
+    std::vector<ServiceException> exceptions;
+    CHECK(service.hydrateCatalog(catalog, NULL, exceptions));
+    server.join();
+
+    CHECK_EQUAL(server.requests.size(), N);
+    Catalog::StudyConstIterator iter;
+    for (iter = catalog.begin();  iter != catalog.end();  ++iter)
+        CHECK_EQUAL(iter->second.getBlockCount(), 7UL);
+
+    // With nothing listening every study fails
+
+    Service down(makeCreds(), "127.0.0.1", 1);
+    CHECK(!down.hydrateCatalog(catalog, NULL, exceptions));
+    CHECK_EQUAL(exceptions.size(), N);
+    for (unsigned i = 0;  i < N;  ++i)
+        CHECK(YosokumoDIF::isException(exceptions[i]));
+
+}   //  end hydrateCatalogInParallelForService
+
+// end ServiceTest.cpp
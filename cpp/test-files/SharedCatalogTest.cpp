@@ -0,0 +1,290 @@
+// SharedCatalogTest.cpp  -  Test the SharedCatalog class
+
+#include "UnitTest++.h"
+
+#include "SharedCatalog.h"
+#include "Thread.h"
+
+#include "TestStudies.h"
+
+#include <sched.h>
+#include <stdlib.h>
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+using namespace Yosokumo;
+
+// A study from the shared builder, at a given block count
+
+static Study makeSharedStudy(unsigned i, uint64_t blockCount)
+{
+    Study study = makeTestStudy(i);
+    study.setBlockCount(blockCount);
+    return study;
+}
+
+static std::string generationName(unsigned g)
+{
+    std::stringstream s;
+    s << g;
+    return s.str();
+}
+
+TEST(publishForSharedCatalog)
+{
+    std::cout << "SharedCatalogTest publishForSharedCatalog" << '\n';
+
+    const unsigned N = 1000;
+
+    SharedCatalog shared;
+
+    {
+        SharedCatalog::ReadGuard guard(shared);
+        CHECK_EQUAL(0u, guard->size());
+        CHECK(guard->findStudy("study-1") == NULL);
+    }
+
+    Catalog catalog = makeTestCatalog(N);
+
+    shared.publish(catalog);
+
+    const Study *unchanged;
+    const Study *changed;
+    const CatalogVersion *first;
+
+    {
+        SharedCatalog::ReadGuard guard(shared);
+        first = &*guard;
+        CHECK_EQUAL(N, guard->size());
+        CHECK_EQUAL("user-1", guard->getUserIdentifier());
+        CHECK_EQUAL("User One", guard->getUserName());
+
+        unchanged = guard->findStudy("study-1");
+        changed   = guard->findStudy("study-2");
+        CHECK(unchanged != NULL && *unchanged == makeSharedStudy(1, 0));
+        CHECK(guard->containsStudy("study-999"));
+        CHECK(!guard->containsStudy("study-1000"));
+
+        Catalog back;
+        guard->getCatalog(back);
+        CHECK(back == catalog);
+    }
+
+    // Publishing the same catalog again changes nothing
+
+    shared.publish(catalog);
+    {
+        SharedCatalog::ReadGuard guard(shared);
+        CHECK(&*guard == first);
+    }
+
+    // A new version shares the studies which did not change
+
+    catalog.addStudy(makeSharedStudy(2, 7));
+    catalog.removeStudy("study-3");
+    catalog.addStudy(makeSharedStudy(N, 0));
+    shared.publish(catalog);
+
+    {
+        SharedCatalog::ReadGuard guard(shared);
+        CHECK(&*guard != first);
+        CHECK_EQUAL(N, guard->size());
+        CHECK(guard->findStudy("study-1") == unchanged);
+        CHECK(guard->findStudy("study-2") != changed);
+        CHECK_EQUAL(7u, guard->findStudy("study-2")->getBlockCount());
+        CHECK(guard->findStudy("study-3") == NULL);
+        CHECK(guard->findStudy("study-1000") != NULL);
+
+        std::vector<const Study *> studies;
+        guard->getStudies(studies);
+        CHECK_EQUAL(N, studies.size());
+
+        Catalog back;
+        guard->getCatalog(back);
+        CHECK(back == catalog);
+    }
+
+    // No guard was held, so the old versions are gone
+
+    CHECK_EQUAL(0u, shared.getRetiredCount());
+}
+
+TEST(applyForSharedCatalog)
+{
+    std::cout << "SharedCatalogTest applyForSharedCatalog" << '\n';
+
+    Catalog before = makeTestCatalog(100);
+
+    Catalog after(before);
+    after.setUserName("User Uno");
+    after.addStudy(makeSharedStudy(5, 1));
+    after.removeStudy("study-6");
+    after.addStudy(makeSharedStudy(100, 0));
+
+    SharedCatalog shared;
+    shared.publish(before);
+
+    const Study *unchanged;
+    {
+        SharedCatalog::ReadGuard guard(shared);
+        unchanged = guard->findStudy("study-7");
+    }
+
+    CatalogDelta delta;
+    delta.compute(before, after);
+    shared.apply(delta);
+
+    SharedCatalog::ReadGuard guard(shared);
+    CHECK_EQUAL("User Uno", guard->getUserName());
+    CHECK(guard->findStudy("study-7") == unchanged);
+
+    Catalog back;
+    guard->getCatalog(back);
+    CHECK(back == after);
+}
+
+TEST(guardsForSharedCatalog)
+{
+    std::cout << "SharedCatalogTest guardsForSharedCatalog" << '\n';
+
+    Catalog catalog("user-1", "User One");
+    catalog.addStudy(makeSharedStudy(0, 0));
+
+    SharedCatalog shared;
+    SharedCatalog other;
+    shared.publish(catalog);
+
+    {
+        SharedCatalog::ReadGuard outer(shared);
+        const Study *study = outer->findStudy("study-0");
+
+        // A held version outlives the refreshes which replace it
+
+        catalog.addStudy(makeSharedStudy(0, 1));
+        shared.publish(catalog);
+        catalog.addStudy(makeSharedStudy(0, 2));
+        shared.publish(catalog);
+        CHECK_EQUAL(2u, shared.getRetiredCount());
+        CHECK_EQUAL(0u, study->getBlockCount());
+
+        {
+            // Nested guards, also on another catalog, see the newest
+
+            SharedCatalog::ReadGuard inner(shared);
+            SharedCatalog::ReadGuard third(other);
+            CHECK_EQUAL(2u,
+                    inner->findStudy("study-0")->getBlockCount());
+            CHECK_EQUAL(0u, third->size());
+        }
+
+        shared.reclaim();
+        CHECK_EQUAL(2u, shared.getRetiredCount());
+        CHECK_EQUAL(0u, outer->findStudy("study-0")->getBlockCount());
+    }
+
+    shared.reclaim();
+    CHECK_EQUAL(0u, shared.getRetiredCount());
+}
+
+// Reads the catalog until told to stop, checking that each version is
+// whole:  the refresher names each version by its generation g, and sets
+// the block count of study 0 to g and of each other study to at most g
+
+class CatalogReader : public Thread
+{
+    SharedCatalog  &shared;
+    const unsigned size;
+    volatile bool  &stop;
+
+public:
+
+    unsigned reads;
+    unsigned errors;
+
+    CatalogReader(SharedCatalog &shared, unsigned size,
+                                                    volatile bool &stop) :
+        shared(shared), size(size), stop(stop), reads(0), errors(0)
+    {}
+
+protected:
+
+    void run()
+    {
+        unsigned i = 0;
+
+        while (!__atomic_load_n(&stop, __ATOMIC_ACQUIRE) || reads == 0)
+        {
+            SharedCatalog::ReadGuard guard(shared);
+
+            uint64_t g = strtoul(guard->getUserName().c_str(), NULL, 10);
+            const Study *first = guard->findStudy("study-0");
+            const Study *study = guard->findStudy(
+                makeSharedStudy(i++ % size, 0).getStudyIdentifier());
+
+            if (guard->size() != size || first == NULL || study == NULL ||
+                first->getBlockCount() != g || study->getBlockCount() > g)
+                ++errors;
+
+            ++reads;
+        }
+    }
+};
+
+TEST(concurrentForSharedCatalog)
+{
+    std::cout << "SharedCatalogTest concurrentForSharedCatalog" << '\n';
+
+    const unsigned N = 200;
+    const unsigned R = 4;
+    const unsigned G = 500;
+
+    Catalog catalog = makeTestCatalog(N);
+    catalog.setUserName(generationName(0));
+
+    SharedCatalog shared;
+    shared.publish(catalog);
+
+    volatile bool stop = false;
+    std::vector<CatalogReader *> readers;
+    for (unsigned r = 0;  r < R;  ++r)
+    {
+        readers.push_back(new CatalogReader(shared, N, stop));
+        CHECK(readers.back()->start());
+    }
+
+    srand(4321);
+
+    for (unsigned g = 1;  g <= G;  ++g)
+    {
+        catalog.setUserName(generationName(g));
+        catalog.addStudy(makeSharedStudy(0, g));
+        for (unsigned k = 0;  k < 5;  ++k)
+            catalog.addStudy(makeSharedStudy(1 + rand() % (N - 1), g));
+        shared.publish(catalog);
+
+        if (g % 50 == 0)
+            sched_yield();
+    }
+
+    __atomic_store_n(&stop, true, __ATOMIC_RELEASE);
+
+    for (unsigned r = 0;  r < R;  ++r)
+    {
+        readers[r]->join();
+        CHECK(readers[r]->reads > 0);
+        CHECK_EQUAL(0u, readers[r]->errors);
+        delete readers[r];
+    }
+
+    shared.reclaim();
+    CHECK_EQUAL(0u, shared.getRetiredCount());
+
+    SharedCatalog::ReadGuard guard(shared);
+    Catalog back;
+    guard->getCatalog(back);
+    CHECK(back == catalog);
+}
+
+// end SharedCatalogTest.cpp
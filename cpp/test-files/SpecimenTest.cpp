@@ -2,6 +2,7 @@
 
 #include "UnitTest++.h"
 #include "Specimen.h"
+#include "EmptyValue.h"
 #include "RealValue.h"
 #include "IntegerValue.h"
 #include "NaturalValue.h"
@@ -317,4 +318,75 @@ TEST(stressTestAccessToCellSequenceForSpecimen)
 
 }   //  end stressTestAccessToCellSequence
 
+TEST(fingerprintForSpecimen)
+{
+    std::cout << "SpecimenTest fingerprintForSpecimen" << '\n';
+
+    std::list<Cell> cellList;
+    makeList(cellList);
+
+    Specimen a(1, cellList.begin(), cellList.end());
+    Specimen b(1, cellList.begin(), cellList.end());
+    CHECK_EQUAL(a.getCellsFingerprint(), b.getCellsFingerprint());
+    CHECK_EQUAL(a.getFingerprint(), b.getFingerprint());
+    CHECK(a == b);
+
+    // Adding and removing cells keeps the fingerprint up to date
+
+    uint64_t fingerprint = a.getCellsFingerprint();
+
+    b.addCell(Cell(99, NaturalValue(99)));
+    CHECK(a.getCellsFingerprint() != b.getCellsFingerprint());
+    CHECK(a != b);
+    b.removeCells(1);
+    CHECK_EQUAL(fingerprint, b.getCellsFingerprint());
+    CHECK(a == b);
+
+    b.clearCells();
+    CHECK_EQUAL(Specimen().getCellsFingerprint(), b.getCellsFingerprint());
+    for (std::list<Cell>::iterator it = cellList.begin();
+                                                it != cellList.end();  ++it)
+        b.addCell(*it);
+    CHECK_EQUAL(fingerprint, b.getCellsFingerprint());
+
+    // The order of the cells counts
+
+    std::list<Cell> reversed(cellList.rbegin(), cellList.rend());
+    Specimen c(1, reversed.begin(), reversed.end());
+    CHECK(a.getCellsFingerprint() != c.getCellsFingerprint());
+    CHECK(a != c);
+
+    // The content fingerprint leaves out the key, status, and weight
+
+    Specimen d(2, Specimen::INACTIVE, 5, EmptyValue(),
+                                        cellList.begin(), cellList.end());
+    CHECK_EQUAL(a.getContentFingerprint(), d.getContentFingerprint());
+    CHECK(a.getFingerprint() != d.getFingerprint());
+    CHECK(a != d);
+
+    d.setPredictand(IntegerValue(-1));
+    CHECK(a.getContentFingerprint() != d.getContentFingerprint());
+
+    // Copies
+
+    Specimen copy(a);
+    CHECK_EQUAL(a.getFingerprint(), copy.getFingerprint());
+    CHECK(copy == a);
+
+    // A real zero is the same value whatever its sign
+
+    Specimen plus(1), minus(1);
+    plus .addCell(Cell(5, RealValue( 0.0)));
+    minus.addCell(Cell(5, RealValue(-0.0)));
+    CHECK(plus.getCell(0) == minus.getCell(0));
+    CHECK_EQUAL(plus.getCellsFingerprint(), minus.getCellsFingerprint());
+    CHECK_EQUAL(plus.getFingerprint(), minus.getFingerprint());
+    CHECK(plus == minus);
+
+    plus .setPredictand(RealValue( 0.0));
+    minus.setPredictand(RealValue(-0.0));
+    CHECK_EQUAL(plus.getContentFingerprint(), minus.getContentFingerprint());
+    CHECK(plus == minus);
+}
+
 //  end SpecimenTest.cpp
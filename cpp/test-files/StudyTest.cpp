@@ -195,6 +195,61 @@ TEST(equalityOperatorsForStudy)
     CHECK(study != study2);
 }
 
+TEST(fingerprintForStudy)
+{
+    std::cout << "StudyTest fingerprintForStudy" << '\n';
+
+    Study study, study2;
+    CHECK_EQUAL(study.getFingerprint(), study2.getFingerprint());
+
+    setAllStudyMembers(study);
+    setAllStudyMembers(study2);
+    CHECK_EQUAL(study.getFingerprint(), study2.getFingerprint());
+    CHECK(study.getFingerprint() != Study().getFingerprint());
+
+    // Each attribute counts, and setting one back restores the fingerprint
+
+    uint64_t fingerprint = study.getFingerprint();
+
+    study2.setLatestProspectTime("some other time");
+    CHECK(study.getFingerprint() != study2.getFingerprint());
+    study2.setLatestProspectTime("latest prospect time");
+    CHECK_EQUAL(fingerprint, study2.getFingerprint());
+
+    study2.setBlockCount(7890);
+    study2.setCellCount(123456);
+    CHECK(study.getFingerprint() != study2.getFingerprint());
+    CHECK(study != study2);
+
+    // The same value in different attributes does not cancel
+
+    Study a, b;
+    a.setStudyName("x");
+    b.setOwnerName("x");
+    CHECK(a.getFingerprint() != b.getFingerprint());
+
+    // Copies, and attributes set through a panel
+
+    Study copy(study);
+    CHECK_EQUAL(fingerprint, copy.getFingerprint());
+    study2 = study;
+    CHECK_EQUAL(fingerprint, study2.getFingerprint());
+
+    Study fromPanel("study name", Study::CHANCE, Study::STOPPED,
+                                                            Study::PUBLIC);
+    fromPanel.setStudyIdentifier("study identifier");
+    fromPanel.setStudyLocation  ("study location");
+    fromPanel.setOwnerIdentifier("owner identifier");
+    fromPanel.setOwnerName      ("owner name");
+    fromPanel.setTableLocation  ("table location");
+    fromPanel.setModelLocation  ("model location");
+    fromPanel.setPanelLocation  ("panel location");
+    fromPanel.setRosterLocation ("roster location");
+    fromPanel.setPanel(study.getPanel());
+    CHECK_EQUAL(fingerprint, fromPanel.getFingerprint());
+    CHECK(fromPanel == study);
+}
+
 TEST(toStringForStudy)
 {
     std::cout << "StudyTest toStringForStudy" << '\n';
@@ -0,0 +1,302 @@
+// TableImporterTest.cpp  -  Test the TableImporter class
+
+#include "UnitTest++.h"
+
+#include "TableImporter.h"
+
+#include <fcntl.h>
+#include <iostream>
+#include <sstream>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+using namespace Yosokumo;
+
+// Keeps a copy of each block handed over, and stops the import after
+// stopAfter blocks (0 means never)
+
+class CollectingSink : public ImportSink
+{
+public:
+    std::vector<std::vector<Specimen> > blocks;
+    std::vector<std::string>            studyIdentifiers;
+    size_t                              stopAfter;
+
+    CollectingSink() : stopAfter(0)
+    {}
+
+    bool blockReady(SpecimenBlock &block)
+    {
+        blocks.push_back(std::vector<Specimen>());
+        for (uint64_t i = 0;  i < block.size();  ++i)
+            blocks.back().push_back(*block.getSpecimen(i));
+        studyIdentifiers.push_back(block.getStudyIdentifier());
+
+        return stopAfter == 0 || blocks.size() < stopAfter;
+    }
+
+    std::vector<Specimen> all() const
+    {
+        std::vector<Specimen> specimens;
+        for (size_t i = 0;  i < blocks.size();  ++i)
+            specimens.insert(specimens.end(), blocks[i].begin(),
+                                                            blocks[i].end());
+        return specimens;
+    }
+};
+
+static bool import(TableImporter &importer, const std::string &text,
+                                                        CollectingSink &sink)
+{
+    return importer.importText(text.data(), text.size(), "study-id", sink);
+}
+
+TEST(mappingForTableImporter)
+{
+    std::cout << "TableImporterTest mappingForTableImporter" << '\n';
+
+    WorkStealingPool pool(2);
+    TableImporter importer(pool);
+    importer.setHeaderLines(1);
+    importer.mapColumn(0, TableImporter::SPECIMEN_KEY);
+    importer.mapColumn(1, TableImporter::PREDICTAND, Value::REAL);
+    importer.mapColumn(2, TableImporter::WEIGHT);
+    importer.mapColumn(4, TableImporter::PREDICTOR, Value::NATURAL, 11);
+    importer.mapColumn(5, TableImporter::PREDICTOR, Value::INTEGER, 12);
+    importer.mapColumn(6, TableImporter::PREDICTOR, Value::REAL,    13);
+
+    std::string text =
+        "key,y,w,ignored,a,b,c\n"
+        "17,0.25,3,xyz,42,-7,1e3\n"
+        "\n"
+        "18,-1.5,,xyz, 9 ,+5,3.14159\r\n"
+        "19,,1,,,,-0.000125";
+
+    CollectingSink sink;
+    CHECK(import(importer, text, sink));
+    CHECK_EQUAL(3u, importer.getSpecimenCount());
+    CHECK_EQUAL(1u, sink.blocks.size());
+    CHECK_EQUAL("study-id", sink.studyIdentifiers[0]);
+
+    std::vector<Specimen> s = sink.all();
+    CHECK_EQUAL(3u, s.size());
+
+    CHECK_EQUAL(17u, s[0].getSpecimenKey());
+    CHECK_EQUAL(0.25, s[0].getPredictand().getRealValue());
+    CHECK_EQUAL(3u, s[0].getWeight());
+    CHECK_EQUAL(3u, s[0].size());
+    CHECK_EQUAL(11u, s[0].getCell(0).getKey());
+    CHECK_EQUAL(42u, s[0].getCell(0).getValue().getNaturalValue());
+    CHECK_EQUAL(12u, s[0].getCell(1).getKey());
+    CHECK_EQUAL(-7, s[0].getCell(1).getValue().getIntegerValue());
+    CHECK_EQUAL(13u, s[0].getCell(2).getKey());
+    CHECK_EQUAL(1000.0, s[0].getCell(2).getValue().getRealValue());
+
+    CHECK_EQUAL(18u, s[1].getSpecimenKey());
+    CHECK_EQUAL(-1.5, s[1].getPredictand().getRealValue());
+    CHECK_EQUAL(Specimen().getWeight(), s[1].getWeight());
+    CHECK_EQUAL(3u, s[1].size());
+    CHECK_EQUAL(9u, s[1].getCell(0).getValue().getNaturalValue());
+    CHECK_EQUAL(5, s[1].getCell(1).getValue().getIntegerValue());
+    CHECK_EQUAL(strtod("3.14159", NULL),
+                                    s[1].getCell(2).getValue().getRealValue());
+
+    CHECK_EQUAL(19u, s[2].getSpecimenKey());
+    CHECK_EQUAL(Value::EMPTY, s[2].getPredictand().getType());
+    CHECK_EQUAL(1u, s[2].size());
+    CHECK_EQUAL(-0.000125, s[2].getCell(0).getValue().getRealValue());
+}
+
+TEST(realsForTableImporter)
+{
+    std::cout << "TableImporterTest realsForTableImporter" << '\n';
+
+    // Each real must come out as strtod() makes it, fast path or not
+
+    const char *reals[] =
+    {
+        "0", "-0.0", "1", "0.1", "123456.789", "9007199254740993",
+        "0.30000000000000004", "1.7976931348623157e308", "2.5E-3",
+        "12345678901234567890.5", ".5", "5."
+    };
+    size_t n = sizeof(reals) / sizeof(reals[0]);
+
+    std::string text;
+    for (size_t i = 0;  i < n;  ++i)
+        text += std::string(reals[i]) + "\n";
+
+    WorkStealingPool pool(1);
+    TableImporter importer(pool);
+    importer.mapColumn(0, TableImporter::PREDICTAND, Value::REAL);
+
+    CollectingSink sink;
+    CHECK(import(importer, text, sink));
+
+    std::vector<Specimen> s = sink.all();
+    CHECK_EQUAL(n, s.size());
+    for (size_t i = 0;  i < n && i < s.size();  ++i)
+    {
+        CHECK_EQUAL(strtod(reals[i], NULL),
+                                        s[i].getPredictand().getRealValue());
+        CHECK_EQUAL(i + 1, s[i].getSpecimenKey());
+    }
+}
+
+TEST(tabsForTableImporter)
+{
+    std::cout << "TableImporterTest tabsForTableImporter" << '\n';
+
+    WorkStealingPool pool(1);
+    TableImporter importer(pool, '\t');
+    importer.mapColumn(1, TableImporter::PREDICTOR, Value::INTEGER, 5);
+
+    CollectingSink sink;
+    CHECK(import(importer, "a,b\t-3\n\t4\n", sink));
+
+    std::vector<Specimen> s = sink.all();
+    CHECK_EQUAL(2u, s.size());
+    CHECK_EQUAL(1u, s[0].getSpecimenKey());
+    CHECK_EQUAL(-3, s[0].getCell(0).getValue().getIntegerValue());
+    CHECK_EQUAL(2u, s[1].getSpecimenKey());
+    CHECK_EQUAL(4, s[1].getCell(0).getValue().getIntegerValue());
+}
+
+TEST(blockLimitsForTableImporter)
+{
+    std::cout << "TableImporterTest blockLimitsForTableImporter" << '\n';
+
+    // Long lines, so the scanner crosses 64-byte blocks, cut into chunks
+    // much smaller than a block
+
+    std::stringstream text;
+    for (unsigned i = 1;  i <= 1000;  ++i)
+    {
+        text << i << "," << i * 0.5;
+        for (unsigned j = 0;  j < 10;  ++j)
+            text << "," << (i + j) % 97;
+        text << "\n";
+    }
+
+    WorkStealingPool pool(4);
+    TableImporter importer(pool);
+    importer.mapColumn(0, TableImporter::SPECIMEN_KEY);
+    importer.mapColumn(1, TableImporter::PREDICTAND, Value::REAL);
+    for (unsigned j = 0;  j < 10;  ++j)
+        importer.mapColumn(2 + j, TableImporter::PREDICTOR, Value::NATURAL,
+                                                                    100 + j);
+    importer.setChunkBytes(100);
+
+    // By count
+
+    importer.setBlockLimits(64, 1 << 20);
+    CollectingSink sink;
+    CHECK(import(importer, text.str(), sink));
+    CHECK_EQUAL(1000u, importer.getSpecimenCount());
+    CHECK_EQUAL(16u, sink.blocks.size());
+    for (size_t i = 0;  i + 1 < sink.blocks.size();  ++i)
+        CHECK_EQUAL(64u, sink.blocks[i].size());
+
+    std::vector<Specimen> s = sink.all();
+    CHECK_EQUAL(1000u, s.size());
+    for (size_t i = 0;  i < s.size();  ++i)
+    {
+        CHECK_EQUAL(i + 1, s[i].getSpecimenKey());
+        CHECK_EQUAL(10u, s[i].size());
+        CHECK_EQUAL((i + 1 + 9) % 97,
+                                s[i].getCell(9).getValue().getNaturalValue());
+    }
+
+    // By bytes:  each specimen is 24 + 16 * 10 = 184 bytes, so 5 fit in 1000
+
+    importer.setBlockLimits(1000, 1000);
+    CollectingSink sink2;
+    CHECK(import(importer, text.str(), sink2));
+    CHECK_EQUAL(200u, sink2.blocks.size());
+    CHECK_EQUAL(5u, sink2.blocks[0].size());
+    CHECK_EQUAL(1000u, sink2.all().size());
+
+    // Stopped by the sink
+
+    CollectingSink sink3;
+    sink3.stopAfter = 3;
+    CHECK(!import(importer, text.str(), sink3));
+    CHECK_EQUAL(3u, sink3.blocks.size());
+    CHECK(std::string(importer.getException().what()).find("stopped") !=
+                                                            std::string::npos);
+}
+
+TEST(errorsForTableImporter)
+{
+    std::cout << "TableImporterTest errorsForTableImporter" << '\n';
+
+    WorkStealingPool pool(2);
+    TableImporter importer(pool);
+    importer.setHeaderLines(2);
+    importer.mapColumn(0, TableImporter::SPECIMEN_KEY);
+    importer.mapColumn(1, TableImporter::PREDICTOR, Value::NATURAL, 1);
+    importer.setChunkBytes(8);
+
+    std::string text = "h1\nh2\n1,1\n2,2\n\n3,3\n4,-4\n5,5\n";
+
+    CollectingSink sink;
+    CHECK(!import(importer, text, sink));
+    CHECK_EQUAL(3u, importer.getSpecimenCount());
+    CHECK_EQUAL(3u, sink.all().size());
+    CHECK_EQUAL("Line 7: bad predictor in column 2",
+                        std::string(importer.getException().what()));
+
+    // A line without its key
+
+    CollectingSink sink2;
+    CHECK(!import(importer, "h1\nh2\n1,1\n,2\n", sink2));
+    CHECK_EQUAL("Line 4: bad specimen key in column 1",
+                        std::string(importer.getException().what()));
+
+    // A file which is not there
+
+    CollectingSink sink3;
+    CHECK(!importer.importFile("/nonexistent/table.csv", "study-id", sink3));
+    CHECK(std::string(importer.getException().what()).find("Cannot open") == 0);
+}
+
+TEST(importFileForTableImporter)
+{
+    std::cout << "TableImporterTest importFileForTableImporter" << '\n';
+
+    char path[] = "/tmp/TableImporterTest.XXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd >= 0);
+
+    std::string text = "key,y\n5,1.5\n6,2.5\n7,3.5\n";
+    CHECK_EQUAL(ssize_t(text.size()), write(fd, text.data(), text.size()));
+    close(fd);
+
+    WorkStealingPool pool(2);
+    TableImporter importer(pool);
+    importer.setHeaderLines(1);
+    importer.mapColumn(0, TableImporter::SPECIMEN_KEY);
+    importer.mapColumn(1, TableImporter::PREDICTAND, Value::REAL);
+
+    CollectingSink sink;
+    CHECK(importer.importFile(path, "study-id", sink));
+
+    std::vector<Specimen> s = sink.all();
+    CHECK_EQUAL(3u, s.size());
+    CHECK_EQUAL(7u, s[2].getSpecimenKey());
+    CHECK_EQUAL(3.5, s[2].getPredictand().getRealValue());
+
+    // An empty file is an empty table
+
+    fd = open(path, O_WRONLY | O_TRUNC);
+    close(fd);
+
+    CollectingSink sink2;
+    CHECK(importer.importFile(path, "study-id", sink2));
+    CHECK_EQUAL(0u, importer.getSpecimenCount());
+    CHECK_EQUAL(0u, sink2.blocks.size());
+
+    unlink(path);
+}
+
+// end TableImporterTest.cpp
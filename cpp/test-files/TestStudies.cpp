@@ -0,0 +1,57 @@
+// TestStudies.cpp  -  Studies and catalogs for testing
+
+#include "TestStudies.h"
+
+#include <sstream>
+
+using namespace Yosokumo;
+
+Study makeTestStudy(unsigned i)
+{
+    std::stringstream s;
+    s << "study-" << i;
+    std::string id = s.str();
+
+    Study study("Study " + id, Study::NUMBER, Study::RUNNING, Study::PRIVATE);
+    study.setStudyIdentifier(id);
+    study.setStudyLocation("/study/" + id);
+    study.setOwnerIdentifier("owner-1");
+    study.setOwnerName("Owner One");
+    study.setTableLocation("/table/" + id);
+    study.setModelLocation("/model/" + id);
+    study.setPanelLocation("/panel/" + id);
+    study.setRosterLocation("/roster/" + id);
+
+    return study;
+}
+
+Study makeTestStudyWithPanel(unsigned i)
+{
+    Study study = makeTestStudy(i);
+    std::string id = study.getStudyIdentifier();
+
+    study.setNameControlLocation("/control/name/" + id);
+    study.setStatusControlLocation("/control/status/" + id);
+    study.setVisibilityControlLocation("/control/visibility/" + id);
+    study.setBlockCount(i);
+    study.setCellCount(100 * i);
+    study.setProspectCount(10 * i);
+    study.setCreationTime("2012-01-31T23:59:59Z");
+    study.setLatestBlockTime("2012-02-29T00:00:00.125Z");
+
+    return study;
+}
+
+Catalog makeTestCatalog(unsigned n, bool withPanels)
+{
+    Catalog catalog("user-1", "User One");
+    catalog.setCatalogLocation("/catalog/user-1");
+
+    for (unsigned i = 0;  i < n;  ++i)
+        catalog.addStudy(withPanels ? makeTestStudyWithPanel(i) :
+                                                            makeTestStudy(i));
+
+    return catalog;
+}
+
+// end TestStudies.cpp
@@ -0,0 +1,37 @@
+// TestStudies.h  -  Studies and catalogs for testing
+
+#ifndef TESTSTUDIES_H
+#define TESTSTUDIES_H
+
+#include "Catalog.h"
+#include "Study.h"
+
+/**
+ * Return study number i, with the attributes a catalog carries:  the
+ * identifier "study-<i>", the name "Study study-<i>", type NUMBER, status
+ * RUNNING, visibility PRIVATE, the owner "owner-1", and each location in
+ * the standard layout, e.g., "/table/study-<i>".
+ */
+Yosokumo::Study makeTestStudy(unsigned i);
+
+/**
+ * Return study number i as above, with the attributes a panel carries as
+ * well:  the control locations, the counts i, 100 * i, and 10 * i, a
+ * creation time, and a latest block time with milliseconds.
+ */
+Yosokumo::Study makeTestStudyWithPanel(unsigned i);
+
+/**
+ * Return the catalog of "user-1", "User One", at "/catalog/user-1", which
+ * holds studies 0 to n - 1.
+ *
+ * @param  n           the number of studies.
+ * @param  withPanels  <code>true</code> means the studies are made by
+ *             <code>makeTestStudyWithPanel()</code>, else by
+ *             <code>makeTestStudy()</code>.
+ */
+Yosokumo::Catalog makeTestCatalog(unsigned n, bool withPanels = false);
+
+#endif  // TESTSTUDIES_H
+
+// end TestStudies.h
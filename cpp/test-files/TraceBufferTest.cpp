@@ -0,0 +1,137 @@
+// TraceBufferTest.cpp  -  Test the TraceBuffer class
+
+#include "UnitTest++.h"
+
+#include "TraceBuffer.h"
+#include "YosokumoRequest.h"
+#include "FakeServer.h"
+
+#include <iostream>
+#include <sstream>
+
+using namespace Yosokumo;
+
+// Throw away events left by earlier tests
+
+static void clearTrace()
+{
+    std::vector<TraceBuffer::Event> events;
+    TraceBuffer::drain(events);
+}
+
+TEST(recordAndDrainForTraceBuffer)
+{
+    std::cout << "TraceBuffer recordAndDrainForTraceBuffer" << '\n';
+
+    clearTrace();
+
+    TraceBuffer::record(TraceBuffer::REQUEST_START, 0, "GET /x");
+    TraceBuffer::record(TraceBuffer::BYTES_SENT, 123);
+    TraceBuffer::record(TraceBuffer::REQUEST_END, 456,
+                    "a very long text which does not fit in one event");
+
+    std::vector<TraceBuffer::Event> events;
+    TraceBuffer::drain(events);
+
+    CHECK_EQUAL(events.size(), 3U);
+    CHECK_EQUAL(events[0].type, TraceBuffer::REQUEST_START);
+    CHECK_EQUAL(events[0].getText(), "GET /x");
+    CHECK_EQUAL(events[1].value, 123UL);
+    CHECK_EQUAL(events[2].getText().size(),
+                                        unsigned(TraceBuffer::TEXT_SIZE));
+    CHECK(events[0].time <= events[2].time);
+
+    // Drained events are not drained again
+
+    events.clear();
+    TraceBuffer::drain(events);
+    CHECK(events.empty());
+
+    TraceBuffer::Event e = { 12345678, 7, 3, TraceBuffer::RESPONSE_STATUS,
+                                                                    0, "" };
+    CHECK_EQUAL(TraceBuffer::formatEvent(e), "12.345678 t3 RESPONSE_STATUS 7");
+
+}   //  end recordAndDrainForTraceBuffer
+
+class Tracer : public Thread
+{
+public:
+    unsigned n;
+
+protected:
+
+    void run()
+    {
+        for (unsigned i = 0;  i < n;  ++i)
+            TraceBuffer::record(TraceBuffer::BYTES_RECEIVED, i);
+    }
+};
+
+TEST(overflowForTraceBuffer)
+{
+    std::cout << "TraceBuffer overflowForTraceBuffer" << '\n';
+
+    clearTrace();
+
+    // A new thread gets a ring of the new capacity
+
+    TraceBuffer::setCapacity(32);
+    uint64_t droppedBefore = TraceBuffer::getDroppedCount();
+
+    Tracer t;
+    t.n = 100;
+    t.start();
+    t.join();
+
+    std::vector<TraceBuffer::Event> events;
+    TraceBuffer::drain(events);
+    TraceBuffer::setCapacity(TraceBuffer::DEFAULT_CAPACITY);
+
+    // The newest events are kept, and every event is either kept or counted
+    // as dropped
+
+    CHECK(events.size() >= 31 && events.size() <= 32);
+    CHECK_EQUAL(events.back().value, 99UL);
+    for (unsigned i = 1;  i < events.size();  ++i)
+        CHECK_EQUAL(events[i].value, events[i - 1].value + 1);
+    CHECK_EQUAL(TraceBuffer::getDroppedCount() - droppedBefore +
+                                                        events.size(), 100UL);
+
+}   //  end overflowForTraceBuffer
+
+TEST(requestForTraceBuffer)
+{
+    std::cout << "TraceBuffer requestForTraceBuffer" << '\n';
+
+    clearTrace();
+
+    std::vector<uint8_t> key(Credentials::KEY_LEN, 7);
+    Credentials creds("THIS-IS-USER-ID1", key);
+
+    FakeServer server(1);
+    server.addResponse(200, std::vector<uint8_t>(10, 'a'));
+    server.start();
+
+    std::stringstream out;
+    {
+        TraceDumper dumper(out, 5);
+        dumper.start();
+
+        YosokumoRequest yr(creds, "127.0.0.1", server.getPort(), "text/plain");
+        yr.setTrace(true);
+        CHECK(yr.getFromServer("/thing"));
+        server.join();
+    }
+
+    std::string text = out.str();
+    CHECK(text.find(" REQUEST_START 0 GET /thing\n")     != std::string::npos);
+    CHECK(text.find(" REQUEST_HEADER 0 Host: 127.0.0.1\n") !=
+                                                        std::string::npos);
+    CHECK(text.find(" RESPONSE_STATUS 200\n")            != std::string::npos);
+    CHECK(text.find(" BYTES_RECEIVED 10\n")              != std::string::npos);
+    CHECK(text.find(" getFromServer\n")                  != std::string::npos);
+    CHECK(text.find(" REQUEST_START") < text.find(" REQUEST_END"));
+
+}   //  end requestForTraceBuffer
+
+// end TraceBufferTest.cpp
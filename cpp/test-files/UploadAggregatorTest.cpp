@@ -0,0 +1,322 @@
+// UploadAggregatorTest.cpp  -  Test the UploadAggregator class
+
+#include "UnitTest++.h"
+
+#include "UploadAggregator.h"
+#include "CellBlock.h"
+#include "RealValue.h"
+#include "SpecimenBlock.h"
+#include "Thread.h"
+#include "YosokumoProtobuf.h"
+#include "FakeServer.h"
+
+#include <iostream>
+#include <unistd.h>
+
+using namespace Yosokumo;
+
+static Specimen makeSpecimen(uint64_t key)
+{
+    Specimen s(key);
+    s.setPredictand(RealValue(key + 0.5));
+    s.addCell(Cell(7, RealValue(key)));
+    return s;
+}
+
+// Decode the block posted by a request; return its number of specimens.
+// A specimen block decodes as a cell block, one cell per specimen.
+
+static uint64_t countSpecimens(
+    const std::string &request,
+    std::string       &studyIdentifier)
+{
+    size_t p = request.find("\r\n\r\n");
+    if (p == std::string::npos)
+        return 0;
+
+    std::vector<uint8_t> entity(request.begin() + p + 4, request.end());
+    YosokumoProtobuf dif;
+    Block block;
+    if (!dif.makeBlockFromBytes(entity, block) ||
+                                        block.getType() != Block::CELL)
+        return 0;
+
+    studyIdentifier = block.getStudyIdentifier();
+    return ((CellBlock &)block).size();
+}
+
+static bool waitForPosted(UploadAggregator &aggregator, uint64_t n)
+{
+    for (int i = 0;  i < 500;  ++i)
+    {
+        if (aggregator.getPostedCount() >= n)
+            return true;
+        usleep(10000);
+    }
+
+    return false;
+}
+
+// Adds COUNT specimens for one of two studies
+
+class SpecimenProducer : public Thread
+{
+    UploadAggregator &aggregator;
+    unsigned         number;
+
+public:
+
+    enum { COUNT = 250 };
+
+    SpecimenProducer(UploadAggregator &aggregator, unsigned number) :
+        aggregator(aggregator), number(number)
+    {}
+
+protected:
+
+    void run()
+    {
+        for (unsigned i = 0;  i < COUNT;  ++i)
+            aggregator.add(number % 2 ? "S1" : "S0", "/table/1",
+                                            makeSpecimen(number * COUNT + i));
+    }
+};
+
+TEST(fullBlockForUploadAggregator)
+{
+    std::cout << "UploadAggregator fullBlockForUploadAggregator" << '\n';
+
+    FakeServer server(1);
+    server.addResponse(201, std::vector<uint8_t>(), "Connection: close\r\n");
+    server.start();
+
+    {
+        // A long delay, so only a full block causes a post
+
+        UploadAggregator aggregator(makeCreds(), "127.0.0.1",
+                                                server.getPort(), 3, 1 << 20,
+                                                                        60000);
+
+        Study study;
+        study.setStudyIdentifier("STUDY-1");
+        study.setTableLocation("/table/1");
+
+        for (uint64_t k = 1;  k <= 3;  ++k)
+            CHECK(aggregator.add(study, makeSpecimen(k)));
+
+        CHECK(waitForPosted(aggregator, 3));
+        CHECK_EQUAL(aggregator.getFailedCount(), 0U);
+        CHECK_EQUAL(aggregator.getPendingBytes(), 0U);
+    }
+    server.join();
+
+    CHECK_EQUAL(server.requests.size(), 1U);
+    CHECK(server.requests[0].find("POST /table/1 HTTP/1.1\r\n") == 0);
+
+    std::string id;
+    CHECK_EQUAL(countSpecimens(server.requests[0], id), 3U);
+    CHECK_EQUAL(id, "STUDY-1");
+
+}   //  end fullBlockForUploadAggregator
+
+TEST(delayAndFlushForUploadAggregator)
+{
+    std::cout << "UploadAggregator delayAndFlushForUploadAggregator" << '\n';
+
+    FakeServer server(3);
+    server.addResponse(201, std::vector<uint8_t>(), "Connection: close\r\n");
+    server.start();
+
+    {
+        UploadAggregator aggregator(makeCreds(), "127.0.0.1",
+                                            server.getPort(), 100, 1 << 20, 20);
+
+        // One specimen is posted once it has waited long enough
+
+        CHECK(aggregator.add("S1", "/table/1", makeSpecimen(1)));
+        CHECK(waitForPosted(aggregator, 1));
+
+        // Specimens for two studies go in a block each
+
+        CHECK(aggregator.add("S1", "/table/1", makeSpecimen(2)));
+        CHECK(aggregator.add("S2", "/table/2", makeSpecimen(3)));
+        CHECK(aggregator.add("S1", "/table/1", makeSpecimen(4)));
+        aggregator.flush();
+
+        CHECK_EQUAL(aggregator.getPostedCount(), 4U);
+        CHECK_EQUAL(aggregator.getPendingBytes(), 0U);
+    }
+    server.join();
+
+    CHECK_EQUAL(server.requests.size(), 3U);
+
+    uint64_t total = 0;
+    for (unsigned i = 1;  i < server.requests.size();  ++i)
+    {
+        std::string id;
+        uint64_t n = countSpecimens(server.requests[i], id);
+        if (id == "S1")
+        {
+            CHECK_EQUAL(n, 2U);
+            CHECK(server.requests[i].find("POST /table/1 ") == 0);
+        }
+        else
+        {
+            CHECK_EQUAL(id, "S2");
+            CHECK_EQUAL(n, 1U);
+            CHECK(server.requests[i].find("POST /table/2 ") == 0);
+        }
+        total += n;
+    }
+    CHECK_EQUAL(total, 3U);
+
+}   //  end delayAndFlushForUploadAggregator
+
+TEST(twoTablesForUploadAggregator)
+{
+    std::cout << "UploadAggregator twoTablesForUploadAggregator" << '\n';
+
+    FakeServer server(2);
+    server.addResponse(201, std::vector<uint8_t>(), "Connection: close\r\n");
+    server.start();
+
+    {
+        UploadAggregator aggregator(makeCreds(), "127.0.0.1",
+                                        server.getPort(), 100, 1 << 20, 60000);
+
+        // Specimens for two tables of one study go in a block each
+
+        CHECK(aggregator.add("S1", "/table/1", makeSpecimen(1)));
+        CHECK(aggregator.add("S1", "/table/2", makeSpecimen(2)));
+        CHECK(aggregator.add("S1", "/table/2", makeSpecimen(3)));
+        aggregator.flush();
+
+        CHECK_EQUAL(aggregator.getPostedCount(), 3U);
+        CHECK_EQUAL(aggregator.getFailedCount(), 0U);
+    }
+    server.join();
+
+    CHECK_EQUAL(server.requests.size(), 2U);
+
+    for (unsigned i = 0;  i < server.requests.size();  ++i)
+    {
+        std::string id;
+        uint64_t n = countSpecimens(server.requests[i], id);
+        CHECK_EQUAL(id, "S1");
+        if (server.requests[i].find("POST /table/1 ") == 0)
+            CHECK_EQUAL(n, 1U);
+        else
+        {
+            CHECK(server.requests[i].find("POST /table/2 ") == 0);
+            CHECK_EQUAL(n, 2U);
+        }
+    }
+
+}   //  end twoTablesForUploadAggregator
+
+TEST(manyProducersForUploadAggregator)
+{
+    std::cout << "UploadAggregator manyProducersForUploadAggregator" << '\n';
+
+    // 4 producers, 2 per study, 1000 specimens in blocks of 100
+
+    FakeServer server(10);
+    server.addResponse(201, std::vector<uint8_t>(), "Connection: close\r\n");
+    server.start();
+
+    {
+        UploadAggregator aggregator(makeCreds(), "127.0.0.1",
+                        server.getPort(), 100, 1 << 20, 60000,
+                        UploadAggregator::DEFAULT_MEMORY_BUDGET, 2);
+
+        std::vector<SpecimenProducer *> producers;
+        for (unsigned p = 0;  p < 4;  ++p)
+        {
+            producers.push_back(new SpecimenProducer(aggregator, p));
+            CHECK(producers.back()->start());
+        }
+        for (unsigned p = 0;  p < producers.size();  ++p)
+        {
+            producers[p]->join();
+            delete producers[p];
+        }
+
+        aggregator.flush();
+        CHECK_EQUAL(aggregator.getPostedCount(), 4U * SpecimenProducer::COUNT);
+        CHECK_EQUAL(aggregator.getFailedCount(), 0U);
+    }
+    server.join();
+
+    CHECK_EQUAL(server.requests.size(), 10U);
+    for (unsigned i = 0;  i < server.requests.size();  ++i)
+    {
+        std::string id;
+        CHECK_EQUAL(countSpecimens(server.requests[i], id), 100U);
+    }
+
+}   //  end manyProducersForUploadAggregator
+
+TEST(memoryBudgetForUploadAggregator)
+{
+    std::cout << "UploadAggregator memoryBudgetForUploadAggregator" << '\n';
+
+    // Room for two specimens:  the third waits until the first two are
+    // posted, and so on
+
+    uint64_t size = UploadAggregator::estimateBytes(makeSpecimen(1));
+
+    FakeServer server(3);
+    server.addResponse(201, std::vector<uint8_t>(), "Connection: close\r\n");
+    server.start();
+
+    {
+        UploadAggregator aggregator(makeCreds(), "127.0.0.1",
+                                server.getPort(), 100, 1 << 20, 60000,
+                                                                    2 * size);
+
+        for (uint64_t k = 1;  k <= 5;  ++k)
+        {
+            CHECK(aggregator.add("S1", "/table/1", makeSpecimen(k)));
+            CHECK(aggregator.getPendingBytes() <= 2 * size);
+        }
+
+        aggregator.flush();
+        CHECK_EQUAL(aggregator.getPostedCount(), 5U);
+    }
+    server.join();
+
+    CHECK_EQUAL(server.requests.size(), 3U);
+
+    std::string id;
+    CHECK_EQUAL(countSpecimens(server.requests[0], id), 2U);
+    CHECK_EQUAL(countSpecimens(server.requests[1], id), 2U);
+    CHECK_EQUAL(countSpecimens(server.requests[2], id), 1U);
+
+}   //  end memoryBudgetForUploadAggregator
+
+TEST(failureForUploadAggregator)
+{
+    std::cout << "UploadAggregator failureForUploadAggregator" << '\n';
+
+    FakeServer server(1);
+    server.addResponse(500, std::vector<uint8_t>(), "Connection: close\r\n");
+    server.start();
+
+    {
+        UploadAggregator aggregator(makeCreds(), "127.0.0.1",
+                                                        server.getPort());
+
+        CHECK(aggregator.add("S1", "/table/1", makeSpecimen(1)));
+        CHECK(aggregator.add("S1", "/table/1", makeSpecimen(2)));
+        aggregator.flush();
+
+        CHECK_EQUAL(aggregator.getPostedCount(), 0U);
+        CHECK_EQUAL(aggregator.getFailedCount(), 2U);
+        CHECK_EQUAL(aggregator.getException().getStatusCode(), 500);
+        CHECK_EQUAL(aggregator.getPendingBytes(), 0U);
+    }
+    server.join();
+
+}   //  end failureForUploadAggregator
+
+// end UploadAggregatorTest.cpp
@@ -0,0 +1,88 @@
+// WorkStealingPoolTest.cpp  -  Test the WorkStealingPool class
+
+#include "UnitTest++.h"
+
+#include "WorkStealingPool.h"
+
+#include <iostream>
+#include <unistd.h>
+
+using namespace Yosokumo;
+
+// Counts the runs of each item, and notes the highest worker number seen.
+// Some items are slow, so the workers which own them fall behind and the
+// others must steal.
+
+class CountingTask : public IndexedTask
+{
+public:
+    std::vector<unsigned> runs;
+    Mutex                 mutex;
+    unsigned              maxWorker;
+
+    CountingTask(size_t count) : runs(count, 0), maxWorker(0)
+    {}
+
+    void runItem(unsigned worker, size_t index)
+    {
+        ++runs[index];
+
+        if (index < 8)
+            usleep(5000);
+
+        ScopedLock lock(mutex);
+        if (worker > maxWorker)
+            maxWorker = worker;
+    }
+};
+
+TEST(forEachForWorkStealingPool)
+{
+    std::cout << "WorkStealingPool forEachForWorkStealingPool" << '\n';
+
+    WorkStealingPool pool(4);
+    CHECK_EQUAL(pool.size(), 4U);
+
+    for (int pass = 0;  pass < 3;  ++pass)
+    {
+        CountingTask task(1000);
+        pool.forEach(task.runs.size(), task);
+
+        for (size_t i = 0;  i < task.runs.size();  ++i)
+            CHECK_EQUAL(task.runs[i], 1U);
+        CHECK(task.maxWorker < pool.size());
+    }
+
+    CountingTask none(0);
+    pool.forEach(0, none);
+
+    // Fewer items than workers
+
+    CountingTask few(2);
+    pool.forEach(few.runs.size(), few);
+    CHECK_EQUAL(few.runs[0], 1U);
+    CHECK_EQUAL(few.runs[1], 1U);
+
+}   //  end forEachForWorkStealingPool
+
+TEST(oneWorkerForWorkStealingPool)
+{
+    std::cout << "WorkStealingPool oneWorkerForWorkStealingPool" << '\n';
+
+    WorkStealingPool pool(1);
+    CHECK_EQUAL(pool.size(), 1U);
+
+    CountingTask task(100);
+    pool.forEach(task.runs.size(), task);
+
+    for (size_t i = 0;  i < task.runs.size();  ++i)
+        CHECK_EQUAL(task.runs[i], 1U);
+    CHECK_EQUAL(task.maxWorker, 0U);
+
+    CHECK(WorkStealingPool::getProcessorCount() >= 1);
+    CHECK_EQUAL(WorkStealingPool().size(),
+                                    WorkStealingPool::getProcessorCount());
+
+}   //  end oneWorkerForWorkStealingPool
+
+// end WorkStealingPoolTest.cpp
@@ -14,6 +14,7 @@
 #include "CellBlock.h"
 #include "PredictorBlock.h"
 #include "SpecimenBlock.h"
+#include "WorkStealingPool.h"
 
 #include <iostream>
 
@@ -124,6 +125,171 @@ TEST(blockMethodsForYosokumoProtobuf)
 }   //  end blockMethodsForYosokumoProtobuf
 
 
+TEST(cellBlockAndSplitBlockForYosokumoProtobuf)
+{
+    std::cout << "YosokumoProtobuf cellBlockAndSplitBlockForYosokumoProtobuf" << '\n';
+
+    YosokumoProtobuf gpb;
+
+    // A cell block is encoded as specimens, and so comes back as the same 
+    // cell block
+
+    CellBlock cblock("Cells");
+    for (unsigned i = 1;  i <= 100;  ++i)
+        cblock.addCell(Cell(i, RealValue(i * 1.5)));
+
+    std::vector<uint8_t> blockAsBytes;
+    CHECK(gpb.makeBytesFromBlock(cblock, blockAsBytes));
+
+    Block out_block;
+    CHECK(gpb.makeBlockFromBytes(blockAsBytes, out_block));
+    CHECK_EQUAL(out_block.getType(), Block::CELL);
+    CHECK_EQUAL(out_block.getItemCount(), 100UL);
+    CHECK(((CellBlock &)out_block).getCell(99) == cblock.getCell(99));
+
+    // No limit means one chunk
+
+    std::vector<uint64_t> starts;
+    CHECK(gpb.splitBlock(cblock, blockAsBytes.size(), starts));
+    CHECK_EQUAL(starts.size(), 1U);
+    CHECK_EQUAL(starts[0], 0UL);
+
+    // Every chunk respects the limit, and chunk sizes add up to the whole
+
+    size_t limit = blockAsBytes.size() / 7;
+    CHECK(gpb.splitBlock(cblock, limit, starts));
+    CHECK(starts.size() >= 7U);
+
+    size_t idBytes = 2 + cblock.getStudyIdentifier().size();
+    size_t total = 0;
+    for (unsigned i = 0;  i < starts.size();  ++i)
+    {
+        uint64_t end = (i + 1 < starts.size()) ? starts[i + 1] : 100;
+        CHECK(starts[i] < end);
+
+        Block chunk;
+        Block::copyBlockRange(chunk, cblock, starts[i], end);
+        std::vector<uint8_t> chunkAsBytes;
+        CHECK(gpb.makeBytesFromBlock(chunk, chunkAsBytes));
+        CHECK(chunkAsBytes.size() <= limit);
+        total += chunkAsBytes.size() - idBytes;
+    }
+    CHECK_EQUAL(total + idBytes, blockAsBytes.size());
+
+    // An item bigger than the limit gets a chunk of its own
+
+    CHECK(gpb.splitBlock(cblock, 1, starts));
+    CHECK_EQUAL(starts.size(), 100U);
+
+    // An empty block has one empty chunk
+
+    CHECK(gpb.splitBlock(EmptyBlock("x"), 1, starts));
+    CHECK_EQUAL(starts.size(), 1U);
+
+}   //  end cellBlockAndSplitBlockForYosokumoProtobuf
+
+TEST(parallelBlockDecodeForYosokumoProtobuf)
+{
+    std::cout << "YosokumoProtobuf parallelBlockDecodeForYosokumoProtobuf" << '\n';
+
+    YosokumoProtobuf gpb;
+    WorkStealingPool pool(4);
+
+    CellBlock cblock("Cells");
+    for (unsigned i = 1;  i <= 10000;  ++i)
+        cblock.addCell(Cell(i, (i % 3) ? Value(RealValue(i * 1.5)) :
+                                         Value(NaturalValue(i))));
+
+    std::vector<uint8_t> blockAsBytes;
+    CHECK(gpb.makeBytesFromBlock(cblock, blockAsBytes));
+
+    // The same block as the serial decoder gives
+
+    Block serial, parallel;
+    CHECK(gpb.makeBlockFromBytes(blockAsBytes, serial));
+    CHECK(gpb.makeBlockFromBytes(blockAsBytes, parallel, pool));
+    CHECK_EQUAL(parallel.getType(), Block::CELL);
+    CHECK_EQUAL(parallel.getStudyIdentifier(), "Cells");
+    CHECK_EQUAL(parallel.getItemCount(), 10000UL);
+    for (uint64_t i = 0;  i < 10000;  ++i)
+        CHECK(((CellBlock &)parallel).getCell(i) ==
+                                            ((CellBlock &)serial).getCell(i));
+
+    // A small block, and a predictor block, are decoded serially
+
+    CellBlock small("Small");
+    small.addCell(Cell(7, RealValue(0.5)));
+    CHECK(gpb.makeBytesFromBlock(small, blockAsBytes));
+    CHECK(gpb.makeBlockFromBytes(blockAsBytes, parallel, pool));
+    CHECK_EQUAL(parallel.getItemCount(), 1UL);
+
+    PredictorBlock pblock("Predictors");
+    pblock.addPredictor(Predictor(5));
+    CHECK(gpb.makeBytesFromBlock(pblock, blockAsBytes));
+    CHECK(gpb.makeBlockFromBytes(blockAsBytes, parallel, pool));
+    CHECK_EQUAL(parallel.getType(), Block::PREDICTOR);
+
+    // A bad specimen, and a truncated block, fail
+
+    CHECK(gpb.makeBytesFromBlock(cblock, blockAsBytes));
+    std::vector<uint8_t> bad = blockAsBytes;
+    bad[9] = 0x0F;                      // First byte of the first specimen
+    CHECK(!gpb.makeBlockFromBytes(bad, parallel, pool));
+    CHECK(gpb.isException());
+
+    bad.assign(blockAsBytes.begin(), blockAsBytes.end() - 1);
+    CHECK(!gpb.makeBlockFromBytes(bad, parallel, pool));
+
+}   //  end parallelBlockDecodeForYosokumoProtobuf
+
+TEST(parallelBlockEncodeForYosokumoProtobuf)
+{
+    std::cout << "YosokumoProtobuf parallelBlockEncodeForYosokumoProtobuf" << '\n';
+
+    YosokumoProtobuf gpb;
+    WorkStealingPool pool(3);
+
+    CellBlock cblock("Cells");
+    for (unsigned i = 1;  i <= 10000;  ++i)
+        cblock.addCell(Cell(i, RealValue(i * 0.25)));
+
+    std::vector<Specimen> specimens(5000);
+    SpecimenBlock sblock("Specimens");
+    for (unsigned i = 0;  i < specimens.size();  ++i)
+    {
+        specimens[i].setSpecimenKey(i + 1);
+        specimens[i].setPredictand(NaturalValue(i));
+        specimens[i].addCell(Cell(3, RealValue(i * 0.5)));
+        sblock.addSpecimen(&specimens[i]);
+    }
+
+    CellBlock small("Small");
+    small.addCell(Cell(7, RealValue(0.5)));
+
+    const Block *blocks[] = { &cblock, &sblock, &small };
+    size_t numSegments[] = { 13, 13, 1 };
+
+    // The segments joined are the serial encoding
+
+    for (unsigned b = 0;  b < 3;  ++b)
+    {
+        std::vector<uint8_t> serial;
+        CHECK(gpb.makeBytesFromBlock(*blocks[b], serial));
+
+        std::vector<std::vector<uint8_t> > segments;
+        CHECK(gpb.makeSegmentsFromBlock(*blocks[b], segments, pool));
+        CHECK_EQUAL(segments.size(), numSegments[b]);
+
+        std::vector<uint8_t> joined;
+        for (size_t i = 0;  i < segments.size();  ++i)
+            joined.insert(joined.end(), segments[i].begin(), 
+                                                        segments[i].end());
+        CHECK(joined == serial);
+    }
+
+}   //  end parallelBlockEncodeForYosokumoProtobuf
+
+
 TEST(catalogMethodsForYosokumoProtobuf)
 {
     std::cout << "YosokumoProtobuf catalogMethodsForYosokumoProtobuf" << '\n';
@@ -3,6 +3,10 @@
 #include "UnitTest++.h"
 
 #include "YosokumoRequest.h"
+#include "FakeServer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
 
 #include <iostream>
 
@@ -118,4 +122,358 @@ TEST(normalizeResourceUriForYosokumoRequest)
 
 }   //  end normalizeResourceUriForYosokumoRequest
 
+TEST(conditionalGetForYosokumoRequest)
+{
+    std::cout << "YosokumoRequest conditionalGetForYosokumoRequest" << '\n';
+
+    setupCredsEtc(creds, hostName, port, contentType);
+
+    std::vector<uint8_t> body(3, 'x');
+
+    FakeServer server(3);
+    server.addResponse(200, body, 
+                "ETag: \"abc\"\r\nLast-Modified: Mon, 19 Oct 2026 "
+                "10:00:00 GMT\r\n");
+    server.addResponse(304, std::vector<uint8_t>());
+    server.addResponse(200, std::vector<uint8_t>(1, 'y'));
+    server.start();
+
+    YosokumoRequest yr(creds, "127.0.0.1", server.getPort(), contentType);
+    CHECK(!yr.getConditionalGet());
+    yr.setConditionalGet(true);
+    CHECK(yr.getConditionalGet());
+
+    std::vector<uint8_t> entity;
+    CHECK(yr.getFromServer("/thing"));
+    CHECK(!yr.isNotModified());
+
+    // Not modified:  the entity is the one cached from the first response
+
+    CHECK(yr.getFromServer("/thing"));
+    CHECK(yr.isNotModified());
+    CHECK_EQUAL(yr.getStatusCode(), 304);
+    yr.getEntity(entity);
+    CHECK(entity == body);
+
+    // Turning conditional GET off drops the cache and the validators
+
+    yr.setConditionalGet(false);
+    CHECK(yr.getFromServer("/thing"));
+    CHECK(!yr.isNotModified());
+    yr.getEntity(entity);
+    CHECK_EQUAL(entity.size(), 1U);
+    server.join();
+
+    CHECK_EQUAL(server.connectionCount, 1);
+    CHECK(server.requests[1].find("If-None-Match: \"abc\"\r\n")
+                                                        != std::string::npos);
+    CHECK(server.requests[1].find("If-Modified-Since: Mon, 19 Oct 2026 "
+                                "10:00:00 GMT\r\n") != std::string::npos);
+    CHECK(server.requests[2].find("If-None-Match:") == std::string::npos);
+
+}   //  end conditionalGetForYosokumoRequest
+
+TEST(compressionForYosokumoRequest)
+{
+    std::cout << "YosokumoRequest compressionForYosokumoRequest" << '\n';
+
+    setupCredsEtc(creds, hostName, port, contentType);
+
+    std::vector<uint8_t> original(20000);
+    for (unsigned i = 0;  i < original.size();  ++i)
+        original[i] = uint8_t(i % 10);
+
+    std::vector<uint8_t> packed;
+    Compressor compressor(Compression::GZIP);
+    CHECK(compressor.compress(original, packed));
+
+    // The first response is gzip in two chunks; the second is plain
+
+    std::string half1(packed.begin(), packed.begin() + packed.size() / 2);
+    std::string half2(packed.begin() + packed.size() / 2, packed.end());
+    std::stringstream raw;
+    raw << "HTTP/1.1 200 OK\r\nContent-Encoding: gzip\r\n"
+        << "Transfer-Encoding: chunked\r\n\r\n"
+        << std::hex << half1.size() << "\r\n" << half1 << "\r\n"
+        << std::hex << half2.size() << "\r\n" << half2 << "\r\n0\r\n\r\n";
+
+    FakeServer server(2);
+    server.addRawResponse(raw.str());
+    server.addResponse(200, std::vector<uint8_t>(1, 'z'));
+    server.start();
+
+    YosokumoRequest yr(creds, "127.0.0.1", server.getPort(), contentType);
+    CHECK_EQUAL(yr.getCompression(), Compression::IDENTITY);
+    CHECK(yr.setCompression(Compression::GZIP, 1));
+    CHECK_EQUAL(yr.getCompression(), Compression::GZIP);
+
+    std::vector<uint8_t> entity;
+    CHECK(yr.postToServer("/thing", original));
+    yr.getEntity(entity);
+    CHECK(entity == original);
+
+    CHECK(yr.postToServer("/thing", original));
+    yr.getEntity(entity);
+    CHECK_EQUAL(entity.size(), 1U);
+    server.join();
+
+    // The request entity was sent compressed
+
+    std::string &r = server.requests[0];
+    CHECK(r.find("Content-Encoding: gzip\r\n") != std::string::npos);
+    CHECK(r.find("Accept-Encoding: gzip\r\n")  != std::string::npos);
+
+    std::string body = r.substr(r.find("\r\n\r\n") + 4);
+    CHECK(body.size() < original.size());
+
+    Decompressor decompressor;
+    CHECK(decompressor.start(Compression::GZIP));
+    entity.clear();
+    CHECK(decompressor.update((const uint8_t *)body.data(), body.size(), 
+                                                                    entity));
+    CHECK(decompressor.finish());
+    CHECK(entity == original);
+
+}   //  end compressionForYosokumoRequest
+
+TEST(unknownEncodingForYosokumoRequest)
+{
+    std::cout << "YosokumoRequest unknownEncodingForYosokumoRequest" << '\n';
+
+    setupCredsEtc(creds, hostName, port, contentType);
+
+    FakeServer server(1);
+    server.addResponse(200, std::vector<uint8_t>(5, 'q'), 
+                                            "Content-Encoding: br\r\n");
+    server.start();
+
+    YosokumoRequest yr(creds, "127.0.0.1", server.getPort(), contentType);
+    CHECK(!yr.getFromServer("/thing"));
+    CHECK(yr.isException());
+    server.join();
+
+}   //  end unknownEncodingForYosokumoRequest
+
+TEST(segmentedPostForYosokumoRequest)
+{
+    std::cout << "YosokumoRequest segmentedPostForYosokumoRequest" << '\n';
+
+    setupCredsEtc(creds, hostName, port, contentType);
+
+    // More segments than one sendmsg() call takes, some of them empty
+
+    std::vector<std::vector<uint8_t> > segments(3000);
+    std::string whole;
+    for (unsigned i = 0;  i < segments.size();  ++i)
+    {
+        segments[i].assign(i % 5, uint8_t('a' + i % 26));
+        whole.append(segments[i].begin(), segments[i].end());
+    }
+
+    FakeServer server(1);
+    server.addResponse(201, std::vector<uint8_t>());
+    server.start();
+
+    YosokumoRequest yr(creds, "127.0.0.1", server.getPort(), contentType);
+    CHECK(yr.postToServer("/thing", segments));
+    CHECK_EQUAL(yr.getStatusCode(), 201);
+    server.join();
+
+    std::stringstream len;
+    len << "Content-Length: " << whole.size() << "\r\n";
+
+    std::string &r = server.requests[0];
+    CHECK(r.find(len.str()) != std::string::npos);
+    CHECK(r.substr(r.find("\r\n\r\n") + 4) == whole);
+
+}   //  end segmentedPostForYosokumoRequest
+
+TEST(compressedFilePostForYosokumoRequest)
+{
+    std::cout << "YosokumoRequest compressedFilePostForYosokumoRequest" 
+                                                                    << '\n';
+
+    setupCredsEtc(creds, hostName, port, contentType);
+
+    // A range of a file longer than one piece read to be compressed
+
+    std::string path = "/tmp/YosokumoRequestTest.file";
+    FILE *f = fopen(path.c_str(), "w+b");
+    CHECK(f != NULL);
+
+    std::string whole;
+    for (unsigned i = 0;  i < 300000;  ++i)
+        whole += char('a' + i % 7 * i % 26);
+    fwrite(whole.data(), 1, whole.size(), f);
+    fflush(f);
+
+    FakeServer server(1);
+    server.addResponse(201, std::vector<uint8_t>());
+    server.start();
+
+    YosokumoRequest yr(creds, "127.0.0.1", server.getPort(), contentType);
+    CHECK(yr.setCompression(Compression::GZIP, 1));
+    CHECK(yr.postFileToServer("/thing", fileno(f), 100, whole.size() - 200));
+    CHECK_EQUAL(yr.getStatusCode(), 201);
+    server.join();
+    fclose(f);
+    remove(path.c_str());
+
+    std::string &r = server.requests[0];
+    std::string body = r.substr(r.find("\r\n\r\n") + 4);
+    CHECK(r.find("Content-Encoding: gzip\r\n") != std::string::npos);
+
+    Decompressor decompressor;
+    std::vector<uint8_t> entity;
+    CHECK(decompressor.start(Compression::GZIP));
+    CHECK(decompressor.update((const uint8_t *)body.data(), body.size(), 
+                                                                    entity));
+    CHECK(decompressor.finish());
+    CHECK(std::string(entity.begin(), entity.end()) == 
+                                        whole.substr(100, whole.size() - 200));
+
+}   //  end compressedFilePostForYosokumoRequest
+
+TEST(staleConnectionForYosokumoRequest)
+{
+    std::cout << "YosokumoRequest staleConnectionForYosokumoRequest" << '\n';
+
+    setupCredsEtc(creds, hostName, port, contentType);
+
+    // The server drops the reused connection after the second and the 
+    // fourth requests
+
+    FakeServer server(5);
+    server.addResponse(200, std::vector<uint8_t>(1, 'a'));
+    server.addRawResponse("");
+    server.addResponse(200, std::vector<uint8_t>(1, 'b'));
+    server.addRawResponse("");
+    server.addResponse(200, std::vector<uint8_t>(1, 'c'));
+    server.start();
+
+    YosokumoRequest yr(creds, "127.0.0.1", server.getPort(), contentType);
+    CHECK(yr.getFromServer("/thing"));
+
+    // A POST is not sent again, as the server may have acted on it
+
+    CHECK(!yr.postToServer("/thing", std::vector<uint8_t>(1, 'p')));
+    CHECK(yr.isException());
+
+    // A GET is sent again on a fresh connection
+
+    std::vector<uint8_t> entity;
+    CHECK(yr.getFromServer("/thing"));
+    CHECK(yr.getFromServer("/thing"));
+    yr.getEntity(entity);
+    CHECK_EQUAL(std::string(entity.begin(), entity.end()), "c");
+    server.join();
+
+    CHECK_EQUAL(server.requests.size(), 5U);
+    CHECK_EQUAL(server.connectionCount, 3);
+    CHECK(server.requests[1].find("POST ") == 0);
+    CHECK(server.requests[3].find("GET ") == 0);
+    CHECK(server.requests[4].find("GET ") == 0);
+
+}   //  end staleConnectionForYosokumoRequest
+
+TEST(malformedChunkForYosokumoRequest)
+{
+    std::cout << "YosokumoRequest malformedChunkForYosokumoRequest" << '\n';
+
+    setupCredsEtc(creds, hostName, port, contentType);
+
+    // A size line which is not hex is an error, not the last chunk
+
+    FakeServer server(2);
+    server.addRawResponse("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n"
+                "\r\n3;name=value\r\nabc\r\nxyz\r\ndef\r\n0\r\n\r\n");
+    server.addRawResponse("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n"
+                "\r\n3\r\nabc\r\n0\r\n\r\n");
+    server.start();
+
+    YosokumoRequest yr(creds, "127.0.0.1", server.getPort(), contentType);
+    CHECK(!yr.getFromServer("/thing"));
+    CHECK(yr.isException());
+
+    std::vector<uint8_t> entity;
+    CHECK(yr.getFromServer("/thing"));
+    yr.getEntity(entity);
+    CHECK_EQUAL(std::string(entity.begin(), entity.end()), "abc");
+    server.join();
+
+}   //  end malformedChunkForYosokumoRequest
+
+TEST(largeEntityForYosokumoRequest)
+{
+    std::cout << "YosokumoRequest largeEntityForYosokumoRequest" << '\n';
+
+    setupCredsEtc(creds, hostName, port, contentType);
+
+    // Entities many times the size of a read, which arrive in many pieces
+
+    std::vector<uint8_t> original(300000);
+    srand(4321);
+    for (unsigned i = 0;  i < original.size();  ++i)
+        original[i] = uint8_t(rand() % 16);
+
+    std::vector<uint8_t> packed;
+    Compressor compressor(Compression::GZIP);
+    CHECK(compressor.compress(original, packed));
+
+    std::string whole(original.begin(), original.end());
+    std::stringstream chunked;
+    chunked << "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+            << std::hex << whole.size() << "\r\n" << whole << "\r\n0\r\n\r\n";
+
+    FakeServer server(3);
+    server.addResponse(200, packed, "Content-Encoding: gzip\r\n");
+    server.addRawResponse(chunked.str());
+    server.addRawResponse("HTTP/1.1 200 OK\r\nConnection: close\r\n\r\n" + 
+                                                                        whole);
+    server.start();
+
+    YosokumoRequest yr(creds, "127.0.0.1", server.getPort(), contentType);
+
+    for (int i = 0;  i < 3;  ++i)
+    {
+        std::vector<uint8_t> entity;
+        CHECK(yr.getFromServer("/thing"));
+        yr.getEntity(entity);
+        CHECK(entity == original);
+    }
+    server.join();
+
+}   //  end largeEntityForYosokumoRequest
+
+TEST(malformedContentLengthForYosokumoRequest)
+{
+    std::cout << "YosokumoRequest malformedContentLengthForYosokumoRequest" 
+                                                                    << '\n';
+
+    setupCredsEtc(creds, hostName, port, contentType);
+
+    // A Content-Length which is not a decimal number is an error
+
+    FakeServer server(4);
+    server.addRawResponse("HTTP/1.1 200 OK\r\nContent-Length: abc\r\n\r\n");
+    server.addRawResponse("HTTP/1.1 200 OK\r\nContent-Length: 3x\r\n\r\nabc");
+    server.addRawResponse("HTTP/1.1 200 OK\r\nContent-Length: -3\r\n\r\nabc");
+    server.addRawResponse("HTTP/1.1 200 OK\r\nContent-Length: 3\r\n\r\nabc");
+    server.start();
+
+    YosokumoRequest yr(creds, "127.0.0.1", server.getPort(), contentType);
+    for (int i = 0;  i < 3;  ++i)
+    {
+        CHECK(!yr.getFromServer("/thing"));
+        CHECK(yr.isException());
+    }
+
+    std::vector<uint8_t> entity;
+    CHECK(yr.getFromServer("/thing"));
+    yr.getEntity(entity);
+    CHECK_EQUAL(std::string(entity.begin(), entity.end()), "abc");
+    server.join();
+
+}   //  end malformedContentLengthForYosokumoRequest
+
 // end YosokumoRequestTest.cpp